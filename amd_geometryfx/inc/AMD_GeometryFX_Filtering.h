@@ -23,11 +23,19 @@
 #ifndef AMD_GEOMETRYFX_FILTERING_H
 #define AMD_GEOMETRYFX_FILTERING_H
 
+#ifdef _WIN32
 // VS2010 has a bug in the headers, where they collide on #defines
 // include <intsafe.h> here to get rid of them
 #include <intsafe.h>
-#include <DirectXMath.h>
 #include <d3d11.h>
+#else
+// The filter itself needs D3D11, but the CPU side of the library, which the
+// tests build on any platform, only needs the types to be declared
+struct ID3D11Buffer;
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+#endif
+#include <DirectXMath.h>
 #include <vector>
 
 #include "AMD_GeometryFX.h"
@@ -41,27 +49,171 @@ enum GEOMETRYFX_FILTER
     GeometryFX_FilterBackface = 0x2,
     GeometryFX_FilterFrustum = 0x8,
     GeometryFX_FilterSmallPrimitives = 0x20,
-    GeometryFX_ClusterFilterBackface = 0x1 << 10
+    GeometryFX_ClusterFilterBackface = 0x1 << 10,
+    GeometryFX_ClusterFilterOcclusion = 0x1 << 11
+};
+
+/**
+Describes the world matrices passed to GeometryFX_Filter::RenderMeshInstanced.
+
+The filter needs the eye position in object space for every instance. For
+rigid transforms, this is computed from the world matrix directly instead of
+inverting it.
+*/
+enum GEOMETRYFX_WORLD_TRANSFORM
+{
+    // Any affine transform; the world matrix is inverted
+    GeometryFX_WorldTransformGeneral,
+    // Rotation, translation and scale, where the rows of the upper 3x3 part
+    // are mutually orthogonal. Uniform scale is always fine, non-uniform
+    // scale only if it is applied before the rotation.
+    GeometryFX_WorldTransformRigid
+};
+
+// Maximum number of views of GeometryFX_Filter::BeginRenderMultiView
+const int GeometryFX_FilterMaximumViewCount = 8;
+
+// Number of passes whose statistics GeometryFX_Filter::GetStatistics keeps
+const int GeometryFX_FilterStatisticsPassCount = 16;
+
+/**
+One view of a multi-view render pass, for example a shadow cascade or a cube
+map face. The viewport is in pixels of the bound render target.
+*/
+struct GeometryFX_FilterView
+{
+    DirectX::XMMATRIX view;
+    DirectX::XMMATRIX projection;
+    int viewportX;
+    int viewportY;
+    int viewportWidth;
+    int viewportHeight;
 };
 
 struct GeometryFX_FilterStatistics
 {
     inline GeometryFX_FilterStatistics()
-        : trianglesProcessed(0)
+        : passIndex(0)
+        , trianglesProcessed(0)
         , trianglesRendered(0)
         , trianglesCulled(0)
         , clustersProcessed (0)
         , clustersRendered (0)
         , clustersCulled (0)
+        , clustersFrustumCulled (0)
+        , clustersBackfaceCulled (0)
+        , clustersOcclusionCulled (0)
+        , instancesCulled (0)
+        , instancesFrustumRejected (0)
+        , instancesDistanceRejected (0)
+        , instancesSizeRejected (0)
+        , occluderTrianglesRasterized (0)
+        , batchesProcessed (0)
+        , batchThreadsProcessed (0)
+        , filterDispatchCount (0)
+        , smallBatchChunkCount (0)
+        , smallBatchChunkHighWaterMark (0)
+        , uploadMapCount (0)
+        , uploadBytes (0)
     {
     }
 
+    // Index of the render pass these statistics belong to, see
+    // GeometryFX_Filter::GetStatistics()
+    int64 passIndex;
+
     int64 trianglesProcessed;
+
+    // Measured on the GPU. These are only filled in by
+    // GeometryFX_Filter::GetStatistics(), the statistics written during
+    // the pass have them set to 0.
     int64 trianglesRendered;
     int64 trianglesCulled;
+
+    // Counted on the CPU while the draws are packed in
+    // GeometryFX_Filter::EndRender().
     int64 clustersProcessed;
     int64 clustersRendered;
     int64 clustersCulled;
+
+    // Breakdown of clustersCulled. Each cluster is counted for the first
+    // test which rejects it, in the order frustum, backface, occlusion.
+    int64 clustersFrustumCulled;
+    int64 clustersBackfaceCulled;
+    int64 clustersOcclusionCulled;
+
+    // Draws rejected as a whole by the bounds of their mesh, before any of
+    // their clusters is tested. Their clusters are included above.
+    int64 instancesCulled;
+
+    // Instances rejected by their bounding sphere in RenderMeshInstanced,
+    // before a draw is recorded for them. These are not included in any of
+    // the counters above.
+    int64 instancesFrustumRejected;
+    int64 instancesDistanceRejected;
+    int64 instancesSizeRejected;
+
+    // Triangles rasterized into the occlusion buffer, from occluders and
+    // from the clusters visible in the previous frame
+    int64 occluderTrianglesRasterized;
+
+    // Small batches dispatched to the filter, and the number of filter
+    // threads they run on. trianglesProcessed / batchThreadsProcessed is the
+    // fraction of threads which have a triangle to work on.
+    int64 batchesProcessed;
+    int64 batchThreadsProcessed;
+
+    // Filter dispatches. Each is followed by the draws of its batches.
+    int64 filterDispatchCount;
+
+    // Buffers for filter dispatches allocated after the last pass, and the
+    // most that were allocated at once. They are created when all others are
+    // still in use by the GPU and released after staying idle for a while.
+    // Each takes up to 12 * 256 bytes per batch of a dispatch.
+    int64 smallBatchChunkCount;
+    int64 smallBatchChunkHighWaterMark;
+
+    // Maps of the upload buffers for the small batches and draws, and the
+    // bytes written to them. All chunks of a pass are uploaded with one map
+    // per buffer.
+    int64 uploadMapCount;
+    int64 uploadBytes;
+};
+
+struct GeometryFX_ClusterStatistics
+{
+    inline GeometryFX_ClusterStatistics()
+        : clusterCount(0)
+        , validConeCount(0)
+        , meanConeAngle(0)
+        , loadedFromCache(false)
+        , vertexCacheMissRatio(0)
+        , vertexTransformRatio(0)
+        , lodClusterCount(0)
+    {
+    }
+
+    // Clusters of the full detail mesh. The cone statistics below refer to
+    // these only.
+    int32 clusterCount;
+
+    // Number of clusters with a normal cone usable for cluster backface
+    // culling
+    int32 validConeCount;
+
+    // Mean half-angle of all valid normal cones, in degrees
+    float meanConeAngle;
+
+    // Set if the clusters were read from the cluster cache
+    bool loadedFromCache;
+
+    // Vertex shader invocations per triangle (ACMR) and per unique vertex
+    // (ATVR) of the index buffer, simulated on a 16 entry FIFO cache
+    float vertexCacheMissRatio;
+    float vertexTransformRatio;
+
+    // Clusters of the simplified levels, if buildClusterLod was set
+    int32 lodClusterCount;
 };
 
 struct GeometryFX_FilterRenderOptions
@@ -70,6 +222,12 @@ struct GeometryFX_FilterRenderOptions
         : enableFiltering(true)
         , enabledFilters(0xFF)
         , statistics(nullptr)
+        , lodErrorThreshold(0)
+        , maximumDrawDistance(0)
+        , minimumProjectedSize(0)
+        , temporalOccluderTriangleBudget(32768)
+        , sortDrawsByMesh(false)
+        , mergeClusterBatches(false)
     {
     }
 
@@ -86,10 +244,58 @@ struct GeometryFX_FilterRenderOptions
     /**
     If set, statistics counters will be enabled.
 
-    If enabled, queries will be issued along with each draw call significantly
-    reducing performance.
+    The counters computed on the CPU are written here by EndRender(). The
+    triangles rendered and culled are measured with a query per small batch
+    chunk, which is read back without waiting for the GPU; use
+    GeometryFX_Filter::GetStatistics() with the passIndex written here to get
+    the complete statistics a few frames later.
     */
     GeometryFX_FilterStatistics *statistics;
+
+    /**
+    Largest allowed simplification error in pixels, for meshes built with
+    buildClusterLod. Each instance draws the coarsest clusters whose error,
+    projected to the screen, stays at or below this. If set to 0, the full
+    detail mesh is drawn.
+    */
+    float lodErrorThreshold;
+
+    /**
+    Instances whose bounding sphere is farther away from the eye than this
+    are not drawn. If set to 0, there is no limit.
+    */
+    float maximumDrawDistance;
+
+    /**
+    Instances whose bounding sphere covers fewer pixels in diameter than
+    this are not drawn. If set to 0, no instance is rejected by its size.
+    */
+    float minimumProjectedSize;
+
+    /**
+    Most triangles rasterized into the occlusion buffer per frame from the
+    clusters visible in the previous frame, see
+    GeometryFX_FilterDesc::temporalOcclusion. Draws are visited in the order
+    they were recorded, so recording near draws first makes the best use of
+    the budget.
+    */
+    int temporalOccluderTriangleBudget;
+
+    /**
+    Reorder the draws before they are packed into small batches, so that all
+    instances of a mesh are next to each other. The order of the instances
+    of one mesh is kept. This improves the cache hit rate of the filter when
+    many meshes are interleaved.
+    */
+    bool sortDrawsByMesh;
+
+    /**
+    Let consecutive visible clusters of one draw share a small batch as long
+    as they fit, instead of giving every cluster its own batch. This keeps
+    more filter threads busy for meshes made of small clusters, see
+    GeometryFX_FilterStatistics::batchThreadsProcessed.
+    */
+    bool mergeClusterBatches;
 };
 
 struct GeometryFX_FilterDesc
@@ -98,6 +304,19 @@ struct GeometryFX_FilterDesc
         : pDevice(nullptr)
         , maximumDrawCallCount(-1)
         , emulateMultiIndirectDraw(false)
+        , buildSpatialClusters(false)
+        , maximumVerticesPerCluster(256)
+        , minimalNormalCones(false)
+        , optimizeVertexCache(false)
+        , buildClusterLod(false)
+        , clusterCacheDirectory(nullptr)
+        , workerThreadCount(0)
+        , occlusionBufferWidth(0)
+        , occlusionBufferHeight(0)
+        , temporalOcclusion(false)
+        , smallBatchCount(384)
+        , singleDispatchFiltering(false)
+        , singleDispatchMemoryLimit(64 * 1024 * 1024)
     {
     }
 
@@ -110,6 +329,81 @@ struct GeometryFX_FilterDesc
 
     // Emulate indirect draw. If the extension is present, it will be not used.
     bool emulateMultiIndirectDraw;
+
+    // Group triangles into clusters by adjacency and spatial proximity
+    // instead of splitting each mesh into runs of consecutive triangles.
+    // This produces tighter bounds and normal cones, but reorders the
+    // triangles of each mesh in the index buffer.
+    bool buildSpatialClusters;
+
+    // Upper bound for the number of unique vertices in a cluster. Only used
+    // if buildSpatialClusters is set.
+    int maximumVerticesPerCluster;
+
+    // Use the smallest cone containing all triangle normals of a cluster for
+    // backface culling, instead of a cone around the average normal. This
+    // makes more clusters cullable at a higher cluster build cost.
+    bool minimalNormalCones;
+
+    // Reorder the triangles inside each cluster for post-transform vertex
+    // cache locality. Cluster membership does not change.
+    bool optimizeVertexCache;
+
+    // Build simplified levels of every mesh on top of its clusters, so
+    // distant instances can draw fewer triangles. See
+    // GeometryFX_FilterRenderOptions::lodErrorThreshold. This takes up to
+    // twice the index buffer memory.
+    bool buildClusterLod;
+
+    // If set, the clusters built by SetMeshData are cached in this directory,
+    // keyed by a hash of the mesh data and the cluster options. The directory
+    // must exist. Cache files are tied to the library version and are
+    // rebuilt automatically after an update.
+    const char *clusterCacheDirectory;
+
+    // Number of threads used for CPU-side work like building clusters,
+    // including the calling thread. If set to 0, one thread per hardware
+    // thread is used. If set to 1, no worker threads are created.
+    int workerThreadCount;
+
+    // Size of the depth buffer rasterized on the CPU from the meshes tagged
+    // with SetMeshOccluder(). Clusters hidden behind these occluders are
+    // rejected before they are sent to the GPU, if
+    // GeometryFX_ClusterFilterOcclusion is enabled. If either is 0, no
+    // occlusion buffer is created.
+    int occlusionBufferWidth;
+    int occlusionBufferHeight;
+
+    // Use the clusters drawn in the previous frame as occluders, in addition
+    // to the meshes tagged with SetMeshOccluder(). Only the choice of
+    // occluders depends on the previous frame, so nothing is hidden wrongly
+    // if the view or the draws change. Requires the occlusion buffer. Every
+    // mesh keeps a copy of its vertices and indices in system memory.
+    bool temporalOcclusion;
+
+    // Number of small batches filtered in one dispatch, which is also the
+    // maximum number of draws per dispatch. A small batch holds up to 256
+    // triangles, the thread group size of the filter shader, and takes
+    // 12 * 256 bytes of filtered index buffer.
+    int smallBatchCount;
+
+    // Filter all small batches of a view with a single dispatch into one
+    // filtered index buffer, followed by one multi draw, instead of one
+    // dispatch and draw per smallBatchCount batches. This avoids switching
+    // between compute and drawing on the GPU. The buffers grow with the
+    // batches of the largest view, up to singleDispatchMemoryLimit bytes;
+    // views with more batches are split into several dispatches.
+    bool singleDispatchFiltering;
+
+    // Memory limit in bytes of the buffers of one filter dispatch, not of the
+    // library. Each dispatch of a pass, at least one per view, has its own
+    // buffers, which are only reused once the GPU is done with them. With N
+    // dispatches per pass and the GPU F passes behind, up to about
+    // N * (F + 1) times this much is allocated.
+    // GeometryFX_FilterStatistics::smallBatchChunkHighWaterMark reports the
+    // most dispatch buffers allocated at once. Idle buffers are released
+    // again, see GeometryFX_FilterStatistics::smallBatchChunkCount.
+    int singleDispatchMemoryLimit;
 };
 
 /**
@@ -145,6 +439,33 @@ class AMD_GEOMETRYFX_DLL_API GeometryFX_Filter
     */
     void SetMeshData(const MeshHandle &handle, const void *pVertexData, const void *pIndexData);
 
+    /**
+    Set the data for several meshes at once.
+
+    The clusters of the meshes are built on worker threads, the data is
+    uploaded on the calling thread. The result is the same as calling
+    SetMeshData() for each mesh in turn.
+
+    RegisterMeshes() must have been called previously.
+
+    @note This function may call functions on the ID3D11Device and the
+        immediate context.
+    */
+    void SetMeshData(const int meshCount, const MeshHandle *pHandles,
+        const void *const *ppVertexData, const void *const *ppIndexData);
+
+    /**
+    Tag a mesh as occluder. Every instance of an occluder is rasterized into
+    the occlusion buffer in EndRender(), before any cluster is tested. Good
+    occluders are large and have few triangles, like walls or terrain.
+
+    A copy of the vertices and indices of each occluder is kept in system
+    memory. This must be called before SetMeshData() for the mesh, and has
+    no effect if GeometryFX_FilterDesc::occlusionBufferWidth or
+    occlusionBufferHeight is 0.
+    */
+    void SetMeshOccluder(const MeshHandle &handle, const bool isOccluder);
+
     /**
     Start a render pass.
 
@@ -154,6 +475,10 @@ class AMD_GEOMETRYFX_DLL_API GeometryFX_Filter
     @note If the multi-indirect-draw extension is present, the context must be
     equal to the immediate context.
 
+    @note The context may be deferred otherwise. The library still reads its
+    GPU queries on the immediate context during the pass and in EndRender(),
+    so these calls must not overlap with other uses of the immediate context.
+
     @note A render pass will change the D3D device state. In particular, the
         following states will be changed:
 
@@ -166,6 +491,26 @@ class AMD_GEOMETRYFX_DLL_API GeometryFX_Filter
         const DirectX::XMMATRIX &view, const DirectX::XMMATRIX &projection,
         const int renderTargetWidth, const int renderTargetHeight);
 
+    /**
+    Start a render pass over several views.
+
+    Every mesh rendered in this pass is drawn into each view which can see
+    it, each view into its own viewport. This renders all shadow cascades or
+    cube map faces of an atlas in one pass: each instance is recorded once,
+    and the work which does not depend on the view, like the level of detail
+    selection, is done once for all views.
+
+    The level of detail and occlusion culling use the first view only, the
+    other views are not occlusion culled. The statistics are summed over all
+    views. viewCount must be between 1 and GeometryFX_FilterMaximumViewCount.
+
+    @note In addition to the state listed for BeginRender(), EndRender() will
+        change the viewports.
+    */
+    void BeginRenderMultiView(ID3D11DeviceContext *pContext,
+        const GeometryFX_FilterRenderOptions &options, const int viewCount,
+        const GeometryFX_FilterView *pViews);
+
     /**
     Render a mesh.
 
@@ -183,6 +528,24 @@ class AMD_GEOMETRYFX_DLL_API GeometryFX_Filter
     void RenderMeshInstanced(
         const MeshHandle &handle, const int instanceCount, const DirectX::XMMATRIX *pWorldMatrices);
 
+    /**
+    Render a mesh with instancing, specifying the kind of world transform.
+
+    Same as above, but GeometryFX_WorldTransformRigid allows the filter to
+    skip the world matrix inversion per instance.
+    */
+    void RenderMeshInstanced(const MeshHandle &handle, const int instanceCount,
+        const DirectX::XMMATRIX *pWorldMatrices, const GEOMETRYFX_WORLD_TRANSFORM transform);
+
+    /**
+    Render a mesh with instancing, using precomputed inverse world matrices.
+
+    pInverseWorldMatrices must contain one inverse per world matrix. This is
+    useful if the application already keeps the inverse around.
+    */
+    void RenderMeshInstanced(const MeshHandle &handle, const int instanceCount,
+        const DirectX::XMMATRIX *pWorldMatrices, const DirectX::XMMATRIX *pInverseWorldMatrices);
+
     /**
     End a render pass.
 
@@ -206,6 +569,36 @@ class AMD_GEOMETRYFX_DLL_API GeometryFX_Filter
     */
     void GetMeshInfo(const MeshHandle &handle, int32 *pIndexCount) const;
 
+    /**
+    Get the small batch size and count in use. The size is the thread group
+    size of the filter shader, the count is GeometryFX_FilterDesc::
+    smallBatchCount clamped to the supported range.
+
+    If a parameter is set to null, it won't be written.
+    */
+    void GetSmallBatchInfo(int32 *pSmallBatchSize, int32 *pSmallBatchCount) const;
+
+    /**
+    Get the complete statistics of an earlier render pass, including the
+    counters measured on the GPU.
+
+    passIndex is the index GeometryFX_FilterRenderOptions::statistics was
+    set to in that pass. Returns false if the GPU is not done with the pass
+    yet, typically until the frame has been presented, or if more than
+    GeometryFX_FilterStatisticsPassCount passes with statistics were
+    rendered since. This must not be called between BeginRender() and
+    EndRender(), as it reads the queries on the immediate context.
+    */
+    bool GetStatistics(const int64 passIndex, GeometryFX_FilterStatistics *pStatistics);
+
+    /**
+    Get statistics about the clusters of a mesh.
+
+    SetMeshData() must have been called for this mesh.
+    */
+    void GetClusterStatistics(const MeshHandle &handle,
+        GeometryFX_ClusterStatistics *pStatistics) const;
+
   private:
     // Disable the copy constructor
     GeometryFX_Filter(const GeometryFX_Filter &);
@@ -30,14 +30,24 @@
 // ComPtr
 #include <wrl.h>
 
+#include <climits>
+#include <deque>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <numeric>
 #include <algorithm>
 
+#include "GeometryFXChunkPool.h"
 #include "GeometryFXMesh.h"
 #include "GeometryFXMeshManager.h"
+#include "GeometryFXClusterBuilder.h"
+#include "GeometryFXClusterVisibility.h"
+#include "GeometryFXInstanceCulling.h"
+#include "GeometryFXOcclusionBuffer.h"
+#include "GeometryFXReferenceFilter.h"
+#include "GeometryFXSmallBatchPacking.h"
+#include "GeometryFXWorkerPool.h"
 
 #include "amd_ags.h"
 
@@ -59,233 +69,116 @@ using namespace GeometryFX_Internal;
 namespace
 {
 
-struct FilterContext
-{
-    const GeometryFX_FilterRenderOptions *options;
-    XMMATRIX view;
-    XMMATRIX projection;
-    XMVECTOR eye;
-    int windowWidth;
-    int windowHeight;
-};
-
-#pragma pack(push, 1)
-struct FrameConstantBuffer
-{
-    XMMATRIX view;
-    XMMATRIX projection;
-    uint32 cullFlags;
-    uint32 width, height;
-};
-
-struct DrawCallArguments
-{
-    XMMATRIX world;
-    XMMATRIX worldView;
-    uint32 meshIndex;
-    uint32 pad[3];
-};
-
-struct IndirectArguments
-{
-    /**
-    Static function to ensure IndirectArguments remains a POD
-    */
-    static void Init (IndirectArguments &ia)
-    {
-        ia.IndexCountPerInstance = 0;
-        ia.InstanceCount = 1;
-        ia.StartIndexLocation = 0;
-        ia.BaseVertexLocation = 0;
-        ia.StartInstanceLocation = 0;
-    }
-
-    uint32 IndexCountPerInstance;
-    uint32 InstanceCount;
-    uint32 StartIndexLocation;
-    int32 BaseVertexLocation;
-    uint32 StartInstanceLocation;
-};
-
-struct SmallBatchData
-{
-    uint32 meshIndex;         // Index into meshConstants
-    uint32 indexOffset;       // Index relative to the meshConstants[meshIndex].indexOffset
-    uint32 faceCount;         // Number of faces in this small batch
-    uint32 outputIndexOffset; // Offset into the output index buffer
-    uint32 drawIndex;         // Index into the SmallBatchDrawCallTable
-    uint32 drawBatchStart;    // First slot for the current draw call
-};
-#pragma pack(pop)
-
-struct DrawCommand
-{
-    inline DrawCommand ()
-        : mesh (nullptr)
-        , drawCallId (-1)
-        , firstTriangle (0)
-    {
-    }
-
-    DrawCallArguments dcb;
-    GeometryFX_Internal::StaticMesh *mesh;
-    int drawCallId;
-    int firstTriangle;
-};
-
 /**
-One small batch chunk can accept multiple draw requests. Draw requests are
-split into small batches of TRIANGLES_PER_SMALL_BATCH each. A draw request always
-occupies consecutive slots. A draw request may be split if it does not fit
-entirely into this small batch.
-
-The filter then processes all small batches in this chunk in one go, and renders
-them by using one indirect draw call per original draw request.
+The GPU side of a filter dispatch. The small batches are packed on the CPU
+into SmallBatchChunkData, and the batches and draws of one or more of them
+are written to the segments of the upload rings. They are filtered into the
+filtered index buffer here and drawn from it. The buffers grow on demand up
+to maximumBatchCount batches of batchSize triangles.
 */
 class SmallBatchChunk
 {
 public:
-    SmallBatchChunk (ID3D11Device *device, bool emulateMultiDraw, AGSContext* agsContext)
-        : smallBatchDataBackingStore_ (SmallBatchMergeConstants::BATCH_COUNT)
-        , drawCallBackingStore_ (SmallBatchMergeConstants::BATCH_COUNT)
+    SmallBatchChunk (ID3D11Device *device, bool emulateMultiDraw, AGSContext* agsContext,
+        const int batchSize, const int maximumBatchCount)
+        : device_ (device)
+        , batchSize_ (batchSize)
+        , batchCount_ (0)
+        , maximumBatchCount_ (maximumBatchCount)
         , agsContext_ (agsContext)
-        , currentBatchCount_ (0)
-        , currentDrawCallCount_ (0)
-        , faceCount_ (0)
         , useMultiIndirectDraw_ (!emulateMultiDraw)
+        , pending_ (false)
+        , drawPending_ (false)
     {
-        CreateFilteredIndexBuffer (device);
-        CreateSmallBatchDataBuffer (device);
-        CreateIndirectDrawArgumentsBuffer (device);
-        CreateDrawCallArgumentsBuffer (device);
-
-        CreateInstanceIdBuffer (device);
+        device->GetImmediateContext (&immediateContext_);
+        CreateCompletionQuery (device);
     }
 
     /**
-    If true is returned, then remainder has been filled and must be
-    re-submitted. Otherwise, the whole request has been handled by this small
-    batch.
+    Check whether the GPU is done with the last Draw() of this chunk. Draw()
+    may record to a deferred context, whose query only completes once the
+    command list was executed, so the query is always read on the immediate
+    context. It is polled without flushing, the commands are flushed at the
+    latest when the frame is presented.
     */
-    bool AddRequest (const DrawCommand &request, DrawCommand &remainder,
-        FilterContext &filterContext)
+    bool IsIdle ()
     {
-        if (currentDrawCallCount_ == SmallBatchMergeConstants::BATCH_COUNT)
+        if (pending_ && !drawPending_ && immediateContext_->GetData (completionQuery_.Get (),
+            nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK)
         {
-            remainder = request;
-            return true;
+            pending_ = false;
         }
-        
-        assert (request.firstTriangle >= 0);
-
-        int firstTriangle = request.firstTriangle;
-        const int firstCluster = firstTriangle / SmallBatchMergeConstants::BATCH_SIZE;
-        int currentCluster = firstCluster;
-        int lastTriangle = firstTriangle;
-
-        const int filteredIndexBufferStartOffset =
-            currentBatchCount_ * SmallBatchMergeConstants::BATCH_SIZE * 3 * sizeof (int);
-
-        const int firstBatch = currentBatchCount_;
-
-        // We move the eye position into object space, so we don't have to
-        // transform the cone into world space all the time
-        // This matrix inversion will happen once every 2^16 triangles on
-        // average; and saves us transforming the cone every 256 triangles
-        const auto eye = DirectX::XMVector4Transform (filterContext.eye, XMMatrixInverse (nullptr, request.dcb.world));
-        
-        // Try to assign batches until we run out of batches or geometry
-        for (int i = currentBatchCount_; i < SmallBatchMergeConstants::BATCH_COUNT; ++i)
-        {
-            lastTriangle = std::min (
-                firstTriangle + SmallBatchMergeConstants::BATCH_SIZE, request.mesh->faceCount);
 
-            assert (currentCluster < static_cast<int>(request.mesh->clusters.size ()));
-            const auto& clusterInfo = request.mesh->clusters[currentCluster];
-            ++currentCluster;
+        return !pending_;
+    }
 
-            bool cullCluster = false;
+    /**
+    Make sure the buffers hold batchCount batches. They are grown to the next
+    power of two, so a growing scene doesn't recreate them every frame.
+    */
+    void Reserve (const int batchCount)
+    {
+        assert (batchCount <= maximumBatchCount_);
 
-            if (((filterContext.options->enabledFilters & GeometryFX_ClusterFilterBackface) != 0) && clusterInfo.valid)
-            {
-                const auto testVec = DirectX::XMVector3Normalize (DirectX::XMVectorSubtract (eye, clusterInfo.coneCenter));
-                // Check if we're inside the cone
-                if (DirectX::XMVectorGetX (DirectX::XMVector3Dot (testVec, clusterInfo.coneAxis)) > clusterInfo.coneAngleCosine)
-                {
-                    cullCluster = true;
-                }
-            }
+        if (batchCount <= batchCount_)
+        {
+            return;
+        }
 
-            if (!cullCluster)
-            {
-                auto &smallBatchData = smallBatchDataBackingStore_[currentBatchCount_];
+        batchCount_ = SmallBatchMergeConstants::MINIMUM_BATCH_COUNT;
 
-                smallBatchData.drawIndex = currentDrawCallCount_;
-                smallBatchData.faceCount = lastTriangle - firstTriangle;
+        while (batchCount_ < batchCount)
+        {
+            batchCount_ *= 2;
+        }
 
-                // Offset relative to the start of the mesh
-                smallBatchData.indexOffset = firstTriangle * 3 * sizeof (int);
-                smallBatchData.outputIndexOffset = filteredIndexBufferStartOffset;
-                smallBatchData.meshIndex = request.dcb.meshIndex;
-                smallBatchData.drawBatchStart = firstBatch;
+        batchCount_ = std::min (batchCount_, maximumBatchCount_);
 
-                faceCount_ += smallBatchData.faceCount;
+        CreateFilteredIndexBuffer (device_);
+        CreateIndirectDrawArgumentsBuffer (device_);
+        CreateInstanceIdBuffer (device_);
+    }
 
-                ++currentBatchCount_;
-            }
+    /**
+    Filter the batches into the filtered index buffer. The chunk must not be
+    reused before Draw() was called.
+    */
+    void Filter (ID3D11DeviceContext *context, const int batchCount, const int drawCallCount,
+        ID3D11ShaderResourceView *smallBatchDataSRV, ID3D11ShaderResourceView *drawCallSRV,
+        ID3D11ComputeShader *computeClearShader, ID3D11ComputeShader *filterShader,
+        ID3D11ShaderResourceView *vertexData, ID3D11ShaderResourceView *indexData,
+        ID3D11ShaderResourceView *meshConstantData, ID3D11Buffer *perFrameConstantBuffer)
+    {
+        assert (batchCount <= batchCount_);
 
-            firstTriangle += SmallBatchMergeConstants::BATCH_SIZE;
+        ClearIndirectArgsBuffer (context, computeClearShader, drawCallCount);
 
-            if (lastTriangle == request.mesh->faceCount)
-            {
-                break;
-            }
-        }
+        ID3D11ShaderResourceView *csSRVs[] = { vertexData, indexData, meshConstantData, drawCallSRV, smallBatchDataSRV };
+        context->CSSetShaderResources (0, 5, csSRVs);
 
-        if (filterContext.options->statistics)
-        {
-            filterContext.options->statistics->clustersProcessed +=
-                currentCluster - firstCluster;
+        UINT initialCounts[] = { 0, 0 };
+        ID3D11UnorderedAccessView *csUAVs[] = { filteredIndexUAV_.Get (), indirectArgumentsUAV_.Get () };
+        context->CSSetUnorderedAccessViews (0, 2, csUAVs, initialCounts);
 
-            filterContext.options->statistics->clustersRendered +=
-                currentBatchCount_ - firstBatch;
+        ID3D11Buffer *csCBs[] = { perFrameConstantBuffer };
+        context->CSSetConstantBuffers (1, 1, csCBs);
 
-            filterContext.options->statistics->clustersCulled +=
-                filterContext.options->statistics->clustersProcessed - filterContext.options->statistics->clustersRendered;
-        }
+        context->CSSetShader (filterShader, nullptr, 0);
 
-        if (currentBatchCount_ > firstBatch)
-        {
-            drawCallBackingStore_[currentDrawCallCount_] = request.dcb;
-            ++currentDrawCallCount_;
-        }
+        context->Dispatch (batchCount, 1, 1);
 
-        // Check if the draw command fit into this call, if not, create a remainder
-        if (lastTriangle < request.mesh->faceCount)
-        {
-            remainder = request;
-            assert (lastTriangle >= 0);
-            remainder.firstTriangle = lastTriangle;
+        csUAVs[0] = nullptr;
+        csUAVs[1] = nullptr;
+        context->CSSetUnorderedAccessViews (0, 2, csUAVs, initialCounts);
 
-            return true;
-        }
-        else
-        {
-            return false;
-        }
+        pending_ = true;
+        drawPending_ = true;
     }
 
-    void Render (ID3D11DeviceContext *context, ID3D11ComputeShader *computeClearShader,
-        ID3D11ComputeShader *filterShader, ID3D11VertexShader *vertexShader,
-        ID3D11ShaderResourceView *vertexData, ID3D11ShaderResourceView *indexData,
-        ID3D11ShaderResourceView *meshConstantData, ID3D11Buffer *globalVertexBuffer,
-        ID3D11Buffer *perFrameConstantBuffer)
+    void Draw (ID3D11DeviceContext *context, const int drawCallCount,
+        ID3D11ShaderResourceView *drawCallSRV, ID3D11VertexShader *vertexShader,
+        ID3D11Buffer *globalVertexBuffer)
     {
-        ClearIndirectArgsBuffer (context, computeClearShader);
-        UpdateDrawCallAndSmallBatchBuffers (context);
-        Filter (context, filterShader, vertexData, indexData, meshConstantData,
-            perFrameConstantBuffer);
-
         context->VSSetShader (vertexShader, nullptr, 0);
 
         context->IASetIndexBuffer (filteredIndexBuffer_.Get (), DXGI_FORMAT_R32_UINT, 0);
@@ -296,19 +189,19 @@ public:
         UINT vbStrides[] = { sizeof (float) * 3, sizeof (int) };
         context->IASetVertexBuffers (0, 2, iaVBs, vbStrides, vbOffsets);
 
-        ID3D11ShaderResourceView *srvs[] = { drawCallSRV_.Get () };
+        ID3D11ShaderResourceView *srvs[] = { drawCallSRV };
 
         context->VSSetShaderResources (3, 1, srvs);
 
         if (agsContext_ && useMultiIndirectDraw_)
         {
             agsDriverExtensions_MultiDrawIndexedInstancedIndirect (agsContext_,
-                currentDrawCallCount_,
+                drawCallCount,
                 indirectArgumentsBuffer_.Get (), 0, sizeof (IndirectArguments));
         }
         else
         {
-            for (int i = 0; i < currentDrawCallCount_; ++i)
+            for (int i = 0; i < drawCallCount; ++i)
             {
                 context->DrawIndexedInstancedIndirect (
                     indirectArgumentsBuffer_.Get (), sizeof (IndirectArguments) * i);
@@ -317,75 +210,32 @@ public:
 
         context->IASetIndexBuffer (nullptr, DXGI_FORMAT_R32_UINT, 0);
 
-        Reset ();
-    }
-
-    int GetFaceCount () const
-    {
-        return faceCount_;
+        context->End (completionQuery_.Get ());
+        drawPending_ = false;
     }
 
 private:
-    void Filter (ID3D11DeviceContext *context, ID3D11ComputeShader *filterShader,
-        ID3D11ShaderResourceView *vertexData, ID3D11ShaderResourceView *indexData,
-        ID3D11ShaderResourceView *meshConstantData, ID3D11Buffer *perFrameConstantBuffer) const
-    {
-        ID3D11ShaderResourceView *csSRVs[] = { vertexData, indexData, meshConstantData, drawCallSRV_.Get (), smallBatchDataSRV_.Get () };
-        context->CSSetShaderResources (0, 5, csSRVs);
-
-        UINT initialCounts[] = { 0, 0 };
-        ID3D11UnorderedAccessView *csUAVs[] = { filteredIndexUAV_.Get (), indirectArgumentsUAV_.Get () };
-        context->CSSetUnorderedAccessViews (0, 2, csUAVs, initialCounts);
-
-        ID3D11Buffer *csCBs[] = { perFrameConstantBuffer };
-        context->CSSetConstantBuffers (1, 1, csCBs);
-
-        context->CSSetShader (filterShader, nullptr, 0);
-        
-        context->Dispatch (currentBatchCount_, 1, 1);
-
-        csUAVs[0] = nullptr;
-        csUAVs[1] = nullptr;
-        context->CSSetUnorderedAccessViews (0, 2, csUAVs, initialCounts);
-    }
-
-    void UpdateDrawCallAndSmallBatchBuffers (ID3D11DeviceContext *context) const
-    {
-        D3D11_MAPPED_SUBRESOURCE mapping;
-        context->Map (smallBatchDataBuffer_.Get (), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapping);
-
-        ::memcpy (mapping.pData, smallBatchDataBackingStore_.data (),
-            sizeof (SmallBatchData) * smallBatchDataBackingStore_.size ());
-
-        context->Unmap (smallBatchDataBuffer_.Get (), 0);
-
-        context->Map (drawCallBuffer_.Get (), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapping);
-
-        ::memcpy (mapping.pData, drawCallBackingStore_.data (),
-            sizeof (DrawCallArguments) * drawCallBackingStore_.size ());
-
-        context->Unmap (drawCallBuffer_.Get (), 0);
-    }
+    SmallBatchChunk (const SmallBatchChunk &);
+    SmallBatchChunk &operator= (const SmallBatchChunk &);
 
     void CreateFilteredIndexBuffer (ID3D11Device *device)
     {
         D3D11_BUFFER_DESC filteredIndexBufferDesc = {};
         filteredIndexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER | D3D11_BIND_UNORDERED_ACCESS;
-        filteredIndexBufferDesc.ByteWidth = SmallBatchMergeConstants::BATCH_COUNT *
-            SmallBatchMergeConstants::BATCH_SIZE *
-            (sizeof (int) * 3);
+        filteredIndexBufferDesc.ByteWidth = batchCount_ * batchSize_ * (sizeof (int) * 3);
         filteredIndexBufferDesc.CPUAccessFlags = 0;
         filteredIndexBufferDesc.MiscFlags = 0;
         filteredIndexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
 
+        filteredIndexBuffer_.Reset ();
+        filteredIndexUAV_.Reset ();
         device->CreateBuffer (&filteredIndexBufferDesc, nullptr, &filteredIndexBuffer_);
         SetDebugName (filteredIndexBuffer_.Get (), "[AMD GeometryFX Filtering] Filtered index buffer [%p]", this);
 
         D3D11_UNORDERED_ACCESS_VIEW_DESC fibUav = {};
         fibUav.Buffer.FirstElement = 0;
         fibUav.Buffer.Flags = 0;
-        fibUav.Buffer.NumElements =
-            SmallBatchMergeConstants::BATCH_COUNT * SmallBatchMergeConstants::BATCH_SIZE * 3;
+        fibUav.Buffer.NumElements = batchCount_ * batchSize_ * 3;
         fibUav.Format = DXGI_FORMAT_R32_UINT;
         fibUav.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
 
@@ -393,45 +243,19 @@ private:
         SetDebugName (filteredIndexUAV_.Get (), "[AMD GeometryFX Filtering] Filtered index buffer UAV [%p]", this);
     }
 
-    void CreateSmallBatchDataBuffer (ID3D11Device *device)
-    {
-        D3D11_BUFFER_DESC smallBatchDataBufferDesc;
-        smallBatchDataBufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        smallBatchDataBufferDesc.ByteWidth =
-            SmallBatchMergeConstants::BATCH_COUNT * sizeof (SmallBatchData);
-        smallBatchDataBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-        smallBatchDataBufferDesc.StructureByteStride = sizeof (SmallBatchData);
-        smallBatchDataBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        smallBatchDataBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-
-        device->CreateBuffer (&smallBatchDataBufferDesc, nullptr, &smallBatchDataBuffer_);
-        SetDebugName (smallBatchDataBuffer_.Get (), "[AMD GeometryFX Filtering] Batch data buffer [%p]", this);
-
-        D3D11_SHADER_RESOURCE_VIEW_DESC smallBatchDataSRVDesc;
-        smallBatchDataSRVDesc.Buffer.FirstElement = 0;
-        smallBatchDataSRVDesc.Buffer.NumElements = SmallBatchMergeConstants::BATCH_COUNT;
-        smallBatchDataSRVDesc.Format = DXGI_FORMAT_UNKNOWN;
-        smallBatchDataSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-
-        device->CreateShaderResourceView (
-            smallBatchDataBuffer_.Get (), &smallBatchDataSRVDesc, &smallBatchDataSRV_);
-        SetDebugName (smallBatchDataSRV_.Get (), "[AMD GeometryFX Filtering] Batch data buffer SRV [%p]", this);
-    }
-
     void CreateIndirectDrawArgumentsBuffer (ID3D11Device *device)
     {
         D3D11_BUFFER_DESC indirectArgumentsBufferDesc;
         indirectArgumentsBufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
         indirectArgumentsBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
-        indirectArgumentsBufferDesc.ByteWidth =
-            sizeof (IndirectArguments) * SmallBatchMergeConstants::BATCH_COUNT;
+        indirectArgumentsBufferDesc.ByteWidth = sizeof (IndirectArguments) * batchCount_;
         indirectArgumentsBufferDesc.StructureByteStride = sizeof (IndirectArguments);
         indirectArgumentsBufferDesc.CPUAccessFlags = 0;
         indirectArgumentsBufferDesc.Usage = D3D11_USAGE_DEFAULT;
 
-        std::vector<IndirectArguments> indirectArgs (SmallBatchMergeConstants::BATCH_COUNT);
+        std::vector<IndirectArguments> indirectArgs (batchCount_);
 
-        for (int i = 0; i < SmallBatchMergeConstants::BATCH_COUNT; ++i)
+        for (int i = 0; i < batchCount_; ++i)
         {
             IndirectArguments::Init (indirectArgs[i]);
         }
@@ -442,6 +266,8 @@ private:
             static_cast<UINT>(sizeof (IndirectArguments) * indirectArgs.size ());
         indirectArgumentsBufferData.SysMemSlicePitch = indirectArgumentsBufferData.SysMemPitch;
 
+        indirectArgumentsBuffer_.Reset ();
+        indirectArgumentsUAV_.Reset ();
         device->CreateBuffer (
             &indirectArgumentsBufferDesc, &indirectArgumentsBufferData, &indirectArgumentsBuffer_);
 
@@ -449,7 +275,7 @@ private:
 
         D3D11_UNORDERED_ACCESS_VIEW_DESC indirectArgsUAVDesc = {};
         indirectArgsUAVDesc.Buffer.FirstElement = 0;
-        indirectArgsUAVDesc.Buffer.NumElements = SmallBatchMergeConstants::BATCH_COUNT * 5;
+        indirectArgsUAVDesc.Buffer.NumElements = batchCount_ * 5;
         indirectArgsUAVDesc.Format = DXGI_FORMAT_R32_UINT;
         indirectArgsUAVDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
 
@@ -458,30 +284,6 @@ private:
         SetDebugName (indirectArgumentsUAV_.Get (), "[AMD GeometryFX Filtering] Indirect arguments buffer UAV [%p]", this);
     }
 
-    void CreateDrawCallArgumentsBuffer (ID3D11Device *device)
-    {
-        D3D11_BUFFER_DESC drawCallBufferDesc;
-        drawCallBufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        drawCallBufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
-        drawCallBufferDesc.ByteWidth =
-            sizeof (DrawCallArguments) * SmallBatchMergeConstants::BATCH_COUNT;
-        drawCallBufferDesc.StructureByteStride = sizeof (DrawCallArguments);
-        drawCallBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        drawCallBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-
-        device->CreateBuffer (&drawCallBufferDesc, nullptr, &drawCallBuffer_);
-        SetDebugName (drawCallBuffer_.Get (), "[AMD GeometryFX Filtering] Draw arguments buffer [%p]", this);
-
-        D3D11_SHADER_RESOURCE_VIEW_DESC drawCallSRVDesc;
-        drawCallSRVDesc.Buffer.FirstElement = 0;
-        drawCallSRVDesc.Buffer.NumElements = SmallBatchMergeConstants::BATCH_COUNT;
-        drawCallSRVDesc.Format = DXGI_FORMAT_UNKNOWN;
-        drawCallSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
-
-        device->CreateShaderResourceView (drawCallBuffer_.Get (), &drawCallSRVDesc, &drawCallSRV_);
-        SetDebugName (drawCallSRV_.Get (), "[AMD GeometryFX Filtering] Draw arguments buffer SRV [%p]", this);
-    }
-
     /**
     The instance ID buffer is our workaround for not having gl_DrawID in D3D.
     The buffer simply contains 0, 1, 2, 3 ..., and is bound with a per-instance
@@ -491,11 +293,11 @@ private:
     {
         D3D11_BUFFER_DESC instanceIdBufferDesc = {};
         instanceIdBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-        instanceIdBufferDesc.ByteWidth = sizeof (int) * SmallBatchMergeConstants::BATCH_COUNT;
+        instanceIdBufferDesc.ByteWidth = sizeof (int) * batchCount_;
         instanceIdBufferDesc.StructureByteStride = sizeof (int);
         instanceIdBufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
 
-        std::vector<int> ids (SmallBatchMergeConstants::BATCH_COUNT);
+        std::vector<int> ids (batchCount_);
         std::iota (ids.begin (), ids.end (), 0);
 
         D3D11_SUBRESOURCE_DATA data;
@@ -503,55 +305,255 @@ private:
         data.SysMemPitch = instanceIdBufferDesc.ByteWidth;
         data.SysMemSlicePitch = data.SysMemPitch;
 
+        instanceIdBuffer_.Reset ();
         device->CreateBuffer (&instanceIdBufferDesc, &data, &instanceIdBuffer_);
         SetDebugName (instanceIdBuffer_.Get (), "[AMD GeometryFX Filtering] Instance ID buffer [%p]", this);
     }
 
-    void Reset ()
+    void CreateCompletionQuery (ID3D11Device *device)
     {
-        currentBatchCount_ = 0;
-        currentDrawCallCount_ = 0;
-        faceCount_ = 0;
+        D3D11_QUERY_DESC queryDesc;
+        queryDesc.MiscFlags = 0;
+        queryDesc.Query = D3D11_QUERY_EVENT;
+
+        device->CreateQuery (&queryDesc, &completionQuery_);
+        SetDebugName (completionQuery_.Get (), "[AMD GeometryFX Filtering] Completion query [%p]", this);
     }
 
-    void ClearIndirectArgsBuffer (
-        ID3D11DeviceContext *context, ID3D11ComputeShader *computeClearShader) const
+    /**
+    The clear shader resets the index count of one draw per thread, in groups
+    of CLEAR_THREAD_COUNT threads.
+    */
+    void ClearIndirectArgsBuffer (ID3D11DeviceContext *context,
+        ID3D11ComputeShader *computeClearShader, const int drawCallCount) const
     {
+        const int CLEAR_THREAD_COUNT = 256;
+
         ID3D11UnorderedAccessView *uavViews[] = { indirectArgumentsUAV_.Get () };
         UINT initialCounts[] = { 0 };
         context->CSSetUnorderedAccessViews (1, 1, uavViews, initialCounts);
         context->CSSetShader (computeClearShader, nullptr, 0);
-        context->Dispatch (currentBatchCount_, 1, 1);
+        context->Dispatch ((drawCallCount + CLEAR_THREAD_COUNT - 1) / CLEAR_THREAD_COUNT, 1, 1);
 
         uavViews[0] = nullptr;
 
         context->CSSetUnorderedAccessViews (0, 1, uavViews, initialCounts);
     }
 
-    ComPtr<ID3D11Buffer> smallBatchDataBuffer_;
-    ComPtr<ID3D11ShaderResourceView> smallBatchDataSRV_;
+    ID3D11Device *device_;
+    int batchSize_;
+    int batchCount_;
+    int maximumBatchCount_;
+
     ComPtr<ID3D11Buffer> filteredIndexBuffer_;
     ComPtr<ID3D11UnorderedAccessView> filteredIndexUAV_;
     ComPtr<ID3D11Buffer> indirectArgumentsBuffer_;
     ComPtr<ID3D11UnorderedAccessView> indirectArgumentsUAV_;
-    ComPtr<ID3D11Buffer> drawCallBuffer_;
-    ComPtr<ID3D11ShaderResourceView> drawCallSRV_;
 
     std::vector<ComPtr<ID3D11Buffer>> drawCallConstantBuffers_;
     ComPtr<ID3D11Buffer> drawCallConstantBufferMerged_;
 
     ComPtr<ID3D11Buffer> instanceIdBuffer_;
 
-    std::vector<SmallBatchData> smallBatchDataBackingStore_;
-    std::vector<DrawCallArguments> drawCallBackingStore_;
-
-    int currentBatchCount_;
-    int currentDrawCallCount_;
-    int faceCount_;
+    ComPtr<ID3D11DeviceContext> immediateContext_;
+    ComPtr<ID3D11Query> completionQuery_;
+    bool pending_;
+    bool drawPending_;
 
     bool useMultiIndirectDraw_;
     AGSContext* agsContext_;
 };
+
+/**
+The small batch chunks in use, see ChunkPool.
+*/
+typedef ChunkPool<SmallBatchChunk> SmallBatchChunkPool;
+
+/**
+A dynamic structured buffer which is written front to back, one segment of
+segmentSize elements per filter dispatch, each with its own SRV. All
+segments of a pass are written with a single map. The map doesn't overwrite
+the segments written before, so the driver neither renames the buffer nor
+waits for the GPU. Once the end is reached, the buffer is discarded and
+written from the start again.
+
+Mapping a dynamic buffer bound as SRV without overwrite requires D3D 11.1,
+without it every map discards. On a deferred context, the first map of a
+dynamic buffer in a command list must discard. A pass maps each ring once,
+so there every map discards and starts at the first segment.
+*/
+class UploadRing
+{
+public:
+    UploadRing (ID3D11Device *device, const int elementSize, const int segmentSize,
+        const int minimumSegmentCount, const char *name)
+        : device_ (device)
+        , elementSize_ (elementSize)
+        , segmentSize_ (segmentSize)
+        , minimumSegmentCount_ (minimumSegmentCount)
+        , name_ (name)
+        , nextSegment_ (0)
+        , mapCount_ (0)
+        , bytesWritten_ (0)
+    {
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+        device->CheckFeatureSupport (D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof (options));
+        canMapNoOverwrite_ = options.MapNoOverwriteOnDynamicBufferSRV != FALSE;
+    }
+
+    /**
+    Map segmentCount consecutive segments. Returns the address of the first
+    one and its index in firstSegment.
+    */
+    void *Map (ID3D11DeviceContext *context, const int segmentCount, int *firstSegment)
+    {
+        if (segmentCount > static_cast<int> (segmentSRVs_.size ()))
+        {
+            CreateBuffer (std::max (segmentCount,
+                std::max (static_cast<int> (segmentSRVs_.size ()) * 2, minimumSegmentCount_)));
+        }
+
+        D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+
+        if (!canMapNoOverwrite_ || nextSegment_ == 0
+            || context->GetType () == D3D11_DEVICE_CONTEXT_DEFERRED
+            || nextSegment_ + segmentCount > static_cast<int> (segmentSRVs_.size ()))
+        {
+            mapType = D3D11_MAP_WRITE_DISCARD;
+            nextSegment_ = 0;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapping;
+        context->Map (buffer_.Get (), 0, mapType, 0, &mapping);
+        ++mapCount_;
+
+        *firstSegment = nextSegment_;
+        void *result = static_cast<char *> (mapping.pData) + GetSegmentOffset (nextSegment_);
+        nextSegment_ += segmentCount;
+
+        return result;
+    }
+
+    void Unmap (ID3D11DeviceContext *context)
+    {
+        context->Unmap (buffer_.Get (), 0);
+    }
+
+    /**
+    Copy elementCount elements to firstElement of the index-th of the
+    segments returned by Map(). Only the elements given are written, the
+    rest of the segment is left as is.
+    */
+    void Write (void *mapping, const int index, const int firstElement,
+        const void *elements, const int elementCount)
+    {
+        assert (firstElement + elementCount <= segmentSize_);
+
+        const size_t offset = GetSegmentOffset (index) + static_cast<size_t> (firstElement) * elementSize_;
+        const size_t size = static_cast<size_t> (elementCount) * elementSize_;
+        ::memcpy (static_cast<char *> (mapping) + offset, elements, size);
+        bytesWritten_ += size;
+    }
+
+    ID3D11ShaderResourceView *GetSegmentSRV (const int segment) const
+    {
+        return segmentSRVs_[segment].Get ();
+    }
+
+    int64 GetMapCount () const
+    {
+        return mapCount_;
+    }
+
+    int64 GetBytesWritten () const
+    {
+        return bytesWritten_;
+    }
+
+private:
+    UploadRing (const UploadRing &);
+    UploadRing &operator= (const UploadRing &);
+
+    size_t GetSegmentOffset (const int segment) const
+    {
+        return static_cast<size_t> (segment) * segmentSize_ * elementSize_;
+    }
+
+    void CreateBuffer (const int segmentCount)
+    {
+        D3D11_BUFFER_DESC bufferDesc;
+        bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        bufferDesc.ByteWidth = segmentCount * segmentSize_ * elementSize_;
+        bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+        bufferDesc.StructureByteStride = elementSize_;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+
+        buffer_.Reset ();
+        device_->CreateBuffer (&bufferDesc, nullptr, &buffer_);
+        SetDebugName (buffer_.Get (), "[AMD GeometryFX Filtering] %s upload ring", name_);
+
+        segmentSRVs_.resize (segmentCount);
+
+        for (int i = 0; i < segmentCount; ++i)
+        {
+            D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+            srvDesc.Buffer.FirstElement = i * segmentSize_;
+            srvDesc.Buffer.NumElements = segmentSize_;
+            srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+
+            segmentSRVs_[i].Reset ();
+            device_->CreateShaderResourceView (buffer_.Get (), &srvDesc, &segmentSRVs_[i]);
+            SetDebugName (segmentSRVs_[i].Get (), "[AMD GeometryFX Filtering] %s upload ring SRV [%d]", name_, i);
+        }
+
+        // The new buffer has nothing in flight
+        nextSegment_ = 0;
+    }
+
+    ID3D11Device *device_;
+    int elementSize_;
+    int segmentSize_;
+    int minimumSegmentCount_;
+    const char *name_;
+    bool canMapNoOverwrite_;
+
+    ComPtr<ID3D11Buffer> buffer_;
+    std::vector<ComPtr<ID3D11ShaderResourceView>> segmentSRVs_;
+    int nextSegment_;
+
+    int64 mapCount_;
+    int64 bytesWritten_;
+};
+
+int GetSupportedSmallBatchCount(const int requestedCount)
+{
+    return std::min(std::max(requestedCount, 1), SmallBatchMergeConstants::MAXIMUM_BATCH_COUNT);
+}
+
+/**
+Most batches filtered by one dispatch. In single dispatch mode, this is as
+many as the GPU buffers of one dispatch can hold within the memory limit,
+but at least the batches of one chunk.
+*/
+int GetFilterDispatchBatchCount(const GeometryFX_FilterDesc &createInfo,
+    const int batchSize, const int batchCount)
+{
+    if (!createInfo.singleDispatchFiltering)
+    {
+        return batchCount;
+    }
+
+    // Filtered indices, upload ring elements, indirect arguments and the
+    // instance ID of each batch
+    const int64 bytesPerBatch = batchSize * 3 * sizeof(int) + sizeof(SmallBatchData)
+        + sizeof(DrawCallArguments) + sizeof(IndirectArguments) + sizeof(int);
+    const int64 memoryLimitBatchCount = createInfo.singleDispatchMemoryLimit / bytesPerBatch;
+
+    return static_cast<int>(std::min(std::max(memoryLimitBatchCount, static_cast<int64>(batchCount)),
+        static_cast<int64>(SmallBatchMergeConstants::MAXIMUM_BATCH_COUNT)));
+}
 }
 
 struct GeometryFX_Filter::Handle
@@ -574,11 +576,6 @@ struct GeometryFX_Filter::Handle
 
 struct GeometryFX_Filter::GeometryFX_OpaqueFilterDesc
 {
-    enum SMALL_BATCH_CHUNK
-    {
-        SMALL_BATCH_CHUNK_COUNT = 16
-    };
-
 public:
     void *operator new (size_t sz) throw()
     {
@@ -594,14 +591,49 @@ public:
         : device_(createInfo.pDevice)
         , maxDrawCallCount_(createInfo.maximumDrawCallCount)
         , emulateMultiDrawIndirect_(false)
+        , smallBatchSize_(SmallBatchMergeConstants::BATCH_SIZE)
+        , smallBatchCount_(GetSupportedSmallBatchCount(createInfo.smallBatchCount))
+        , dispatchBatchCount_(GetFilterDispatchBatchCount(createInfo, smallBatchSize_, smallBatchCount_))
+        , singleDispatchFiltering_(createInfo.singleDispatchFiltering)
+        , smallBatchPacker_(smallBatchSize_, smallBatchCount_)
         , currentDrawCall_(0)
+        , temporalOcclusion_(false)
         , deviceContext_(nullptr)
+        , viewCount_(0)
+        , setViewports_(false)
+        , nextPassIndex_(0)
+        , passQueryCount_(0)
     {
-        CreateQueries();
+        device_->GetImmediateContext(&immediateContext_);
+
         CreateConstantBuffers();
         CreateShaders();
 
-        meshManager_ = GeometryFX_Internal::CreateGlobalMeshManager();
+        GeometryFX_Internal::ClusterBuilderOptions clusterBuilderOptions;
+        clusterBuilderOptions.spatialClusters = createInfo.buildSpatialClusters;
+        clusterBuilderOptions.maximumVerticesPerCluster = createInfo.maximumVerticesPerCluster;
+        clusterBuilderOptions.maximumTrianglesPerCluster =
+            std::min(smallBatchSize_, SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE);
+        clusterBuilderOptions.coneType = createInfo.minimalNormalCones
+            ? GeometryFX_Internal::CLUSTER_CONE_MINIMAL
+            : GeometryFX_Internal::CLUSTER_CONE_AVERAGE_NORMAL;
+        clusterBuilderOptions.optimizeVertexCache = createInfo.optimizeVertexCache;
+        clusterBuilderOptions.buildLod = createInfo.buildClusterLod;
+
+        if (createInfo.occlusionBufferWidth > 0 && createInfo.occlusionBufferHeight > 0)
+        {
+            occlusionBuffer_.reset(new GeometryFX_Internal::OcclusionBuffer(
+                createInfo.occlusionBufferWidth, createInfo.occlusionBufferHeight));
+            temporalOcclusion_ = createInfo.temporalOcclusion;
+        }
+
+        if (createInfo.clusterCacheDirectory != nullptr)
+        {
+            clusterBuilderOptions.cacheDirectory = createInfo.clusterCacheDirectory;
+        }
+
+        meshManager_ = GeometryFX_Internal::CreateGlobalMeshManager(clusterBuilderOptions);
+        workerPool_.reset(new GeometryFX_Internal::WorkerPool(createInfo.workerThreadCount));
         agsContext_ = nullptr;
 
         if (agsInit(&agsContext_, nullptr, nullptr) == AGS_SUCCESS)
@@ -648,6 +680,7 @@ public:
         for (int i = 0; i < meshCount; ++i)
         {
             handles_[i]->mesh = meshManager_->GetMesh(i);
+            handles_[i]->mesh->isTemporalOccluder = temporalOcclusion_;
         }
 
         CreateIndirectDrawArgumentsBuffer(meshCount, indicesInMesh, verticesInMesh);
@@ -659,11 +692,20 @@ public:
 
         CreateDrawCallConstantBuffers();
 
-        for (int i = 0; i < SMALL_BATCH_CHUNK_COUNT; ++i)
+        // The chunks are created on demand by the first passes. A single
+        // dispatch per view needs one upload segment per view, instead of
+        // room for several passes of chunks.
+        const int minimumUploadSegmentCount = singleDispatchFiltering_ ? 1 : 16;
+
+        smallBatchChunkPool_.reset(new SmallBatchChunkPool([this]()
         {
-            smallBatchChunks_.emplace_back(
-                new SmallBatchChunk(device_, emulateMultiDrawIndirect_, agsContext_));
-        }
+            return new SmallBatchChunk(device_, emulateMultiDrawIndirect_, agsContext_,
+                smallBatchSize_, dispatchBatchCount_);
+        }));
+        smallBatchDataRing_.reset(new UploadRing(device_, sizeof(SmallBatchData),
+            dispatchBatchCount_, minimumUploadSegmentCount, "Batch data"));
+        drawCallRing_.reset(new UploadRing(device_, sizeof(DrawCallArguments),
+            dispatchBatchCount_, minimumUploadSegmentCount, "Draw arguments"));
 
         std::vector<MeshHandle> result;
         result.reserve(handles_.size());
@@ -684,61 +726,161 @@ public:
         meshManager_->SetData(device_, deviceContext.Get(), handle->index, vertexData, indexData);
     }
 
-    void BeginRender(ID3D11DeviceContext *context, const FilterContext &filterContext)
+    void SetMeshData(const int meshCount, const MeshHandle *handles,
+        const void *const *vertexData, const void *const *indexData)
+    {
+        ComPtr<ID3D11DeviceContext> deviceContext;
+        device_->GetImmediateContext(&deviceContext);
+
+        std::vector<int> meshIndices(meshCount);
+        for (int i = 0; i < meshCount; ++i)
+        {
+            meshIndices[i] = handles[i]->index;
+        }
+
+        meshManager_->SetData(device_, deviceContext.Get(), *workerPool_, meshCount,
+            meshIndices.data(), vertexData, indexData);
+    }
+
+    void SetMeshOccluder(const MeshHandle &handle, const bool isOccluder)
+    {
+        // The system memory copy is made while uploading
+        assert(handle->mesh->clusters.empty());
+
+        handle->mesh->isOccluder = isOccluder && occlusionBuffer_;
+    }
+
+    /**
+    viewports is null for a single view, in which case the viewport set by
+    the application is kept. Otherwise, it holds one viewport per view.
+    */
+    void BeginRender(ID3D11DeviceContext *context, const int viewCount,
+        const FilterContext *filterContexts, const D3D11_VIEWPORT *viewports)
     {
+        assert(viewCount > 0 && viewCount <= GeometryFX_FilterMaximumViewCount);
+
         deviceContext_ = context;
-        filterContext_ = filterContext;
+        viewCount_ = viewCount;
+        setViewports_ = viewports != nullptr;
         currentDrawCall_ = 0;
 
-        if (filterContext.options->statistics)
+        for (int i = 0; i < viewCount; ++i)
         {
-            *filterContext.options->statistics = GeometryFX_FilterStatistics();
-        }
+            const FilterContext &filterContext = filterContexts[i];
+            const auto options = filterContext.options;
 
-        drawCommands_.clear();
+            filterContexts_[i] = filterContext;
+            instanceCullers_[i] = InstanceCuller(filterContext.viewProjection, filterContext.eye,
+                filterContext.lodErrorScale, (options->enabledFilters & GeometryFX_FilterFrustum) != 0,
+                options->maximumDrawDistance, options->minimumProjectedSize);
 
-        frameConstantBufferBackingStore_.view = filterContext.view;
-        frameConstantBufferBackingStore_.projection = filterContext.projection;
-        frameConstantBufferBackingStore_.height = filterContext.windowHeight;
-        frameConstantBufferBackingStore_.width = filterContext.windowWidth;
-        frameConstantBufferBackingStore_.cullFlags = filterContext.options->enabledFilters;
+            if (viewports)
+            {
+                viewports_[i] = viewports[i];
+            }
+        }
 
-        D3D11_MAPPED_SUBRESOURCE mapping;
-        context->Map(frameConstantBuffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapping);
-        ::memcpy(mapping.pData, &frameConstantBufferBackingStore_,
-            sizeof(frameConstantBufferBackingStore_));
-        context->Unmap(frameConstantBuffer_.Get(), 0);
+        if (filterContexts_[0].options->statistics)
+        {
+            *filterContexts_[0].options->statistics = GeometryFX_FilterStatistics();
+            filterContexts_[0].options->statistics->passIndex = nextPassIndex_++;
+            passQueryCount_ = 0;
+        }
+
+        drawCommands_.clear();
 
         context->PSSetShader(nullptr, NULL, 0);
     }
 
-    void RenderMeshInstanced(
-        const MeshHandle &handle, const int count, const DirectX::XMMATRIX *worldMatrices)
+    void RenderMeshInstanced(const MeshHandle &handle, const int count,
+        const DirectX::XMMATRIX *worldMatrices, const DirectX::XMMATRIX *inverseWorldMatrices,
+        const GEOMETRYFX_WORLD_TRANSFORM transform)
     {
         assert(deviceContext_);
 
+        const bool cullInstances =
+            filterContexts_[0].options->enableFiltering && instanceCullers_[0].IsEnabled();
+
         for (int i = 0; i < count; ++i)
         {
+            if (cullInstances && !TestInstance(handle->mesh, worldMatrices[i], transform))
+            {
+                continue;
+            }
+
             DrawCommand request;
             request.mesh = handle->mesh;
             request.dcb.world = worldMatrices[i];
-            request.dcb.worldView = worldMatrices[i] * filterContext_.view;
             request.dcb.meshIndex = handle->index;
             request.drawCallId = currentDrawCall_;
+            request.transform = inverseWorldMatrices ? GeometryFX_WorldTransformGeneral : transform;
 
-            if (!filterContext_.options->enableFiltering)
+            // The general inverse is left to the packing threads, and is
+            // skipped entirely for draws culled by the mesh frustum test.
+            // Only the eye of the first view is cached, the other views of
+            // a multi-view pass compute theirs while packing.
+            if (inverseWorldMatrices)
             {
-                D3D11_MAPPED_SUBRESOURCE mapping;
-                deviceContext_->Map(drawCallConstantBuffers_[currentDrawCall_].Get(), 0,
-                    D3D11_MAP_WRITE_DISCARD, 0, &mapping);
-                ::memcpy(mapping.pData, &request.dcb, sizeof(request.dcb));
-                deviceContext_->Unmap(drawCallConstantBuffers_[currentDrawCall_].Get(), 0);
+                request.objectSpaceEye = GetObjectSpaceEye(filterContexts_[0].eye, inverseWorldMatrices[i]);
+                request.hasObjectSpaceEye = true;
+            }
+            else if (transform == GeometryFX_WorldTransformRigid)
+            {
+                request.objectSpaceEye = GetObjectSpaceEye(filterContexts_[0].eye, worldMatrices[i], transform);
+                request.hasObjectSpaceEye = true;
             }
 
             drawCommands_.push_back(request);
 
-            ++currentDrawCall_;
+            ++currentDrawCall_;
+        }
+    }
+
+    /**
+    False if the instance is rejected by the bounding sphere of its mesh in
+    every view, in which case no draw must be recorded for it. The reason
+    is counted for the first view.
+    */
+    bool TestInstance(const StaticMesh *mesh, const DirectX::XMMATRIX &world,
+        const GEOMETRYFX_WORLD_TRANSFORM transform)
+    {
+        const auto result = instanceCullers_[0].Test(world, transform, mesh->boundingSphere);
+
+        if (result == INSTANCE_CULL_RESULT_VISIBLE)
+        {
+            return true;
+        }
+
+        for (int i = 1; i < viewCount_; ++i)
+        {
+            if (instanceCullers_[i].Test(world, transform, mesh->boundingSphere) ==
+                INSTANCE_CULL_RESULT_VISIBLE)
+            {
+                return true;
+            }
+        }
+
+        if (filterContexts_[0].options->statistics)
+        {
+            auto statistics = filterContexts_[0].options->statistics;
+
+            switch (result)
+            {
+            case INSTANCE_CULL_RESULT_FRUSTUM:
+                ++statistics->instancesFrustumRejected;
+                break;
+            case INSTANCE_CULL_RESULT_DISTANCE:
+                ++statistics->instancesDistanceRejected;
+                break;
+            case INSTANCE_CULL_RESULT_SIZE:
+                ++statistics->instancesSizeRejected;
+                break;
+            default:
+                break;
+            }
         }
+
+        return false;
     }
 
     void EndRender()
@@ -748,18 +890,58 @@ public:
 
         deviceContext_->VSSetConstantBuffers(1, 1, constantBuffers);
 
-        if (filterContext_.options->enableFiltering)
+        // Occlusion culling only uses the first view
+        if (filterContexts_[0].options->enableFiltering)
         {
-            RenderGeometryChunked(deviceContext_, filterContext_);
+            RasterizeOccluders(filterContexts_[0]);
+            RenderGeometryChunked(deviceContext_);
         }
         else
         {
-            RenderGeometryDefault(deviceContext_, filterContext_);
+            RenderGeometryDefault(deviceContext_);
+        }
+
+        if (filterContexts_[0].options->statistics)
+        {
+            PassStatistics passStatistics;
+            passStatistics.statistics = *filterContexts_[0].options->statistics;
+            passStatistics.pendingQueries = passQueryCount_;
+            passStatistics_.push_back(passStatistics);
+
+            if (static_cast<int>(passStatistics_.size()) > GeometryFX_FilterStatisticsPassCount)
+            {
+                passStatistics_.pop_front();
+            }
         }
 
+        CollectPipelineStatistics();
+
         deviceContext_ = nullptr;
     }
 
+    bool GetStatistics(const int64 passIndex, GeometryFX_FilterStatistics *statistics)
+    {
+        CollectPipelineStatistics();
+
+        if (passStatistics_.empty() || passIndex < passStatistics_.front().statistics.passIndex
+            || passIndex > passStatistics_.back().statistics.passIndex)
+        {
+            return false;
+        }
+
+        // Passes with statistics are numbered consecutively
+        const PassStatistics &passStatistics =
+            passStatistics_[static_cast<size_t>(passIndex - passStatistics_.front().statistics.passIndex)];
+
+        if (passStatistics.pendingQueries > 0)
+        {
+            return false;
+        }
+
+        *statistics = passStatistics.statistics;
+        return true;
+    }
+
     void GetBuffersForMesh(const MeshHandle &handle, ID3D11Buffer **vertexBuffer,
         int32 *vertexOffset, ID3D11Buffer **indexBuffer, int32 *indexOffset) const
     {
@@ -794,6 +976,34 @@ public:
         }
     }
 
+    void GetSmallBatchInfo(int32 *smallBatchSize, int32 *smallBatchCount) const
+    {
+        if (smallBatchSize)
+        {
+            *smallBatchSize = smallBatchSize_;
+        }
+
+        if (smallBatchCount)
+        {
+            *smallBatchCount = smallBatchCount_;
+        }
+    }
+
+    void GetClusterStatistics(const MeshHandle &handle,
+        GeometryFX_ClusterStatistics *statistics) const
+    {
+        const auto &clusterStatistics = handle->mesh->clusterStatistics;
+
+        statistics->clusterCount = clusterStatistics.clusterCount;
+        statistics->validConeCount = clusterStatistics.validClusterCount;
+        statistics->meanConeAngle = clusterStatistics.meanConeAngle;
+        statistics->loadedFromCache = handle->mesh->clustersLoadedFromCache;
+        statistics->vertexCacheMissRatio = handle->mesh->vertexCacheStatistics.acmr;
+        statistics->vertexTransformRatio = handle->mesh->vertexCacheStatistics.atvr;
+        statistics->lodClusterCount = static_cast<int32>(handle->mesh->clusters.size())
+            - handle->mesh->baseClusterCount;
+    }
+
 private:
     bool emulateMultiDrawIndirect_;
     AGSContext* agsContext_;
@@ -801,24 +1011,86 @@ private:
     std::vector<std::unique_ptr<GeometryFX_Filter::Handle>> handles_;
 
     std::unique_ptr<GeometryFX_Internal::IMeshManager> meshManager_;
+    std::unique_ptr<GeometryFX_Internal::WorkerPool> workerPool_;
+    std::unique_ptr<GeometryFX_Internal::OcclusionBuffer> occlusionBuffer_;
     std::vector<ComPtr<ID3D11Buffer>> drawCallConstantBuffers_;
     int currentDrawCall_;
     int maxDrawCallCount_;
 
     std::vector<DrawCommand> drawCommands_;
+    std::vector<DrawCommand> sortedDrawCommands_;
+
+    bool temporalOcclusion_;
+    GeometryFX_Internal::ClusterVisibility clusterVisibility_;
 
     ID3D11DeviceContext *deviceContext_;
-    FilterContext filterContext_;
+    int viewCount_;
+    bool setViewports_;
+    FilterContext filterContexts_[GeometryFX_FilterMaximumViewCount];
+    D3D11_VIEWPORT viewports_[GeometryFX_FilterMaximumViewCount];
+    GeometryFX_Internal::InstanceCuller instanceCullers_[GeometryFX_FilterMaximumViewCount];
+
+    /**
+    The pipeline statistics of each chunk are read back once the GPU is
+    done, in the order the chunks were submitted. The filtered triangle
+    counts are added to the statistics of the pass which submitted the
+    chunk, which are kept for the last GeometryFX_FilterStatisticsPassCount
+    passes.
+    */
+    struct PipelineStatisticsQuery
+    {
+        ComPtr<ID3D11Query> query;
+        int64 passIndex;
+        int64 trianglesSubmitted;
+    };
+
+    struct PassStatistics
+    {
+        GeometryFX_FilterStatistics statistics;
+        int pendingQueries;
+    };
+
+    std::deque<PipelineStatisticsQuery> pendingStatisticsQueries_;
+    std::vector<ComPtr<ID3D11Query>> freeStatisticsQueries_;
+    std::deque<PassStatistics> passStatistics_;
+    int64 nextPassIndex_;
+    int passQueryCount_;
 
-    ComPtr<ID3D11Query> pipelineQuery_;
     ID3D11Device *device_;
 
+    // Queries are only read here, never on the context of the render pass
+    ComPtr<ID3D11DeviceContext> immediateContext_;
+
     FrameConstantBuffer frameConstantBufferBackingStore_;
     ComPtr<ID3D11Buffer> frameConstantBuffer_;
 
     ComPtr<ID3D11ComputeShader> filterComputeShader_;
 
-    std::vector<std::unique_ptr<SmallBatchChunk>> smallBatchChunks_;
+    int smallBatchSize_;
+    int smallBatchCount_;
+    int dispatchBatchCount_;
+    bool singleDispatchFiltering_;
+
+    std::unique_ptr<SmallBatchChunkPool> smallBatchChunkPool_;
+    std::unique_ptr<UploadRing> smallBatchDataRing_;
+    std::unique_ptr<UploadRing> drawCallRing_;
+
+    /**
+    The chunks of one view which are filtered together, see
+    UploadSmallBatchChunks().
+    */
+    struct FilterDispatch
+    {
+        int view;
+        int batchCount;
+        int drawCallCount;
+        int faceCount;
+    };
+
+    std::vector<FilterDispatch> filterDispatches_;
+    std::vector<SmallBatchChunk *> dispatchChunks_;
+    std::vector<SmallBatchData> smallBatchDataScratch_;
+    GeometryFX_Internal::SmallBatchPacker smallBatchPacker_;
 
     ComPtr<ID3D11ComputeShader> clearDrawIndirectArgumentsComputeShader_;
 
@@ -865,6 +1137,8 @@ private:
             sizeof(AMD_GeometryFX_ClearDrawIndirectArgsCS), AMD_GeometryFX_ClearDrawIndirectArgsCS,
             ShaderType::Compute);
 
+        // One thread group of the filter shader processes one small batch
+        assert(smallBatchSize_ == SmallBatchMergeConstants::BATCH_SIZE);
         CreateShader(device_, (ID3D11DeviceChild **)filterComputeShader_.GetAddressOf(),
             sizeof(AMD_GeometryFX_FilterCS), AMD_GeometryFX_FilterCS, ShaderType::Compute);
     }
@@ -936,14 +1210,6 @@ private:
         }
     }
 
-    void CreateQueries()
-    {
-        D3D11_QUERY_DESC queryDesc;
-        queryDesc.MiscFlags = 0;
-        queryDesc.Query = D3D11_QUERY_PIPELINE_STATISTICS;
-        device_->CreateQuery(&queryDesc, &pipelineQuery_);
-    }
-
     void CreateConstantBuffers()
     {
         D3D11_BUFFER_DESC cbDesc;
@@ -970,7 +1236,34 @@ private:
         context->CSSetUnorderedAccessViews(0, 1, uavViews, initialCounts);
     }
 
-    void RenderGeometryDefault(ID3D11DeviceContext *context, FilterContext & /* filterContext */) const
+    /**
+    Upload the frame constants of a view, and set its viewport for a multi-
+    view pass. The previous contents of the constant buffer are discarded,
+    draws and dispatches issued before keep the old view.
+    */
+    void SetView(ID3D11DeviceContext *context, const int view)
+    {
+        const FilterContext &filterContext = filterContexts_[view];
+
+        frameConstantBufferBackingStore_.view = filterContext.view;
+        frameConstantBufferBackingStore_.projection = filterContext.projection;
+        frameConstantBufferBackingStore_.height = filterContext.windowHeight;
+        frameConstantBufferBackingStore_.width = filterContext.windowWidth;
+        frameConstantBufferBackingStore_.cullFlags = filterContext.options->enabledFilters;
+
+        D3D11_MAPPED_SUBRESOURCE mapping;
+        context->Map(frameConstantBuffer_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapping);
+        ::memcpy(mapping.pData, &frameConstantBufferBackingStore_,
+            sizeof(frameConstantBufferBackingStore_));
+        context->Unmap(frameConstantBuffer_.Get(), 0);
+
+        if (setViewports_)
+        {
+            context->RSSetViewports(1, &viewports_[view]);
+        }
+    }
+
+    void RenderGeometryDefault(ID3D11DeviceContext *context)
     {
         assert(context);
         ComPtr<ID3DUserDefinedAnnotation> annotation;
@@ -985,19 +1278,35 @@ private:
             annotation->BeginEvent(L"Depth pass");
         }
 
-        for (std::vector<DrawCommand>::const_iterator it = drawCommands_.begin(),
-            end = drawCommands_.end();
-            it != end; ++it)
+        for (int view = 0; view < viewCount_; ++view)
         {
-            ID3D11Buffer *vertexBuffers[] = { it->mesh->vertexBuffer.Get() };
-            UINT strides[] = { sizeof(float) * 3 };
-            UINT offsets[] = { static_cast<UINT>(it->mesh->vertexOffset) };
-            context->IASetVertexBuffers(0, 1, vertexBuffers, strides, offsets);
-            context->IASetIndexBuffer(
-                it->mesh->indexBuffer.Get(), DXGI_FORMAT_R32_UINT, it->mesh->indexOffset);
-            ID3D11Buffer *constantBuffers[] = { drawCallConstantBuffers_[it->drawCallId].Get() };
-            context->VSSetConstantBuffers(0, 1, constantBuffers);
-            context->DrawIndexed(it->mesh->indexCount, 0, 0);
+            SetView(context, view);
+
+            for (std::vector<DrawCommand>::const_iterator it = drawCommands_.begin(),
+                end = drawCommands_.end();
+                it != end; ++it)
+            {
+                // The draw constants depend on the view, so they are uploaded
+                // here instead of when the draw is recorded
+                DrawCallArguments dcb = it->dcb;
+                dcb.worldView = it->dcb.world * filterContexts_[view].view;
+
+                D3D11_MAPPED_SUBRESOURCE mapping;
+                context->Map(drawCallConstantBuffers_[it->drawCallId].Get(), 0,
+                    D3D11_MAP_WRITE_DISCARD, 0, &mapping);
+                ::memcpy(mapping.pData, &dcb, sizeof(dcb));
+                context->Unmap(drawCallConstantBuffers_[it->drawCallId].Get(), 0);
+
+                ID3D11Buffer *vertexBuffers[] = { it->mesh->vertexBuffer.Get() };
+                UINT strides[] = { sizeof(float) * 3 };
+                UINT offsets[] = { static_cast<UINT>(it->mesh->vertexOffset) };
+                context->IASetVertexBuffers(0, 1, vertexBuffers, strides, offsets);
+                context->IASetIndexBuffer(
+                    it->mesh->indexBuffer.Get(), DXGI_FORMAT_R32_UINT, it->mesh->indexOffset);
+                ID3D11Buffer *constantBuffers[] = { drawCallConstantBuffers_[it->drawCallId].Get() };
+                context->VSSetConstantBuffers(0, 1, constantBuffers);
+                context->DrawIndexed(it->mesh->indexCount, 0, 0);
+            }
         }
 
         if (annotation.Get() != nullptr)
@@ -1006,99 +1315,342 @@ private:
         }
     }
 
-    void RenderGeometryChunked(ID3D11DeviceContext *context, FilterContext &filterContext) const
+    void RasterizeOccluders(FilterContext &filterContext)
     {
-        if (drawCommands_.empty())
+        if (!occlusionBuffer_ ||
+            (filterContext.options->enabledFilters & GeometryFX_ClusterFilterOcclusion) == 0)
         {
+            // The history would be stale once occlusion culling is enabled
+            // again
+            clusterVisibility_.Reset();
             return;
         }
 
-        ComPtr<ID3DUserDefinedAnnotation> annotation;
-        context->QueryInterface(IID_PPV_ARGS(&annotation)); // QueryInterface can fail with E_NOINTERFACE
+        occlusionBuffer_->Clear();
 
-        int currentSmallBatchChunk = 0;
+        int64 rasterizedTriangles = 0;
 
-        context->IASetInputLayout(depthOnlyLayoutMID_.Get());
-        ID3D11VertexShader *vertexShader = depthOnlyVertexShaderMID_.Get();
+        for (std::vector<DrawCommand>::const_iterator it = drawCommands_.begin(),
+            end = drawCommands_.end();
+            it != end; ++it)
+        {
+            const StaticMesh *mesh = it->mesh;
 
-        if (annotation.Get() != nullptr)
+            if (mesh->isOccluder)
+            {
+                occlusionBuffer_->RasterizeTriangles(it->dcb.world * filterContext.viewProjection,
+                    mesh->occluderVertices.data(), mesh->vertexCount,
+                    mesh->occluderIndices.data(), mesh->indexCount);
+                rasterizedTriangles += mesh->faceCount;
+            }
+        }
+
+        if (temporalOcclusion_)
         {
-            annotation->BeginEvent(L"Depth pass");
+            rasterizedTriangles += RasterizeTemporalOccluders(drawCommands_,
+                filterContext.viewProjection,
+                filterContext.options->temporalOccluderTriangleBudget, clusterVisibility_,
+                *occlusionBuffer_);
+            filterContext.clusterVisibility = &clusterVisibility_;
         }
 
-        for (std::vector<DrawCommand>::const_iterator it = drawCommands_.begin(),
-            end = drawCommands_.end();
-            it != end; ++it)
+        occlusionBuffer_->BuildHierarchy();
+        filterContext.occlusionBuffer = occlusionBuffer_.get();
+
+        if (filterContext.options->statistics)
+        {
+            filterContext.options->statistics->occluderTrianglesRasterized += rasterizedTriangles;
+        }
+    }
+
+    ComPtr<ID3D11Query> AcquireStatisticsQuery()
+    {
+        ComPtr<ID3D11Query> query;
+
+        if (freeStatisticsQueries_.empty())
+        {
+            D3D11_QUERY_DESC queryDesc;
+            queryDesc.MiscFlags = 0;
+            queryDesc.Query = D3D11_QUERY_PIPELINE_STATISTICS;
+            device_->CreateQuery(&queryDesc, &query);
+        }
+        else
+        {
+            query = freeStatisticsQueries_.back();
+            freeStatisticsQueries_.pop_back();
+        }
+
+        return query;
+    }
+
+    /**
+    Read back the statistics queries the GPU is done with. The queries may
+    have been issued on a deferred context, so they are always read on the
+    immediate context. They are polled without flushing, so this never waits
+    for the GPU.
+    */
+    void CollectPipelineStatistics()
+    {
+        while (!pendingStatisticsQueries_.empty())
         {
-            DrawCommand current = *it;
-            DrawCommand next;
+            const PipelineStatisticsQuery &query = pendingStatisticsQueries_.front();
+
+            D3D11_QUERY_DATA_PIPELINE_STATISTICS stats;
+            if (immediateContext_->GetData(query.query.Get(), &stats, sizeof(stats),
+                D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+            {
+                break;
+            }
+
+            // The pass may have dropped out of the history already
+            for (std::deque<PassStatistics>::iterator it = passStatistics_.begin(),
+                end = passStatistics_.end();
+                it != end; ++it)
+            {
+                if (it->statistics.passIndex == query.passIndex)
+                {
+                    it->statistics.trianglesRendered += stats.IAPrimitives;
+                    it->statistics.trianglesCulled +=
+                        query.trianglesSubmitted - static_cast<int64>(stats.IAPrimitives);
+                    --it->pendingQueries;
+                    break;
+                }
+            }
+
+            freeStatisticsQueries_.push_back(query.query);
+            pendingStatisticsQueries_.pop_front();
+        }
+    }
+
+    /**
+    Merge the chunks of the pass into filter dispatches and write their
+    batches and draws into the upload rings, one segment per dispatch, with
+    a single map per ring. Consecutive chunks of a view share a dispatch as
+    long as their batches fit, which are rebased to follow each other.
+    The segments of a dispatch have the same index in both rings. Returns
+    the segment of the first dispatch.
+    */
+    int UploadSmallBatchChunks(ID3D11DeviceContext *context)
+    {
+        filterDispatches_.clear();
 
-            while (smallBatchChunks_[currentSmallBatchChunk]->AddRequest(current, next, filterContext))
+        for (int view = 0; view < viewCount_; ++view)
+        {
+            for (int i = 0; i < smallBatchPacker_.GetChunkCount(view); ++i)
             {
-                const int trianglesInBatch =
-                    smallBatchChunks_[currentSmallBatchChunk]->GetFaceCount();
+                const SmallBatchChunkData &chunkData = smallBatchPacker_.GetChunk(view, i);
+
+                if (filterDispatches_.empty() || filterDispatches_.back().view != view
+                    || filterDispatches_.back().batchCount + chunkData.GetBatchCount()
+                        > dispatchBatchCount_)
+                {
+                    FilterDispatch dispatch;
+                    dispatch.view = view;
+                    dispatch.batchCount = 0;
+                    dispatch.drawCallCount = 0;
+                    dispatch.faceCount = 0;
+                    filterDispatches_.push_back(dispatch);
+                }
+
+                FilterDispatch &dispatch = filterDispatches_.back();
+                dispatch.batchCount += chunkData.GetBatchCount();
+                dispatch.drawCallCount += chunkData.GetDrawCallCount();
+                dispatch.faceCount += chunkData.GetFaceCount();
+            }
+        }
+
+        if (filterDispatches_.empty())
+        {
+            return 0;
+        }
 
-                if (filterContext.options->statistics)
+        const int dispatchCount = static_cast<int>(filterDispatches_.size());
+
+        int firstSegment = 0;
+        int firstDrawCallSegment = 0;
+        void *smallBatchData = smallBatchDataRing_->Map(context, dispatchCount, &firstSegment);
+        void *drawCalls = drawCallRing_->Map(context, dispatchCount, &firstDrawCallSegment);
+        assert(firstSegment == firstDrawCallSegment);
+
+        int dispatch = -1;
+        int batchBase = 0;
+        int drawCallBase = 0;
+
+        for (int view = 0; view < viewCount_; ++view)
+        {
+            for (int i = 0; i < smallBatchPacker_.GetChunkCount(view); ++i)
+            {
+                const SmallBatchChunkData &chunkData = smallBatchPacker_.GetChunk(view, i);
+                const auto &chunkSmallBatchData = chunkData.GetSmallBatchData();
+                const auto &chunkDrawCalls = chunkData.GetDrawCallArguments();
+
+                // Same walk as above, a dispatch starts with the first chunk
+                // which doesn't fit the previous one
+                if (dispatch < 0 || filterDispatches_[dispatch].view != view
+                    || batchBase + chunkData.GetBatchCount() > filterDispatches_[dispatch].batchCount)
                 {
-                    filterContext.options->statistics->trianglesProcessed += trianglesInBatch;
-                    context->Begin(pipelineQuery_.Get());
+                    ++dispatch;
+                    batchBase = 0;
+                    drawCallBase = 0;
                 }
 
-                // Overflow, submit this batch and continue with next one
-                smallBatchChunks_[currentSmallBatchChunk]->Render(context,
-                    clearDrawIndirectArgumentsComputeShader_.Get(),
-                    filterComputeShader_.Get(),
-                    vertexShader, meshManager_->GetVertexBufferSRV(),
-                    meshManager_->GetIndexBufferSRV(), meshManager_->GetMeshConstantsBuffer(),
-                    meshManager_->GetVertexBuffer(), frameConstantBuffer_.Get());
+                const SmallBatchData *batches = chunkSmallBatchData.data();
 
-                if (filterContext.options->statistics)
+                if (batchBase > 0)
                 {
-                    context->End(pipelineQuery_.Get());
+                    // The output space of each batch follows from its index
+                    // in the dispatch, see SmallBatchChunkData::AddRequest()
+                    smallBatchDataScratch_.assign(chunkSmallBatchData.begin(), chunkSmallBatchData.end());
 
-                    D3D11_QUERY_DATA_PIPELINE_STATISTICS stats;
-                    while (context->GetData(pipelineQuery_.Get(), &stats, sizeof(stats), 0) != S_OK)
+                    for (std::vector<SmallBatchData>::iterator it = smallBatchDataScratch_.begin(),
+                        end = smallBatchDataScratch_.end();
+                        it != end; ++it)
                     {
-                        Yield();
+                        it->outputIndexOffset += batchBase * smallBatchSize_ * 3 * sizeof(int);
+                        it->drawIndex += drawCallBase;
+                        it->drawBatchStart += batchBase;
                     }
 
-                    filterContext.options->statistics->trianglesRendered += stats.IAPrimitives;
-                    filterContext.options->statistics->trianglesCulled +=
-                        (trianglesInBatch - stats.IAPrimitives);
+                    batches = smallBatchDataScratch_.data();
                 }
 
-                current = next;
-                currentSmallBatchChunk = (currentSmallBatchChunk + 1) % smallBatchChunks_.size();
+                smallBatchDataRing_->Write(smallBatchData, dispatch, batchBase, batches,
+                    chunkData.GetBatchCount());
+                drawCallRing_->Write(drawCalls, dispatch, drawCallBase, chunkDrawCalls.data(),
+                    chunkData.GetDrawCallCount());
+
+                batchBase += chunkData.GetBatchCount();
+                drawCallBase += chunkData.GetDrawCallCount();
             }
         }
 
-        const int trianglesInBatch = smallBatchChunks_[currentSmallBatchChunk]->GetFaceCount();
-        if (filterContext.options->statistics)
+        smallBatchDataRing_->Unmap(context);
+        drawCallRing_->Unmap(context);
+
+        return firstSegment;
+    }
+
+    void RenderGeometryChunked(ID3D11DeviceContext *context)
+    {
+        if (drawCommands_.empty())
         {
-            context->Begin(pipelineQuery_.Get());
-            filterContext.options->statistics->trianglesProcessed += trianglesInBatch;
+            return;
         }
 
-        smallBatchChunks_[currentSmallBatchChunk]->Render(context,
-            clearDrawIndirectArgumentsComputeShader_.Get(),
-            filterComputeShader_.Get(),
-            vertexShader, meshManager_->GetVertexBufferSRV(), meshManager_->GetIndexBufferSRV(),
-            meshManager_->GetMeshConstantsBuffer(), meshManager_->GetVertexBuffer(),
-            frameConstantBuffer_.Get());
+        ComPtr<ID3DUserDefinedAnnotation> annotation;
+        context->QueryInterface(IID_PPV_ARGS(&annotation)); // QueryInterface can fail with E_NOINTERFACE
 
-        if (filterContext.options->statistics)
+        const GeometryFX_FilterRenderOptions *options = filterContexts_[0].options;
+        GeometryFX_FilterStatistics *statistics = options->statistics;
+
+        // The draws were visited in the recorded order up to here, the
+        // temporal occluders rely on it
+        if (options->sortDrawsByMesh)
         {
-            context->End(pipelineQuery_.Get());
+            SortDrawCommandsByMesh(drawCommands_, static_cast<int>(handles_.size()),
+                sortedDrawCommands_);
+        }
 
-            D3D11_QUERY_DATA_PIPELINE_STATISTICS stats;
-            while (context->GetData(pipelineQuery_.Get(), &stats, sizeof(stats), 0) != S_OK)
+        // The culling and packing of all draw commands runs on the worker
+        // threads, only the submission below uses the context
+        smallBatchPacker_.Pack(*workerPool_, drawCommands_, filterContexts_, viewCount_,
+            statistics);
+
+        const int64 mapCount = smallBatchDataRing_->GetMapCount() + drawCallRing_->GetMapCount();
+        const int64 bytesUploaded =
+            smallBatchDataRing_->GetBytesWritten() + drawCallRing_->GetBytesWritten();
+        const int firstSegment = UploadSmallBatchChunks(context);
+
+        context->IASetInputLayout(depthOnlyLayoutMID_.Get());
+        ID3D11VertexShader *vertexShader = depthOnlyVertexShaderMID_.Get();
+
+        if (annotation.Get() != nullptr)
+        {
+            annotation->BeginEvent(L"Depth pass");
+        }
+
+        const int dispatchCount = static_cast<int>(filterDispatches_.size());
+        int firstDispatch = 0;
+
+        for (int view = 0; view < viewCount_; ++view)
+        {
+            int endDispatch = firstDispatch;
+
+            while (endDispatch < dispatchCount && filterDispatches_[endDispatch].view == view)
+            {
+                ++endDispatch;
+            }
+
+            if (endDispatch == firstDispatch)
+            {
+                continue;
+            }
+
+            SetView(context, view);
+
+            // All dispatches of the view are filtered before the first draw,
+            // so the GPU switches from compute to drawing once per view
+            dispatchChunks_.clear();
+
+            for (int i = firstDispatch; i < endDispatch; ++i)
+            {
+                const FilterDispatch &dispatch = filterDispatches_[i];
+                SmallBatchChunk *chunk = smallBatchChunkPool_->Acquire(dispatch.batchCount);
+
+                chunk->Filter(context, dispatch.batchCount, dispatch.drawCallCount,
+                    smallBatchDataRing_->GetSegmentSRV(firstSegment + i),
+                    drawCallRing_->GetSegmentSRV(firstSegment + i),
+                    clearDrawIndirectArgumentsComputeShader_.Get(), filterComputeShader_.Get(),
+                    meshManager_->GetVertexBufferSRV(), meshManager_->GetIndexBufferSRV(),
+                    meshManager_->GetMeshConstantsBuffer(), frameConstantBuffer_.Get());
+
+                dispatchChunks_.push_back(chunk);
+            }
+
+            for (int i = firstDispatch; i < endDispatch; ++i)
             {
-                Yield();
+                const FilterDispatch &dispatch = filterDispatches_[i];
+
+                if (statistics)
+                {
+                    statistics->trianglesProcessed += dispatch.faceCount;
+                    statistics->batchesProcessed += dispatch.batchCount;
+                    statistics->batchThreadsProcessed += dispatch.batchCount * smallBatchSize_;
+                    ++statistics->filterDispatchCount;
+
+                    PipelineStatisticsQuery query;
+                    query.query = AcquireStatisticsQuery();
+                    query.passIndex = statistics->passIndex;
+                    query.trianglesSubmitted = dispatch.faceCount;
+                    pendingStatisticsQueries_.push_back(query);
+                    ++passQueryCount_;
+
+                    context->Begin(query.query.Get());
+                }
+
+                dispatchChunks_[i - firstDispatch]->Draw(context, dispatch.drawCallCount,
+                    drawCallRing_->GetSegmentSRV(firstSegment + i), vertexShader,
+                    meshManager_->GetVertexBuffer());
+
+                if (statistics)
+                {
+                    context->End(pendingStatisticsQueries_.back().query.Get());
+                }
             }
 
-            filterContext.options->statistics->trianglesRendered += stats.IAPrimitives;
-            filterContext.options->statistics->trianglesCulled +=
-                (trianglesInBatch - stats.IAPrimitives);
+            firstDispatch = endDispatch;
+        }
+
+        smallBatchChunkPool_->EndPass();
+
+        if (statistics)
+        {
+            statistics->smallBatchChunkCount = smallBatchChunkPool_->GetChunkCount();
+            statistics->smallBatchChunkHighWaterMark = smallBatchChunkPool_->GetHighWaterMark();
+            statistics->uploadMapCount += smallBatchDataRing_->GetMapCount()
+                + drawCallRing_->GetMapCount() - mapCount;
+            statistics->uploadBytes += smallBatchDataRing_->GetBytesWritten()
+                + drawCallRing_->GetBytesWritten() - bytesUploaded;
         }
 
         if (annotation.Get() != nullptr)
@@ -1142,6 +1694,24 @@ void GeometryFX_Filter::SetMeshData(const GeometryFX_Filter::MeshHandle &handle,
     impl_->SetMeshData(handle, vertexData, indexData);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void GeometryFX_Filter::SetMeshData(const int meshCount, const GeometryFX_Filter::MeshHandle *handles,
+    const void *const *vertexData, const void *const *indexData)
+{
+    assert(meshCount >= 0);
+    assert(handles != nullptr);
+    assert(vertexData != nullptr);
+    assert(indexData != nullptr);
+
+    impl_->SetMeshData(meshCount, handles, vertexData, indexData);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GeometryFX_Filter::SetMeshOccluder(const MeshHandle &handle, const bool isOccluder)
+{
+    impl_->SetMeshOccluder(handle, isOccluder);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 void GeometryFX_Filter::BeginRender(ID3D11DeviceContext *context, const GeometryFX_FilterRenderOptions &options,
     const DirectX::XMMATRIX &view, const DirectX::XMMATRIX &projection, const int windowWidth,
@@ -1151,20 +1721,43 @@ void GeometryFX_Filter::BeginRender(ID3D11DeviceContext *context, const Geometry
     assert(windowWidth > 0);
     assert(windowHeight > 0);
 
-    FilterContext filterContext;
-    filterContext.options = &options;
-    filterContext.projection = projection;
-    filterContext.view = view;
-    filterContext.windowWidth = windowWidth;
-    filterContext.windowHeight = windowHeight;
+    const FilterContext filterContext =
+        CreateFilterContext(options, view, projection, windowWidth, windowHeight);
+
+    impl_->BeginRender(context, 1, &filterContext, nullptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GeometryFX_Filter::BeginRenderMultiView(ID3D11DeviceContext *context,
+    const GeometryFX_FilterRenderOptions &options, const int viewCount,
+    const GeometryFX_FilterView *views)
+{
+    assert(context != nullptr);
+    assert(viewCount > 0 && viewCount <= GeometryFX_FilterMaximumViewCount);
+    assert(views != nullptr);
+
+    FilterContext filterContexts[GeometryFX_FilterMaximumViewCount];
+    D3D11_VIEWPORT viewports[GeometryFX_FilterMaximumViewCount];
+
+    for (int i = 0; i < viewCount; ++i)
+    {
+        const GeometryFX_FilterView &view = views[i];
 
-    const auto inverseView = DirectX::XMMatrixInverse (nullptr, view);
-    DirectX::XMFLOAT4X4 float4x4;
-    XMStoreFloat4x4 (&float4x4, inverseView);
+        assert(view.viewportWidth > 0);
+        assert(view.viewportHeight > 0);
 
-    filterContext.eye = DirectX::XMVectorSet (float4x4._41, float4x4._42, float4x4._43, 1);
+        filterContexts[i] = CreateFilterContext(options, view.view, view.projection,
+            view.viewportWidth, view.viewportHeight);
 
-    impl_->BeginRender(context, filterContext);
+        viewports[i].TopLeftX = static_cast<float>(view.viewportX);
+        viewports[i].TopLeftY = static_cast<float>(view.viewportY);
+        viewports[i].Width = static_cast<float>(view.viewportWidth);
+        viewports[i].Height = static_cast<float>(view.viewportHeight);
+        viewports[i].MinDepth = 0;
+        viewports[i].MaxDepth = 1;
+    }
+
+    impl_->BeginRender(context, viewCount, filterContexts, viewports);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1177,7 +1770,21 @@ void GeometryFX_Filter::RenderMesh(const GeometryFX_Filter::MeshHandle &handle,
 void GeometryFX_Filter::RenderMeshInstanced(
     const GeometryFX_Filter::MeshHandle &handle, const int instanceCount, const DirectX::XMMATRIX *worlds)
 {
-    impl_->RenderMeshInstanced(handle, instanceCount, worlds);
+    impl_->RenderMeshInstanced(handle, instanceCount, worlds, nullptr, GeometryFX_WorldTransformGeneral);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GeometryFX_Filter::RenderMeshInstanced(const GeometryFX_Filter::MeshHandle &handle,
+    const int instanceCount, const DirectX::XMMATRIX *worlds, const GEOMETRYFX_WORLD_TRANSFORM transform)
+{
+    impl_->RenderMeshInstanced(handle, instanceCount, worlds, nullptr, transform);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GeometryFX_Filter::RenderMeshInstanced(const GeometryFX_Filter::MeshHandle &handle,
+    const int instanceCount, const DirectX::XMMATRIX *worlds, const DirectX::XMMATRIX *inverseWorlds)
+{
+    impl_->RenderMeshInstanced(handle, instanceCount, worlds, inverseWorlds, GeometryFX_WorldTransformGeneral);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1199,4 +1806,27 @@ void GeometryFX_Filter::GetMeshInfo(const MeshHandle &handle, int32 *indexCount)
     impl_->GetMeshInfo(handle, indexCount);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+void GeometryFX_Filter::GetSmallBatchInfo(int32 *smallBatchSize, int32 *smallBatchCount) const
+{
+    impl_->GetSmallBatchInfo(smallBatchSize, smallBatchCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool GeometryFX_Filter::GetStatistics(const int64 passIndex, GeometryFX_FilterStatistics *statistics)
+{
+    assert(statistics != nullptr);
+
+    return impl_->GetStatistics(passIndex, statistics);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GeometryFX_Filter::GetClusterStatistics(
+    const MeshHandle &handle, GeometryFX_ClusterStatistics *statistics) const
+{
+    assert(statistics != nullptr);
+
+    impl_->GetClusterStatistics(handle, statistics);
+}
+
 } // namespace AMD
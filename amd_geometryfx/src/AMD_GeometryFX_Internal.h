@@ -28,9 +28,24 @@ namespace GeometryFX_Internal
 {
 struct SmallBatchMergeConstants
 {
-    // If this changes, the shaders have to be recompiled as well
+    // BATCH_SIZE is the thread group size of the filter shader, BATCH_COUNT
+    // the default of GeometryFX_FilterDesc::smallBatchCount. The CPU side
+    // also handles batch sizes from MINIMUM_BATCH_SIZE to MAXIMUM_BATCH_SIZE.
     static const int BATCH_SIZE = 4 * 64; // Should be a multiple of the wavefront size
     static const int BATCH_COUNT = 1 * 384;
+
+    static const int MINIMUM_BATCH_SIZE = 64;
+    static const int MAXIMUM_BATCH_SIZE = 512;
+
+    // Smallest number of batches the buffers of a dispatch are created for
+    static const int MINIMUM_BATCH_COUNT = 64;
+
+    // At most one thread group per dispatch dimension
+    static const int MAXIMUM_BATCH_COUNT = 65535;
+
+    // Upper bound for the triangles of a single cluster, given by the packed
+    // cluster format. Larger batches hold several clusters.
+    static const int MAXIMUM_CLUSTER_SIZE = 256;
 };
 }
 }
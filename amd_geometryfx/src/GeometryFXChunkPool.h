@@ -0,0 +1,145 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_GEOMETRYFX_CHUNK_POOL_H
+#define AMD_GEOMETRYFX_CHUNK_POOL_H
+
+#include <algorithm>
+#include <climits>
+#include <deque>
+#include <functional>
+#include <memory>
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+
+/**
+The chunks of filter dispatches in use, ordered by submission. A chunk is
+only reused once the GPU is done with it, which is checked for the oldest
+chunk only. If it is still in flight, a new chunk is created instead of
+waiting for it, so the pool grows to the number of chunks submitted per
+pass times the number of passes the GPU is behind.
+
+To give memory back after a busy scene, the number of chunks which are idle
+at the end of a pass is tracked. Chunks which stayed idle in all passes of
+a trim interval are released. The high-water mark keeps the most chunks
+that were ever allocated at once.
+
+Chunk must provide bool IsIdle (), which polls the GPU, and
+void Reserve (int batchCount). New chunks are made by createChunk.
+*/
+template <typename Chunk>
+class ChunkPool
+{
+public:
+    enum
+    {
+        TRIM_INTERVAL = 128
+    };
+
+    explicit ChunkPool (const std::function<Chunk * ()> &createChunk)
+        : createChunk_ (createChunk)
+        , highWaterMark_ (0)
+        , passesSinceTrim_ (0)
+        , minimumIdleChunks_ (INT_MAX)
+    {
+    }
+
+    /**
+    Get a chunk which holds batchCount batches. The chunk moves to the back
+    of the pool and stays in use until it was drawn.
+    */
+    Chunk *Acquire (const int batchCount)
+    {
+        if (!chunks_.empty () && chunks_.front ()->IsIdle ())
+        {
+            chunks_.push_back (std::move (chunks_.front ()));
+            chunks_.pop_front ();
+        }
+        else
+        {
+            chunks_.emplace_back (createChunk_ ());
+            highWaterMark_ = std::max (highWaterMark_, static_cast<int> (chunks_.size ()));
+        }
+
+        chunks_.back ()->Reserve (batchCount);
+
+        return chunks_.back ().get ();
+    }
+
+    /**
+    Call at the end of each pass, after all chunks were rendered.
+    */
+    void EndPass ()
+    {
+        int idleChunks = 0;
+
+        for (typename std::deque<std::unique_ptr<Chunk>>::iterator it = chunks_.begin (),
+            end = chunks_.end ();
+            it != end && (*it)->IsIdle (); ++it)
+        {
+            ++idleChunks;
+        }
+
+        minimumIdleChunks_ = std::min (minimumIdleChunks_, idleChunks);
+
+        if (++passesSinceTrim_ < TRIM_INTERVAL)
+        {
+            return;
+        }
+
+        // Idle chunks are at the front, releasing them doesn't affect the GPU
+        chunks_.erase (chunks_.begin (), chunks_.begin () + minimumIdleChunks_);
+
+        passesSinceTrim_ = 0;
+        minimumIdleChunks_ = INT_MAX;
+    }
+
+    int GetChunkCount () const
+    {
+        return static_cast<int> (chunks_.size ());
+    }
+
+    int GetHighWaterMark () const
+    {
+        return highWaterMark_;
+    }
+
+private:
+    ChunkPool (const ChunkPool &);
+    ChunkPool &operator= (const ChunkPool &);
+
+    std::function<Chunk * ()> createChunk_;
+
+    std::deque<std::unique_ptr<Chunk>> chunks_;
+    int highWaterMark_;
+    int passesSinceTrim_;
+    int minimumIdleChunks_;
+};
+
+} // namespace GeometryFX_Internal
+} // namespace AMD
+
+#endif // AMD_GEOMETRYFX_CHUNK_POOL_H
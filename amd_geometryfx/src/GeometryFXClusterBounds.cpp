@@ -0,0 +1,976 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXClusterBounds.h"
+
+#include "AMD_GeometryFX_Internal.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_SSE2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_SSE2 0
+#endif
+
+// MSVC accepts AVX intrinsics in any function, other compilers only if the
+// whole file is compiled for AVX
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_SSE2 && (defined(_MSC_VER) || defined(__AVX__))
+#define AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_AVX 1
+#else
+#define AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_AVX 0
+#endif
+
+#define AMD_GEOMETRY_FX_ENABLE_CLUSTER_CENTER_SAFETY_CHECK 1
+
+#ifdef min
+#undef min
+#endif
+
+#ifdef max
+#undef max
+#endif
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+struct Triangle
+{
+    DirectX::XMVECTOR vtx[3];
+};
+
+DirectX::XMVECTOR LoadVertex(const float *vertices, const int32 index)
+{
+    return DirectX::XMVectorSet(
+        vertices[index * 3 + 0], vertices[index * 3 + 1], vertices[index * 3 + 2], 1.0f);
+}
+
+/**
+Write the bounds to the cluster and run the validity checks which are shared
+between all kernels.
+*/
+void StoreClusterBounds(const DirectX::XMVECTOR aabbMin, const DirectX::XMVECTOR aabbMax,
+    const DirectX::XMVECTOR center, const DirectX::XMVECTOR coneAxis, const float t,
+    const float coneOpening, bool validCluster, Cluster &cluster)
+{
+    cluster.aabbMax = aabbMax;
+    cluster.aabbMin = aabbMin;
+
+    // cos (PI/2 - acos (coneOpening))
+    cluster.coneAngleCosine = sqrtf(1 - coneOpening * coneOpening);
+    cluster.coneCenter = DirectX::XMVectorAdd(center,
+        DirectX::XMVectorMultiply(coneAxis, DirectX::XMVectorSet(t, t, t, t)));
+    cluster.coneAxis = coneAxis;
+
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_CENTER_SAFETY_CHECK
+    // If distance of coneCenter to the bounding box center is more
+    // than 16x the bounding box extent, the cluster is also invalid
+    // This is mostly a safety measure - if triangles are nearly
+    // parallel to coneAxis, t may become very large and unstable
+    const float aabbSize = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(aabbMax, aabbMin)));
+    const float coneCenterToCenterDistance = DirectX::XMVectorGetX(
+        DirectX::XMVector3Length(
+            DirectX::XMVectorSubtract(cluster.coneCenter,
+                DirectX::XMVectorDivide(
+                    DirectX::XMVectorAdd(aabbMax, aabbMin),
+                    DirectX::XMVectorSet(2, 2, 2, 2))
+    )));
+
+    if (coneCenterToCenterDistance > (16 * aabbSize))
+    {
+        validCluster = false;
+    }
+#endif
+
+    cluster.valid = validCluster;
+}
+
+bool IsDegenerateNormal(const float x, const float y, const float z)
+{
+    // XMVector3Normalize returns zero for zero-length vectors
+    return x == 0 && y == 0 && z == 0;
+}
+
+/**
+A spherical cap on the unit sphere, given by its axis and the cosine of its
+half-angle.
+*/
+struct Cap
+{
+    DirectX::XMVECTOR axis;
+    float cosine;
+};
+
+// Slack for directions which lie on the boundary of a cap
+const float CAP_EPSILON = 1e-5f;
+
+bool CapContains(const Cap &cap, const DirectX::XMVECTOR direction)
+{
+    return DirectX::XMVectorGetX(DirectX::XMVector3Dot(cap.axis, direction))
+        >= cap.cosine - CAP_EPSILON;
+}
+
+bool CapFromTwoDirections(const DirectX::XMVECTOR a, const DirectX::XMVECTOR b, Cap &cap)
+{
+    const auto sum = DirectX::XMVectorAdd(a, b);
+    if (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(sum)) < CAP_EPSILON)
+    {
+        // Opposite directions
+        return false;
+    }
+
+    cap.axis = DirectX::XMVector3Normalize(sum);
+    cap.cosine = DirectX::XMVectorGetX(DirectX::XMVector3Dot(cap.axis, a));
+    return true;
+}
+
+bool CapFromThreeDirections(const DirectX::XMVECTOR a, const DirectX::XMVECTOR b,
+    const DirectX::XMVECTOR c, Cap &cap)
+{
+    // The boundary of the cap is the circle through a, b and c, so the axis
+    // is the normal of the plane through them
+    auto axis = DirectX::XMVector3Cross(
+        DirectX::XMVectorSubtract(b, a), DirectX::XMVectorSubtract(c, a));
+
+    if (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(axis)) < CAP_EPSILON * CAP_EPSILON)
+    {
+        // Two of the directions (nearly) coincide, use the widest pair
+        Cap ab, bc, ca;
+        if (!CapFromTwoDirections(a, b, ab) || !CapFromTwoDirections(b, c, bc)
+            || !CapFromTwoDirections(c, a, ca))
+        {
+            return false;
+        }
+
+        cap = ab;
+        if (bc.cosine < cap.cosine) cap = bc;
+        if (ca.cosine < cap.cosine) cap = ca;
+        return true;
+    }
+
+    axis = DirectX::XMVector3Normalize(axis);
+    if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(axis, a)) < 0)
+    {
+        axis = DirectX::XMVectorNegate(axis);
+    }
+
+    cap.axis = axis;
+    cap.cosine = DirectX::XMVectorGetX(DirectX::XMVector3Dot(axis, a));
+    return true;
+}
+
+/**
+Find the smallest cone which contains all negated triangle normals. Degenerate
+triangles have no normal and are skipped.
+
+This is Welzl's smallest enclosing circle algorithm on the unit sphere: each
+cap is defined by at most three directions on its boundary. The caps only
+grow, so once a cap is a hemisphere or more, no valid cone exists and the
+search stops. The directions are visited in a fixed pseudo-random order to
+get the expected linear run time on sorted input.
+*/
+bool ComputeMinimalConeAxis(const float *normalX, const float *normalY, const float *normalZ,
+    const int count, DirectX::XMVECTOR &coneAxis)
+{
+    std::array<DirectX::XMVECTOR, SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE> directions;
+    int directionCount = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (!IsDegenerateNormal(normalX[i], normalY[i], normalZ[i]))
+        {
+            directions[directionCount++] =
+                DirectX::XMVectorSet(-normalX[i], -normalY[i], -normalZ[i], 0);
+        }
+    }
+
+    if (directionCount == 0)
+    {
+        return false;
+    }
+
+    // Fisher-Yates shuffle with a fixed linear congruential generator, so the
+    // result does not depend on the standard library
+    uint32 state = 0x9E3779B9u;
+    for (int i = directionCount - 1; i > 0; --i)
+    {
+        state = state * 1664525u + 1013904223u;
+        std::swap(directions[i], directions[(state >> 8) % (i + 1)]);
+    }
+
+    Cap cap = { directions[0], 1.0f };
+
+    for (int i = 1; i < directionCount; ++i)
+    {
+        if (CapContains(cap, directions[i]))
+        {
+            continue;
+        }
+
+        cap.axis = directions[i];
+        cap.cosine = 1.0f;
+
+        for (int j = 0; j < i; ++j)
+        {
+            if (CapContains(cap, directions[j]))
+            {
+                continue;
+            }
+
+            if (!CapFromTwoDirections(directions[i], directions[j], cap))
+            {
+                return false;
+            }
+
+            for (int k = 0; k < j; ++k)
+            {
+                if (CapContains(cap, directions[k]))
+                {
+                    continue;
+                }
+
+                const float previousCosine = cap.cosine;
+                if (!CapFromThreeDirections(directions[i], directions[j], directions[k], cap))
+                {
+                    return false;
+                }
+
+                // The caps only grow while i and j stay fixed. If the new one
+                // is smaller, the circle through i, j and k bounds the small
+                // side while the directions need the large one, which is more
+                // than a hemisphere.
+                if (cap.cosine <= 0 || cap.cosine > previousCosine + CAP_EPSILON)
+                {
+                    return false;
+                }
+            }
+
+            if (cap.cosine <= 0)
+            {
+                return false;
+            }
+        }
+    }
+
+    coneAxis = cap.axis;
+    return true;
+}
+
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_SSE2
+// The streams are padded to a multiple of this by repeating the last
+// triangle. Repeating a triangle does not change the bounds, the cone or the
+// validity, so the kernels do not need a remainder loop.
+const int TRIANGLE_STREAM_PADDING = 8;
+
+/**
+The triangles of one cluster as structure-of-arrays streams.
+*/
+struct TriangleStreams
+{
+    enum
+    {
+        V0_X, V0_Y, V0_Z,
+        V1_X, V1_Y, V1_Z,
+        V2_X, V2_Y, V2_Z,
+        POSITION_STREAM_COUNT
+    };
+
+    alignas(32) float position[POSITION_STREAM_COUNT][SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE];
+    alignas(32) float normal[3][SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE];
+};
+
+static_assert(SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE % TRIANGLE_STREAM_PADDING == 0,
+    "MAXIMUM_CLUSTER_SIZE must be a multiple of the triangle stream padding");
+
+/**
+Load the triangles of the cluster into the position streams and return the
+padded triangle count.
+*/
+int GatherTriangles(const float *vertices, const int32 *indices, const Cluster &cluster,
+    TriangleStreams &streams)
+{
+    const int triangleCount = cluster.triangleCount;
+
+    for (int i = 0; i < triangleCount; ++i)
+    {
+        const int32 *triangleIndices = indices + (cluster.firstTriangle + i) * 3;
+
+        for (int j = 0; j < 3; ++j)
+        {
+            const float *vertex = vertices + triangleIndices[j] * 3;
+            streams.position[j * 3 + 0][i] = vertex[0];
+            streams.position[j * 3 + 1][i] = vertex[1];
+            streams.position[j * 3 + 2][i] = vertex[2];
+        }
+    }
+
+    const int paddedCount = (triangleCount + TRIANGLE_STREAM_PADDING - 1)
+        / TRIANGLE_STREAM_PADDING * TRIANGLE_STREAM_PADDING;
+
+    for (int i = triangleCount; i < paddedCount; ++i)
+    {
+        for (int j = 0; j < TriangleStreams::POSITION_STREAM_COUNT; ++j)
+        {
+            streams.position[j][i] = streams.position[j][triangleCount - 1];
+        }
+    }
+
+    return paddedCount;
+}
+
+struct SSE2Ops
+{
+    typedef __m128 Vector;
+    static const int Width = 4;
+
+    static Vector Load(const float *p) { return _mm_load_ps(p); }
+    static void Store(float *p, const Vector v) { _mm_store_ps(p, v); }
+    static Vector Splat(const float f) { return _mm_set1_ps(f); }
+    static Vector Zero() { return _mm_setzero_ps(); }
+
+    static Vector Add(const Vector a, const Vector b) { return _mm_add_ps(a, b); }
+    static Vector Sub(const Vector a, const Vector b) { return _mm_sub_ps(a, b); }
+    static Vector Mul(const Vector a, const Vector b) { return _mm_mul_ps(a, b); }
+    static Vector Div(const Vector a, const Vector b) { return _mm_div_ps(a, b); }
+    static Vector Sqrt(const Vector a) { return _mm_sqrt_ps(a); }
+    static Vector Min(const Vector a, const Vector b) { return _mm_min_ps(a, b); }
+    static Vector Max(const Vector a, const Vector b) { return _mm_max_ps(a, b); }
+
+    static Vector And(const Vector a, const Vector b) { return _mm_and_ps(a, b); }
+    static Vector AndNot(const Vector a, const Vector b) { return _mm_andnot_ps(a, b); }
+    static Vector Or(const Vector a, const Vector b) { return _mm_or_ps(a, b); }
+    static Vector Xor(const Vector a, const Vector b) { return _mm_xor_ps(a, b); }
+
+    static Vector CompareNotEqual(const Vector a, const Vector b) { return _mm_cmpneq_ps(a, b); }
+    static bool AnyLess(const Vector a, const Vector b)
+    {
+        return _mm_movemask_ps(_mm_cmplt_ps(a, b)) != 0;
+    }
+};
+
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_AVX
+struct AVXOps
+{
+    typedef __m256 Vector;
+    static const int Width = 8;
+
+    static Vector Load(const float *p) { return _mm256_load_ps(p); }
+    static void Store(float *p, const Vector v) { _mm256_store_ps(p, v); }
+    static Vector Splat(const float f) { return _mm256_set1_ps(f); }
+    static Vector Zero() { return _mm256_setzero_ps(); }
+
+    static Vector Add(const Vector a, const Vector b) { return _mm256_add_ps(a, b); }
+    static Vector Sub(const Vector a, const Vector b) { return _mm256_sub_ps(a, b); }
+    static Vector Mul(const Vector a, const Vector b) { return _mm256_mul_ps(a, b); }
+    static Vector Div(const Vector a, const Vector b) { return _mm256_div_ps(a, b); }
+    static Vector Sqrt(const Vector a) { return _mm256_sqrt_ps(a); }
+    static Vector Min(const Vector a, const Vector b) { return _mm256_min_ps(a, b); }
+    static Vector Max(const Vector a, const Vector b) { return _mm256_max_ps(a, b); }
+
+    static Vector And(const Vector a, const Vector b) { return _mm256_and_ps(a, b); }
+    static Vector AndNot(const Vector a, const Vector b) { return _mm256_andnot_ps(a, b); }
+    static Vector Or(const Vector a, const Vector b) { return _mm256_or_ps(a, b); }
+    static Vector Xor(const Vector a, const Vector b) { return _mm256_xor_ps(a, b); }
+
+    // Same predicates as _mm_cmpneq_ps and _mm_cmplt_ps
+    static Vector CompareNotEqual(const Vector a, const Vector b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ);
+    }
+    static bool AnyLess(const Vector a, const Vector b)
+    {
+        return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)) != 0;
+    }
+};
+#endif
+
+/**
+Normalize (x, y, z) exactly like XMVector3Normalize does on the SSE2 path:
+zero-length vectors become zero, infinite-length ones become QNaN.
+*/
+template <typename Ops>
+void Normalize(typename Ops::Vector &x, typename Ops::Vector &y, typename Ops::Vector &z)
+{
+    typedef typename Ops::Vector Vector;
+
+    const Vector lengthSq = Ops::Add(Ops::Add(Ops::Mul(x, x), Ops::Mul(y, y)), Ops::Mul(z, z));
+    const Vector length = Ops::Sqrt(lengthSq);
+    const Vector nonZeroMask = Ops::CompareNotEqual(Ops::Zero(), length);
+    const Vector finiteMask =
+        Ops::CompareNotEqual(lengthSq, Ops::Splat(std::numeric_limits<float>::infinity()));
+    const Vector qnan = Ops::AndNot(finiteMask, Ops::Splat(std::numeric_limits<float>::quiet_NaN()));
+
+    x = Ops::Or(Ops::And(Ops::And(Ops::Div(x, length), nonZeroMask), finiteMask), qnan);
+    y = Ops::Or(Ops::And(Ops::And(Ops::Div(y, length), nonZeroMask), finiteMask), qnan);
+    z = Ops::Or(Ops::And(Ops::And(Ops::Div(z, length), nonZeroMask), finiteMask), qnan);
+}
+
+/**
+First pass: compute the normal of every triangle once and store it in the
+normal streams, and find the bounding box of all vertices.
+*/
+template <typename Ops>
+void ComputeNormalsAndBounds(TriangleStreams &streams, const int paddedCount,
+    float aabbMin[3], float aabbMax[3])
+{
+    typedef typename Ops::Vector Vector;
+
+    const Vector infinity = Ops::Splat(std::numeric_limits<float>::infinity());
+    Vector minimum[3] = { infinity, infinity, infinity };
+    Vector maximum[3] = { Ops::Sub(Ops::Zero(), infinity), Ops::Sub(Ops::Zero(), infinity),
+        Ops::Sub(Ops::Zero(), infinity) };
+
+    for (int i = 0; i < paddedCount; i += Ops::Width)
+    {
+        Vector v[TriangleStreams::POSITION_STREAM_COUNT];
+        for (int j = 0; j < TriangleStreams::POSITION_STREAM_COUNT; ++j)
+        {
+            v[j] = Ops::Load(streams.position[j] + i);
+        }
+
+        for (int c = 0; c < 3; ++c)
+        {
+            minimum[c] = Ops::Min(minimum[c],
+                Ops::Min(Ops::Min(v[TriangleStreams::V0_X + c], v[TriangleStreams::V1_X + c]),
+                    v[TriangleStreams::V2_X + c]));
+            maximum[c] = Ops::Max(maximum[c],
+                Ops::Max(Ops::Max(v[TriangleStreams::V0_X + c], v[TriangleStreams::V1_X + c]),
+                    v[TriangleStreams::V2_X + c]));
+        }
+
+        const Vector e1x = Ops::Sub(v[TriangleStreams::V1_X], v[TriangleStreams::V0_X]);
+        const Vector e1y = Ops::Sub(v[TriangleStreams::V1_Y], v[TriangleStreams::V0_Y]);
+        const Vector e1z = Ops::Sub(v[TriangleStreams::V1_Z], v[TriangleStreams::V0_Z]);
+        const Vector e2x = Ops::Sub(v[TriangleStreams::V2_X], v[TriangleStreams::V0_X]);
+        const Vector e2y = Ops::Sub(v[TriangleStreams::V2_Y], v[TriangleStreams::V0_Y]);
+        const Vector e2z = Ops::Sub(v[TriangleStreams::V2_Z], v[TriangleStreams::V0_Z]);
+
+        Vector nx = Ops::Sub(Ops::Mul(e1y, e2z), Ops::Mul(e1z, e2y));
+        Vector ny = Ops::Sub(Ops::Mul(e1z, e2x), Ops::Mul(e1x, e2z));
+        Vector nz = Ops::Sub(Ops::Mul(e1x, e2y), Ops::Mul(e1y, e2x));
+
+        Normalize<Ops>(nx, ny, nz);
+
+        Ops::Store(streams.normal[0] + i, nx);
+        Ops::Store(streams.normal[1] + i, ny);
+        Ops::Store(streams.normal[2] + i, nz);
+    }
+
+    for (int c = 0; c < 3; ++c)
+    {
+        alignas(32) float lanes[2][Ops::Width];
+        Ops::Store(lanes[0], minimum[c]);
+        Ops::Store(lanes[1], maximum[c]);
+
+        aabbMin[c] = *std::min_element(lanes[0], lanes[0] + Ops::Width);
+        aabbMax[c] = *std::max_element(lanes[1], lanes[1] + Ops::Width);
+    }
+}
+
+/**
+Second pass: intersect the cone ray center + t * coneAxis with the plane of
+every triangle. Returns false if two triangles face each other, in which case
+t and coneOpening contain the values up to the first such triangle, as in the
+reference implementation.
+*/
+template <typename Ops>
+bool IntersectConeWithPlanes(const TriangleStreams &streams, const int paddedCount,
+    const DirectX::XMFLOAT3 &center, const DirectX::XMFLOAT3 &coneAxis,
+    float &t, float &coneOpening)
+{
+    typedef typename Ops::Vector Vector;
+
+    const Vector zero = Ops::Zero();
+
+    const Vector centerX = Ops::Splat(center.x);
+    const Vector centerY = Ops::Splat(center.y);
+    const Vector centerZ = Ops::Splat(center.z);
+    const Vector axisX = Ops::Splat(coneAxis.x);
+    const Vector axisY = Ops::Splat(coneAxis.y);
+    const Vector axisZ = Ops::Splat(coneAxis.z);
+
+    Vector tMax = Ops::Splat(t);
+    Vector openingMin = Ops::Splat(coneOpening);
+
+    bool validCluster = true;
+    alignas(32) float directionalLanes[Ops::Width];
+    alignas(32) float tLanes[Ops::Width];
+
+    for (int i = 0; i < paddedCount; i += Ops::Width)
+    {
+        const Vector nx = Ops::Load(streams.normal[0] + i);
+        const Vector ny = Ops::Load(streams.normal[1] + i);
+        const Vector nz = Ops::Load(streams.normal[2] + i);
+
+        // dot (coneAxis, -normal), XMVectorNegate is a subtraction from zero
+        const Vector directionalPart = Ops::Add(Ops::Add(
+            Ops::Mul(axisX, Ops::Sub(zero, nx)),
+            Ops::Mul(axisY, Ops::Sub(zero, ny))),
+            Ops::Mul(axisZ, Ops::Sub(zero, nz)));
+
+        const Vector distance = Ops::Add(Ops::Add(
+            Ops::Mul(Ops::Sub(centerX, Ops::Load(streams.position[TriangleStreams::V0_X] + i)), nx),
+            Ops::Mul(Ops::Sub(centerY, Ops::Load(streams.position[TriangleStreams::V0_Y] + i)), ny)),
+            Ops::Mul(Ops::Sub(centerZ, Ops::Load(streams.position[TriangleStreams::V0_Z] + i)), nz));
+
+        // Same division as the reference, including the sign of zero
+        const Vector td = Ops::Div(distance, directionalPart);
+
+        if (Ops::AnyLess(directionalPart, zero))
+        {
+            // Take the lanes in order up to the first back-facing one
+            Ops::Store(directionalLanes, directionalPart);
+            Ops::Store(tLanes, td);
+
+            for (int j = 0; j < Ops::Width; ++j)
+            {
+                if (directionalLanes[j] < 0)
+                {
+                    break;
+                }
+
+                tMax = Ops::Max(Ops::Splat(tLanes[j]), tMax);
+                openingMin = Ops::Min(Ops::Splat(directionalLanes[j]), openingMin);
+            }
+
+            validCluster = false;
+            break;
+        }
+
+        // Operand order matches std::max (t, td) and std::min (coneOpening,
+        // directionalPart) if td or directionalPart are NaN
+        tMax = Ops::Max(td, tMax);
+        openingMin = Ops::Min(directionalPart, openingMin);
+    }
+
+    Ops::Store(tLanes, tMax);
+    Ops::Store(directionalLanes, openingMin);
+
+    for (int j = 0; j < Ops::Width; ++j)
+    {
+        t = std::max(t, tLanes[j]);
+        coneOpening = std::min(coneOpening, directionalLanes[j]);
+    }
+
+    return validCluster;
+}
+
+template <typename Ops>
+void ComputeClusterBoundsSIMD(const float *vertices, const int32 *indices,
+    const ClusterConeType coneType, Cluster &cluster)
+{
+    // 12 KiB stack space
+    TriangleStreams streams;
+
+    const int paddedCount = GatherTriangles(vertices, indices, cluster, streams);
+
+    float aabbMinValues[3], aabbMaxValues[3];
+    ComputeNormalsAndBounds<Ops>(streams, paddedCount, aabbMinValues, aabbMaxValues);
+
+    const auto aabbMin = DirectX::XMVectorSet(aabbMinValues[0], aabbMinValues[1], aabbMinValues[2], 1.0f);
+    const auto aabbMax = DirectX::XMVectorSet(aabbMaxValues[0], aabbMaxValues[1], aabbMaxValues[2], 1.0f);
+
+    // The axis is summed in triangle order so the rounding matches the
+    // reference implementation
+    auto coneAxis = DirectX::XMVectorZero();
+    for (int i = 0; i < cluster.triangleCount; ++i)
+    {
+        coneAxis = DirectX::XMVectorAdd(coneAxis, DirectX::XMVectorNegate(DirectX::XMVectorSet(
+            streams.normal[0][i], streams.normal[1][i], streams.normal[2][i], 0.0f)));
+    }
+
+    const auto center = DirectX::XMVectorDivide(DirectX::XMVectorAdd(aabbMin, aabbMax),
+        DirectX::XMVectorSet(2, 2, 2, 2));
+    coneAxis = DirectX::XMVector3Normalize(coneAxis);
+
+    if (coneType == CLUSTER_CONE_MINIMAL)
+    {
+        // If the normals do not fit into a cone, the averaged axis is kept
+        // and the plane pass rejects the cluster
+        ComputeMinimalConeAxis(streams.normal[0], streams.normal[1], streams.normal[2],
+            cluster.triangleCount, coneAxis);
+
+        // Degenerate triangles cannot be seen from any side. A NaN normal
+        // makes the plane pass ignore them, as every comparison fails.
+        for (int i = 0; i < paddedCount; ++i)
+        {
+            if (IsDegenerateNormal(streams.normal[0][i], streams.normal[1][i], streams.normal[2][i]))
+            {
+                streams.normal[0][i] = streams.normal[1][i] = streams.normal[2][i] =
+                    std::numeric_limits<float>::quiet_NaN();
+            }
+        }
+    }
+
+    DirectX::XMFLOAT3 centerValues, coneAxisValues;
+    DirectX::XMStoreFloat3(&centerValues, center);
+    DirectX::XMStoreFloat3(&coneAxisValues, coneAxis);
+
+    float coneOpening = 1;
+    float t = -std::numeric_limits<float>::infinity();
+    const bool validCluster = IntersectConeWithPlanes<Ops>(
+        streams, paddedCount, centerValues, coneAxisValues, t, coneOpening);
+
+    StoreClusterBounds(aabbMin, aabbMax, center, coneAxis, t, coneOpening, validCluster, cluster);
+}
+#endif
+
+ClusterBoundsKernel DetectClusterBoundsKernel()
+{
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_AVX
+#ifdef _MSC_VER
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 1);
+
+    const bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+    const bool avx = (cpuInfo[2] & (1 << 28)) != 0;
+
+    // The OS must save the YMM registers on context switches
+    if (osxsave && avx && (_xgetbv(0) & 0x6) == 0x6)
+    {
+        return CLUSTER_BOUNDS_KERNEL_AVX;
+    }
+#else
+    // Compiled with -mavx, so the CPU is required to support it
+    return CLUSTER_BOUNDS_KERNEL_AVX;
+#endif
+#endif
+
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_SSE2
+    return CLUSTER_BOUNDS_KERNEL_SSE2;
+#else
+    return CLUSTER_BOUNDS_KERNEL_REFERENCE;
+#endif
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ClusterBoundsKernel GetClusterBoundsKernel()
+{
+    static const ClusterBoundsKernel kernel = DetectClusterBoundsKernel();
+    return kernel;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ComputeClusterBounds(const float *vertices, const int32 *indices,
+    const ClusterConeType coneType, Cluster &cluster)
+{
+    ComputeClusterBounds(vertices, indices, coneType, GetClusterBoundsKernel(), cluster);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ComputeClusterBounds(const float *vertices, const int32 *indices,
+    const ClusterConeType coneType, const ClusterBoundsKernel kernel, Cluster &cluster)
+{
+    assert(cluster.triangleCount > 0);
+    assert(cluster.triangleCount <= SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE);
+
+    const ClusterBoundsKernel supportedKernel = GetClusterBoundsKernel();
+
+    switch (std::min(kernel, supportedKernel))
+    {
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_AVX
+    case CLUSTER_BOUNDS_KERNEL_AVX:
+        ComputeClusterBoundsSIMD<AVXOps>(vertices, indices, coneType, cluster);
+        break;
+#endif
+
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_BOUNDS_SSE2
+    case CLUSTER_BOUNDS_KERNEL_SSE2:
+        ComputeClusterBoundsSIMD<SSE2Ops>(vertices, indices, coneType, cluster);
+        break;
+#endif
+
+    default:
+        ComputeClusterBoundsReference(vertices, indices, coneType, cluster);
+        break;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ComputeClusterBoundsReference(const float *vertices, const int32 *indices,
+    const ClusterConeType coneType, Cluster &cluster)
+{
+    // 12 KiB stack space
+    std::array<Triangle, SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE> triangleCache;
+
+    // Only used for the minimal cone
+    std::array<float, SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE> normalX, normalY, normalZ;
+
+    assert(cluster.triangleCount <= SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE);
+
+    const int clusterStart = cluster.firstTriangle;
+    const int clusterEnd = cluster.firstTriangle + cluster.triangleCount;
+
+    const int clusterTriangleCount = cluster.triangleCount;
+
+    // Load all triangles into our local cache
+    for (int triangleIndex = clusterStart; triangleIndex < clusterEnd; ++triangleIndex)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            triangleCache[triangleIndex - clusterStart].vtx[j] =
+                LoadVertex(vertices, indices[triangleIndex * 3 + j]);
+        }
+    }
+
+    auto aabbMin = DirectX::XMVectorSplatInfinity();
+    auto aabbMax = DirectX::XMVectorNegate(DirectX::XMVectorSplatInfinity());
+
+    auto coneAxis = DirectX::XMVectorZero();
+
+    for (int triangleIndex = 0; triangleIndex < clusterTriangleCount; ++triangleIndex)
+    {
+        const auto &triangle = triangleCache[triangleIndex];
+        for (int j = 0; j < 3; ++j)
+        {
+            aabbMin = DirectX::XMVectorMin(aabbMin, triangle.vtx[j]);
+            aabbMax = DirectX::XMVectorMax(aabbMax, triangle.vtx[j]);
+        }
+
+        const auto triangleNormal = DirectX::XMVector3Normalize(
+            DirectX::XMVector3Cross(
+                DirectX::XMVectorSubtract(triangle.vtx[1], triangle.vtx[0]),
+                DirectX::XMVectorSubtract(triangle.vtx[2], triangle.vtx[0])));
+
+        coneAxis = DirectX::XMVectorAdd(coneAxis, DirectX::XMVectorNegate(triangleNormal));
+
+        normalX[triangleIndex] = DirectX::XMVectorGetX(triangleNormal);
+        normalY[triangleIndex] = DirectX::XMVectorGetY(triangleNormal);
+        normalZ[triangleIndex] = DirectX::XMVectorGetZ(triangleNormal);
+    }
+
+    // This is the cosine of the cone opening angle - 1 means it's 0 degrees,
+    // we're minimizing this value (at 0, it would mean the cone is 90
+    // degrees open)
+    float coneOpening = 1;
+    bool validCluster = true;
+
+    const auto center = DirectX::XMVectorDivide(DirectX::XMVectorAdd(aabbMin, aabbMax),
+        DirectX::XMVectorSet(2, 2, 2, 2));
+    coneAxis = DirectX::XMVector3Normalize(coneAxis);
+
+    if (coneType == CLUSTER_CONE_MINIMAL)
+    {
+        ComputeMinimalConeAxis(normalX.data(), normalY.data(), normalZ.data(),
+            clusterTriangleCount, coneAxis);
+    }
+
+    float t = -std::numeric_limits<float>::infinity();
+
+    // We nee a second pass to find the intersection of the line
+    // center + t * coneAxis with the plane defined by each
+    // triangle
+    for (int triangleIndex = 0; triangleIndex < clusterTriangleCount; ++triangleIndex)
+    {
+        const auto &triangle = triangleCache[triangleIndex];
+        // Compute the triangle plane from the three vertices
+
+        const auto triangleNormal = DirectX::XMVector3Normalize(
+            DirectX::XMVector3Cross(
+                DirectX::XMVectorSubtract(triangle.vtx[1], triangle.vtx[0]),
+                DirectX::XMVectorSubtract(triangle.vtx[2], triangle.vtx[0])));
+
+        if (coneType == CLUSTER_CONE_MINIMAL && IsDegenerateNormal(normalX[triangleIndex],
+            normalY[triangleIndex], normalZ[triangleIndex]))
+        {
+            continue;
+        }
+
+        const float directionalPart = DirectX::XMVectorGetX(
+            DirectX::XMVector3Dot(coneAxis, DirectX::XMVectorNegate(triangleNormal)));
+
+        if (directionalPart < 0)
+        {
+            // No solution for this cluster - at least two triangles
+            // are facing each other
+            validCluster = false;
+            break;
+        }
+
+        // We need to intersect the plane with our cone ray which is
+        // center + t * coneAxis, and find the max
+        // t along the cone ray (which points into the empty
+        // space). coneAxis is opposite to the normal, so the
+        // denominator dot(coneAxis, normal) is -directionalPart and
+        // both signs cancel against the reversed center - v0
+        // See: https://en.wikipedia.org/wiki/Line%E2%80%93plane_intersection
+        const float td = DirectX::XMVectorGetX(DirectX::XMVectorDivide(
+            DirectX::XMVector3Dot(DirectX::XMVectorSubtract(center, triangle.vtx[0]), triangleNormal),
+            DirectX::XMVectorSet(directionalPart, directionalPart, directionalPart, directionalPart)));
+
+        t = std::max(t, td);
+
+        coneOpening = std::min(coneOpening, directionalPart);
+    }
+
+    StoreClusterBounds(aabbMin, aabbMax, center, coneAxis, t, coneOpening, validCluster, cluster);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void MergeClusterBounds(const std::vector<Cluster> &clusters, Cluster &merged)
+{
+    merged = Cluster();
+    merged.aabbMin = merged.aabbMax = merged.coneCenter = merged.coneAxis =
+        DirectX::XMVectorZero();
+    merged.coneAngleCosine = 1;
+    merged.valid = false;
+    merged.firstTriangle = 0;
+    merged.triangleCount = 0;
+
+    if (clusters.empty())
+    {
+        return;
+    }
+
+    merged.aabbMin = clusters.front().aabbMin;
+    merged.aabbMax = clusters.front().aabbMax;
+    merged.firstTriangle = clusters.front().firstTriangle;
+
+    bool allValid = true;
+    auto axisSum = DirectX::XMVectorZero();
+
+    for (auto it = clusters.begin(), end = clusters.end(); it != end; ++it)
+    {
+        merged.aabbMin = DirectX::XMVectorMin(merged.aabbMin, it->aabbMin);
+        merged.aabbMax = DirectX::XMVectorMax(merged.aabbMax, it->aabbMax);
+        merged.triangleCount += it->triangleCount;
+
+        allValid = allValid && it->valid;
+        axisSum = DirectX::XMVectorAdd(axisSum, it->coneAxis);
+    }
+
+    // The mesh is backfacing where all cluster cones overlap, so a single
+    // invalid cluster rules out the mesh cone. This is the common case for
+    // closed meshes.
+    if (!allValid || DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(axisSum)) == 0)
+    {
+        return;
+    }
+
+    const auto axis = DirectX::XMVector3Normalize(axisSum);
+
+    // A cone around axis lies inside the cone of a cluster if its angle is
+    // smaller by at least the angle between the axes
+    const float ANGLE_EPSILON = 1e-4f;
+
+    float angle = DirectX::XM_PI;
+    for (auto it = clusters.begin(), end = clusters.end(); it != end; ++it)
+    {
+        const float axisAngle = std::acos(std::max(-1.0f, std::min(1.0f,
+            DirectX::XMVectorGetX(DirectX::XMVector3Dot(axis, it->coneAxis)))));
+        const float clusterAngle = std::acos(std::max(-1.0f, std::min(1.0f,
+            it->coneAngleCosine)));
+
+        angle = std::min(angle, clusterAngle - axisAngle - ANGLE_EPSILON);
+    }
+
+    if (angle <= 0)
+    {
+        return;
+    }
+
+    // The translated cone apex + cone also lies inside a cluster cone if the
+    // apex does. Walk out from the center of the mesh along the axis until
+    // the apex is inside all cluster cones. Far enough out, the direction
+    // from any cluster apex approaches axis, which is inside every cone.
+    const auto center = DirectX::XMVectorScale(
+        DirectX::XMVectorAdd(merged.aabbMin, merged.aabbMax), 0.5f);
+    const float radius = std::max(DirectX::XMVectorGetX(DirectX::XMVector3Length(
+        DirectX::XMVectorSubtract(merged.aabbMax, merged.aabbMin))) * 0.5f,
+        std::numeric_limits<float>::min());
+
+    auto isInsideAll = [&clusters, ANGLE_EPSILON](const DirectX::XMVECTOR apex)
+    {
+        for (auto it = clusters.begin(), end = clusters.end(); it != end; ++it)
+        {
+            const auto direction = DirectX::XMVectorSubtract(apex, it->coneCenter);
+            const float length = DirectX::XMVectorGetX(DirectX::XMVector3Length(direction));
+
+            // The cluster apex itself counts as inside
+            if (length > 0 && DirectX::XMVectorGetX(DirectX::XMVector3Dot(direction, it->coneAxis))
+                < it->coneAngleCosine * length * (1 + ANGLE_EPSILON))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    auto apexAt = [center, axis](const float distance)
+    {
+        return DirectX::XMVectorAdd(center, DirectX::XMVectorScale(axis, distance));
+    };
+
+    const int MAXIMUM_DOUBLING_STEPS = 24;
+    const int BISECTION_STEPS = 12;
+
+    float outside = -radius;
+    float inside = radius;
+
+    int step = 0;
+    while (!isInsideAll(apexAt(inside)))
+    {
+        if (++step == MAXIMUM_DOUBLING_STEPS)
+        {
+            return;
+        }
+
+        outside = inside;
+        inside *= 2;
+    }
+
+    // The closer the apex, the more views the cone covers. Only verified
+    // positions are kept, so this is safe even where the search is not
+    // monotonic.
+    for (int i = 0; i < BISECTION_STEPS; ++i)
+    {
+        const float middle = (outside + inside) * 0.5f;
+        if (isInsideAll(apexAt(middle)))
+        {
+            inside = middle;
+        }
+        else
+        {
+            outside = middle;
+        }
+    }
+
+    merged.coneCenter = apexAt(inside);
+    merged.coneAxis = axis;
+    merged.coneAngleCosine = std::cos(angle);
+    merged.valid = true;
+}
+}
+}
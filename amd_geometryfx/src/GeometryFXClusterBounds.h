@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_CLUSTER_BOUNDS_H
+#define AMD_GEOMETRYFX_CLUSTER_BOUNDS_H
+
+#include "GeometryFXClusterBuilder.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+enum ClusterBoundsKernel
+{
+    CLUSTER_BOUNDS_KERNEL_REFERENCE,
+    CLUSTER_BOUNDS_KERNEL_SSE2,
+    CLUSTER_BOUNDS_KERNEL_AVX
+};
+
+/**
+Compute the bounding box and the normal cone of the triangles referenced by
+cluster.firstTriangle and cluster.triangleCount. See ClusterConeType for how
+the cone axis is chosen.
+
+The triangles are gathered into structure-of-arrays streams and processed
+four (SSE2) or eight (AVX) at a time. The widest kernel supported by the CPU
+is selected on first use.
+
+The vector kernels repeat the operations of the DirectXMath SSE2 code path
+in the same order and without fused multiply-add, so they produce the same
+bits as ComputeClusterBoundsReference when DirectXMath is built with
+_XM_SSE_INTRINSICS_ (except that a cone center offset of zero may come out
+as -0 instead of +0 or vice versa). With _XM_NO_INTRINSICS_ or _XM_SSE4_INTRINSICS_,
+XMVector3Normalize and XMVector3Dot round differently, and the results may
+differ by a few ulp per component.
+*/
+void ComputeClusterBounds(const float *vertices, const int32 *indices,
+    const ClusterConeType coneType, Cluster &cluster);
+
+/**
+Same as ComputeClusterBounds, but always uses the given kernel. If the CPU
+does not support it, the reference kernel is used instead.
+*/
+void ComputeClusterBounds(const float *vertices, const int32 *indices,
+    const ClusterConeType coneType, const ClusterBoundsKernel kernel, Cluster &cluster);
+
+/**
+The scalar DirectXMath implementation the vector kernels are checked
+against.
+*/
+void ComputeClusterBoundsReference(const float *vertices, const int32 *indices,
+    const ClusterConeType coneType, Cluster &cluster);
+
+/**
+The widest kernel the CPU and the operating system support.
+*/
+ClusterBoundsKernel GetClusterBoundsKernel();
+
+/**
+Merge the bounds of all clusters of a mesh. The box is the union of the
+cluster boxes. The cone, if valid, lies inside the cone of every cluster, so
+an eye inside it sees only back faces of the whole mesh. Meshes with any
+invalid cluster, such as closed meshes, get no valid cone.
+*/
+void MergeClusterBounds(const std::vector<Cluster> &clusters, Cluster &merged);
+}
+}
+
+#endif // AMD_GEOMETRYFX_CLUSTER_BOUNDS_H
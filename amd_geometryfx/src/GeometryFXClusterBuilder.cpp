@@ -0,0 +1,518 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXClusterBuilder.h"
+
+#include "AMD_GeometryFX_Internal.h"
+#include "GeometryFXClusterBounds.h"
+#include "GeometryFXClusterCache.h"
+#include "GeometryFXWorkerPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#ifdef min
+#undef min
+#endif
+
+#ifdef max
+#undef max
+#endif
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+DirectX::XMVECTOR LoadVertex(const float *vertices, const int32 index)
+{
+    return DirectX::XMVectorSet(
+        vertices[index * 3 + 0], vertices[index * 3 + 1], vertices[index * 3 + 2], 1.0f);
+}
+
+// Spread the lower 10 bits of v so there are two zero bits between each bit
+uint32 SpreadBits(uint32 v)
+{
+    v &= 0x3FF;
+    v = (v | (v << 16)) & 0x030000FF;
+    v = (v | (v << 8)) & 0x0300F00F;
+    v = (v | (v << 4)) & 0x030C30C3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+/**
+Order the triangles along a Morton curve through their centroids. This is
+used to pick the seed triangle whenever a new cluster is started, so
+consecutive clusters stay close to each other.
+*/
+std::vector<int> CreateSeedOrder(const std::vector<DirectX::XMFLOAT3> &centroids)
+{
+    const int triangleCount = static_cast<int>(centroids.size());
+
+    auto boundsMin = DirectX::XMVectorSplatInfinity();
+    auto boundsMax = DirectX::XMVectorNegate(DirectX::XMVectorSplatInfinity());
+
+    for (int i = 0; i < triangleCount; ++i)
+    {
+        const auto c = DirectX::XMLoadFloat3(&centroids[i]);
+        boundsMin = DirectX::XMVectorMin(boundsMin, c);
+        boundsMax = DirectX::XMVectorMax(boundsMax, c);
+    }
+
+    DirectX::XMFLOAT3 origin, extent;
+    DirectX::XMStoreFloat3(&origin, boundsMin);
+    DirectX::XMStoreFloat3(&extent, DirectX::XMVectorSubtract(boundsMax, boundsMin));
+
+    const float scaleX = extent.x > 0 ? 1023.0f / extent.x : 0;
+    const float scaleY = extent.y > 0 ? 1023.0f / extent.y : 0;
+    const float scaleZ = extent.z > 0 ? 1023.0f / extent.z : 0;
+
+    std::vector<std::pair<uint32, int>> keys(triangleCount);
+    for (int i = 0; i < triangleCount; ++i)
+    {
+        const uint32 x = static_cast<uint32>((centroids[i].x - origin.x) * scaleX);
+        const uint32 y = static_cast<uint32>((centroids[i].y - origin.y) * scaleY);
+        const uint32 z = static_cast<uint32>((centroids[i].z - origin.z) * scaleZ);
+
+        keys[i].first = SpreadBits(x) | (SpreadBits(y) << 1) | (SpreadBits(z) << 2);
+        keys[i].second = i;
+    }
+
+    // Sorting the pairs also compares the triangle index, so the order is
+    // fully deterministic
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<int> result(triangleCount);
+    for (int i = 0; i < triangleCount; ++i)
+    {
+        result[i] = keys[i].second;
+    }
+
+    return result;
+}
+
+void UpdateVertexCacheStatistics(const ClusterBuilderInput &input, ClusterBuilderOutput &output)
+{
+    const int32 *indices = output.reorderedIndices.empty()
+        ? static_cast<const int32 *>(input.indexData)
+        : output.reorderedIndices.data();
+
+    output.vertexCacheStatistics = SimulateVertexCache(indices, input.indexCount,
+        input.vertexCount, VERTEX_CACHE_SIMULATION_SIZE);
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<Cluster> CreateClusters(const int indexCount, const void *vertexData,
+    const void *indexData, const int trianglesPerCluster, const ClusterConeType coneType)
+{
+    const int32 *indices = static_cast<const int32 *>(indexData);
+    const float *vertices = static_cast<const float *>(vertexData);
+
+    const int triangleCount = indexCount / 3;
+    assert(trianglesPerCluster > 0);
+    assert(trianglesPerCluster <= SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE);
+
+    const int clusterCount = (triangleCount + trianglesPerCluster - 1) / trianglesPerCluster;
+
+    std::vector<Cluster> result(clusterCount);
+    for (int i = 0; i < clusterCount; ++i)
+    {
+        const int clusterStart = i * trianglesPerCluster;
+        const int clusterEnd = std::min(clusterStart + trianglesPerCluster, triangleCount);
+
+        result[i].firstTriangle = clusterStart;
+        result[i].triangleCount = clusterEnd - clusterStart;
+
+        ComputeClusterBounds(vertices, indices, coneType, result[i]);
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<Cluster> CreateSpatialClusters(const int indexCount, const int vertexCount,
+    const void *vertexData, const void *indexData, const int maximumVerticesPerCluster,
+    const int maximumTrianglesPerCluster, const ClusterConeType coneType,
+    int32 *reorderedIndexData)
+{
+    const int32 *indices = static_cast<const int32 *>(indexData);
+    const float *vertices = static_cast<const float *>(vertexData);
+
+    const int triangleCount = indexCount / 3;
+
+    // A cluster must be able to hold at least one triangle
+    const int vertexBudget = std::max(3, maximumVerticesPerCluster);
+
+    std::vector<DirectX::XMFLOAT3> centroids(triangleCount);
+    std::vector<DirectX::XMFLOAT3> normals(triangleCount);
+
+    for (int i = 0; i < triangleCount; ++i)
+    {
+        const auto v0 = LoadVertex(vertices, indices[i * 3 + 0]);
+        const auto v1 = LoadVertex(vertices, indices[i * 3 + 1]);
+        const auto v2 = LoadVertex(vertices, indices[i * 3 + 2]);
+
+        DirectX::XMStoreFloat3(&centroids[i], DirectX::XMVectorDivide(
+            DirectX::XMVectorAdd(DirectX::XMVectorAdd(v0, v1), v2),
+            DirectX::XMVectorSet(3, 3, 3, 3)));
+
+        // Degenerate triangles end up with a zero normal, which makes them
+        // neutral with respect to the cone
+        DirectX::XMStoreFloat3(&normals[i], DirectX::XMVector3Normalize(
+            DirectX::XMVector3Cross(
+                DirectX::XMVectorSubtract(v1, v0),
+                DirectX::XMVectorSubtract(v2, v0))));
+    }
+
+    // Vertex to triangle adjacency, stored as offsets into one flat array
+    std::vector<int> adjacencyOffsets(vertexCount + 1, 0);
+    for (int i = 0; i < triangleCount * 3; ++i)
+    {
+        assert(indices[i] >= 0 && indices[i] < vertexCount);
+        ++adjacencyOffsets[indices[i] + 1];
+    }
+
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+    }
+
+    std::vector<int> adjacentTriangles(triangleCount * 3);
+    {
+        std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (int i = 0; i < triangleCount; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                adjacentTriangles[fill[indices[i * 3 + j]]++] = i;
+            }
+        }
+    }
+
+    const std::vector<int> seedOrder = CreateSeedOrder(centroids);
+    int nextSeed = 0;
+
+    // Stamps hold the index of the cluster which last touched a vertex or
+    // considered a triangle, so they never need to be cleared
+    std::vector<int> vertexStamp(vertexCount, -1);
+    std::vector<int> candidateStamp(triangleCount, -1);
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<int> candidates;
+    std::vector<int> clusterTriangles;
+    assert(maximumTrianglesPerCluster > 0);
+    assert(maximumTrianglesPerCluster <= SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE);
+
+    clusterTriangles.reserve(maximumTrianglesPerCluster);
+
+    std::vector<Cluster> result;
+    int emittedTriangleCount = 0;
+
+    while (emittedTriangleCount < triangleCount)
+    {
+        const int clusterIndex = static_cast<int>(result.size());
+
+        int clusterVertexCount = 0;
+        auto normalSum = DirectX::XMVectorZero();
+        auto centroidSum = DirectX::XMVectorZero();
+        float clusterRadius = 0;
+
+        candidates.clear();
+        clusterTriangles.clear();
+
+        while (nextSeed < triangleCount && emitted[seedOrder[nextSeed]])
+        {
+            ++nextSeed;
+        }
+
+        int triangle = seedOrder[nextSeed];
+
+        for (;;)
+        {
+            emitted[triangle] = true;
+            clusterTriangles.push_back(triangle);
+
+            for (int j = 0; j < 3; ++j)
+            {
+                const int vertex = indices[triangle * 3 + j];
+                if (vertexStamp[vertex] != clusterIndex)
+                {
+                    vertexStamp[vertex] = clusterIndex;
+                    ++clusterVertexCount;
+                }
+
+                for (int k = adjacencyOffsets[vertex]; k < adjacencyOffsets[vertex + 1]; ++k)
+                {
+                    const int neighbor = adjacentTriangles[k];
+                    if (!emitted[neighbor] && candidateStamp[neighbor] != clusterIndex)
+                    {
+                        candidateStamp[neighbor] = clusterIndex;
+                        candidates.push_back(neighbor);
+                    }
+                }
+            }
+
+            normalSum = DirectX::XMVectorAdd(normalSum, DirectX::XMLoadFloat3(&normals[triangle]));
+            centroidSum = DirectX::XMVectorAdd(centroidSum, DirectX::XMLoadFloat3(&centroids[triangle]));
+
+            const float clusterSize = static_cast<float>(clusterTriangles.size());
+            const auto clusterCenter = DirectX::XMVectorDivide(centroidSum,
+                DirectX::XMVectorSet(clusterSize, clusterSize, clusterSize, clusterSize));
+            const auto clusterNormal = DirectX::XMVector3Normalize(normalSum);
+
+            clusterRadius = std::max(clusterRadius, DirectX::XMVectorGetX(DirectX::XMVector3Length(
+                DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&centroids[triangle]), clusterCenter))));
+
+            if (static_cast<int>(clusterTriangles.size()) == maximumTrianglesPerCluster)
+            {
+                break;
+            }
+
+            // Pick the candidate which adds the fewest vertices, stays close
+            // to the cluster center and agrees with the average normal, so
+            // the bounding box stays small and the normal cone stays valid
+            int bestCandidate = -1;
+            float bestScore = std::numeric_limits<float>::max();
+
+            for (size_t i = 0; i < candidates.size();)
+            {
+                const int candidate = candidates[i];
+                if (emitted[candidate])
+                {
+                    candidates[i] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+
+                int newVertexCount = 0;
+                for (int j = 0; j < 3; ++j)
+                {
+                    if (vertexStamp[indices[candidate * 3 + j]] != clusterIndex)
+                    {
+                        ++newVertexCount;
+                    }
+                }
+
+                if (clusterVertexCount + newVertexCount <= vertexBudget)
+                {
+                    const float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(
+                        DirectX::XMVectorSubtract(
+                            DirectX::XMLoadFloat3(&centroids[candidate]), clusterCenter)));
+                    const float normalAgreement = DirectX::XMVectorGetX(DirectX::XMVector3Dot(
+                        DirectX::XMLoadFloat3(&normals[candidate]), clusterNormal));
+
+                    // A back-facing candidate costs more than any new
+                    // vertex, so it is only picked if nothing else is left
+                    const float score = static_cast<float>(newVertexCount)
+                        + 2.0f * (1.0f - normalAgreement)
+                        + distance / (clusterRadius + distance + 1e-20f);
+
+                    // Ties are resolved by the triangle index to keep the
+                    // result independent of the candidate order
+                    if (score < bestScore
+                        || (score == bestScore && candidate < bestCandidate))
+                    {
+                        bestScore = score;
+                        bestCandidate = candidate;
+                    }
+                }
+
+                ++i;
+            }
+
+            if (bestCandidate == -1)
+            {
+                // No connected triangle fits, continue with the next
+                // triangle along the seed order if it fits the budget
+                while (nextSeed < triangleCount && emitted[seedOrder[nextSeed]])
+                {
+                    ++nextSeed;
+                }
+
+                if (nextSeed == triangleCount)
+                {
+                    break;
+                }
+
+                const int seed = seedOrder[nextSeed];
+
+                int newVertexCount = 0;
+                for (int j = 0; j < 3; ++j)
+                {
+                    if (vertexStamp[indices[seed * 3 + j]] != clusterIndex)
+                    {
+                        ++newVertexCount;
+                    }
+                }
+
+                if (clusterVertexCount + newVertexCount > vertexBudget)
+                {
+                    break;
+                }
+
+                bestCandidate = seed;
+            }
+
+            triangle = bestCandidate;
+        }
+
+        Cluster cluster;
+        cluster.firstTriangle = emittedTriangleCount;
+        cluster.triangleCount = static_cast<int>(clusterTriangles.size());
+
+        for (int i = 0; i < cluster.triangleCount; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                reorderedIndexData[(emittedTriangleCount + i) * 3 + j] =
+                    indices[clusterTriangles[i] * 3 + j];
+            }
+        }
+
+        emittedTriangleCount += cluster.triangleCount;
+
+        ComputeClusterBounds(vertices, reorderedIndexData, coneType, cluster);
+        result.push_back(cluster);
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BuildClusters(const ClusterBuilderOptions &options, const ClusterBuilderInput &input,
+    ClusterBuilderOutput &output)
+{
+    const bool useCache = !options.cacheDirectory.empty();
+    uint64 cacheKey = 0;
+
+    if (useCache)
+    {
+        cacheKey = ComputeClusterCacheKey(options, input);
+
+        if (LoadClusterCache(options.cacheDirectory, cacheKey, options, input, output))
+        {
+            UpdateVertexCacheStatistics(input, output);
+            return;
+        }
+    }
+
+    output.loadedFromCache = false;
+
+    if (options.spatialClusters)
+    {
+        output.reorderedIndices.resize(input.indexCount);
+        output.clusters = CreateSpatialClusters(input.indexCount, input.vertexCount,
+            input.vertexData, input.indexData, options.maximumVerticesPerCluster,
+            options.maximumTrianglesPerCluster, options.coneType, output.reorderedIndices.data());
+    }
+    else
+    {
+        output.reorderedIndices.clear();
+        output.clusters = CreateClusters(input.indexCount, input.vertexData, input.indexData,
+            options.maximumTrianglesPerCluster, options.coneType);
+    }
+
+    output.baseClusterCount = static_cast<int>(output.clusters.size());
+    output.clusterLods.clear();
+
+    if ((options.optimizeVertexCache || options.buildLod) && output.reorderedIndices.empty())
+    {
+        const int32 *indices = static_cast<const int32 *>(input.indexData);
+        output.reorderedIndices.assign(indices, indices + input.indexCount);
+    }
+
+    if (options.buildLod)
+    {
+        BuildClusterLod(input.vertexCount, static_cast<const float *>(input.vertexData),
+            options.maximumVerticesPerCluster, options.maximumTrianglesPerCluster,
+            options.coneType, output.clusters, output.reorderedIndices, output.clusterLods);
+    }
+
+    if (options.optimizeVertexCache)
+    {
+
+        // The bounds and cones do not depend on the order of the triangles
+        // inside a cluster, so they stay valid
+        VertexCacheOptimizer optimizer(input.vertexCount);
+        for (auto it = output.clusters.begin(), end = output.clusters.end(); it != end; ++it)
+        {
+            optimizer.Optimize(output.reorderedIndices.data() + it->firstTriangle * 3,
+                it->triangleCount);
+        }
+    }
+
+    UpdateVertexCacheStatistics(input, output);
+
+    if (useCache)
+    {
+        // A failed write only costs the rebuild on the next run
+        StoreClusterCache(options.cacheDirectory, cacheKey, options, input, output);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BuildClusters(WorkerPool &pool, const ClusterBuilderOptions &options,
+    const int meshCount, const ClusterBuilderInput *inputs, ClusterBuilderOutput *outputs)
+{
+    pool.ParallelFor(meshCount, [&](const int mesh, const int /* threadIndex */)
+    {
+        BuildClusters(options, inputs[mesh], outputs[mesh]);
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+ClusterStatistics ComputeClusterStatistics(const std::vector<Cluster> &clusters)
+{
+    ClusterStatistics result;
+    result.clusterCount = static_cast<int>(clusters.size());
+
+    double coneAngleSum = 0;
+
+    for (std::vector<Cluster>::const_iterator it = clusters.begin(), end = clusters.end();
+         it != end; ++it)
+    {
+        if (it->valid)
+        {
+            ++result.validClusterCount;
+
+            // coneAngleCosine stores cos (PI/2 - normal cone angle)
+            coneAngleSum += std::asin(std::min(1.0f, it->coneAngleCosine));
+        }
+    }
+
+    if (result.validClusterCount > 0)
+    {
+        result.meanConeAngle = static_cast<float>(
+            coneAngleSum / result.validClusterCount * 180.0 / DirectX::XM_PI);
+    }
+
+    return result;
+}
+
+} // namespace GeometryFX_Internal
+} // namespace AMD
@@ -0,0 +1,246 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_CLUSTER_BUILDER_H
+#define AMD_GEOMETRYFX_CLUSTER_BUILDER_H
+
+#include <string>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "AMD_Types.h"
+#include "GeometryFXClusterLod.h"
+#include "GeometryFXVertexCache.h"
+
+/**
+The cluster builder is plain CPU code without any D3D dependency, so it can
+be compiled and benchmarked on its own.
+*/
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+class WorkerPool;
+
+/**
+A cluster is a run of consecutive triangles in the index buffer of a mesh.
+It never contains more than ClusterBuilderOptions::maximumTrianglesPerCluster
+triangles, so each cluster can be filtered by exactly one small batch.
+*/
+struct Cluster
+{
+    DirectX::XMVECTOR aabbMin, aabbMax;
+    DirectX::XMVECTOR coneCenter, coneAxis;
+
+    float coneAngleCosine;
+    bool valid;
+
+    int firstTriangle;
+    int triangleCount;
+};
+
+enum ClusterConeType
+{
+    /**
+    The cone axis is the normalized sum of the negated triangle normals. This
+    is cheap, but a single triangle facing away from the average invalidates
+    the whole cluster.
+    */
+    CLUSTER_CONE_AVERAGE_NORMAL,
+
+    /**
+    The cone axis is the axis of the smallest cone containing all negated
+    triangle normals. This gives the tightest opening angle and makes more
+    clusters valid, at a somewhat higher build cost.
+    */
+    CLUSTER_CONE_MINIMAL
+};
+
+struct ClusterBuilderOptions
+{
+    inline ClusterBuilderOptions()
+        : spatialClusters(false)
+        , maximumVerticesPerCluster(256)
+        , maximumTrianglesPerCluster(256)
+        , coneType(CLUSTER_CONE_AVERAGE_NORMAL)
+        , optimizeVertexCache(false)
+        , buildLod(false)
+    {
+    }
+
+    /**
+    If set, triangles are grouped by adjacency and spatial proximity and the
+    index data is reordered to match. Otherwise, the index buffer is split
+    into runs of maximumTrianglesPerCluster triangles in the order it was
+    provided.
+    */
+    bool spatialClusters;
+
+    /**
+    Upper bound for the number of unique vertices referenced by a single
+    spatial cluster.
+    */
+    int maximumVerticesPerCluster;
+
+    /**
+    Upper bound for the number of triangles in any cluster. Must not be
+    larger than the small batch size of the filter, nor than
+    SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE.
+    */
+    int maximumTrianglesPerCluster;
+
+    ClusterConeType coneType;
+
+    /**
+    If set, the triangles inside each cluster are reordered for
+    post-transform vertex cache locality. The clusters themselves do not
+    change.
+    */
+    bool optimizeVertexCache;
+
+    /**
+    If set, simplified versions of the mesh are built on top of the clusters,
+    see BuildClusterLod. They need up to the same number of indices again.
+    */
+    bool buildLod;
+
+    /**
+    If not empty, the clusters of each mesh are looked up in this directory
+    by a hash of the mesh data, and stored there on a miss.
+    */
+    std::string cacheDirectory;
+};
+
+struct ClusterBuilderInput
+{
+    int indexCount;
+    int vertexCount;
+    const void *vertexData;
+    const void *indexData;
+};
+
+struct ClusterBuilderOutput
+{
+    inline ClusterBuilderOutput()
+        : baseClusterCount(0)
+        , loadedFromCache(false)
+    {
+    }
+
+    std::vector<Cluster> clusters;
+
+    // The clusters of the full detail mesh come first. Any clusters after
+    // them belong to the simplified levels, and have triangles after the
+    // input triangles in reorderedIndices.
+    int baseClusterCount;
+
+    // One entry per cluster if the levels of detail were built, empty
+    // otherwise
+    std::vector<ClusterLod> clusterLods;
+
+    // Only filled if the builder reordered the triangles, empty otherwise
+    std::vector<int32> reorderedIndices;
+
+    bool loadedFromCache;
+
+    // Simulated vertex cache efficiency of the final triangle order
+    VertexCacheStatistics vertexCacheStatistics;
+};
+
+struct ClusterStatistics
+{
+    inline ClusterStatistics()
+        : clusterCount(0)
+        , validClusterCount(0)
+        , meanConeAngle(0)
+    {
+    }
+
+    int clusterCount;
+    int validClusterCount;
+
+    // Mean half-angle of the normal cones of all valid clusters, in degrees
+    float meanConeAngle;
+};
+
+/**
+Split the index buffer into runs of trianglesPerCluster consecutive
+triangles.
+*/
+std::vector<Cluster> CreateClusters(const int indexCount, const void *vertexData,
+    const void *indexData, const int trianglesPerCluster, const ClusterConeType coneType);
+
+/**
+Group triangles into clusters by adjacency and spatial proximity.
+
+Each cluster is bounded by maximumTrianglesPerCluster triangles and
+maximumVerticesPerCluster vertices. The reordered index data is written to
+reorderedIndexData, which must have space for indexCount indices. The
+returned clusters refer to the reordered index data.
+*/
+std::vector<Cluster> CreateSpatialClusters(const int indexCount, const int vertexCount,
+    const void *vertexData, const void *indexData, const int maximumVerticesPerCluster,
+    const int maximumTrianglesPerCluster, const ClusterConeType coneType,
+    int32 *reorderedIndexData);
+
+/**
+Build coarser levels on top of the clusters of one mesh.
+
+Clusters which share vertices are merged into groups of a few clusters, the
+triangles of each group are simplified to about half, and the result is
+split into new spatial clusters. This repeats on the new clusters until a
+group cannot be reduced any more, or the simplified levels together reach
+the triangle count of the full detail mesh. Vertices shared with other
+groups and vertices on open edges stay in place, so any selection made with
+IsClusterLodSelected is free of cracks.
+
+The new clusters are appended to clusters, and their triangles to indices,
+which must hold the triangles of the input clusters. lods gets one entry per
+cluster, including the input clusters.
+*/
+void BuildClusterLod(const int vertexCount, const float *vertices,
+    const int maximumVerticesPerCluster, const int maximumTrianglesPerCluster,
+    const ClusterConeType coneType, std::vector<Cluster> &clusters, std::vector<int32> &indices,
+    std::vector<ClusterLod> &lods);
+
+/**
+Build the clusters of one mesh as selected by options.
+*/
+void BuildClusters(const ClusterBuilderOptions &options, const ClusterBuilderInput &input,
+    ClusterBuilderOutput &output);
+
+/**
+Build the clusters of many meshes on the worker pool.
+
+Every mesh is processed on its own and only writes to its own output, so
+the result is the same for any number of threads.
+*/
+void BuildClusters(WorkerPool &pool, const ClusterBuilderOptions &options,
+    const int meshCount, const ClusterBuilderInput *inputs, ClusterBuilderOutput *outputs);
+
+ClusterStatistics ComputeClusterStatistics(const std::vector<Cluster> &clusters);
+
+} // namespace GeometryFX_Internal
+} // namespace AMD
+
+#endif // AMD_GEOMETRYFX_CLUSTER_BUILDER_H
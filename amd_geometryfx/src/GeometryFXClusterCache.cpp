@@ -0,0 +1,511 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXClusterCache.h"
+
+#include "AMD_GeometryFX.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(disable : 4996)
+#endif
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+// Increment whenever the layout below changes
+const uint32 CLUSTER_CACHE_FORMAT_VERSION = 4;
+
+// 'GFXC'
+const uint32 CLUSTER_CACHE_MAGIC = 0x43584647;
+
+/**
+A cache file is a header, followed by clusterCount cluster records, followed
+by clusterCount level of detail records if they were built, followed by
+reorderedIndexCount indices, which are present if the builder reordered
+the triangles. All members are naturally aligned, so the file can be used
+directly after a single read or from a memory mapping.
+*/
+struct ClusterCacheHeader
+{
+    uint32 magic;
+    uint32 formatVersion;
+    uint32 libraryVersion[3];
+    uint32 maximumTrianglesPerCluster;
+
+    uint64 key;
+
+    int32 vertexCount;
+    int32 indexCount;
+
+    int32 spatialClusters;
+    int32 maximumVerticesPerCluster;
+    int32 coneType;
+
+    int32 optimizeVertexCache;
+    int32 buildLod;
+
+    int32 clusterCount;
+    int32 reorderedIndexCount;
+    int32 baseClusterCount;
+};
+
+static_assert(sizeof(ClusterCacheHeader) == 72, "Unexpected cluster cache header size");
+
+struct ClusterCacheRecord
+{
+    float aabbMin[3];
+    float aabbMax[3];
+    float coneCenter[3];
+    float coneAxis[3];
+    float coneAngleCosine;
+
+    int32 firstTriangle;
+    int32 triangleCount;
+    int32 valid;
+};
+
+static_assert(sizeof(ClusterCacheRecord) == 64, "Unexpected cluster cache record size");
+
+// Stored as is, it only consists of floats
+static_assert(sizeof(ClusterLod) == 40, "Unexpected cluster level of detail size");
+
+/**
+xxHash64 by Yann Collet. It runs at memory speed, so hashing is negligible
+compared to building the clusters.
+*/
+class Hash64
+{
+public:
+    static uint64 Compute(const void *data, const std::size_t size, const uint64 seed)
+    {
+        const byte *p = static_cast<const byte *>(data);
+        const byte *const end = p + size;
+
+        uint64 h;
+
+        if (size >= 32)
+        {
+            uint64 v1 = seed + PRIME_1 + PRIME_2;
+            uint64 v2 = seed + PRIME_2;
+            uint64 v3 = seed;
+            uint64 v4 = seed - PRIME_1;
+
+            const byte *const limit = end - 32;
+            do
+            {
+                v1 = Round(v1, Read64(p));
+                v2 = Round(v2, Read64(p + 8));
+                v3 = Round(v3, Read64(p + 16));
+                v4 = Round(v4, Read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+            h = MergeRound(h, v1);
+            h = MergeRound(h, v2);
+            h = MergeRound(h, v3);
+            h = MergeRound(h, v4);
+        }
+        else
+        {
+            h = seed + PRIME_5;
+        }
+
+        h += static_cast<uint64>(size);
+
+        for (; p + 8 <= end; p += 8)
+        {
+            h ^= Round(0, Read64(p));
+            h = RotateLeft(h, 27) * PRIME_1 + PRIME_4;
+        }
+
+        if (p + 4 <= end)
+        {
+            h ^= static_cast<uint64>(Read32(p)) * PRIME_1;
+            h = RotateLeft(h, 23) * PRIME_2 + PRIME_3;
+            p += 4;
+        }
+
+        for (; p < end; ++p)
+        {
+            h ^= static_cast<uint64>(static_cast<uint8>(*p)) * PRIME_5;
+            h = RotateLeft(h, 11) * PRIME_1;
+        }
+
+        h ^= h >> 33;
+        h *= PRIME_2;
+        h ^= h >> 29;
+        h *= PRIME_3;
+        h ^= h >> 32;
+
+        return h;
+    }
+
+private:
+    static const uint64 PRIME_1 = 0x9E3779B185EBCA87ULL;
+    static const uint64 PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+    static const uint64 PRIME_3 = 0x165667B19E3779F9ULL;
+    static const uint64 PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+    static const uint64 PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+    static uint64 RotateLeft(const uint64 v, const int r)
+    {
+        return (v << r) | (v >> (64 - r));
+    }
+
+    static uint64 Read64(const byte *p)
+    {
+        uint64 v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint32 Read32(const byte *p)
+    {
+        uint32 v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static uint64 Round(uint64 acc, const uint64 input)
+    {
+        acc += input * PRIME_2;
+        acc = RotateLeft(acc, 31);
+        return acc * PRIME_1;
+    }
+
+    static uint64 MergeRound(uint64 acc, const uint64 v)
+    {
+        acc ^= Round(0, v);
+        return acc * PRIME_1 + PRIME_4;
+    }
+};
+
+std::string GetCacheFileName(const std::string &directory, const uint64 key)
+{
+    char name[32];
+    std::sprintf(name, "%016llx.gfxclusters", static_cast<unsigned long long>(key));
+
+    if (directory.empty())
+    {
+        return name;
+    }
+
+    const char last = directory[directory.size() - 1];
+    if (last == '/' || last == '\\')
+    {
+        return directory + name;
+    }
+
+    return directory + "/" + name;
+}
+
+void FillHeader(const uint64 key, const ClusterBuilderOptions &options,
+    const ClusterBuilderInput &input, ClusterCacheHeader &header)
+{
+    std::memset(&header, 0, sizeof(header));
+
+    header.magic = CLUSTER_CACHE_MAGIC;
+    header.formatVersion = CLUSTER_CACHE_FORMAT_VERSION;
+    header.libraryVersion[0] = AMD_GEOMETRYFX_VERSION_MAJOR;
+    header.libraryVersion[1] = AMD_GEOMETRYFX_VERSION_MINOR;
+    header.libraryVersion[2] = AMD_GEOMETRYFX_VERSION_PATCH;
+    header.maximumTrianglesPerCluster = options.maximumTrianglesPerCluster;
+
+    header.key = key;
+
+    header.vertexCount = input.vertexCount;
+    header.indexCount = input.indexCount;
+
+    header.spatialClusters = options.spatialClusters ? 1 : 0;
+    header.maximumVerticesPerCluster = options.spatialClusters ? options.maximumVerticesPerCluster : 0;
+    header.coneType = options.coneType;
+    header.optimizeVertexCache = options.optimizeVertexCache ? 1 : 0;
+    header.buildLod = options.buildLod ? 1 : 0;
+}
+
+unsigned int GetCurrentProcessIdentifier()
+{
+#ifdef _WIN32
+    return static_cast<unsigned int>(_getpid());
+#else
+    return static_cast<unsigned int>(getpid());
+#endif
+}
+
+bool IsValidCluster(const ClusterCacheRecord &record, const int triangleCount,
+    const int maximumTrianglesPerCluster)
+{
+    return record.triangleCount > 0
+        && record.triangleCount <= maximumTrianglesPerCluster
+        && record.firstTriangle >= 0
+        && record.firstTriangle <= triangleCount - record.triangleCount;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+uint64 ComputeClusterCacheKey(const ClusterBuilderOptions &options, const ClusterBuilderInput &input)
+{
+    // The header already stores everything which changes the result, so it
+    // doubles as the seed
+    ClusterCacheHeader header;
+    FillHeader(0, options, input, header);
+
+    uint64 key = Hash64::Compute(&header, sizeof(header), 0);
+    key = Hash64::Compute(input.vertexData, input.vertexCount * 3 * sizeof(float), key);
+    key = Hash64::Compute(input.indexData, input.indexCount * sizeof(int32), key);
+
+    return key;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool LoadClusterCache(const std::string &directory, const uint64 key,
+    const ClusterBuilderOptions &options, const ClusterBuilderInput &input,
+    ClusterBuilderOutput &output)
+{
+    auto handle = std::fopen(GetCacheFileName(directory, key).c_str(), "rb");
+
+    if (handle == nullptr)
+    {
+        return false;
+    }
+
+    std::vector<byte> contents;
+
+    if (std::fseek(handle, 0, SEEK_END) == 0)
+    {
+        const long size = std::ftell(handle);
+
+        if (size >= static_cast<long>(sizeof(ClusterCacheHeader)))
+        {
+            contents.resize(size);
+            std::rewind(handle);
+
+            if (std::fread(contents.data(), 1, contents.size(), handle) != contents.size())
+            {
+                contents.clear();
+            }
+        }
+    }
+
+    std::fclose(handle);
+
+    if (contents.empty())
+    {
+        return false;
+    }
+
+    ClusterCacheHeader expectedHeader;
+    FillHeader(key, options, input, expectedHeader);
+
+    ClusterCacheHeader header;
+    std::memcpy(&header, contents.data(), sizeof(header));
+
+    // Everything but the counts at the end must match
+    if (std::memcmp(&header, &expectedHeader, offsetof(ClusterCacheHeader, clusterCount)) != 0)
+    {
+        return false;
+    }
+
+    bool validCounts;
+    if (options.buildLod)
+    {
+        // The simplified levels add up to the same number of indices again
+        validCounts = header.reorderedIndexCount >= input.indexCount
+            && header.reorderedIndexCount <= input.indexCount * 2
+            && header.reorderedIndexCount % 3 == 0
+            && header.baseClusterCount >= 0
+            && header.baseClusterCount <= header.clusterCount;
+    }
+    else
+    {
+        validCounts = header.reorderedIndexCount
+                == ((options.spatialClusters || options.optimizeVertexCache) ? input.indexCount : 0)
+            && header.baseClusterCount == header.clusterCount;
+    }
+
+    // Triangles of the simplified levels follow the input triangles
+    const int triangleCount = (std::max)(input.indexCount, header.reorderedIndexCount) / 3;
+
+    if (!validCounts || header.clusterCount < 0 || header.clusterCount > triangleCount)
+    {
+        return false;
+    }
+
+    const std::size_t lodRecordCount = options.buildLod ? header.clusterCount : 0;
+
+    const std::size_t clusterOffset = sizeof(ClusterCacheHeader);
+    const std::size_t lodOffset = clusterOffset + header.clusterCount * sizeof(ClusterCacheRecord);
+    const std::size_t indexOffset = lodOffset + lodRecordCount * sizeof(ClusterLod);
+    const std::size_t expectedSize = indexOffset + header.reorderedIndexCount * sizeof(int32);
+
+    if (contents.size() != expectedSize)
+    {
+        return false;
+    }
+
+    const ClusterCacheRecord *records =
+        reinterpret_cast<const ClusterCacheRecord *>(contents.data() + clusterOffset);
+    const ClusterLod *lods = reinterpret_cast<const ClusterLod *>(contents.data() + lodOffset);
+    const int32 *indices = reinterpret_cast<const int32 *>(contents.data() + indexOffset);
+
+    std::vector<Cluster> clusters(header.clusterCount);
+    for (int i = 0; i < header.clusterCount; ++i)
+    {
+        const ClusterCacheRecord &record = records[i];
+
+        if (!IsValidCluster(record, triangleCount, options.maximumTrianglesPerCluster))
+        {
+            return false;
+        }
+
+        Cluster &cluster = clusters[i];
+        cluster.aabbMin = DirectX::XMVectorSet(record.aabbMin[0], record.aabbMin[1], record.aabbMin[2], 1.0f);
+        cluster.aabbMax = DirectX::XMVectorSet(record.aabbMax[0], record.aabbMax[1], record.aabbMax[2], 1.0f);
+        cluster.coneCenter = DirectX::XMVectorSet(record.coneCenter[0], record.coneCenter[1], record.coneCenter[2], 1.0f);
+        cluster.coneAxis = DirectX::XMVectorSet(record.coneAxis[0], record.coneAxis[1], record.coneAxis[2], 0.0f);
+        cluster.coneAngleCosine = record.coneAngleCosine;
+        cluster.valid = record.valid != 0;
+        cluster.firstTriangle = record.firstTriangle;
+        cluster.triangleCount = record.triangleCount;
+    }
+
+    for (int i = 0; i < header.reorderedIndexCount; ++i)
+    {
+        if (indices[i] < 0 || indices[i] >= input.vertexCount)
+        {
+            return false;
+        }
+    }
+
+    output.clusters.swap(clusters);
+    output.baseClusterCount = header.baseClusterCount;
+    output.clusterLods.assign(lods, lods + lodRecordCount);
+    output.reorderedIndices.assign(indices, indices + header.reorderedIndexCount);
+    output.loadedFromCache = true;
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool StoreClusterCache(const std::string &directory, const uint64 key,
+    const ClusterBuilderOptions &options, const ClusterBuilderInput &input,
+    const ClusterBuilderOutput &output)
+{
+    ClusterCacheHeader header;
+    FillHeader(key, options, input, header);
+    header.clusterCount = static_cast<int32>(output.clusters.size());
+    header.reorderedIndexCount = static_cast<int32>(output.reorderedIndices.size());
+    header.baseClusterCount = output.baseClusterCount;
+
+    std::vector<ClusterCacheRecord> records(output.clusters.size());
+    for (std::size_t i = 0; i < output.clusters.size(); ++i)
+    {
+        const Cluster &cluster = output.clusters[i];
+        ClusterCacheRecord &record = records[i];
+
+        DirectX::XMFLOAT3 v;
+        DirectX::XMStoreFloat3(&v, cluster.aabbMin);
+        record.aabbMin[0] = v.x; record.aabbMin[1] = v.y; record.aabbMin[2] = v.z;
+        DirectX::XMStoreFloat3(&v, cluster.aabbMax);
+        record.aabbMax[0] = v.x; record.aabbMax[1] = v.y; record.aabbMax[2] = v.z;
+        DirectX::XMStoreFloat3(&v, cluster.coneCenter);
+        record.coneCenter[0] = v.x; record.coneCenter[1] = v.y; record.coneCenter[2] = v.z;
+        DirectX::XMStoreFloat3(&v, cluster.coneAxis);
+        record.coneAxis[0] = v.x; record.coneAxis[1] = v.y; record.coneAxis[2] = v.z;
+        record.coneAngleCosine = cluster.coneAngleCosine;
+        record.firstTriangle = cluster.firstTriangle;
+        record.triangleCount = cluster.triangleCount;
+        record.valid = cluster.valid ? 1 : 0;
+    }
+
+    // Several threads and processes may store the same mesh at once, so
+    // every writer needs its own temporary file
+    static std::atomic<uint32> temporaryFileCounter(0);
+    char suffix[32];
+    std::sprintf(suffix, ".tmp%u_%u", GetCurrentProcessIdentifier(),
+        static_cast<unsigned int>(temporaryFileCounter++));
+
+    const std::string fileName = GetCacheFileName(directory, key);
+    const std::string temporaryFileName = fileName + suffix;
+
+    auto handle = std::fopen(temporaryFileName.c_str(), "wb");
+
+    if (handle == nullptr)
+    {
+        return false;
+    }
+
+    bool success = std::fwrite(&header, sizeof(header), 1, handle) == 1;
+
+    if (success && !records.empty())
+    {
+        success = std::fwrite(records.data(), sizeof(ClusterCacheRecord), records.size(), handle)
+            == records.size();
+    }
+
+    if (success && !output.clusterLods.empty())
+    {
+        success = std::fwrite(output.clusterLods.data(), sizeof(ClusterLod),
+            output.clusterLods.size(), handle) == output.clusterLods.size();
+    }
+
+    if (success && !output.reorderedIndices.empty())
+    {
+        success = std::fwrite(output.reorderedIndices.data(), sizeof(int32),
+            output.reorderedIndices.size(), handle) == output.reorderedIndices.size();
+    }
+
+    success = (std::fclose(handle) == 0) && success;
+
+    // rename does not replace existing files on Windows
+    if (success)
+    {
+        std::remove(fileName.c_str());
+        success = std::rename(temporaryFileName.c_str(), fileName.c_str()) == 0;
+    }
+
+    if (!success)
+    {
+        std::remove(temporaryFileName.c_str());
+    }
+
+    return success;
+}
+}
+}
@@ -0,0 +1,65 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_CLUSTER_CACHE_H
+#define AMD_GEOMETRYFX_CLUSTER_CACHE_H
+
+#include <string>
+
+#include "AMD_Types.h"
+#include "GeometryFXClusterBuilder.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+/**
+Hash the vertex and index data together with every builder option which
+affects the result.
+*/
+uint64 ComputeClusterCacheKey(const ClusterBuilderOptions &options, const ClusterBuilderInput &input);
+
+/**
+Try to load the clusters for the given key from the cache directory.
+
+The whole file is read with a single read call. Returns false if the file
+does not exist, was written by a different library version or with a
+different cluster size, or does not match the input. output is only modified
+on success.
+*/
+bool LoadClusterCache(const std::string &directory, const uint64 key,
+    const ClusterBuilderOptions &options, const ClusterBuilderInput &input,
+    ClusterBuilderOutput &output);
+
+/**
+Write the clusters for the given key to the cache directory.
+
+The file is written under a temporary name and renamed once complete, so
+concurrent readers never see a partial file.
+*/
+bool StoreClusterCache(const std::string &directory, const uint64 key,
+    const ClusterBuilderOptions &options, const ClusterBuilderInput &input,
+    const ClusterBuilderOutput &output);
+}
+}
+
+#endif // AMD_GEOMETRYFX_CLUSTER_CACHE_H
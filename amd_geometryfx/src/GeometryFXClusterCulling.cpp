@@ -0,0 +1,205 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXClusterCulling.h"
+
+#include <cfloat>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define AMD_GEOMETRY_FX_ENABLE_CLUSTER_CULLING_SSE2 1
+#include <emmintrin.h>
+#else
+#define AMD_GEOMETRY_FX_ENABLE_CLUSTER_CULLING_SSE2 0
+#endif
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_CULLING_SSE2
+// Four consecutive 16 bit lanes, converted to float
+inline __m128 LoadQuantized(const uint16 *values)
+{
+    const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(values));
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, _mm_setzero_si128()));
+}
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BuildClusterBlocks(const std::vector<PackedCluster> &clusters,
+    std::vector<ClusterBlock> &blocks)
+{
+    const int clusterCount = static_cast<int>(clusters.size());
+
+    blocks.assign((clusterCount + CLUSTER_BLOCK_SIZE - 1) / CLUSTER_BLOCK_SIZE, ClusterBlock());
+
+    for (auto &block : blocks)
+    {
+        for (int lane = 0; lane < CLUSTER_BLOCK_SIZE; ++lane)
+        {
+            block.coneCutoff[lane] = FLT_MAX;
+        }
+    }
+
+    for (int i = 0; i < clusterCount; ++i)
+    {
+        const PackedCluster &cluster = clusters[i];
+        ClusterBlock &block = blocks[i / CLUSTER_BLOCK_SIZE];
+        const int lane = i % CLUSTER_BLOCK_SIZE;
+
+        float axis[3];
+        DecodeConeAxis(cluster.coneAxis, axis);
+
+        for (int j = 0; j < 3; ++j)
+        {
+            block.aabbMin[j][lane] = cluster.aabbMin[j];
+            block.aabbMax[j][lane] = cluster.aabbMax[j];
+            block.coneApex[j][lane] = cluster.coneApex[j];
+            block.coneAxis[j][lane] = axis[j];
+        }
+
+        if (cluster.coneCutoff != PACKED_CLUSTER_INVALID_CONE)
+        {
+            const float cutoff = DecodeConeCutoff(cluster.coneCutoff);
+            block.coneCutoff[lane] = cutoff * cutoff
+                * (axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+uint32 ObjectSpaceFrustum::GetOutsideMask(const ClusterBlock &block) const
+{
+    // For each plane, only the box corner furthest along the plane normal
+    // needs to be tested. The normal is the same for all lanes, so the
+    // corner is picked once per plane instead of once per lane.
+    const uint16 *corners[PLANE_COUNT][3];
+
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        const float normal[3] = {
+            planeComponents_[i].x, planeComponents_[i].y, planeComponents_[i].z };
+
+        for (int j = 0; j < 3; ++j)
+        {
+            corners[i][j] = normal[j] > 0 ? block.aabbMax[j] : block.aabbMin[j];
+        }
+    }
+
+    uint32 mask = 0;
+
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_CULLING_SSE2
+    for (int lane = 0; lane < CLUSTER_BLOCK_SIZE; lane += 4)
+    {
+        __m128 outside = _mm_setzero_ps();
+
+        for (int i = 0; i < PLANE_COUNT; ++i)
+        {
+            const DirectX::XMFLOAT4 &plane = planeComponents_[i];
+
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), LoadQuantized(corners[i][0] + lane)),
+                    _mm_mul_ps(_mm_set1_ps(plane.y), LoadQuantized(corners[i][1] + lane))),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), LoadQuantized(corners[i][2] + lane)),
+                    _mm_set1_ps(plane.w)));
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+        }
+
+        mask |= static_cast<uint32>(_mm_movemask_ps(outside)) << lane;
+    }
+#else
+    for (int lane = 0; lane < CLUSTER_BLOCK_SIZE; ++lane)
+    {
+        for (int i = 0; i < PLANE_COUNT; ++i)
+        {
+            const DirectX::XMFLOAT4 &plane = planeComponents_[i];
+
+            const float distance = plane.x * corners[i][0][lane] + plane.y * corners[i][1][lane]
+                + plane.z * corners[i][2][lane] + plane.w;
+
+            if (distance < 0)
+            {
+                mask |= 1u << lane;
+                break;
+            }
+        }
+    }
+#endif
+
+    return mask;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+uint32 GetBackfacingMask(const ClusterBlock &block, const DirectX::XMFLOAT3 &eye)
+{
+    uint32 mask = 0;
+
+#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_CULLING_SSE2
+    const __m128 eyeX = _mm_set1_ps(eye.x);
+    const __m128 eyeY = _mm_set1_ps(eye.y);
+    const __m128 eyeZ = _mm_set1_ps(eye.z);
+
+    for (int lane = 0; lane < CLUSTER_BLOCK_SIZE; lane += 4)
+    {
+        const __m128 dx = _mm_sub_ps(eyeX, _mm_loadu_ps(block.coneApex[0] + lane));
+        const __m128 dy = _mm_sub_ps(eyeY, _mm_loadu_ps(block.coneApex[1] + lane));
+        const __m128 dz = _mm_sub_ps(eyeZ, _mm_loadu_ps(block.coneApex[2] + lane));
+
+        const __m128 d = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(dx, _mm_loadu_ps(block.coneAxis[0] + lane)),
+            _mm_mul_ps(dy, _mm_loadu_ps(block.coneAxis[1] + lane))),
+            _mm_mul_ps(dz, _mm_loadu_ps(block.coneAxis[2] + lane)));
+
+        const __m128 directionLengthSq = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+        const __m128 backfacing = _mm_and_ps(_mm_cmpgt_ps(d, _mm_setzero_ps()),
+            _mm_cmpgt_ps(_mm_mul_ps(d, d),
+                _mm_mul_ps(_mm_loadu_ps(block.coneCutoff + lane), directionLengthSq)));
+
+        mask |= static_cast<uint32>(_mm_movemask_ps(backfacing)) << lane;
+    }
+#else
+    for (int lane = 0; lane < CLUSTER_BLOCK_SIZE; ++lane)
+    {
+        const float dx = eye.x - block.coneApex[0][lane];
+        const float dy = eye.y - block.coneApex[1][lane];
+        const float dz = eye.z - block.coneApex[2][lane];
+
+        const float d = dx * block.coneAxis[0][lane] + dy * block.coneAxis[1][lane]
+            + dz * block.coneAxis[2][lane];
+
+        if (d > 0 && d * d > block.coneCutoff[lane] * (dx * dx + dy * dy + dz * dz))
+        {
+            mask |= 1u << lane;
+        }
+    }
+#endif
+
+    return mask;
+}
+}
+}
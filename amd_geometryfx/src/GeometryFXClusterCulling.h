@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_CLUSTER_CULLING_H
+#define AMD_GEOMETRYFX_CLUSTER_CULLING_H
+
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "AMD_Types.h"
+#include "GeometryFXPackedCluster.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+// Number of clusters tested at once, one bit each in a cluster mask
+const int CLUSTER_BLOCK_SIZE = 8;
+
+/**
+The culling data of CLUSTER_BLOCK_SIZE consecutive clusters of a mesh, in
+structure of arrays layout. Cluster i of a mesh is lane i %
+CLUSTER_BLOCK_SIZE of block i / CLUSTER_BLOCK_SIZE.
+
+The boxes stay quantized as in PackedCluster. The cone is decoded, and the
+cutoff already includes the length of the decoded axis, see
+GetBackfacingMask. Lanes past the last cluster are never culled, but must
+be masked out by the caller.
+*/
+struct ClusterBlock
+{
+    uint16 aabbMin[3][CLUSTER_BLOCK_SIZE];
+    uint16 aabbMax[3][CLUSTER_BLOCK_SIZE];
+
+    float coneApex[3][CLUSTER_BLOCK_SIZE];
+    float coneAxis[3][CLUSTER_BLOCK_SIZE];
+
+    // Square of the cone cutoff times the squared length of coneAxis, or
+    // FLT_MAX for clusters without a valid cone
+    float coneCutoff[CLUSTER_BLOCK_SIZE];
+};
+
+/**
+Build the blocks for all packed clusters of a mesh.
+*/
+void BuildClusterBlocks(const std::vector<PackedCluster> &clusters,
+    std::vector<ClusterBlock> &blocks);
+
+/**
+The frustum planes of one draw request, in the object space of the mesh. The
+object space may include the dequantization of the packed cluster boxes, so
+the boxes are tested without decoding them.
+
+The planes are read straight from the columns of the world-view-projection
+matrix, so no matrix inversion is needed. Only the planes FilterCS tests per
+triangle are used: the four side planes and w > 0. Near and far are left out,
+as depth clipping may be disabled.
+*/
+class ObjectSpaceFrustum
+{
+public:
+    explicit ObjectSpaceFrustum(const DirectX::XMMATRIX &worldViewProjection)
+    {
+        const auto m = DirectX::XMMatrixTranspose(worldViewProjection);
+
+        planes_[0] = DirectX::XMVectorAdd(m.r[3], m.r[0]);      // Left
+        planes_[1] = DirectX::XMVectorSubtract(m.r[3], m.r[0]); // Right
+        planes_[2] = DirectX::XMVectorAdd(m.r[3], m.r[1]);      // Bottom
+        planes_[3] = DirectX::XMVectorSubtract(m.r[3], m.r[1]); // Top
+        planes_[4] = m.r[3];                                    // In front of the eye
+
+        for (int i = 0; i < PLANE_COUNT; ++i)
+        {
+            DirectX::XMStoreFloat4(&planeComponents_[i], planes_[i]);
+        }
+    }
+
+    /**
+    True if the box is completely on the outer side of one plane. Boxes which
+    straddle a corner of the frustum are kept, which is conservative.
+    */
+    bool IsOutside(const DirectX::XMVECTOR aabbMin, const DirectX::XMVECTOR aabbMax) const
+    {
+        const auto center = DirectX::XMVectorScale(DirectX::XMVectorAdd(aabbMin, aabbMax), 0.5f);
+        const auto extent = DirectX::XMVectorScale(DirectX::XMVectorSubtract(aabbMax, aabbMin), 0.5f);
+
+        for (int i = 0; i < PLANE_COUNT; ++i)
+        {
+            // Distance of the center and projected radius of the box, both
+            // scaled by the length of the plane normal
+            const float distance =
+                DirectX::XMVectorGetX(DirectX::XMPlaneDotCoord(planes_[i], center));
+            const float radius = DirectX::XMVectorGetX(
+                DirectX::XMVector3Dot(DirectX::XMVectorAbs(planes_[i]), extent));
+
+            if (distance + radius < 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+    IsOutside for all clusters of a block at once. Bit i is set if lane i is
+    outside.
+    */
+    uint32 GetOutsideMask(const ClusterBlock &block) const;
+
+private:
+    static const int PLANE_COUNT = 5;
+    DirectX::XMVECTOR planes_[PLANE_COUNT];
+    DirectX::XMFLOAT4 planeComponents_[PLANE_COUNT];
+};
+
+/**
+IsConeBackfacing for all clusters of a block at once. Bit i is set if eye,
+in object space, lies inside the cone of lane i.
+*/
+uint32 GetBackfacingMask(const ClusterBlock &block, const DirectX::XMFLOAT3 &eye);
+
+inline int CountClusterMaskBits(uint32 mask)
+{
+    mask = mask - ((mask >> 1) & 0x55555555);
+    mask = (mask & 0x33333333) + ((mask >> 2) & 0x33333333);
+    return static_cast<int>((((mask + (mask >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+}
+}
+}
+
+#endif // AMD_GEOMETRYFX_CLUSTER_CULLING_H
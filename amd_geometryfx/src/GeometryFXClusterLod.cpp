@@ -0,0 +1,821 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXClusterLod.h"
+
+#include "GeometryFXClusterBuilder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+#ifdef min
+#undef min
+#endif
+
+#ifdef max
+#undef max
+#endif
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+// Number of clusters simplified together. Larger groups move the locked
+// group borders less often, but make every level coarser.
+const int LOD_GROUP_SIZE = 4;
+
+// Each level aims at half the triangles of the level below
+const float LOD_TARGET_RATIO = 0.5f;
+
+// Groups which cannot get below this fraction of their triangles are not
+// simplified any further
+const float LOD_MINIMUM_REDUCTION = 0.85f;
+
+// Upper bound for the collapse passes over one group
+const int LOD_MAXIMUM_PASSES = 16;
+
+/**
+Sum of squared distances to a set of planes, weighted by the area of the
+triangle each plane came from. Stored as the upper triangle of a symmetric
+4x4 matrix.
+*/
+struct Quadric
+{
+    Quadric()
+        : weight(0)
+    {
+        std::fill(a, a + 10, 0.0);
+    }
+
+    void AddPlane(const double n[3], const double d, const double w)
+    {
+        a[0] += w * n[0] * n[0]; a[1] += w * n[0] * n[1]; a[2] += w * n[0] * n[2]; a[3] += w * n[0] * d;
+        a[4] += w * n[1] * n[1]; a[5] += w * n[1] * n[2]; a[6] += w * n[1] * d;
+        a[7] += w * n[2] * n[2]; a[8] += w * n[2] * d;
+        a[9] += w * d * d;
+        weight += w;
+    }
+
+    void Add(const Quadric &other)
+    {
+        for (int i = 0; i < 10; ++i)
+        {
+            a[i] += other.a[i];
+        }
+
+        weight += other.weight;
+    }
+
+    double Evaluate(const float p[3]) const
+    {
+        const double x = p[0], y = p[1], z = p[2];
+
+        return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+            + a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+            + a[7] * z * z + 2 * a[8] * z
+            + a[9];
+    }
+
+    double a[10];
+    double weight;
+};
+
+void ComputeNormal(const float *p0, const float *p1, const float *p2, double n[3])
+{
+    const double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    const double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+struct Collapse
+{
+    double cost;
+    int from;
+    int to;
+
+    bool operator<(const Collapse &other) const
+    {
+        return cost < other.cost;
+    }
+};
+
+/**
+Edge collapse simplification of the triangles of one group.
+
+Vertices are only ever moved onto one of their neighbours, so the
+simplified mesh uses a subset of the original vertices and needs no new
+vertex data. Locked vertices never move, which keeps the borders to the
+rest of the mesh intact.
+*/
+class GroupSimplifier
+{
+public:
+    /**
+    Reduce triangles, which index positions, to about targetTriangleCount
+    triangles. Returns the largest error of all collapses, as the square
+    root of the area weighted mean squared distance to the original planes.
+    */
+    float Simplify(const std::vector<float> &positions, const std::vector<bool> &locked,
+        std::vector<int32> &triangles, const int targetTriangleCount)
+    {
+        const int vertexCount = static_cast<int>(positions.size() / 3);
+        int triangleCount = static_cast<int>(triangles.size() / 3);
+
+        quadrics_.assign(vertexCount, Quadric());
+        for (int i = 0; i < triangleCount; ++i)
+        {
+            const int32 *t = &triangles[i * 3];
+            const float *p0 = &positions[t[0] * 3];
+
+            double n[3];
+            ComputeNormal(p0, &positions[t[1] * 3], &positions[t[2] * 3], n);
+
+            const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            if (length == 0)
+            {
+                continue;
+            }
+
+            n[0] /= length; n[1] /= length; n[2] /= length;
+            const double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+
+            for (int j = 0; j < 3; ++j)
+            {
+                quadrics_[t[j]].AddPlane(n, d, length * 0.5);
+            }
+        }
+
+        alive_.assign(triangleCount, true);
+        int aliveCount = triangleCount;
+        double maximumCost = 0;
+
+        for (int pass = 0; pass < LOD_MAXIMUM_PASSES && aliveCount > targetTriangleCount; ++pass)
+        {
+            BuildAdjacency(vertexCount, triangles);
+            CollectCollapses(positions, locked, triangles);
+
+            // Every collapse changes the quadric of its target and the
+            // triangle fan of its source, so both are left alone for the
+            // rest of the pass
+            touched_.assign(vertexCount, false);
+            bool collapsed = false;
+
+            for (auto it = collapses_.begin(), end = collapses_.end();
+                 it != end && aliveCount > targetTriangleCount; ++it)
+            {
+                if (touched_[it->from] || touched_[it->to]
+                    || !IsManifoldCollapse(triangles, it->from, it->to)
+                    || FlipsTriangle(positions, triangles, it->from, it->to))
+                {
+                    continue;
+                }
+
+                for (int i = adjacencyOffsets_[it->from]; i < adjacencyOffsets_[it->from + 1]; ++i)
+                {
+                    const int triangle = adjacentTriangles_[i];
+                    if (!alive_[triangle])
+                    {
+                        continue;
+                    }
+
+                    int32 *t = &triangles[triangle * 3];
+                    if (t[0] == it->to || t[1] == it->to || t[2] == it->to)
+                    {
+                        alive_[triangle] = false;
+                        --aliveCount;
+                    }
+                    else
+                    {
+                        for (int j = 0; j < 3; ++j)
+                        {
+                            if (t[j] == it->from)
+                            {
+                                t[j] = it->to;
+                            }
+                        }
+                    }
+                }
+
+                quadrics_[it->to].Add(quadrics_[it->from]);
+                maximumCost = std::max(maximumCost, it->cost);
+
+                touched_[it->from] = true;
+                touched_[it->to] = true;
+                collapsed = true;
+            }
+
+            if (!collapsed)
+            {
+                break;
+            }
+        }
+
+        int writeIndex = 0;
+        for (int i = 0; i < triangleCount; ++i)
+        {
+            if (alive_[i])
+            {
+                for (int j = 0; j < 3; ++j)
+                {
+                    triangles[writeIndex * 3 + j] = triangles[i * 3 + j];
+                }
+
+                ++writeIndex;
+            }
+        }
+
+        triangles.resize(writeIndex * 3);
+
+        return static_cast<float>(std::sqrt(maximumCost));
+    }
+
+private:
+    void BuildAdjacency(const int vertexCount, const std::vector<int32> &triangles)
+    {
+        const int triangleCount = static_cast<int>(triangles.size() / 3);
+
+        adjacencyOffsets_.assign(vertexCount + 1, 0);
+        for (int i = 0; i < triangleCount; ++i)
+        {
+            if (alive_[i])
+            {
+                for (int j = 0; j < 3; ++j)
+                {
+                    ++adjacencyOffsets_[triangles[i * 3 + j] + 1];
+                }
+            }
+        }
+
+        for (int i = 0; i < vertexCount; ++i)
+        {
+            adjacencyOffsets_[i + 1] += adjacencyOffsets_[i];
+        }
+
+        adjacentTriangles_.resize(adjacencyOffsets_[vertexCount]);
+        fill_.assign(adjacencyOffsets_.begin(), adjacencyOffsets_.end() - 1);
+
+        for (int i = 0; i < triangleCount; ++i)
+        {
+            if (alive_[i])
+            {
+                for (int j = 0; j < 3; ++j)
+                {
+                    adjacentTriangles_[fill_[triangles[i * 3 + j]]++] = i;
+                }
+            }
+        }
+    }
+
+    void CollectCollapses(const std::vector<float> &positions, const std::vector<bool> &locked,
+        const std::vector<int32> &triangles)
+    {
+        collapses_.clear();
+
+        const int triangleCount = static_cast<int>(triangles.size() / 3);
+        for (int i = 0; i < triangleCount; ++i)
+        {
+            if (!alive_[i])
+            {
+                continue;
+            }
+
+            for (int j = 0; j < 3; ++j)
+            {
+                const int from = triangles[i * 3 + j];
+                const int to = triangles[i * 3 + (j + 1) % 3];
+
+                // Each interior edge is visited from both of its triangles,
+                // once in each direction
+                if (!locked[from])
+                {
+                    Quadric q = quadrics_[from];
+                    q.Add(quadrics_[to]);
+
+                    Collapse collapse;
+                    collapse.cost = std::max(0.0, q.Evaluate(&positions[to * 3]))
+                        / std::max(q.weight, DBL_MIN);
+                    collapse.from = from;
+                    collapse.to = to;
+                    collapses_.push_back(collapse);
+                }
+            }
+        }
+
+        std::sort(collapses_.begin(), collapses_.end());
+    }
+
+    /**
+    An edge inside a surface has exactly two opposite vertices. If the two
+    endpoints share more neighbours, the collapse would pinch the surface
+    into a non-manifold edge.
+    */
+    bool IsManifoldCollapse(const std::vector<int32> &triangles, const int from, const int to)
+    {
+        CollectNeighbours(triangles, from, fromNeighbours_);
+        CollectNeighbours(triangles, to, toNeighbours_);
+
+        int shared = 0;
+        for (auto it = toNeighbours_.begin(), end = toNeighbours_.end(); it != end; ++it)
+        {
+            if (*it != from && *it != to
+                && std::binary_search(fromNeighbours_.begin(), fromNeighbours_.end(), *it))
+            {
+                ++shared;
+            }
+        }
+
+        return shared == 2;
+    }
+
+    void CollectNeighbours(const std::vector<int32> &triangles, const int vertex,
+        std::vector<int> &neighbours) const
+    {
+        neighbours.clear();
+        for (int i = adjacencyOffsets_[vertex]; i < adjacencyOffsets_[vertex + 1]; ++i)
+        {
+            if (alive_[adjacentTriangles_[i]])
+            {
+                const int32 *t = &triangles[adjacentTriangles_[i] * 3];
+                neighbours.insert(neighbours.end(), t, t + 3);
+            }
+        }
+
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    }
+
+    bool FlipsTriangle(const std::vector<float> &positions, const std::vector<int32> &triangles,
+        const int from, const int to) const
+    {
+        for (int i = adjacencyOffsets_[from]; i < adjacencyOffsets_[from + 1]; ++i)
+        {
+            const int triangle = adjacentTriangles_[i];
+            const int32 *t = &triangles[triangle * 3];
+
+            if (!alive_[triangle] || t[0] == to || t[1] == to || t[2] == to)
+            {
+                continue;
+            }
+
+            double before[3], after[3];
+            ComputeNormal(&positions[t[0] * 3], &positions[t[1] * 3], &positions[t[2] * 3], before);
+            ComputeNormal(
+                &positions[(t[0] == from ? to : t[0]) * 3],
+                &positions[(t[1] == from ? to : t[1]) * 3],
+                &positions[(t[2] == from ? to : t[2]) * 3], after);
+
+            if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::vector<Quadric> quadrics_;
+    std::vector<bool> alive_;
+    std::vector<bool> touched_;
+    std::vector<int> adjacencyOffsets_;
+    std::vector<int> adjacentTriangles_;
+    std::vector<int> fill_;
+    std::vector<int> fromNeighbours_;
+    std::vector<int> toNeighbours_;
+    std::vector<Collapse> collapses_;
+};
+
+void ComputeBoundingSphere(const Cluster &cluster, ClusterLod &lod)
+{
+    DirectX::XMFLOAT3 aabbMin, aabbMax;
+    DirectX::XMStoreFloat3(&aabbMin, cluster.aabbMin);
+    DirectX::XMStoreFloat3(&aabbMax, cluster.aabbMax);
+
+    lod.center[0] = (aabbMin.x + aabbMax.x) * 0.5f;
+    lod.center[1] = (aabbMin.y + aabbMax.y) * 0.5f;
+    lod.center[2] = (aabbMin.z + aabbMax.z) * 0.5f;
+
+    const float dx = aabbMax.x - aabbMin.x;
+    const float dy = aabbMax.y - aabbMin.y;
+    const float dz = aabbMax.z - aabbMin.z;
+    lod.radius = 0.5f * std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/**
+A sphere around the spheres of all clusters of a group. The center is the
+center of their bounding box, which is not optimal, but close enough for
+the small groups used here.
+*/
+void ComputeGroupSphere(const std::vector<ClusterLod> &lods, const std::vector<int> &group,
+    float center[3], float &radius)
+{
+    float lower[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float upper[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for (auto it = group.begin(), end = group.end(); it != end; ++it)
+    {
+        const ClusterLod &lod = lods[*it];
+        for (int j = 0; j < 3; ++j)
+        {
+            lower[j] = std::min(lower[j], lod.center[j] - lod.radius);
+            upper[j] = std::max(upper[j], lod.center[j] + lod.radius);
+        }
+    }
+
+    for (int j = 0; j < 3; ++j)
+    {
+        center[j] = (lower[j] + upper[j]) * 0.5f;
+    }
+
+    radius = 0;
+    for (auto it = group.begin(), end = group.end(); it != end; ++it)
+    {
+        const ClusterLod &lod = lods[*it];
+        const float dx = lod.center[0] - center[0];
+        const float dy = lod.center[1] - center[1];
+        const float dz = lod.center[2] - center[2];
+
+        radius = std::max(radius, std::sqrt(dx * dx + dy * dy + dz * dz) + lod.radius);
+    }
+}
+
+/**
+Split the clusters of one level into groups of up to LOD_GROUP_SIZE
+clusters. A group grows by the cluster which shares the most vertices with
+it, and groups are seeded in cluster order, which is spatially coherent for
+spatial clusters.
+*/
+std::vector<std::vector<int>> CreateGroups(const int vertexCount,
+    const std::vector<Cluster> &clusters, const std::vector<int32> &indices,
+    const std::vector<int> &level)
+{
+    const int levelCount = static_cast<int>(level.size());
+
+    // Vertex to cluster adjacency, with each cluster listed once per vertex
+    std::vector<int> vertexStamp(vertexCount, -1);
+    std::vector<int> adjacencyOffsets(vertexCount + 1, 0);
+
+    for (int i = 0; i < levelCount; ++i)
+    {
+        const Cluster &cluster = clusters[level[i]];
+        for (int j = cluster.firstTriangle * 3; j < (cluster.firstTriangle + cluster.triangleCount) * 3; ++j)
+        {
+            if (vertexStamp[indices[j]] != i)
+            {
+                vertexStamp[indices[j]] = i;
+                ++adjacencyOffsets[indices[j] + 1];
+            }
+        }
+    }
+
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+    }
+
+    std::vector<int> adjacentClusters(adjacencyOffsets[vertexCount]);
+    {
+        std::vector<int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        std::fill(vertexStamp.begin(), vertexStamp.end(), -1);
+
+        for (int i = 0; i < levelCount; ++i)
+        {
+            const Cluster &cluster = clusters[level[i]];
+            for (int j = cluster.firstTriangle * 3; j < (cluster.firstTriangle + cluster.triangleCount) * 3; ++j)
+            {
+                if (vertexStamp[indices[j]] != i)
+                {
+                    vertexStamp[indices[j]] = i;
+                    adjacentClusters[fill[indices[j]]++] = i;
+                }
+            }
+        }
+    }
+
+    std::vector<bool> grouped(levelCount, false);
+    std::vector<int> sharedVertices(levelCount, 0);
+    std::vector<int> candidates;
+    std::vector<std::vector<int>> groups;
+
+    // Stamps of the group which last counted a vertex
+    std::vector<int> groupStamp(vertexCount, -1);
+
+    for (int seed = 0; seed < levelCount; ++seed)
+    {
+        if (grouped[seed])
+        {
+            continue;
+        }
+
+        const int groupIndex = static_cast<int>(groups.size());
+        std::vector<int> group;
+        candidates.clear();
+
+        int next = seed;
+        while (next >= 0)
+        {
+            grouped[next] = true;
+            group.push_back(next);
+
+            if (static_cast<int>(group.size()) == LOD_GROUP_SIZE)
+            {
+                break;
+            }
+
+            // Count the vertices the new member adds to the group for each
+            // neighbour
+            const Cluster &cluster = clusters[level[next]];
+            for (int j = cluster.firstTriangle * 3; j < (cluster.firstTriangle + cluster.triangleCount) * 3; ++j)
+            {
+                const int vertex = indices[j];
+                if (groupStamp[vertex] == groupIndex)
+                {
+                    continue;
+                }
+
+                groupStamp[vertex] = groupIndex;
+
+                for (int k = adjacencyOffsets[vertex]; k < adjacencyOffsets[vertex + 1]; ++k)
+                {
+                    const int neighbour = adjacentClusters[k];
+                    if (!grouped[neighbour])
+                    {
+                        if (sharedVertices[neighbour] == 0)
+                        {
+                            candidates.push_back(neighbour);
+                        }
+
+                        ++sharedVertices[neighbour];
+                    }
+                }
+            }
+
+            next = -1;
+            for (auto it = candidates.begin(), end = candidates.end(); it != end; ++it)
+            {
+                if (!grouped[*it] && (next < 0 || sharedVertices[*it] > sharedVertices[next]))
+                {
+                    next = *it;
+                }
+            }
+        }
+
+        for (auto it = candidates.begin(), end = candidates.end(); it != end; ++it)
+        {
+            sharedVertices[*it] = 0;
+        }
+
+        for (auto it = group.begin(), end = group.end(); it != end; ++it)
+        {
+            *it = level[*it];
+        }
+
+        groups.push_back(group);
+    }
+
+    return groups;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void BuildClusterLod(const int vertexCount, const float *vertices,
+    const int maximumVerticesPerCluster, const int maximumTrianglesPerCluster,
+    const ClusterConeType coneType, std::vector<Cluster> &clusters, std::vector<int32> &indices,
+    std::vector<ClusterLod> &lods)
+{
+    const int baseClusterCount = static_cast<int>(clusters.size());
+
+    // The simplified levels together may not use more indices than the full
+    // detail mesh
+    const std::size_t indexBudget = indices.size() * 2;
+
+    lods.resize(baseClusterCount);
+    for (int i = 0; i < baseClusterCount; ++i)
+    {
+        ClusterLod &lod = lods[i];
+        ComputeBoundingSphere(clusters[i], lod);
+        lod.error = 0;
+
+        std::copy(lod.center, lod.center + 3, lod.parentCenter);
+        lod.parentRadius = lod.radius;
+        lod.parentError = FLT_MAX;
+    }
+
+    std::vector<int> level(baseClusterCount);
+    for (int i = 0; i < baseClusterCount; ++i)
+    {
+        level[i] = i;
+    }
+
+    // Vertices on the border of a cluster which is not simplified any
+    // further must never move again
+    std::vector<bool> frozen(vertexCount, false);
+
+    // Number of clusters using a vertex in the current level, and in the
+    // current group
+    std::vector<int> levelUseCount(vertexCount, 0);
+    std::vector<int> groupUseCount(vertexCount, 0);
+
+    std::vector<int32> localIndex(vertexCount, -1);
+    std::vector<int32> globalIndex;
+    std::vector<float> positions;
+    std::vector<bool> locked;
+    std::vector<int32> triangles;
+    std::vector<int32> reordered;
+    std::vector<std::pair<int32, int32>> edges;
+    GroupSimplifier simplifier;
+
+    bool budgetExhausted = false;
+
+    while (level.size() > 1 && !budgetExhausted)
+    {
+        const std::vector<std::vector<int>> groups = CreateGroups(vertexCount, clusters, indices, level);
+
+        std::fill(levelUseCount.begin(), levelUseCount.end(), 0);
+        for (auto it = level.begin(), end = level.end(); it != end; ++it)
+        {
+            const Cluster &cluster = clusters[*it];
+            for (int j = cluster.firstTriangle * 3; j < (cluster.firstTriangle + cluster.triangleCount) * 3; ++j)
+            {
+                ++levelUseCount[indices[j]];
+            }
+        }
+
+        std::vector<int> nextLevel;
+
+        for (auto group = groups.begin(), groupEnd = groups.end(); group != groupEnd; ++group)
+        {
+            // Gather the triangles of the group with compact vertex indices,
+            // so the clustering below only pays for the vertices of the group
+            globalIndex.clear();
+            positions.clear();
+            triangles.clear();
+
+            for (auto it = group->begin(), end = group->end(); it != end; ++it)
+            {
+                const Cluster &cluster = clusters[*it];
+                for (int j = cluster.firstTriangle * 3; j < (cluster.firstTriangle + cluster.triangleCount) * 3; ++j)
+                {
+                    const int32 vertex = indices[j];
+                    ++groupUseCount[vertex];
+
+                    if (localIndex[vertex] < 0)
+                    {
+                        localIndex[vertex] = static_cast<int32>(globalIndex.size());
+                        globalIndex.push_back(vertex);
+                        positions.insert(positions.end(), vertices + vertex * 3, vertices + vertex * 3 + 3);
+                    }
+
+                    triangles.push_back(localIndex[vertex]);
+                }
+            }
+
+            const int localVertexCount = static_cast<int>(globalIndex.size());
+            const int groupTriangleCount = static_cast<int>(triangles.size() / 3);
+
+            // Lock the vertices shared with other clusters, and the vertices
+            // on open edges, which are the borders of the mesh
+            locked.assign(localVertexCount, false);
+            for (int i = 0; i < localVertexCount; ++i)
+            {
+                const int32 vertex = globalIndex[i];
+                locked[i] = frozen[vertex] || levelUseCount[vertex] != groupUseCount[vertex];
+            }
+
+            edges.clear();
+            for (int i = 0; i < groupTriangleCount; ++i)
+            {
+                for (int j = 0; j < 3; ++j)
+                {
+                    const int32 a = triangles[i * 3 + j];
+                    const int32 b = triangles[i * 3 + (j + 1) % 3];
+                    edges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+                }
+            }
+
+            std::sort(edges.begin(), edges.end());
+            for (std::size_t i = 0; i < edges.size();)
+            {
+                std::size_t j = i + 1;
+                while (j < edges.size() && edges[j] == edges[i])
+                {
+                    ++j;
+                }
+
+                if (j - i != 2)
+                {
+                    locked[edges[i].first] = true;
+                    locked[edges[i].second] = true;
+                }
+
+                i = j;
+            }
+
+            const int targetTriangleCount = static_cast<int>(groupTriangleCount * LOD_TARGET_RATIO);
+            const float simplifyError = simplifier.Simplify(positions, locked, triangles, targetTriangleCount);
+            const int simplifiedTriangleCount = static_cast<int>(triangles.size() / 3);
+
+            const bool reduced = simplifiedTriangleCount > 0
+                && simplifiedTriangleCount <= groupTriangleCount * LOD_MINIMUM_REDUCTION;
+
+            if (reduced && indices.size() + triangles.size() > indexBudget)
+            {
+                budgetExhausted = true;
+            }
+
+            if (!reduced || budgetExhausted)
+            {
+                // The clusters of this group stay the coarsest version of
+                // their part of the mesh
+                for (int i = 0; i < localVertexCount; ++i)
+                {
+                    if (levelUseCount[globalIndex[i]] != groupUseCount[globalIndex[i]])
+                    {
+                        frozen[globalIndex[i]] = true;
+                    }
+                }
+            }
+            else
+            {
+                float groupError = 0;
+                for (auto it = group->begin(), end = group->end(); it != end; ++it)
+                {
+                    groupError = std::max(groupError, lods[*it].error);
+                }
+
+                groupError += simplifyError;
+
+                ClusterLod groupLod;
+                ComputeGroupSphere(lods, *group, groupLod.center, groupLod.radius);
+                groupLod.error = groupError;
+                std::copy(groupLod.center, groupLod.center + 3, groupLod.parentCenter);
+                groupLod.parentRadius = groupLod.radius;
+                groupLod.parentError = FLT_MAX;
+
+                for (auto it = group->begin(), end = group->end(); it != end; ++it)
+                {
+                    ClusterLod &lod = lods[*it];
+                    std::copy(groupLod.center, groupLod.center + 3, lod.parentCenter);
+                    lod.parentRadius = groupLod.radius;
+                    lod.parentError = groupError;
+                }
+
+                reordered.resize(triangles.size());
+                std::vector<Cluster> groupClusters = CreateSpatialClusters(
+                    static_cast<int>(triangles.size()), localVertexCount, positions.data(),
+                    triangles.data(), maximumVerticesPerCluster, maximumTrianglesPerCluster,
+                    coneType, reordered.data());
+
+                const int firstTriangle = static_cast<int>(indices.size() / 3);
+                for (auto it = reordered.begin(), end = reordered.end(); it != end; ++it)
+                {
+                    indices.push_back(globalIndex[*it]);
+                }
+
+                for (auto it = groupClusters.begin(), end = groupClusters.end(); it != end; ++it)
+                {
+                    it->firstTriangle += firstTriangle;
+
+                    nextLevel.push_back(static_cast<int>(clusters.size()));
+                    clusters.push_back(*it);
+                    lods.push_back(groupLod);
+                }
+            }
+
+            for (auto it = globalIndex.begin(), end = globalIndex.end(); it != end; ++it)
+            {
+                localIndex[*it] = -1;
+                groupUseCount[*it] = 0;
+            }
+        }
+
+        level.swap(nextLevel);
+    }
+}
+}
+}
@@ -0,0 +1,98 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_CLUSTER_LOD_H
+#define AMD_GEOMETRYFX_CLUSTER_LOD_H
+
+#include <algorithm>
+#include <cmath>
+
+#include <DirectXMath.h>
+
+#include "AMD_Types.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+/**
+Level of detail information of one cluster.
+
+Each simplified cluster was created from a group of finer clusters. The
+sphere and error of a simplified cluster are those of its group, and the
+finer clusters store them as their parent. A cluster is drawn if its own
+error is small enough, but the error of its parent is not, see
+IsClusterLodSelected. As the parent sphere contains the own sphere and the
+parent error is never smaller, this picks exactly one level for every part
+of the mesh, and neighbouring groups always meet at vertices both sides
+kept.
+*/
+struct ClusterLod
+{
+    float center[3];
+    float radius;
+
+    // Object space distance between the simplified and the original surface.
+    // Zero for the clusters of the full detail mesh.
+    float error;
+
+    float parentCenter[3];
+    float parentRadius;
+
+    // FLT_MAX for clusters which were not simplified any further
+    float parentError;
+};
+
+/**
+The error of a sphere in pixels. projectionScale converts an error at unit
+distance into pixels, for example projection.r[1].y * windowHeight / 2. The
+distance is measured to the surface of the sphere, and eyes inside the
+sphere are treated as very close.
+*/
+inline float GetProjectedLodError(const float center[3], const float radius, const float error,
+    const DirectX::XMFLOAT3 &eye, const float projectionScale)
+{
+    const float dx = center[0] - eye.x;
+    const float dy = center[1] - eye.y;
+    const float dz = center[2] - eye.z;
+
+    const float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - radius;
+
+    return error * projectionScale / (std::max)(distance, 1.0e-6f);
+}
+
+/**
+True if the cluster belongs to the level of detail that keeps the projected
+error at or below threshold. eye is in object space.
+*/
+inline bool IsClusterLodSelected(const ClusterLod &lod, const DirectX::XMFLOAT3 &eye,
+    const float projectionScale, const float threshold)
+{
+    return GetProjectedLodError(lod.center, lod.radius, lod.error, eye, projectionScale)
+            <= threshold
+        && GetProjectedLodError(lod.parentCenter, lod.parentRadius, lod.parentError, eye,
+               projectionScale) > threshold;
+}
+}
+}
+
+#endif // AMD_GEOMETRYFX_CLUSTER_LOD_H
@@ -0,0 +1,162 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXClusterVisibility.h"
+
+#include "GeometryFXMesh.h"
+#include "GeometryFXOcclusionBuffer.h"
+#include "GeometryFXSmallBatchPacking.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+///////////////////////////////////////////////////////////////////////////////
+ClusterVisibility::ClusterVisibility()
+    : current_(0)
+{
+    Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ClusterVisibility::BeginFrame()
+{
+    current_ = 1 - current_;
+
+    Frame &frame = frames_[current_];
+    frame.bits.clear();
+    frame.offsets.assign(1, 0);
+    frame.meshIndices.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ClusterVisibility::AddDraw(const int meshIndex, const int clusterCount)
+{
+    Frame &frame = frames_[current_];
+
+    const int wordCount = (clusterCount + 31) / 32;
+    frame.bits.resize(frame.bits.size() + wordCount, 0);
+    frame.offsets.push_back(frame.offsets.back() + wordCount);
+    frame.meshIndices.push_back(meshIndex);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+const uint32 *ClusterVisibility::GetPreviousVisibility(
+    const int draw, const int meshIndex) const
+{
+    const Frame &frame = frames_[1 - current_];
+
+    if (draw >= static_cast<int>(frame.meshIndices.size())
+        || frame.meshIndices[draw] != meshIndex)
+    {
+        return nullptr;
+    }
+
+    return frame.bits.data() + frame.offsets[draw];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ClusterVisibility::Reset()
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        frames_[i].bits.clear();
+        frames_[i].offsets.assign(1, 0);
+        frames_[i].meshIndices.clear();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int64 RasterizeTemporalOccluders(const std::vector<DrawCommand> &drawCommands,
+    const DirectX::XMMATRIX &viewProjection, const int triangleBudget,
+    ClusterVisibility &clusterVisibility, OcclusionBuffer &occlusionBuffer)
+{
+    clusterVisibility.BeginFrame();
+
+    for (std::vector<DrawCommand>::const_iterator it = drawCommands.begin(),
+        end = drawCommands.end();
+        it != end; ++it)
+    {
+        clusterVisibility.AddDraw(it->dcb.meshIndex, static_cast<int>(it->mesh->clusters.size()));
+    }
+
+    int budget = triangleBudget;
+    int64 rasterizedTriangles = 0;
+
+    for (int draw = 0; draw < static_cast<int>(drawCommands.size()) && budget > 0; ++draw)
+    {
+        const DrawCommand &command = drawCommands[draw];
+        const StaticMesh *mesh = command.mesh;
+
+        // Occluders were rasterized completely already
+        if (mesh->isOccluder)
+        {
+            continue;
+        }
+
+        const uint32 *visible =
+            clusterVisibility.GetPreviousVisibility(draw, command.dcb.meshIndex);
+
+        if (visible == nullptr)
+        {
+            continue;
+        }
+
+        const int wordCount = (static_cast<int>(mesh->clusters.size()) + 31) / 32;
+        bool transformed = false;
+
+        for (int word = 0; word < wordCount && budget > 0; ++word)
+        {
+            const uint32 bits = visible[word];
+
+            for (int bit = 0; bits != 0 && bit < 32 && budget > 0; ++bit)
+            {
+                if ((bits & (1u << bit)) == 0)
+                {
+                    continue;
+                }
+
+                // The vertices are only transformed once per draw, and
+                // only if any of its clusters is rasterized
+                if (!transformed)
+                {
+                    occlusionBuffer.TransformVertices(command.dcb.world * viewProjection,
+                        mesh->occluderVertices.data(), mesh->vertexCount);
+                    transformed = true;
+                }
+
+                const auto &cluster = mesh->clusters[word * 32 + bit];
+                const int triangleCount = GetTriangleCount(cluster);
+
+                occlusionBuffer.RasterizeTransformedTriangles(
+                    mesh->occluderIndices.data() + cluster.firstTriangle * 3, triangleCount * 3);
+
+                budget -= triangleCount;
+                rasterizedTriangles += triangleCount;
+            }
+        }
+    }
+
+    return rasterizedTriangles;
+}
+}
+}
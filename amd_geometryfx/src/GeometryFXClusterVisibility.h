@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_CLUSTER_VISIBILITY_H
+#define AMD_GEOMETRYFX_CLUSTER_VISIBILITY_H
+
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "AMD_Types.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+struct DrawCommand;
+class OcclusionBuffer;
+
+/**
+Remembers which clusters of which draw were drawn, for one frame and the
+frame before. Draws are identified by their index in the frame, so the
+history only carries over if the application records its draws in a stable
+order. A draw whose mesh changed has no history.
+
+Each draw owns whole words of the bit set, so different threads may set
+clusters of different draws concurrently.
+*/
+class ClusterVisibility
+{
+public:
+    ClusterVisibility();
+
+    /**
+    Make the current frame the previous one, and start a new frame without
+    any draws.
+    */
+    void BeginFrame();
+
+    /**
+    Append a draw to the current frame. Must be called for all draws before
+    SetVisible is called for any of them.
+    */
+    void AddDraw(const int meshIndex, const int clusterCount);
+
+    void SetVisible(const int draw, const int cluster)
+    {
+        Frame &frame = frames_[current_];
+        frame.bits[frame.offsets[draw] + cluster / 32] |= 1u << (cluster % 32);
+    }
+
+    /**
+    The clusters of a draw which were visible in the previous frame, one bit
+    per cluster, or nullptr if the draw has no history.
+    */
+    const uint32 *GetPreviousVisibility(const int draw, const int meshIndex) const;
+
+    bool WasVisible(const int draw, const int meshIndex, const int cluster) const
+    {
+        const uint32 *bits = GetPreviousVisibility(draw, meshIndex);
+        return bits != nullptr && (bits[cluster / 32] & (1u << (cluster % 32))) != 0;
+    }
+
+    /**
+    Forget both frames.
+    */
+    void Reset();
+
+private:
+    ClusterVisibility(const ClusterVisibility &);
+    ClusterVisibility &operator=(const ClusterVisibility &);
+
+    struct Frame
+    {
+        std::vector<uint32> bits;
+
+        // One more entry than there are draws
+        std::vector<int> offsets;
+        std::vector<int> meshIndices;
+    };
+
+    Frame frames_[2];
+    int current_;
+};
+
+/**
+Rasterize the clusters drawn in the previous frame into occlusionBuffer, and
+add the draws of this frame to clusterVisibility, which is filled in while
+packing. Meshes which are occluders are skipped, as they are rasterized
+completely. Draws are visited in order until triangleBudget triangles are
+rasterized. Returns the number of triangles rasterized.
+*/
+int64 RasterizeTemporalOccluders(const std::vector<DrawCommand> &drawCommands,
+    const DirectX::XMMATRIX &viewProjection, const int triangleBudget,
+    ClusterVisibility &clusterVisibility, OcclusionBuffer &occlusionBuffer);
+}
+}
+
+#endif // AMD_GEOMETRYFX_CLUSTER_VISIBILITY_H
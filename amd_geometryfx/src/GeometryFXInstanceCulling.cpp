@@ -0,0 +1,143 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXInstanceCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef max
+#undef max
+#endif
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+///////////////////////////////////////////////////////////////////////////////
+DirectX::XMFLOAT4 GetBoundingSphere(const Cluster &bounds)
+{
+    const auto center =
+        DirectX::XMVectorScale(DirectX::XMVectorAdd(bounds.aabbMin, bounds.aabbMax), 0.5f);
+    const auto halfDiagonal = DirectX::XMVector3Length(
+        DirectX::XMVectorScale(DirectX::XMVectorSubtract(bounds.aabbMax, bounds.aabbMin), 0.5f));
+
+    DirectX::XMFLOAT4 sphere;
+    DirectX::XMStoreFloat4(&sphere, DirectX::XMVectorSelect(center, halfDiagonal,
+        DirectX::XMVectorSelectControl(0, 0, 0, 1)));
+
+    return sphere;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+InstanceCuller::InstanceCuller()
+    : eye_(DirectX::XMVectorZero())
+    , projectionScale_(0)
+    , frustumCulling_(false)
+    , maximumDistance_(0)
+    , minimumProjectedSize_(0)
+{
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        planes_[i] = DirectX::XMVectorZero();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+InstanceCuller::InstanceCuller(const DirectX::XMMATRIX &viewProjection,
+    const DirectX::XMVECTOR eye, const float projectionScale, const bool frustumCulling,
+    const float maximumDistance, const float minimumProjectedSize)
+    : eye_(eye)
+    , projectionScale_(projectionScale)
+    , frustumCulling_(frustumCulling)
+    , maximumDistance_(maximumDistance)
+    , minimumProjectedSize_(minimumProjectedSize)
+{
+    const auto m = DirectX::XMMatrixTranspose(viewProjection);
+
+    planes_[0] = DirectX::XMVectorAdd(m.r[3], m.r[0]);      // Left
+    planes_[1] = DirectX::XMVectorSubtract(m.r[3], m.r[0]); // Right
+    planes_[2] = DirectX::XMVectorAdd(m.r[3], m.r[1]);      // Bottom
+    planes_[3] = DirectX::XMVectorSubtract(m.r[3], m.r[1]); // Top
+    planes_[4] = m.r[3];                                    // In front of the eye
+
+    for (int i = 0; i < PLANE_COUNT; ++i)
+    {
+        planes_[i] = DirectX::XMPlaneNormalize(planes_[i]);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+InstanceCullResult InstanceCuller::Test(const DirectX::XMMATRIX &world,
+    const GEOMETRYFX_WORLD_TRANSFORM transform, const DirectX::XMFLOAT4 &sphere) const
+{
+    const auto center = DirectX::XMVector3Transform(DirectX::XMLoadFloat4(&sphere), world);
+
+    const float rowLengths[3] = {
+        DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[0])),
+        DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[1])),
+        DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(world.r[2]))
+    };
+
+    // The largest factor by which the world matrix stretches a vector. The
+    // rows of rigid transforms are orthogonal, so this is the longest row.
+    // Otherwise, the Frobenius norm bounds it from above.
+    const float scale = std::sqrt(transform == GeometryFX_WorldTransformRigid
+        ? std::max(rowLengths[0], std::max(rowLengths[1], rowLengths[2]))
+        : rowLengths[0] + rowLengths[1] + rowLengths[2]);
+    const float radius = sphere.w * scale;
+
+    if (frustumCulling_)
+    {
+        for (int i = 0; i < PLANE_COUNT; ++i)
+        {
+            if (DirectX::XMVectorGetX(DirectX::XMPlaneDotCoord(planes_[i], center)) < -radius)
+            {
+                return INSTANCE_CULL_RESULT_FRUSTUM;
+            }
+        }
+    }
+
+    if (maximumDistance_ > 0 || minimumProjectedSize_ > 0)
+    {
+        // Distance to the surface of the sphere, as for the level of detail
+        // selection. The projected size is overestimated close to the eye,
+        // so nothing visible is rejected.
+        const float distance = DirectX::XMVectorGetX(
+            DirectX::XMVector3Length(DirectX::XMVectorSubtract(center, eye_))) - radius;
+
+        if (maximumDistance_ > 0 && distance > maximumDistance_)
+        {
+            return INSTANCE_CULL_RESULT_DISTANCE;
+        }
+
+        if (minimumProjectedSize_ > 0 && distance > 0
+            && 2 * radius * projectionScale_ < minimumProjectedSize_ * distance)
+        {
+            return INSTANCE_CULL_RESULT_SIZE;
+        }
+    }
+
+    return INSTANCE_CULL_RESULT_VISIBLE;
+}
+}
+}
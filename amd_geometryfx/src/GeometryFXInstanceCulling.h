@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_INSTANCE_CULLING_H
+#define AMD_GEOMETRYFX_INSTANCE_CULLING_H
+
+#include <DirectXMath.h>
+
+#include "AMD_GeometryFX_Filtering.h"
+#include "GeometryFXClusterBuilder.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+enum InstanceCullResult
+{
+    INSTANCE_CULL_RESULT_VISIBLE,
+    INSTANCE_CULL_RESULT_FRUSTUM,
+    INSTANCE_CULL_RESULT_DISTANCE,
+    INSTANCE_CULL_RESULT_SIZE
+};
+
+/**
+The sphere around the box of a cluster, as center and radius in w.
+*/
+DirectX::XMFLOAT4 GetBoundingSphere(const Cluster &bounds);
+
+/**
+Rejects whole instances by the bounding sphere of their mesh, before a draw
+is recorded for them. This is coarser than the box and cluster tests done
+while packing, but only needs the world matrix.
+
+The frustum uses the same planes as ObjectSpaceFrustum, in world space and
+normalized, so the sphere radius can be compared against them directly.
+*/
+class InstanceCuller
+{
+public:
+    /**
+    Rejects nothing.
+    */
+    InstanceCuller();
+
+    /**
+    maximumDistance and minimumProjectedSize are disabled if 0.
+    projectionScale converts a size at unit distance into pixels, like
+    FilterContext::lodErrorScale.
+    */
+    InstanceCuller(const DirectX::XMMATRIX &viewProjection, const DirectX::XMVECTOR eye,
+        const float projectionScale, const bool frustumCulling,
+        const float maximumDistance, const float minimumProjectedSize);
+
+    /**
+    sphere is in object space, see GetBoundingSphere. For general
+    transforms, the radius is scaled by the Frobenius norm of the world
+    matrix, which is conservative. For rigid ones, the longest row is exact.
+    */
+    InstanceCullResult Test(const DirectX::XMMATRIX &world,
+        const GEOMETRYFX_WORLD_TRANSFORM transform, const DirectX::XMFLOAT4 &sphere) const;
+
+    bool IsEnabled() const
+    {
+        return frustumCulling_ || maximumDistance_ > 0 || minimumProjectedSize_ > 0;
+    }
+
+private:
+    static const int PLANE_COUNT = 5;
+    DirectX::XMVECTOR planes_[PLANE_COUNT];
+    DirectX::XMVECTOR eye_;
+
+    float projectionScale_;
+    bool frustumCulling_;
+    float maximumDistance_;
+    float minimumProjectedSize_;
+};
+}
+}
+
+#endif // AMD_GEOMETRYFX_INSTANCE_CULLING_H
@@ -37,6 +37,12 @@ StaticMesh::StaticMesh(const int vertexCount, const int indexCount, const int me
     , meshIndex(meshIndex)
     , indexOffset(0)
     , vertexOffset(0)
+    , baseClusterCount(0)
+    , bounds()
+    , boundingSphere(0, 0, 0, 0)
+    , clustersLoadedFromCache(false)
+    , isOccluder(false)
+    , isTemporalOccluder(false)
 {
     assert(meshIndex >= 0);
 }
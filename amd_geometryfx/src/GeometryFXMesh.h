@@ -23,12 +23,18 @@
 #ifndef AMD_GEOMETRYFX_MESH_H
 #define AMD_GEOMETRYFX_MESH_H
 
+#ifdef _WIN32
 #include <d3d11.h>
 #include <wrl.h>
+#endif
 #include <vector>
 
 #include <DirectXMath.h>
 
+#include "GeometryFXClusterBuilder.h"
+#include "GeometryFXClusterCulling.h"
+#include "GeometryFXPackedCluster.h"
+
 namespace AMD
 {
 namespace GeometryFX_Internal
@@ -42,11 +48,14 @@ public:
     virtual ~StaticMesh();
 
 public:
+    // The tests build the CPU side of the library without D3D
+#ifdef _WIN32
     Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> vertexBufferSRV;
     Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> indexBufferSRV;
     Microsoft::WRL::ComPtr<ID3D11Buffer> meshConstantsBuffer;
+#endif
 
     int vertexCount;
     int faceCount;
@@ -56,16 +65,40 @@ public:
     int indexOffset;
     int vertexOffset;
 
-    struct Cluster
-    {
-        DirectX::XMVECTOR aabbMin, aabbMax;
-        DirectX::XMVECTOR coneCenter, coneAxis;
+    std::vector<PackedCluster> clusters;
+    ClusterQuantization clusterQuantization;
+
+    // The culling data of clusters, CLUSTER_BLOCK_SIZE clusters per block
+    std::vector<ClusterBlock> clusterBlocks;
+
+    // The first baseClusterCount clusters make up the full detail mesh. The
+    // rest, if any, are simplified levels selected through clusterLods,
+    // which then has one entry per cluster.
+    int baseClusterCount;
+    std::vector<ClusterLod> clusterLods;
+
+    // Union of all clusters, with a cone inside all cluster cones. Used to
+    // reject a whole draw before walking its clusters.
+    Cluster bounds;
+
+    // Sphere around bounds, center in xyz and radius in w. Used to reject
+    // instances before a draw is recorded for them.
+    DirectX::XMFLOAT4 boundingSphere;
+
+    // Computed before packing, from the full precision clusters
+    ClusterStatistics clusterStatistics;
+    bool clustersLoadedFromCache;
 
-        float coneAngleCosine;
-        bool valid;
-    };
+    VertexCacheStatistics vertexCacheStatistics;
 
-    std::vector<Cluster> clusters;
+    // Occluders keep their vertices and indices in system memory, so they
+    // can be rasterized into the occlusion buffer. Temporal occluders only
+    // rasterize the clusters visible in the previous frame. The indices are
+    // in upload order, so each cluster is a range of them.
+    bool isOccluder;
+    bool isTemporalOccluder;
+    std::vector<float> occluderVertices;
+    std::vector<int32> occluderIndices;
 
 private:
     StaticMesh(const StaticMesh &);
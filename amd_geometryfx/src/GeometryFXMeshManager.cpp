@@ -23,26 +23,17 @@
 #include "GeometryFXMeshManager.h"
 
 #include "GeometryFXMesh.h"
+#include "GeometryFXClusterBounds.h"
+#include "GeometryFXClusterBuilder.h"
+#include "GeometryFXInstanceCulling.h"
+#include "GeometryFXReferenceFilter.h"
 #include "GeometryFXUtility_Internal.h"
-#include "AMD_GeometryFX_Internal.h"
 
 #include <wrl.h>
 
+#include <cassert>
 #include <memory>
 #include <vector>
-#include <array>
-
-#include <DirectXMath.h>
-
-#define AMD_GEOMETRY_FX_ENABLE_CLUSTER_CENTER_SAFETY_CHECK 1
-
-#ifdef min
-#undef min
-#endif
-
-#ifdef max
-#undef max
-#endif
 
 using namespace Microsoft::WRL;
 
@@ -136,6 +127,11 @@ class MeshManagerBase : public IMeshManager
 class MeshManagerGlobal : public MeshManagerBase
 {
 public:
+    MeshManagerGlobal(const ClusterBuilderOptions &options)
+        : options_(options)
+    {
+    }
+
     void Allocate(ID3D11Device *device, const int meshCount, const int *verticesPerMesh,
         const int *indicesPerMesh) override
     {
@@ -145,7 +141,7 @@ public:
         for (int i = 0; i < meshCount; ++i)
         {
             totalVertexCount += verticesPerMesh[i];
-            totalIndexCount += indicesPerMesh[i];
+            totalIndexCount += GetReservedIndexCount(indicesPerMesh[i]);
         }
 
         CreateVertexBuffer(device, totalVertexCount);
@@ -163,7 +159,7 @@ public:
             meshes_[i]->indexBufferSRV = indexBufferSRV_;
 
             meshes_[i]->indexOffset = indexOffset;
-            indexOffset += indicesPerMesh[i] * sizeof(int);
+            indexOffset += GetReservedIndexCount(indicesPerMesh[i]) * sizeof(int);
 
             meshes_[i]->vertexOffset = vertexOffset;
             vertexOffset += verticesPerMesh[i] * 3 * sizeof(float);
@@ -172,188 +168,108 @@ public:
         CreateMeshConstantsBuffer(device);
     }
 
-    std::vector<StaticMesh::Cluster> CreateClusters (
-        const int indexCount,
-        const void* vertexData,
-        const void* indexData)
+    void SetData(ID3D11Device * /* device */, ID3D11DeviceContext *context, const int meshIndex,
+        const void *vertexData, const void *indexData) override
     {
-        const int32_t* indices = static_cast<const int32_t*> (indexData);
-        const float* vertices = static_cast<const float*> (vertexData);
+        StaticMesh *mesh = meshes_[meshIndex].get();
 
-        // 16 KiB stack space
-        struct Triangle
-        {
-            DirectX::XMVECTOR vtx[3];
-        };
+        ClusterBuilderInput input;
+        input.indexCount = mesh->indexCount;
+        input.vertexCount = mesh->vertexCount;
+        input.vertexData = vertexData;
+        input.indexData = indexData;
 
-        std::array<Triangle, SmallBatchMergeConstants::BATCH_SIZE * 3> triangleCache;
+        ClusterBuilderOutput output;
+        BuildClusters(options_, input, output);
 
-        const int triangleCount = indexCount / 3;
-        const int clusterCount = (triangleCount + SmallBatchMergeConstants::BATCH_SIZE - 1)
-            / SmallBatchMergeConstants::BATCH_SIZE;
+        UploadData(context, mesh, vertexData, indexData, output);
+    }
 
-        std::vector<StaticMesh::Cluster> result (clusterCount);
-        for (int i = 0; i < clusterCount; ++i)
+    void SetData(ID3D11Device * /* device */, ID3D11DeviceContext *context, WorkerPool &pool,
+        const int meshCount, const int *meshIndices, const void *const *vertexData,
+        const void *const *indexData) override
+    {
+        std::vector<ClusterBuilderInput> inputs(meshCount);
+        for (int i = 0; i < meshCount; ++i)
         {
-            const int clusterStart = i * SmallBatchMergeConstants::BATCH_SIZE;
-            const int clusterEnd = std::min (clusterStart + SmallBatchMergeConstants::BATCH_SIZE,
-                triangleCount);
-
-            const int clusterTriangleCount = clusterEnd - clusterStart;
-
-            // Load all triangles into our local cache
-            for (int triangleIndex = clusterStart; triangleIndex < clusterEnd; ++triangleIndex)
-            {
-                triangleCache[triangleIndex - clusterStart].vtx[0] = DirectX::XMVectorSet (
-                    vertices[indices[triangleIndex * 3 + 0] * 3 + 0],
-                    vertices[indices[triangleIndex * 3 + 0] * 3 + 1],
-                    vertices[indices[triangleIndex * 3 + 0] * 3 + 2],
-                    1.0f
-                );
-
-                triangleCache[triangleIndex - clusterStart].vtx[1] = DirectX::XMVectorSet (
-                    vertices[indices[triangleIndex * 3 + 1] * 3 + 0],
-                    vertices[indices[triangleIndex * 3 + 1] * 3 + 1],
-                    vertices[indices[triangleIndex * 3 + 1] * 3 + 2],
-                    1.0f
-                );
-
-                triangleCache[triangleIndex - clusterStart].vtx[2] = DirectX::XMVectorSet (
-                    vertices[indices[triangleIndex * 3 + 2] * 3 + 0],
-                    vertices[indices[triangleIndex * 3 + 2] * 3 + 1],
-                    vertices[indices[triangleIndex * 3 + 2] * 3 + 2],
-                    1.0f
-                );
-            }
-
-            auto aabbMin = DirectX::XMVectorSplatInfinity ();
-            auto aabbMax = DirectX::XMVectorNegate (DirectX::XMVectorSplatInfinity ());
-
-            auto coneAxis = DirectX::XMVectorZero ();
-
-            for (int triangleIndex = 0; triangleIndex < clusterTriangleCount; ++triangleIndex)
-            {
-                const auto& triangle = triangleCache[triangleIndex];
-                for (int j = 0; j < 3; ++j)
-                {
-                    aabbMin = DirectX::XMVectorMin (aabbMin, triangle.vtx[j]);
-                    aabbMax = DirectX::XMVectorMax (aabbMax, triangle.vtx[j]);
-                }
-                
-                const auto triangleNormal = DirectX::XMVector3Normalize (
-                    DirectX::XMVector3Cross (
-                        DirectX::XMVectorSubtract (triangle.vtx[1], triangle.vtx[0]),
-                        DirectX::XMVectorSubtract( triangle.vtx[2], triangle.vtx[0])));
-
-                coneAxis = DirectX::XMVectorAdd (coneAxis, DirectX::XMVectorNegate (triangleNormal));
-            }
-
-            // This is the cosine of the cone opening angle - 1 means it's 0,
-            // we're minimizing this value (at 0, it would mean the cone is 90
-            // open)
-            float coneOpening = 1;
-            bool validCluster = true;
-
-            const auto center = DirectX::XMVectorDivide (DirectX::XMVectorAdd (aabbMin, aabbMax),
-                DirectX::XMVectorSet (2, 2, 2, 2));
-            coneAxis = DirectX::XMVector3Normalize (coneAxis);
-
-            float t = -std::numeric_limits<float>::infinity ();
-
-            // We nee a second pass to find the intersection of the line
-            // center + t * coneAxis with the plane defined by each
-            // triangle
-            for (int triangleIndex = 0; triangleIndex < clusterTriangleCount; ++triangleIndex)
-            {
-                const auto& triangle = triangleCache[triangleIndex];
-                // Compute the triangle plane from the three vertices
-                
-                const auto triangleNormal = DirectX::XMVector3Normalize (
-                    DirectX::XMVector3Cross (
-                        DirectX::XMVectorSubtract (triangle.vtx[1], triangle.vtx[0]),
-                        DirectX::XMVectorSubtract (triangle.vtx[2], triangle.vtx[0])));
-
-                const float directionalPart = DirectX::XMVectorGetX (
-                    DirectX::XMVector3Dot (coneAxis, DirectX::XMVectorNegate (triangleNormal)));
-
-                if (directionalPart < 0)
-                {
-                    // No solution for this cluster - at least two triangles
-                    // are facing each other
-                    validCluster = false;
-                    break;
-                }
-
-                // We need to intersect the plane with our cone ray which is
-                // center + t * coneAxis, and find the max
-                // t along the cone ray (which points into the empty
-                // space)
-                // See: https://en.wikipedia.org/wiki/Line%E2%80%93plane_intersection
-                const float td = DirectX::XMVectorGetX (DirectX::XMVectorDivide (
-                    DirectX::XMVector3Dot (DirectX::XMVectorSubtract(center, triangle.vtx[0]), triangleNormal),
-                    DirectX::XMVectorSet (-directionalPart, -directionalPart, -directionalPart, -directionalPart)));
-
-                t = std::max (t, td);
-
-                coneOpening = std::min (coneOpening, directionalPart);
-            }
-
-            result[i].aabbMax = aabbMax;
-            result[i].aabbMin = aabbMin;
-
-            // cos (PI/2 - acos (coneOpening))
-            result[i].coneAngleCosine = sqrtf (1 - coneOpening * coneOpening);
-            result[i].coneCenter = DirectX::XMVectorAdd (center,
-                DirectX::XMVectorMultiply (coneAxis, DirectX::XMVectorSet (t, t, t, t)));
-            result[i].coneAxis = coneAxis;
-
-#if AMD_GEOMETRY_FX_ENABLE_CLUSTER_CENTER_SAFETY_CHECK
-            // If distance of coneCenter to the bounding box center is more
-            // than 16x the bounding box extent, the cluster is also invalid
-            // This is mostly a safety measure - if triangles are nearly
-            // parallel to coneAxis, t may become very large and unstable
-            const float aabbSize = DirectX::XMVectorGetX (DirectX::XMVector3Length (DirectX::XMVectorSubtract (aabbMax, aabbMin)));
-            const float coneCenterToCenterDistance = DirectX::XMVectorGetX (
-                DirectX::XMVector3Length (
-                    DirectX::XMVectorSubtract (result[i].coneCenter,
-                        DirectX::XMVectorDivide (
-                            DirectX::XMVectorAdd (aabbMax, aabbMin),
-                            DirectX::XMVectorSet (2, 2, 2, 2))
-            )));
-
-            if (coneCenterToCenterDistance > (16 * aabbSize))
-            {
-                validCluster = false;
-            }
-#endif
-
-            result[i].valid = validCluster;
+            const StaticMesh *mesh = meshes_[meshIndices[i]].get();
+
+            inputs[i].indexCount = mesh->indexCount;
+            inputs[i].vertexCount = mesh->vertexCount;
+            inputs[i].vertexData = vertexData[i];
+            inputs[i].indexData = indexData[i];
         }
 
-        return result;
+        std::vector<ClusterBuilderOutput> outputs(meshCount);
+        BuildClusters(pool, options_, meshCount, inputs.data(), outputs.data());
+
+        // The context must only be used from this thread, so all uploads
+        // happen here once the workers are done
+        for (int i = 0; i < meshCount; ++i)
+        {
+            UploadData(context, meshes_[meshIndices[i]].get(), vertexData[i], indexData[i],
+                outputs[i]);
+        }
     }
 
-    void SetData(ID3D11Device * /* device */, ID3D11DeviceContext *context, const int meshIndex,
-        const void *vertexData, const void *indexData) override
+  private:
+    void UploadData(ID3D11DeviceContext *context, StaticMesh *mesh, const void *vertexData,
+        const void *indexData, ClusterBuilderOutput &clusterData)
     {
+        // The statistics describe the full detail mesh, while the bounds
+        // must hold for every level that may be drawn
+        mesh->clusterStatistics = ComputeClusterStatistics(std::vector<Cluster>(
+            clusterData.clusters.begin(),
+            clusterData.clusters.begin() + clusterData.baseClusterCount));
+        MergeClusterBounds(clusterData.clusters, mesh->bounds);
+        mesh->boundingSphere = GetBoundingSphere(mesh->bounds);
+        PackClusters(clusterData.clusters, mesh->clusters, mesh->clusterQuantization);
+        BuildClusterBlocks(mesh->clusters, mesh->clusterBlocks);
+        mesh->baseClusterCount = clusterData.baseClusterCount;
+        mesh->clusterLods.swap(clusterData.clusterLods);
+        mesh->clustersLoadedFromCache = clusterData.loadedFromCache;
+        mesh->vertexCacheStatistics = clusterData.vertexCacheStatistics;
+
+        // Upload the triangles in cluster order, followed by the triangles of
+        // the simplified levels
+        int indexCount = mesh->indexCount;
+        if (!clusterData.reorderedIndices.empty())
+        {
+            indexData = clusterData.reorderedIndices.data();
+            indexCount = static_cast<int>(clusterData.reorderedIndices.size());
+        }
+
+        assert(indexCount <= GetReservedIndexCount(mesh->indexCount));
+
+        if (mesh->isOccluder || mesh->isTemporalOccluder)
+        {
+            const float *vertices = static_cast<const float *>(vertexData);
+            const int32 *indices = static_cast<const int32 *>(indexData);
+
+            mesh->occluderVertices.assign(vertices, vertices + mesh->vertexCount * 3);
+            mesh->occluderIndices.assign(indices, indices + indexCount);
+        }
+
         D3D11_BOX dstBox;
-        dstBox.left = meshes_[meshIndex]->vertexOffset;
-        dstBox.right = dstBox.left + meshes_[meshIndex]->vertexCount * 3 * sizeof(float);
+        dstBox.left = mesh->vertexOffset;
+        dstBox.right = dstBox.left + mesh->vertexCount * 3 * sizeof(float);
         dstBox.top = 0;
         dstBox.bottom = 1;
         dstBox.front = 0;
         dstBox.back = 1;
         context->UpdateSubresource(vertexBuffer_.Get(), 0, &dstBox, vertexData, 0, 0);
 
-        dstBox.left = meshes_[meshIndex]->indexOffset;
-        dstBox.right = dstBox.left + meshes_[meshIndex]->indexCount * sizeof(int);
+        dstBox.left = mesh->indexOffset;
+        dstBox.right = dstBox.left + indexCount * sizeof(int);
         context->UpdateSubresource(indexBuffer_.Get(), 0, &dstBox, indexData, 0, 0);
+    }
 
-        meshes_[meshIndex]->clusters = CreateClusters (meshes_[meshIndex]->indexCount,
-            vertexData, indexData);
+    // The simplified levels use at most as many indices as the mesh itself
+    int GetReservedIndexCount(const int indexCount) const
+    {
+        return options_.buildLod ? indexCount * 2 : indexCount;
     }
 
-  private:
     void CreateVertexBuffer(ID3D11Device *device, const int vertexCount)
     {
         D3D11_BUFFER_DESC vbDesc = {};
@@ -422,6 +338,8 @@ public:
     }
 
   private:
+    ClusterBuilderOptions options_;
+
     ComPtr<ID3D11Buffer> vertexBuffer_;
     ComPtr<ID3D11ShaderResourceView> vertexBufferSRV_;
     ComPtr<ID3D11Buffer> indexBuffer_;
@@ -429,9 +347,9 @@ public:
 };
 
 ///////////////////////////////////////////////////////////////////////////////
-std::unique_ptr<IMeshManager> CreateGlobalMeshManager()
+std::unique_ptr<IMeshManager> CreateGlobalMeshManager(const ClusterBuilderOptions &options)
 {
-    return std::unique_ptr<IMeshManager>(new MeshManagerGlobal());
+    return std::unique_ptr<IMeshManager>(new MeshManagerGlobal(options));
 }
 
 } // namespace GeometryFX_Internal
@@ -33,16 +33,8 @@ namespace AMD
 namespace GeometryFX_Internal
 {
 class StaticMesh;
-
-#pragma pack(push, 1)
-struct MeshConstants
-{
-    uint32 vertexCount;
-    uint32 faceCount;
-    uint32 indexOffset;
-    uint32 vertexOffset;
-};
-#pragma pack(pop)
+class WorkerPool;
+struct ClusterBuilderOptions;
 
 class IMeshManager
 {
@@ -56,6 +48,14 @@ class IMeshManager
     virtual void SetData(ID3D11Device *pDevice, ID3D11DeviceContext *pContext, const int meshIndex,
         const void *pVertexData, const void *pIndexData) = 0;
 
+    /**
+    Set the data for several meshes at once. The clusters are built on the
+    worker pool, all calls to the context happen on the calling thread.
+    */
+    virtual void SetData(ID3D11Device *pDevice, ID3D11DeviceContext *pContext, WorkerPool &pool,
+        const int meshCount, const int *pMeshIndices, const void *const *ppVertexData,
+        const void *const *ppIndexData) = 0;
+
     virtual StaticMesh *GetMesh(const int index) const = 0;
     virtual int GetMeshCount() const = 0;
 
@@ -71,7 +71,7 @@ class IMeshManager
     IMeshManager &operator=(const IMeshManager &);
 };
 
-std::unique_ptr<IMeshManager> CreateGlobalMeshManager();
+std::unique_ptr<IMeshManager> CreateGlobalMeshManager(const ClusterBuilderOptions &options);
 
 } // namespace GeometryFX_Internal
 } // namespace AMD
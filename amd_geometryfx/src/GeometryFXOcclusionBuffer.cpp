@@ -0,0 +1,416 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXOcclusionBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define AMD_GEOMETRY_FX_ENABLE_OCCLUSION_SSE2 1
+#include <emmintrin.h>
+#else
+#define AMD_GEOMETRY_FX_ENABLE_OCCLUSION_SSE2 0
+#endif
+
+#ifdef min
+#undef min
+#endif
+
+#ifdef max
+#undef max
+#endif
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+// Vertices closer to the eye than this in w are treated as crossing the
+// near plane
+const float OCCLUSION_MINIMUM_W = 1.0e-5f;
+
+// Largest number of texels tested along each axis of a box
+const int OCCLUSION_TEST_FOOTPRINT = 4;
+
+// Uncovered pixels never occlude anything
+const float OCCLUSION_EMPTY_DEPTH = FLT_MAX;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+OcclusionBuffer::OcclusionBuffer(const int width, const int height)
+    : width_(std::max(1, width))
+    , height_(std::max(1, height))
+    , pitch_((std::max(1, width) + 3) & ~3)
+{
+    depth_.resize(pitch_ * height_);
+
+    int offset = 0;
+    int levelWidth = width_;
+    int levelHeight = height_;
+
+    for (;;)
+    {
+        Level level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.offset = offset;
+        levels_.push_back(level);
+
+        offset += levelWidth * levelHeight;
+
+        if (levelWidth == 1 && levelHeight == 1)
+        {
+            break;
+        }
+
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+
+    hierarchy_.resize(offset);
+
+    Clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::Clear()
+{
+    std::fill(depth_.begin(), depth_.end(), OCCLUSION_EMPTY_DEPTH);
+    std::fill(hierarchy_.begin(), hierarchy_.end(), OCCLUSION_EMPTY_DEPTH);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::RasterizeTriangles(const DirectX::XMMATRIX &worldViewProjection,
+    const float *vertices, const int vertexCount, const int32 *indices, const int indexCount)
+{
+    TransformVertices(worldViewProjection, vertices, vertexCount);
+    RasterizeTransformedTriangles(indices, indexCount);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::TransformVertices(const DirectX::XMMATRIX &worldViewProjection,
+    const float *vertices, const int vertexCount)
+{
+    transformed_.resize(vertexCount);
+
+    const float halfWidth = width_ * 0.5f;
+    const float halfHeight = height_ * 0.5f;
+
+    for (int i = 0; i < vertexCount; ++i)
+    {
+        const auto clip = DirectX::XMVector3Transform(
+            DirectX::XMVectorSet(vertices[i * 3 + 0], vertices[i * 3 + 1], vertices[i * 3 + 2], 1),
+            worldViewProjection);
+
+        DirectX::XMFLOAT4 v;
+        DirectX::XMStoreFloat4(&v, clip);
+
+        DirectX::XMFLOAT4 &screen = transformed_[i];
+
+        // Geometry in front of the near plane is clipped on the GPU, so it
+        // must not occlude anything here either
+        if (v.w < OCCLUSION_MINIMUM_W || v.z < 0)
+        {
+            screen = DirectX::XMFLOAT4(0, 0, 0, 0);
+            continue;
+        }
+
+        const float invW = 1.0f / v.w;
+        screen.x = (v.x * invW + 1.0f) * halfWidth;
+        screen.y = (1.0f - v.y * invW) * halfHeight;
+        screen.z = v.z * invW;
+        screen.w = 1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::RasterizeTransformedTriangles(const int32 *indices, const int indexCount)
+{
+    for (int i = 0; i + 2 < indexCount; i += 3)
+    {
+        const DirectX::XMFLOAT4 &v0 = transformed_[indices[i + 0]];
+        const DirectX::XMFLOAT4 &v1 = transformed_[indices[i + 1]];
+        const DirectX::XMFLOAT4 &v2 = transformed_[indices[i + 2]];
+
+        if (v0.w != 0 && v1.w != 0 && v2.w != 0)
+        {
+            RasterizeTriangle(&v0.x, &v1.x, &v2.x);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::RasterizeTriangle(const float *v0, const float *v1, const float *v2)
+{
+    // Twice the signed area. The vertices are swapped if needed so the
+    // inside of the triangle is where all edge functions are positive.
+    float area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v1[1] - v0[1]) * (v2[0] - v0[0]);
+
+    if (area < 0)
+    {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    if (!(area > 1.0e-6f))
+    {
+        return;
+    }
+
+    const float minX = std::min(std::min(v0[0], v1[0]), v2[0]);
+    const float maxX = std::max(std::max(v0[0], v1[0]), v2[0]);
+    const float minY = std::min(std::min(v0[1], v1[1]), v2[1]);
+    const float maxY = std::max(std::max(v0[1], v1[1]), v2[1]);
+
+    if (maxX < 0 || maxY < 0 || minX > width_ || minY > height_)
+    {
+        return;
+    }
+
+    const int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+    const int x1 = std::min(width_ - 1, static_cast<int>(std::ceil(maxX)));
+    const int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+    const int y1 = std::min(height_ - 1, static_cast<int>(std::ceil(maxY)));
+
+    // Edge functions e = a * x + b * y + c, one per edge, opposite to the
+    // vertex with the same index
+    const float *const v[3] = { v0, v1, v2 };
+    float a[3], b[3], c[3];
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const float *p = v[(i + 1) % 3];
+        const float *q = v[(i + 2) % 3];
+
+        a[i] = p[1] - q[1];
+        b[i] = q[0] - p[0];
+        c[i] = p[0] * q[1] - p[1] * q[0];
+    }
+
+    // The depth plane, evaluated at the corner of the pixel which is
+    // furthest away, but never beyond the farthest vertex
+    const float invArea = 1.0f / area;
+    const float za = (a[0] * v0[2] + a[1] * v1[2] + a[2] * v2[2]) * invArea;
+    const float zb = (b[0] * v0[2] + b[1] * v1[2] + b[2] * v2[2]) * invArea;
+    const float zc = (v0[2] - za * v0[0] - zb * v0[1]) + 0.5f * (std::abs(za) + std::abs(zb));
+    const float zmax = std::max(std::max(v0[2], v1[2]), v2[2]);
+
+    // Start at a multiple of four, the padding covers the end of each row
+    const int alignedX0 = x0 & ~3;
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float cy = y + 0.5f;
+        float *row = &depth_[y * pitch_];
+
+#if AMD_GEOMETRY_FX_ENABLE_OCCLUSION_SSE2
+        const __m128 stepX = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        const __m128 zMax = _mm_set1_ps(zmax);
+
+        __m128 e[3], ea4[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            const __m128 ai = _mm_set1_ps(a[i]);
+            e[i] = _mm_add_ps(_mm_set1_ps(b[i] * cy + c[i] + a[i] * alignedX0), _mm_mul_ps(ai, stepX));
+            ea4[i] = _mm_set1_ps(a[i] * 4);
+        }
+
+        __m128 z = _mm_add_ps(_mm_set1_ps(zb * cy + zc + za * alignedX0),
+            _mm_mul_ps(_mm_set1_ps(za), stepX));
+        const __m128 za4 = _mm_set1_ps(za * 4);
+        const __m128 zero = _mm_setzero_ps();
+
+        for (int x = alignedX0; x <= x1; x += 4)
+        {
+            const __m128 inside = _mm_and_ps(_mm_and_ps(
+                _mm_cmpge_ps(e[0], zero), _mm_cmpge_ps(e[1], zero)), _mm_cmpge_ps(e[2], zero));
+
+            if (_mm_movemask_ps(inside) != 0)
+            {
+                const __m128 old = _mm_loadu_ps(row + x);
+                const __m128 updated = _mm_min_ps(old, _mm_min_ps(z, zMax));
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, updated), _mm_andnot_ps(inside, old)));
+            }
+
+            e[0] = _mm_add_ps(e[0], ea4[0]);
+            e[1] = _mm_add_ps(e[1], ea4[1]);
+            e[2] = _mm_add_ps(e[2], ea4[2]);
+            z = _mm_add_ps(z, za4);
+        }
+#else
+        for (int x = alignedX0; x <= x1; ++x)
+        {
+            const float cx = x + 0.5f;
+
+            if (a[0] * cx + b[0] * cy + c[0] >= 0
+                && a[1] * cx + b[1] * cy + c[1] >= 0
+                && a[2] * cx + b[2] * cy + c[2] >= 0)
+            {
+                row[x] = std::min(row[x], std::min(za * cx + zb * cy + zc, zmax));
+            }
+        }
+#endif
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void OcclusionBuffer::BuildHierarchy()
+{
+    // A pixel on the silhouette of an occluder, or on a step in depth, may
+    // be covered only in part. Its neighbour on the other side of the edge
+    // holds the depth seen through the rest of the pixel, so taking the
+    // largest depth of each 3x3 block makes every pixel conservative.
+    // Neighbours outside the screen are ignored, as nothing is visible
+    // there.
+    dilated_.resize(width_ * height_);
+    for (int y = 0; y < height_; ++y)
+    {
+        const float *row = &depth_[y * pitch_];
+        float *target = &dilated_[y * width_];
+
+        for (int x = 0; x < width_; ++x)
+        {
+            target[x] = std::max(std::max(row[std::max(x - 1, 0)], row[x]),
+                row[std::min(x + 1, width_ - 1)]);
+        }
+    }
+
+    for (int y = 0; y < height_; ++y)
+    {
+        const float *above = &dilated_[std::max(y - 1, 0) * width_];
+        const float *row = &dilated_[y * width_];
+        const float *below = &dilated_[std::min(y + 1, height_ - 1) * width_];
+        float *target = &hierarchy_[y * width_];
+
+        for (int x = 0; x < width_; ++x)
+        {
+            target[x] = std::max(std::max(above[x], row[x]), below[x]);
+        }
+    }
+
+    for (std::size_t i = 1; i < levels_.size(); ++i)
+    {
+        const Level &source = levels_[i - 1];
+        const Level &target = levels_[i];
+
+        const float *src = &hierarchy_[source.offset];
+        float *dst = &hierarchy_[target.offset];
+
+        for (int y = 0; y < target.height; ++y)
+        {
+            const int sy0 = y * 2;
+            const int sy1 = std::min(sy0 + 1, source.height - 1);
+
+            for (int x = 0; x < target.width; ++x)
+            {
+                const int sx0 = x * 2;
+                const int sx1 = std::min(sx0 + 1, source.width - 1);
+
+                dst[y * target.width + x] = std::max(
+                    std::max(src[sy0 * source.width + sx0], src[sy0 * source.width + sx1]),
+                    std::max(src[sy1 * source.width + sx0], src[sy1 * source.width + sx1]));
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool OcclusionBuffer::IsOccluded(const DirectX::XMMATRIX &worldViewProjection,
+    const DirectX::XMVECTOR aabbMin, const DirectX::XMVECTOR aabbMax) const
+{
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const auto corner = DirectX::XMVectorSelect(aabbMin, aabbMax,
+            DirectX::XMVectorSelectControl(i & 1, (i >> 1) & 1, (i >> 2) & 1, 0));
+
+        DirectX::XMFLOAT4 v;
+        DirectX::XMStoreFloat4(&v, DirectX::XMVector3Transform(corner, worldViewProjection));
+
+        if (v.w < OCCLUSION_MINIMUM_W)
+        {
+            return false;
+        }
+
+        const float invW = 1.0f / v.w;
+        minX = std::min(minX, v.x * invW);
+        maxX = std::max(maxX, v.x * invW);
+        minY = std::min(minY, v.y * invW);
+        maxY = std::max(maxY, v.y * invW);
+        minZ = std::min(minZ, v.z * invW);
+    }
+
+    if (minZ < 0)
+    {
+        return false;
+    }
+
+    // Pixels touched by the screen space rectangle of the box. y is flipped
+    // between clip space and the buffer.
+    const float left = (minX + 1.0f) * width_ * 0.5f;
+    const float right = (maxX + 1.0f) * width_ * 0.5f;
+    const float top = (1.0f - maxY) * height_ * 0.5f;
+    const float bottom = (1.0f - minY) * height_ * 0.5f;
+
+    if (right < 0 || bottom < 0 || left > width_ || top > height_)
+    {
+        return false;
+    }
+
+    const int x0 = std::max(0, static_cast<int>(std::floor(left)));
+    const int x1 = std::min(width_ - 1, static_cast<int>(std::floor(right)));
+    const int y0 = std::max(0, static_cast<int>(std::floor(top)));
+    const int y1 = std::min(height_ - 1, static_cast<int>(std::floor(bottom)));
+
+    // Go up the hierarchy until the rectangle spans only a few texels
+    std::size_t levelIndex = 0;
+    while (levelIndex + 1 < levels_.size()
+        && ((x1 >> levelIndex) - (x0 >> levelIndex) >= OCCLUSION_TEST_FOOTPRINT
+            || (y1 >> levelIndex) - (y0 >> levelIndex) >= OCCLUSION_TEST_FOOTPRINT))
+    {
+        ++levelIndex;
+    }
+
+    const Level &level = levels_[levelIndex];
+    const float *texels = &hierarchy_[level.offset];
+
+    for (int y = y0 >> levelIndex; y <= (y1 >> levelIndex); ++y)
+    {
+        for (int x = x0 >> levelIndex; x <= (x1 >> levelIndex); ++x)
+        {
+            if (texels[y * level.width + x] >= minZ)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+}
+}
@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_OCCLUSION_BUFFER_H
+#define AMD_GEOMETRYFX_OCCLUSION_BUFFER_H
+
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "AMD_Types.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+/**
+A low resolution depth buffer rasterized on the CPU, used to reject
+clusters hidden behind large occluders before they reach the GPU.
+
+Triangles are sampled at the pixel centers, so the triangles of a mesh
+leave no gaps, and each covered pixel stores the largest depth of the
+triangle inside the pixel. Before testing, every pixel takes the largest
+depth of its neighbours, which accounts for pixels only partly covered by
+an occluder. Boxes are tested against a hierarchy which stores the largest
+depth of each block of pixels, and are occluded only if they lie behind
+the occluders in every pixel they touch. The only case this misses is a
+gap narrower than a pixel between two separate occluders.
+
+The depth convention is the D3D default, with z / w growing from 0 at the
+near plane to 1 at the far plane. Reversed depth is not supported.
+
+This is plain CPU code without any D3D dependency, so it can be compiled
+and benchmarked on its own.
+*/
+class OcclusionBuffer
+{
+public:
+    OcclusionBuffer(const int width, const int height);
+
+    /**
+    Remove all occluders.
+    */
+    void Clear();
+
+    /**
+    Rasterize indexCount / 3 triangles. worldViewProjection transforms the
+    vertices to clip space. Triangles crossing the near plane are skipped,
+    which loses some occlusion, but never hides anything. Both windings are
+    rasterized.
+    */
+    void RasterizeTriangles(const DirectX::XMMATRIX &worldViewProjection, const float *vertices,
+        const int vertexCount, const int32 *indices, const int indexCount);
+
+    /**
+    RasterizeTriangles in two steps, so a subset of the triangles of a mesh
+    can be rasterized without transforming its vertices again. The indices
+    refer to the vertices of the last call to TransformVertices.
+    */
+    void TransformVertices(const DirectX::XMMATRIX &worldViewProjection, const float *vertices,
+        const int vertexCount);
+    void RasterizeTransformedTriangles(const int32 *indices, const int indexCount);
+
+    /**
+    Update the hierarchy after rasterizing. Must be called before IsOccluded.
+    */
+    void BuildHierarchy();
+
+    /**
+    True if the box, transformed by worldViewProjection, is hidden behind the
+    occluders. Boxes which cross the near plane or lie outside the screen
+    are never occluded.
+    */
+    bool IsOccluded(const DirectX::XMMATRIX &worldViewProjection,
+        const DirectX::XMVECTOR aabbMin, const DirectX::XMVECTOR aabbMax) const;
+
+    int GetWidth() const
+    {
+        return width_;
+    }
+
+    int GetHeight() const
+    {
+        return height_;
+    }
+
+private:
+    OcclusionBuffer(const OcclusionBuffer &);
+    OcclusionBuffer &operator=(const OcclusionBuffer &);
+
+    void RasterizeTriangle(const float *v0, const float *v1, const float *v2);
+
+    struct Level
+    {
+        int width;
+        int height;
+        int offset;
+    };
+
+    int width_;
+    int height_;
+
+    // Rows are padded to a multiple of four pixels, so the rasterizer can
+    // always write four pixels at once
+    int pitch_;
+    std::vector<float> depth_;
+
+    // Level 0 is depth_ without padding, after taking the largest depth of
+    // each 3x3 block. Each further level stores the largest depth of 2x2
+    // texels of the level below.
+    std::vector<Level> levels_;
+    std::vector<float> hierarchy_;
+    std::vector<float> dilated_;
+
+    // Screen space x, y, z and a flag for usable vertices
+    std::vector<DirectX::XMFLOAT4> transformed_;
+};
+}
+}
+
+#endif // AMD_GEOMETRYFX_OCCLUSION_BUFFER_H
@@ -0,0 +1,257 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXPackedCluster.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+const int QUANTIZED_MAX = PACKED_CLUSTER_QUANTIZED_MAX;
+const int CONE_AXIS_MAX = 254;
+const int CONE_CUTOFF_MAX = 254;
+
+static_assert(QUANTIZED_MAX == std::numeric_limits<uint16>::max(),
+    "Quantized coordinates must use the full uint16 range");
+
+float Dequantize(const int q, const float offset, const float scale)
+{
+    return offset + static_cast<float>(q) * scale;
+}
+
+uint16 QuantizeMin(const float value, const float offset, const float scale)
+{
+    int q = scale > 0 ? static_cast<int>(std::floor((value - offset) / scale)) : 0;
+    q = std::max(0, std::min(q, QUANTIZED_MAX));
+
+    // The division may round either way, so step down until the decoded
+    // value is below the input
+    while (q > 0 && Dequantize(q, offset, scale) > value)
+    {
+        --q;
+    }
+
+    return static_cast<uint16>(q);
+}
+
+uint16 QuantizeMax(const float value, const float offset, const float scale)
+{
+    int q = scale > 0 ? static_cast<int>(std::ceil((value - offset) / scale)) : 0;
+    q = std::max(0, std::min(q, QUANTIZED_MAX));
+
+    while (q < QUANTIZED_MAX && Dequantize(q, offset, scale) < value)
+    {
+        ++q;
+    }
+
+    return static_cast<uint16>(q);
+}
+
+/**
+Step size so that offset + QUANTIZED_MAX * scale is at least maximum.
+*/
+float ComputeQuantizationScale(const float minimum, const float maximum)
+{
+    if (!(maximum > minimum))
+    {
+        return 0;
+    }
+
+    float scale = (maximum - minimum) / QUANTIZED_MAX;
+    while (Dequantize(QUANTIZED_MAX, minimum, scale) < maximum)
+    {
+        scale = std::nextafter(scale, std::numeric_limits<float>::max());
+    }
+
+    return scale;
+}
+
+/**
+Octahedral encoding of a unit vector. All four neighbouring grid points are
+tried and the one closest to the input is kept, which roughly halves the
+error of plain rounding.
+
+Returns the angle between the input and the decoded axis.
+*/
+float EncodeConeAxis(const DirectX::XMVECTOR axis, uint8 encoded[2])
+{
+    const float x = DirectX::XMVectorGetX(axis);
+    const float y = DirectX::XMVectorGetY(axis);
+    const float z = DirectX::XMVectorGetZ(axis);
+
+    const float invL1 = 1.0f / (std::abs(x) + std::abs(y) + std::abs(z));
+    float u = x * invL1;
+    float v = y * invL1;
+
+    if (z < 0)
+    {
+        // Fold the lower hemisphere over the diagonals
+        const float fu = (1 - std::abs(v)) * (u < 0 ? -1.0f : 1.0f);
+        const float fv = (1 - std::abs(u)) * (v < 0 ? -1.0f : 1.0f);
+        u = fu;
+        v = fv;
+    }
+
+    const float su = (u + 1) * 0.5f * CONE_AXIS_MAX;
+    const float sv = (v + 1) * 0.5f * CONE_AXIS_MAX;
+
+    const int u0 = std::max(0, std::min(static_cast<int>(std::floor(su)), CONE_AXIS_MAX - 1));
+    const int v0 = std::max(0, std::min(static_cast<int>(std::floor(sv)), CONE_AXIS_MAX - 1));
+
+    float bestDot = -2;
+    for (int i = 0; i < 4; ++i)
+    {
+        const uint8 candidate[2] = {
+            static_cast<uint8>(u0 + (i & 1)), static_cast<uint8>(v0 + (i >> 1))};
+
+        float decoded[3];
+        DecodeConeAxis(candidate, decoded);
+
+        const float d = DirectX::XMVectorGetX(DirectX::XMVector3Dot(
+            DirectX::XMVector3Normalize(DirectX::XMVectorSet(decoded[0], decoded[1], decoded[2], 0)),
+            axis));
+
+        if (d > bestDot)
+        {
+            bestDot = d;
+            encoded[0] = candidate[0];
+            encoded[1] = candidate[1];
+        }
+    }
+
+    return std::acos(std::max(-1.0f, std::min(bestDot, 1.0f)));
+}
+
+/**
+Encode the cone cutoff so that the packed cone is contained in the original
+one. A cone with a different axis lies inside the original cone if its angle
+is smaller by at least the angle between the axes.
+*/
+uint8 EncodeConeCutoff(const Cluster &cluster, const float axisError)
+{
+    // Some extra room for the rounding of the test itself
+    const float ANGLE_EPSILON = 1e-4f;
+
+    const float angle =
+        std::acos(std::max(-1.0f, std::min(cluster.coneAngleCosine, 1.0f)))
+        - axisError - ANGLE_EPSILON;
+
+    if (angle <= 0)
+    {
+        return PACKED_CLUSTER_INVALID_CONE;
+    }
+
+    const float cutoff = std::cos(angle);
+
+    int q = std::max(0, std::min(
+        static_cast<int>(std::ceil(cutoff * CONE_CUTOFF_MAX)), CONE_CUTOFF_MAX));
+
+    while (q < CONE_CUTOFF_MAX && DecodeConeCutoff(static_cast<uint8>(q)) < cutoff)
+    {
+        ++q;
+    }
+
+    return static_cast<uint8>(q);
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void PackClusters(const std::vector<Cluster> &clusters, std::vector<PackedCluster> &packed,
+    ClusterQuantization &quantization)
+{
+    packed.resize(clusters.size());
+    quantization = ClusterQuantization();
+
+    if (clusters.empty())
+    {
+        return;
+    }
+
+    auto meshMin = clusters.front().aabbMin;
+    auto meshMax = clusters.front().aabbMax;
+    for (auto it = clusters.begin(), end = clusters.end(); it != end; ++it)
+    {
+        meshMin = DirectX::XMVectorMin(meshMin, it->aabbMin);
+        meshMax = DirectX::XMVectorMax(meshMax, it->aabbMax);
+    }
+
+    DirectX::XMFLOAT3 minimum, maximum;
+    DirectX::XMStoreFloat3(&minimum, meshMin);
+    DirectX::XMStoreFloat3(&maximum, meshMax);
+
+    quantization.offset = minimum;
+    quantization.scale.x = ComputeQuantizationScale(minimum.x, maximum.x);
+    quantization.scale.y = ComputeQuantizationScale(minimum.y, maximum.y);
+    quantization.scale.z = ComputeQuantizationScale(minimum.z, maximum.z);
+
+    const float offset[3] = {
+        quantization.offset.x, quantization.offset.y, quantization.offset.z};
+    const float scale[3] = {quantization.scale.x, quantization.scale.y, quantization.scale.z};
+
+    for (std::size_t i = 0; i < clusters.size(); ++i)
+    {
+        const Cluster &cluster = clusters[i];
+        PackedCluster &result = packed[i];
+
+        assert(cluster.triangleCount > 0 && cluster.triangleCount <= 256);
+        result.firstTriangle = static_cast<uint32>(cluster.firstTriangle);
+        result.triangleCountMinusOne = static_cast<uint8>(cluster.triangleCount - 1);
+
+        DirectX::XMFLOAT3 aabbMin, aabbMax, apex;
+        DirectX::XMStoreFloat3(&aabbMin, cluster.aabbMin);
+        DirectX::XMStoreFloat3(&aabbMax, cluster.aabbMax);
+        DirectX::XMStoreFloat3(&apex, cluster.coneCenter);
+
+        const float clusterMin[3] = {aabbMin.x, aabbMin.y, aabbMin.z};
+        const float clusterMax[3] = {aabbMax.x, aabbMax.y, aabbMax.z};
+
+        for (int j = 0; j < 3; ++j)
+        {
+            result.aabbMin[j] = QuantizeMin(clusterMin[j], offset[j], scale[j]);
+            result.aabbMax[j] = QuantizeMax(clusterMax[j], offset[j], scale[j]);
+        }
+
+        result.coneApex[0] = apex.x;
+        result.coneApex[1] = apex.y;
+        result.coneApex[2] = apex.z;
+
+        if (cluster.valid)
+        {
+            const float axisError = EncodeConeAxis(cluster.coneAxis, result.coneAxis);
+            result.coneCutoff = EncodeConeCutoff(cluster, axisError);
+        }
+        else
+        {
+            result.coneAxis[0] = result.coneAxis[1] = CONE_AXIS_MAX / 2;
+            result.coneCutoff = PACKED_CLUSTER_INVALID_CONE;
+        }
+    }
+}
+}
+}
@@ -0,0 +1,198 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_PACKED_CLUSTER_H
+#define AMD_GEOMETRYFX_PACKED_CLUSTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "AMD_Types.h"
+#include "GeometryFXClusterBuilder.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+/**
+The run-time form of a Cluster, as walked by the filter for every draw.
+
+The bounding box is quantized to 16 bits per component relative to the
+bounds of the mesh, see ClusterQuantization. The cone axis is octahedral
+encoded with 8 bits per component, and the cosine of the cone angle is
+stored in 8 bits. The cone apex stays a float, as it may lie far outside the
+mesh.
+
+All quantization is conservative: the box only grows, and the cone angle
+shrinks by the axis encoding error, so a packed cluster is never culled
+where the original one would not be.
+*/
+struct PackedCluster
+{
+    float coneApex[3];
+    uint32 firstTriangle;
+
+    uint16 aabbMin[3];
+    uint16 aabbMax[3];
+
+    // Octahedral coordinates, 0 .. 254 maps to -1 .. 1
+    uint8 coneAxis[2];
+
+    // The cosine of the cone angle, 0 .. 254 maps to 0 .. 1. Invalid
+    // clusters store PACKED_CLUSTER_INVALID_CONE, which decodes to a value
+    // above 1 that no dot product can exceed.
+    uint8 coneCutoff;
+
+    uint8 triangleCountMinusOne;
+};
+
+static_assert(sizeof(PackedCluster) == 32, "Unexpected packed cluster size");
+
+const uint8 PACKED_CLUSTER_INVALID_CONE = 255;
+
+// Largest quantized box coordinate, which maps to the maximum of the mesh
+const int PACKED_CLUSTER_QUANTIZED_MAX = 65535;
+
+/**
+Maps the quantized bounding boxes of one mesh back to object space:
+position = offset + quantized * scale.
+*/
+struct ClusterQuantization
+{
+    inline ClusterQuantization()
+        : offset(0, 0, 0)
+        , scale(0, 0, 0)
+    {
+    }
+
+    DirectX::XMFLOAT3 offset;
+    DirectX::XMFLOAT3 scale;
+};
+
+/**
+Pack clusters for the filter. The quantization range is the union of all
+cluster bounding boxes.
+*/
+void PackClusters(const std::vector<Cluster> &clusters, std::vector<PackedCluster> &packed,
+    ClusterQuantization &quantization);
+
+/**
+Matrix from the quantized space of the bounding boxes to object space. The
+frustum test is done directly on the quantized boxes by prepending this to
+the world matrix.
+*/
+inline DirectX::XMMATRIX GetDequantizationMatrix(const ClusterQuantization &quantization)
+{
+    return DirectX::XMMatrixScaling(quantization.scale.x, quantization.scale.y,
+               quantization.scale.z)
+        * DirectX::XMMatrixTranslation(quantization.offset.x, quantization.offset.y,
+              quantization.offset.z);
+}
+
+inline int GetTriangleCount(const PackedCluster &cluster)
+{
+    return cluster.triangleCountMinusOne + 1;
+}
+
+inline DirectX::XMVECTOR GetQuantizedAabbMin(const PackedCluster &cluster)
+{
+    return DirectX::XMVectorSet(cluster.aabbMin[0], cluster.aabbMin[1], cluster.aabbMin[2], 1);
+}
+
+inline DirectX::XMVECTOR GetQuantizedAabbMax(const PackedCluster &cluster)
+{
+    return DirectX::XMVectorSet(cluster.aabbMax[0], cluster.aabbMax[1], cluster.aabbMax[2], 1);
+}
+
+/**
+The box of the whole mesh in quantized space, which is the union of all
+cluster boxes.
+*/
+inline DirectX::XMVECTOR GetQuantizedMeshAabbMin()
+{
+    return DirectX::XMVectorSet(0, 0, 0, 1);
+}
+
+inline DirectX::XMVECTOR GetQuantizedMeshAabbMax()
+{
+    const float q = static_cast<float>(PACKED_CLUSTER_QUANTIZED_MAX);
+    return DirectX::XMVectorSet(q, q, q, 1);
+}
+
+/**
+The cone axis as stored, which is not normalized.
+*/
+inline void DecodeConeAxis(const uint8 encoded[2], float axis[3])
+{
+    const float x = encoded[0] * (1.0f / 127.0f) - 1.0f;
+    const float y = encoded[1] * (1.0f / 127.0f) - 1.0f;
+    const float z = 1.0f - std::abs(x) - std::abs(y);
+
+    // Fold the lower hemisphere back. Zero counts as positive, as in the
+    // encoder.
+    const float t = (std::max)(-z, 0.0f);
+    axis[0] = x - std::copysign(t, x);
+    axis[1] = y - std::copysign(t, y);
+    axis[2] = z;
+}
+
+inline float DecodeConeCutoff(const uint8 encoded)
+{
+    return encoded * (1.0f / 254.0f);
+}
+
+/**
+True if eye, in object space, lies inside the cone of the cluster, so all
+of its triangles face away from it.
+
+This is the test of the unpacked cluster, dot(normalize(eye - apex), axis)
+> cutoff, rewritten to avoid the square roots: both sides are squared, and
+the axis length is multiplied in instead of normalizing it.
+*/
+inline bool IsConeBackfacing(const PackedCluster &cluster, const DirectX::XMFLOAT3 &eye)
+{
+    float axis[3];
+    DecodeConeAxis(cluster.coneAxis, axis);
+
+    const float dx = eye.x - cluster.coneApex[0];
+    const float dy = eye.y - cluster.coneApex[1];
+    const float dz = eye.z - cluster.coneApex[2];
+
+    const float d = dx * axis[0] + dy * axis[1] + dz * axis[2];
+    if (d <= 0)
+    {
+        return false;
+    }
+
+    const float cutoff = DecodeConeCutoff(cluster.coneCutoff);
+    const float directionLengthSq = dx * dx + dy * dy + dz * dz;
+    const float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    return d * d > cutoff * cutoff * directionLengthSq * axisLengthSq;
+}
+}
+}
+
+#endif // AMD_GEOMETRYFX_PACKED_CLUSTER_H
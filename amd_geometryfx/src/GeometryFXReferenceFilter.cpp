@@ -0,0 +1,312 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXReferenceFilter.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "AMD_GeometryFX_Internal.h"
+
+#ifdef min
+#undef min
+#endif
+
+#ifdef max
+#undef max
+#endif
+
+using namespace DirectX;
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+// Must match the shader
+const int CLEAR_THREAD_COUNT = 256;
+
+const uint32 SUBPIXEL_BITS = 8;
+const uint32 SUBPIXEL_MASK = 0xFF;
+const uint32 SUBPIXEL_SAMPLES = 1 << SUBPIXEL_BITS;
+
+/**
+Float to integer conversion as done by D3D, which clamps values out of range
+and turns NaN into 0. A plain cast is undefined for those.
+*/
+int32 FloatToInt(const float value)
+{
+    if (value != value)
+    {
+        return 0;
+    }
+
+    if (value >= 2147483648.0f)
+    {
+        return 0x7FFFFFFF;
+    }
+
+    if (value <= -2147483648.0f)
+    {
+        return -0x7FFFFFFF - 1;
+    }
+
+    return static_cast<int32>(value);
+}
+
+XMVECTOR LoadVertex(const void *vertexData, const uint32 index, const uint32 vertexOffset)
+{
+    XMFLOAT3 position;
+    ::memcpy(&position,
+        static_cast<const uint8 *>(vertexData) + vertexOffset + index * sizeof(XMFLOAT3),
+        sizeof(XMFLOAT3));
+
+    return XMVectorSet(position.x, position.y, position.z, 1);
+}
+
+/**
+The matrices of the constant buffers are packed, so they are loaded without
+assuming any alignment.
+*/
+XMMATRIX LoadMatrix(const XMMATRIX &matrix)
+{
+    return XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4 *>(&matrix));
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool CullTriangle(const uint32 indices[3], const XMFLOAT4 vertices[3],
+    const uint32 cullFlags, const uint32 windowWidth, const uint32 windowHeight)
+{
+    bool cull = false;
+
+    if (cullFlags & GeometryFX_FilterDuplicateIndices)
+    {
+        if (indices[0] == indices[1]
+            || indices[1] == indices[2]
+            || indices[0] == indices[2])
+        {
+            cull = true;
+        }
+    }
+
+    // Culling in homogeneous coordinates, see "Triangle Scan Conversion using
+    // 2D Homogeneous Coordinates" by Marc Olano and Trey Greer. The rows of
+    // the matrix are the x, y and w of each vertex.
+    if (cullFlags & GeometryFX_FilterBackface)
+    {
+        const float determinant =
+            vertices[0].x * (vertices[1].y * vertices[2].w - vertices[1].w * vertices[2].y)
+            - vertices[0].y * (vertices[1].x * vertices[2].w - vertices[1].w * vertices[2].x)
+            + vertices[0].w * (vertices[1].x * vertices[2].y - vertices[1].y * vertices[2].x);
+
+        cull = cull || (determinant > 0);
+    }
+
+    // Normalized 0..1 screen space
+    float x[3];
+    float y[3];
+    int verticesInFrontOfNearPlane = 0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        x[i] = vertices[i].x / vertices[i].w / 2 + 0.5f;
+        y[i] = vertices[i].y / vertices[i].w / 2 + 0.5f;
+
+        if (vertices[i].w < 0)
+        {
+            ++verticesInFrontOfNearPlane;
+        }
+    }
+
+    if (cullFlags & GeometryFX_FilterSmallPrimitives)
+    {
+        // 23.8 fixed point with a guard band, like the hardware
+        int32 minBB[2] = { 1 << 30, 1 << 30 };
+        int32 maxBB[2] = { -(1 << 30), -(1 << 30) };
+
+        bool insideGuardBand = true;
+        for (int i = 0; i < 3; ++i)
+        {
+            const float screenSpaceX = x[i] * static_cast<float>(windowWidth);
+            const float screenSpaceY = y[i] * static_cast<float>(windowHeight);
+
+            if (screenSpaceX < -(1 << 23) || screenSpaceX > (1 << 23)
+                || screenSpaceY < -(1 << 23) || screenSpaceY > (1 << 23))
+            {
+                insideGuardBand = false;
+            }
+
+            const int32 subpixelX = FloatToInt(screenSpaceX * SUBPIXEL_SAMPLES);
+            const int32 subpixelY = FloatToInt(screenSpaceY * SUBPIXEL_SAMPLES);
+
+            minBB[0] = std::min(subpixelX, minBB[0]);
+            minBB[1] = std::min(subpixelY, minBB[1]);
+            maxBB[0] = std::max(subpixelX, maxBB[0]);
+            maxBB[1] = std::max(subpixelY, maxBB[1]);
+        }
+
+        if (verticesInFrontOfNearPlane == 0 && insideGuardBand)
+        {
+            // Is the box right of or above the sample point, and narrower
+            // than the distance between samples? The shader mixes int and
+            // uint here, which makes the arithmetic unsigned.
+            for (int axis = 0; axis < 2; ++axis)
+            {
+                const uint32 minimum = static_cast<uint32>(minBB[axis]);
+                const uint32 maximum = static_cast<uint32>(maxBB[axis]);
+
+                cull = cull
+                    || (((minimum & SUBPIXEL_MASK) > SUBPIXEL_SAMPLES / 2)
+                        && ((maximum - ((minimum & ~SUBPIXEL_MASK) + SUBPIXEL_SAMPLES / 2))
+                            < (SUBPIXEL_SAMPLES - 1)));
+            }
+        }
+    }
+
+    if (cullFlags & GeometryFX_FilterFrustum)
+    {
+        if (verticesInFrontOfNearPlane == 3)
+        {
+            cull = true;
+        }
+
+        if (verticesInFrontOfNearPlane == 0)
+        {
+            const float minX = std::min(std::min(x[0], x[1]), x[2]);
+            const float minY = std::min(std::min(y[0], y[1]), y[2]);
+            const float maxX = std::max(std::max(x[0], x[1]), x[2]);
+            const float maxY = std::max(std::max(y[0], y[1]), y[2]);
+
+            cull = cull || (maxX < 0) || (maxY < 0) || (minX > 1) || (minY > 1);
+        }
+    }
+
+    return cull;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FilterSmallBatches(const FrameConstantBuffer &frame, const void *vertexData,
+    const uint32 *indexData, const MeshConstants *meshConstants,
+    const DrawCallArguments *drawCallArguments, const SmallBatchData *smallBatches,
+    const int batchCount, uint32 *filteredIndices, IndirectArguments *indirectArguments,
+    const int indirectArgumentCount)
+{
+    // ClearDrawIndirectArgsCS runs one thread per argument. Threads past the
+    // end of the buffer write nothing, like out of bounds UAV writes.
+    const int clearCount = std::min(batchCount * CLEAR_THREAD_COUNT, indirectArgumentCount);
+
+    for (int i = 0; i < clearCount; ++i)
+    {
+        indirectArguments[i].IndexCountPerInstance = 0;
+    }
+
+    const XMMATRIX projection = LoadMatrix(frame.projection);
+
+    // One FilterCS thread group per batch, one thread per triangle
+    uint32 keptTriangles[SmallBatchMergeConstants::MAXIMUM_BATCH_SIZE];
+
+    for (int batch = 0; batch < batchCount; ++batch)
+    {
+        const SmallBatchData &smallBatch = smallBatches[batch];
+        const MeshConstants &mesh = meshConstants[smallBatch.meshIndex];
+
+        assert(smallBatch.faceCount <= SmallBatchMergeConstants::MAXIMUM_BATCH_SIZE);
+        assert(static_cast<int>(smallBatch.drawIndex) < indirectArgumentCount);
+
+        const uint32 *batchIndices = indexData + (mesh.indexOffset + smallBatch.indexOffset) / 4;
+        const uint32 drawIndex = smallBatch.drawIndex;
+        const XMMATRIX worldView = LoadMatrix(drawCallArguments[drawIndex].worldView);
+
+        uint32 keptTriangleCount = 0;
+
+        for (uint32 triangle = 0; triangle < smallBatch.faceCount; ++triangle)
+        {
+            const uint32 indices[3] =
+            {
+                batchIndices[triangle * 3 + 0],
+                batchIndices[triangle * 3 + 1],
+                batchIndices[triangle * 3 + 2]
+            };
+
+            XMFLOAT4 vertices[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                XMStoreFloat4(&vertices[i], XMVector4Transform(XMVector4Transform(
+                    LoadVertex(vertexData, indices[i], mesh.vertexOffset), worldView), projection));
+            }
+
+            if (!CullTriangle(indices, vertices, frame.cullFlags, frame.width, frame.height))
+            {
+                keptTriangles[keptTriangleCount++] = triangle;
+            }
+        }
+
+        // The group reserves space for all its triangles at once, after the
+        // batches of the same draw which ran before
+        IndirectArguments &arguments = indirectArguments[drawIndex];
+        uint32 *output = filteredIndices + smallBatch.outputIndexOffset / 4
+            + arguments.IndexCountPerInstance;
+
+        arguments.IndexCountPerInstance += keptTriangleCount * 3;
+
+        for (uint32 i = 0; i < keptTriangleCount; ++i)
+        {
+            const uint32 triangle = keptTriangles[i];
+
+            output[i * 3 + 0] = batchIndices[triangle * 3 + 0];
+            output[i * 3 + 1] = batchIndices[triangle * 3 + 1];
+            output[i * 3 + 2] = batchIndices[triangle * 3 + 2];
+        }
+
+        if (static_cast<uint32>(batch) == smallBatch.drawBatchStart)
+        {
+            arguments.StartIndexLocation = smallBatch.outputIndexOffset / 4;
+            arguments.BaseVertexLocation = mesh.vertexOffset / 12;
+            arguments.StartInstanceLocation = drawIndex;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void FilterSmallBatchChunk(const FrameConstantBuffer &frame, const void *vertexData,
+    const uint32 *indexData, const MeshConstants *meshConstants,
+    const SmallBatchChunkData &chunk, std::vector<uint32> &filteredIndices,
+    std::vector<IndirectArguments> &indirectArguments)
+{
+    filteredIndices.assign(chunk.GetMaximumBatchCount() * chunk.GetBatchSize() * 3, 0);
+    indirectArguments.resize(chunk.GetMaximumBatchCount());
+
+    for (auto it = indirectArguments.begin(), end = indirectArguments.end(); it != end; ++it)
+    {
+        IndirectArguments::Init(*it);
+    }
+
+    FilterSmallBatches(frame, vertexData, indexData, meshConstants,
+        chunk.GetDrawCallArguments().data(), chunk.GetSmallBatchData().data(),
+        chunk.GetBatchCount(), filteredIndices.data(), indirectArguments.data(),
+        static_cast<int>(indirectArguments.size()));
+}
+}
+}
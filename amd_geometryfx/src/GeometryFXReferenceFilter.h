@@ -0,0 +1,121 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_REFERENCE_FILTER_H
+#define AMD_GEOMETRYFX_REFERENCE_FILTER_H
+
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "AMD_Types.h"
+#include "GeometryFXSmallBatchPacking.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+#pragma pack(push, 1)
+/**
+The layout of the buffers read and written by the filter shaders, see
+AMD_GeometryFX_Filtering.hlsl.
+*/
+struct FrameConstantBuffer
+{
+    DirectX::XMMATRIX view;
+    DirectX::XMMATRIX projection;
+    uint32 cullFlags;
+    uint32 width, height;
+};
+
+struct MeshConstants
+{
+    uint32 vertexCount;
+    uint32 faceCount;
+    uint32 indexOffset;
+    uint32 vertexOffset;
+};
+
+struct IndirectArguments
+{
+    /**
+    Static function to ensure IndirectArguments remains a POD
+    */
+    static void Init (IndirectArguments &ia)
+    {
+        ia.IndexCountPerInstance = 0;
+        ia.InstanceCount = 1;
+        ia.StartIndexLocation = 0;
+        ia.BaseVertexLocation = 0;
+        ia.StartInstanceLocation = 0;
+    }
+
+    uint32 IndexCountPerInstance;
+    uint32 InstanceCount;
+    uint32 StartIndexLocation;
+    int32 BaseVertexLocation;
+    uint32 StartInstanceLocation;
+};
+#pragma pack(pop)
+
+/**
+CullTriangle of the filter shader. The vertices are in clip space. Returns
+true if the triangle is culled by any of the GEOMETRYFX_FILTER flags set in
+cullFlags.
+*/
+bool CullTriangle(const uint32 indices[3], const DirectX::XMFLOAT4 vertices[3],
+    const uint32 cullFlags, const uint32 windowWidth, const uint32 windowHeight);
+
+/**
+A C++ version of one small batch chunk going through the filter shaders, which
+runs ClearDrawIndirectArgsCS and then FilterCS over batchCount batches.
+
+The inputs are the buffers the shaders read: vertexData and indexData are the
+global vertex and index buffers, meshConstants holds one entry per mesh and
+drawCallArguments one per draw of the chunk. filteredIndices must hold three
+indices per triangle of the output ranges of all draws, and
+indirectArguments must hold indirectArgumentCount entries initialized with
+IndirectArguments::Init. Both are written the same way as on the GPU.
+
+On the GPU, the order in which the batches of a draw append their triangles
+is not defined. Here, batches and triangles are processed in order, which is
+one of the orders the GPU may produce. The triangles kept by each draw are
+the same, up to differences in floating point rounding of the transforms.
+*/
+void FilterSmallBatches(const FrameConstantBuffer &frame, const void *vertexData,
+    const uint32 *indexData, const MeshConstants *meshConstants,
+    const DrawCallArguments *drawCallArguments, const SmallBatchData *smallBatches,
+    const int batchCount, uint32 *filteredIndices, IndirectArguments *indirectArguments,
+    const int indirectArgumentCount);
+
+/**
+Filter one packed chunk, sizing and initializing the output buffers like the
+GPU chunk does.
+*/
+void FilterSmallBatchChunk(const FrameConstantBuffer &frame, const void *vertexData,
+    const uint32 *indexData, const MeshConstants *meshConstants,
+    const SmallBatchChunkData &chunk, std::vector<uint32> &filteredIndices,
+    std::vector<IndirectArguments> &indirectArguments);
+}
+}
+
+#endif // AMD_GEOMETRYFX_REFERENCE_FILTER_H
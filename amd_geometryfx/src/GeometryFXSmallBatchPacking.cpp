@@ -0,0 +1,677 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXSmallBatchPacking.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "AMD_GeometryFX_Internal.h"
+#include "GeometryFXClusterCulling.h"
+#include "GeometryFXClusterVisibility.h"
+#include "GeometryFXMesh.h"
+#include "GeometryFXOcclusionBuffer.h"
+#include "GeometryFXWorkerPool.h"
+
+#ifdef min
+#undef min
+#endif
+
+#ifdef max
+#undef max
+#endif
+
+using namespace DirectX;
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+// Number of draw commands packed by one task of the worker pool. Each range
+// ends with a partially filled chunk, so this is a trade-off between load
+// balancing and the number of chunks submitted.
+const int DRAW_COMMANDS_PER_PACKING_RANGE = 1024;
+
+enum INSTANCE_CULL_REASON
+{
+    INSTANCE_CULL_FRUSTUM,
+    INSTANCE_CULL_BACKFACE,
+    INSTANCE_CULL_OCCLUSION
+};
+
+/**
+Statistics for a draw request rejected as a whole by the mesh bounds. All
+clusters of its full detail mesh count as culled for the same reason, as
+the level it would have drawn is not known yet.
+*/
+void CountRejectedInstance (GeometryFX_FilterStatistics *statistics,
+    const int clusterCount, const INSTANCE_CULL_REASON reason)
+{
+    if (statistics == nullptr)
+    {
+        return;
+    }
+
+    ++statistics->instancesCulled;
+    statistics->clustersProcessed += clusterCount;
+    statistics->clustersCulled += clusterCount;
+
+    switch (reason)
+    {
+    case INSTANCE_CULL_FRUSTUM:
+        statistics->clustersFrustumCulled += clusterCount;
+        break;
+    case INSTANCE_CULL_BACKFACE:
+        statistics->clustersBackfaceCulled += clusterCount;
+        break;
+    case INSTANCE_CULL_OCCLUSION:
+        statistics->clustersOcclusionCulled += clusterCount;
+        break;
+    }
+}
+
+/**
+Add the cluster and instance counters of source to target. The triangle
+counters are filled in while the chunks are rendered.
+*/
+void AccumulateClusterStatistics (GeometryFX_FilterStatistics &target,
+    const GeometryFX_FilterStatistics &source)
+{
+    target.clustersProcessed += source.clustersProcessed;
+    target.clustersRendered += source.clustersRendered;
+    target.clustersCulled += source.clustersCulled;
+    target.clustersFrustumCulled += source.clustersFrustumCulled;
+    target.clustersBackfaceCulled += source.clustersBackfaceCulled;
+    target.clustersOcclusionCulled += source.clustersOcclusionCulled;
+    target.instancesCulled += source.instancesCulled;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FilterContext CreateFilterContext (const GeometryFX_FilterRenderOptions &options,
+    const XMMATRIX &view, const XMMATRIX &projection, const int width, const int height)
+{
+    FilterContext filterContext;
+    filterContext.options = &options;
+    filterContext.projection = projection;
+    filterContext.view = view;
+    filterContext.viewProjection = view * projection;
+    filterContext.windowWidth = width;
+    filterContext.windowHeight = height;
+    filterContext.lodErrorScale = XMVectorGetY (projection.r[1]) * height * 0.5f;
+    filterContext.occlusionBuffer = nullptr;
+    filterContext.clusterVisibility = nullptr;
+
+    const auto inverseView = XMMatrixInverse (nullptr, view);
+    XMFLOAT4X4 float4x4;
+    XMStoreFloat4x4 (&float4x4, inverseView);
+
+    filterContext.eye = XMVectorSet (float4x4._41, float4x4._42, float4x4._43, 1);
+
+    return filterContext;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+XMFLOAT3 GetObjectSpaceEye (const XMVECTOR eye,
+    const XMMATRIX &world, const GEOMETRYFX_WORLD_TRANSFORM transform)
+{
+    XMFLOAT3 result;
+
+    if (transform == GeometryFX_WorldTransformRigid)
+    {
+        // With row vectors, p' = p * M + t. As the rows of M are orthogonal,
+        // M^-1 = M^T with each column divided by the squared length of the
+        // corresponding row, so p = (p' - t) * M^-1 is three dot products
+        const XMVECTOR toEye = XMVectorSubtract (eye, world.r[3]);
+
+        result.x = XMVectorGetX (XMVector3Dot (toEye, world.r[0]))
+            / XMVectorGetX (XMVector3LengthSq (world.r[0]));
+        result.y = XMVectorGetX (XMVector3Dot (toEye, world.r[1]))
+            / XMVectorGetX (XMVector3LengthSq (world.r[1]));
+        result.z = XMVectorGetX (XMVector3Dot (toEye, world.r[2]))
+            / XMVectorGetX (XMVector3LengthSq (world.r[2]));
+    }
+    else
+    {
+        XMStoreFloat3 (&result, XMVector4Transform (eye, XMMatrixInverse (nullptr, world)));
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+XMFLOAT3 GetObjectSpaceEye (const XMVECTOR eye, const XMMATRIX &inverseWorld)
+{
+    XMFLOAT3 result;
+    XMStoreFloat3 (&result, XMVector4Transform (eye, inverseWorld));
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SortDrawCommandsByMesh (std::vector<DrawCommand> &drawCommands,
+    const int meshCount, std::vector<DrawCommand> &scratch)
+{
+    // A counting sort, which is stable and linear in the number of draws
+    std::vector<int> offsets (meshCount + 1, 0);
+
+    for (auto it = drawCommands.begin (), end = drawCommands.end (); it != end; ++it)
+    {
+        assert (static_cast<int>(it->dcb.meshIndex) < meshCount);
+        ++offsets[it->dcb.meshIndex + 1];
+    }
+
+    for (int i = 0; i < meshCount; ++i)
+    {
+        offsets[i + 1] += offsets[i];
+    }
+
+    scratch.resize (drawCommands.size ());
+
+    for (auto it = drawCommands.begin (), end = drawCommands.end (); it != end; ++it)
+    {
+        scratch[offsets[it->dcb.meshIndex]++] = *it;
+    }
+
+    drawCommands.swap (scratch);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+DrawCullResults::DrawCullResults ()
+    : visibleViews_ (0)
+    , clusterCount_ (0)
+    , blockCount_ (0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void DrawCullResults::Compute (const DrawCommand &request, const FilterContext *views,
+    const int viewCount, GeometryFX_FilterStatistics *statistics)
+{
+    assert (viewCount > 0 && viewCount <= GeometryFX_FilterMaximumViewCount);
+
+    const StaticMesh *mesh = request.mesh;
+    const GeometryFX_FilterRenderOptions &options = *views[0].options;
+
+    // Without a threshold, only the clusters of the full detail mesh are
+    // walked. Otherwise, all levels are walked and each cluster decides
+    // on its own whether it belongs to the selected level.
+    const float lodErrorThreshold = options.lodErrorThreshold;
+    const bool selectLod = lodErrorThreshold > 0 && !mesh->clusterLods.empty ();
+
+    clusterCount_ = selectLod ? static_cast<int>(mesh->clusters.size ()) : mesh->baseClusterCount;
+    blockCount_ = (clusterCount_ + CLUSTER_BLOCK_SIZE - 1) / CLUSTER_BLOCK_SIZE;
+    visibleViews_ = 0;
+
+    const bool frustumCulling = (options.enabledFilters & GeometryFX_FilterFrustum) != 0;
+    const bool backfaceCulling = (options.enabledFilters & GeometryFX_ClusterFilterBackface) != 0;
+
+    // We move the eye position into object space, so we don't have to
+    // transform the cones into world space all the time. Unless the draw
+    // came with a rigid transform or an inverse, this needs a matrix
+    // inversion, so it only happens for views which pass the frustum test.
+    XMFLOAT3 eyes[GeometryFX_FilterMaximumViewCount];
+    bool hasEye[GeometryFX_FilterMaximumViewCount] = {};
+
+    const auto getEye = [&](const int view) -> const XMFLOAT3 &
+    {
+        if (!hasEye[view])
+        {
+            eyes[view] = (view == 0 && request.hasObjectSpaceEye)
+                ? request.objectSpaceEye
+                : GetObjectSpaceEye (views[view].eye, request.dcb.world, request.transform);
+            hasEye[view] = true;
+        }
+
+        return eyes[view];
+    };
+
+    // The whole mesh is tested first, once per view
+    for (int view = 0; view < viewCount; ++view)
+    {
+        const FilterContext &filterContext = views[view];
+
+        // The quantized cluster boxes are transformed straight to clip
+        // space, without decoding them first
+        const XMMATRIX quantizedWorldViewProjection = (frustumCulling || filterContext.occlusionBuffer)
+            ? GetDequantizationMatrix (mesh->clusterQuantization)
+                * request.dcb.world * filterContext.viewProjection
+            : XMMatrixIdentity ();
+
+        XMStoreFloat4x4 (&quantizedWorldViewProjections_[view], quantizedWorldViewProjection);
+
+        if (frustumCulling && ObjectSpaceFrustum (quantizedWorldViewProjection).IsOutside (
+            GetQuantizedMeshAabbMin (), GetQuantizedMeshAabbMax ()))
+        {
+            CountRejectedInstance (statistics, mesh->baseClusterCount, INSTANCE_CULL_FRUSTUM);
+            continue;
+        }
+
+        if (backfaceCulling && mesh->bounds.valid)
+        {
+            const auto &bounds = mesh->bounds;
+            const auto testVec = XMVector3Normalize (
+                XMVectorSubtract (XMLoadFloat3 (&getEye (view)), bounds.coneCenter));
+
+            if (XMVectorGetX (XMVector3Dot (testVec, bounds.coneAxis)) > bounds.coneAngleCosine)
+            {
+                CountRejectedInstance (statistics, mesh->baseClusterCount, INSTANCE_CULL_BACKFACE);
+                continue;
+            }
+        }
+
+        if (filterContext.occlusionBuffer && filterContext.occlusionBuffer->IsOccluded (
+            quantizedWorldViewProjection, GetQuantizedMeshAabbMin (), GetQuantizedMeshAabbMax ()))
+        {
+            CountRejectedInstance (statistics, mesh->baseClusterCount, INSTANCE_CULL_OCCLUSION);
+            continue;
+        }
+
+        visibleViews_ |= 1u << view;
+    }
+
+    if (visibleViews_ == 0)
+    {
+        return;
+    }
+
+    // The masks are only grown, every entry used below is written first
+    if (static_cast<int>(laneMasks_.size ()) < blockCount_)
+    {
+        laneMasks_.resize (blockCount_);
+    }
+
+    if (static_cast<int>(frustumMasks_.size ()) < blockCount_ * viewCount)
+    {
+        frustumMasks_.resize (blockCount_ * viewCount);
+        backfaceMasks_.resize (blockCount_ * viewCount);
+    }
+
+    // The level is selected from the first view even if that view does not
+    // see the draw, so all views draw the same geometry. Clusters of the
+    // other levels are skipped without counting them.
+    for (int block = 0; block < blockCount_; ++block)
+    {
+        const int blockStart = block * CLUSTER_BLOCK_SIZE;
+        const int endLane = std::min (CLUSTER_BLOCK_SIZE, clusterCount_ - blockStart);
+
+        uint32 laneMask = (1u << endLane) - 1;
+
+        if (selectLod)
+        {
+            for (int lane = 0; lane < endLane; ++lane)
+            {
+                if (!IsClusterLodSelected (mesh->clusterLods[blockStart + lane],
+                    getEye (0), views[0].lodErrorScale, lodErrorThreshold))
+                {
+                    laneMask &= ~(1u << lane);
+                }
+            }
+        }
+
+        laneMasks_[block] = static_cast<uint8>(laneMask);
+    }
+
+    for (int view = 0; view < viewCount; ++view)
+    {
+        if (!IsVisible (view))
+        {
+            continue;
+        }
+
+        // The planes are moved into the quantized space of the cluster
+        // boxes once per view instead of moving every box into world space
+        const ObjectSpaceFrustum frustum (GetQuantizedWorldViewProjection (view));
+
+        uint8 *frustumMasks = &frustumMasks_[view * blockCount_];
+        uint8 *backfaceMasks = &backfaceMasks_[view * blockCount_];
+
+        for (int block = 0; block < blockCount_; ++block)
+        {
+            const uint32 laneMask = laneMasks_[block];
+            const auto &clusterBlock = mesh->clusterBlocks[block];
+
+            // A cluster is only counted for the first test which rejects
+            // it. Invalid cones never pass the cone test, so there is no
+            // separate check for them.
+            const uint32 frustumMask = (frustumCulling && laneMask != 0)
+                ? frustum.GetOutsideMask (clusterBlock) & laneMask
+                : 0;
+            const uint32 backfaceMask = (backfaceCulling && (laneMask & ~frustumMask) != 0)
+                ? GetBackfacingMask (clusterBlock, getEye (view)) & laneMask & ~frustumMask
+                : 0;
+
+            frustumMasks[block] = static_cast<uint8>(frustumMask);
+            backfaceMasks[block] = static_cast<uint8>(backfaceMask);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+SmallBatchChunkData::SmallBatchChunkData (const int batchSize, const int batchCount)
+    : batchSize_ (batchSize)
+    , maximumBatchCount_ (batchCount)
+    , currentBatchCount_ (0)
+    , currentDrawCallCount_ (0)
+    , faceCount_ (0)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool SmallBatchChunkData::AddRequest (const DrawCommand &request, DrawCommand &remainder,
+    const FilterContext &filterContext, const DrawCullResults &cullResults,
+    const int view, GeometryFX_FilterStatistics *statistics)
+{
+    assert (request.firstCluster >= 0);
+    assert (cullResults.IsVisible (view));
+
+    const int clusterCount = cullResults.GetClusterCount ();
+    int currentCluster = request.firstCluster;
+
+    const OcclusionBuffer *occlusionBuffer = filterContext.occlusionBuffer;
+    ClusterVisibility *clusterVisibility = filterContext.clusterVisibility;
+    const XMMATRIX quantizedWorldViewProjection = occlusionBuffer
+        ? cullResults.GetQuantizedWorldViewProjection (view)
+        : XMMatrixIdentity ();
+
+    if (currentDrawCallCount_ == maximumBatchCount_)
+    {
+        remainder = request;
+        return true;
+    }
+
+    const int filteredIndexBufferStartOffset =
+        currentBatchCount_ * batchSize_ * 3 * sizeof (int);
+
+    const int firstBatch = currentBatchCount_;
+    const bool mergeBatches = filterContext.options->mergeClusterBatches;
+
+    int processedClusters = 0;
+    int renderedClusters = 0;
+    int frustumCulledClusters = 0;
+    int backfaceCulledClusters = 0;
+    int occlusionCulledClusters = 0;
+
+    bool chunkFull = false;
+
+    // The clusters are walked one block at a time, using the masks of the
+    // cull results. The surviving clusters are assigned to batches until we
+    // run out of batches or geometry.
+    while (!chunkFull && currentCluster < clusterCount)
+    {
+        const int blockStart = currentCluster - currentCluster % CLUSTER_BLOCK_SIZE;
+        const int block = blockStart / CLUSTER_BLOCK_SIZE;
+
+        const int firstLane = currentCluster - blockStart;
+        const int endLane = std::min (CLUSTER_BLOCK_SIZE, clusterCount - blockStart);
+
+        const uint32 laneMask = cullResults.GetLaneMask (block) & ~((1u << firstLane) - 1);
+        const uint32 frustumMask = cullResults.GetFrustumMask (view, block) & laneMask;
+        const uint32 backfaceMask = cullResults.GetBackfaceMask (view, block) & laneMask;
+        const uint32 visibleMask = laneMask & ~(frustumMask | backfaceMask);
+
+        int lane = firstLane;
+        for (; lane < endLane; ++lane)
+        {
+            if ((visibleMask & (1u << lane)) == 0)
+            {
+                continue;
+            }
+
+            const auto &clusterInfo = request.mesh->clusters[blockStart + lane];
+            const int triangleCount = GetTriangleCount (clusterInfo);
+            assert (triangleCount <= batchSize_);
+
+            // The triangles of the cluster can be appended to the previous
+            // batch of this draw if they follow its triangles directly. The
+            // output space of the draw only depends on its batch count, and
+            // a batch never holds more than batchSize_ triangles.
+            SmallBatchData *previousBatch = (mergeBatches && currentBatchCount_ > firstBatch)
+                ? &smallBatchDataBackingStore_.back ()
+                : nullptr;
+            const bool mergeIntoPrevious = previousBatch
+                && previousBatch->indexOffset + previousBatch->faceCount * 3 * sizeof (int)
+                    == clusterInfo.firstTriangle * 3 * sizeof (int)
+                && previousBatch->faceCount + triangleCount <= static_cast<uint32>(batchSize_);
+
+            // The rest of the block goes into the remainder
+            if (!mergeIntoPrevious && currentBatchCount_ == maximumBatchCount_)
+            {
+                chunkFull = true;
+                break;
+            }
+
+            if (occlusionBuffer && occlusionBuffer->IsOccluded (
+                quantizedWorldViewProjection, GetQuantizedAabbMin (clusterInfo),
+                GetQuantizedAabbMax (clusterInfo)))
+            {
+                ++occlusionCulledClusters;
+                continue;
+            }
+
+            if (clusterVisibility)
+            {
+                clusterVisibility->SetVisible (request.drawCallId, blockStart + lane);
+            }
+
+            if (mergeIntoPrevious)
+            {
+                previousBatch->faceCount += triangleCount;
+            }
+            else
+            {
+                smallBatchDataBackingStore_.push_back (SmallBatchData ());
+                auto &smallBatchData = smallBatchDataBackingStore_.back ();
+
+                smallBatchData.drawIndex = currentDrawCallCount_;
+                smallBatchData.faceCount = triangleCount;
+
+                // Offset relative to the start of the mesh
+                smallBatchData.indexOffset = clusterInfo.firstTriangle * 3 * sizeof (int);
+                smallBatchData.outputIndexOffset = filteredIndexBufferStartOffset;
+                smallBatchData.meshIndex = request.dcb.meshIndex;
+                smallBatchData.drawBatchStart = firstBatch;
+
+                ++currentBatchCount_;
+            }
+
+            faceCount_ += triangleCount;
+            ++renderedClusters;
+        }
+
+        // Only the lanes before the one which did not fit are done
+        const uint32 doneMask = laneMask & ((1u << lane) - 1);
+
+        processedClusters += CountClusterMaskBits (doneMask);
+        frustumCulledClusters += CountClusterMaskBits (frustumMask & doneMask);
+        backfaceCulledClusters += CountClusterMaskBits (backfaceMask & doneMask);
+
+        currentCluster = blockStart + lane;
+    }
+
+    if (statistics)
+    {
+        statistics->clustersProcessed += processedClusters;
+
+        statistics->clustersRendered += renderedClusters;
+
+        statistics->clustersCulled +=
+            frustumCulledClusters + backfaceCulledClusters + occlusionCulledClusters;
+
+        statistics->clustersFrustumCulled += frustumCulledClusters;
+        statistics->clustersBackfaceCulled += backfaceCulledClusters;
+        statistics->clustersOcclusionCulled += occlusionCulledClusters;
+    }
+
+    if (currentBatchCount_ > firstBatch)
+    {
+        drawCallBackingStore_.push_back (request.dcb);
+        drawCallBackingStore_.back ().worldView = request.dcb.world * filterContext.view;
+        ++currentDrawCallCount_;
+    }
+
+    // Check if the draw command fit into this call, if not, create a remainder
+    if (currentCluster < clusterCount)
+    {
+        remainder = request;
+        remainder.firstCluster = currentCluster;
+
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SmallBatchChunkData::Reset ()
+{
+    smallBatchDataBackingStore_.clear ();
+    drawCallBackingStore_.clear ();
+
+    currentBatchCount_ = 0;
+    currentDrawCallCount_ = 0;
+    faceCount_ = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+SmallBatchPacker::SmallBatchPacker (const int batchSize, const int batchCount)
+    : batchSize_ (batchSize)
+    , batchCount_ (batchCount)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+SmallBatchPacker::~SmallBatchPacker ()
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void SmallBatchPacker::Pack (WorkerPool &pool, const std::vector<DrawCommand> &drawCommands,
+    const FilterContext *views, const int viewCount, GeometryFX_FilterStatistics *statistics)
+{
+    assert (viewCount > 0 && viewCount <= GeometryFX_FilterMaximumViewCount);
+
+    const int drawCommandCount = static_cast<int>(drawCommands.size ());
+    const int rangeCount = (drawCommandCount + DRAW_COMMANDS_PER_PACKING_RANGE - 1)
+        / DRAW_COMMANDS_PER_PACKING_RANGE;
+
+    while (static_cast<int>(ranges_.size ()) < rangeCount)
+    {
+        ranges_.emplace_back (new Range);
+    }
+
+    pool.ParallelFor (rangeCount, [&](const int rangeIndex, const int /* threadIndex */)
+    {
+        Range &range = *ranges_[rangeIndex];
+        range.statistics = GeometryFX_FilterStatistics ();
+
+        GeometryFX_FilterStatistics *rangeStatistics = statistics ? &range.statistics : nullptr;
+
+        // Chunks are reused from the previous frames where possible
+        const auto nextChunk = [this, &range](const int view) -> SmallBatchChunkData *
+        {
+            auto &chunks = range.chunks[view];
+
+            if (range.chunkCount[view] == static_cast<int>(chunks.size ()))
+            {
+                chunks.emplace_back (new SmallBatchChunkData (batchSize_, batchCount_));
+            }
+
+            SmallBatchChunkData *chunk = chunks[range.chunkCount[view]++].get ();
+            chunk->Reset ();
+
+            return chunk;
+        };
+
+        // The current chunk of each view, started on the first visible draw
+        SmallBatchChunkData *currentChunks[GeometryFX_FilterMaximumViewCount] = {};
+
+        for (int view = 0; view < viewCount; ++view)
+        {
+            range.chunkCount[view] = 0;
+        }
+
+        const int first = rangeIndex * DRAW_COMMANDS_PER_PACKING_RANGE;
+        const int last = std::min (first + DRAW_COMMANDS_PER_PACKING_RANGE, drawCommandCount);
+
+        for (int i = first; i < last; ++i)
+        {
+            range.cullResults.Compute (drawCommands[i], views, viewCount, rangeStatistics);
+
+            for (int view = 0; view < viewCount; ++view)
+            {
+                if (!range.cullResults.IsVisible (view))
+                {
+                    continue;
+                }
+
+                if (currentChunks[view] == nullptr)
+                {
+                    currentChunks[view] = nextChunk (view);
+                }
+
+                DrawCommand current = drawCommands[i];
+                DrawCommand next;
+
+                // Overflow, continue with the next chunk
+                while (currentChunks[view]->AddRequest (current, next, views[view],
+                    range.cullResults, view, rangeStatistics))
+                {
+                    current = next;
+                    currentChunks[view] = nextChunk (view);
+                }
+            }
+        }
+    });
+
+    for (int view = 0; view < viewCount; ++view)
+    {
+        chunks_[view].clear ();
+    }
+
+    for (int i = 0; i < rangeCount; ++i)
+    {
+        const Range &range = *ranges_[i];
+
+        for (int view = 0; view < viewCount; ++view)
+        {
+            // The last chunk of a range may have stayed empty
+            for (int j = 0; j < range.chunkCount[view]; ++j)
+            {
+                if (range.chunks[view][j]->GetBatchCount () > 0)
+                {
+                    chunks_[view].push_back (range.chunks[view][j].get ());
+                }
+            }
+        }
+
+        if (statistics)
+        {
+            AccumulateClusterStatistics (*statistics, range.statistics);
+        }
+    }
+}
+}
+}
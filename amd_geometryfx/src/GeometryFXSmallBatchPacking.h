@@ -0,0 +1,358 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_SMALL_BATCH_PACKING_H
+#define AMD_GEOMETRYFX_SMALL_BATCH_PACKING_H
+
+#include <memory>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "AMD_GeometryFX_Filtering.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+class ClusterVisibility;
+class OcclusionBuffer;
+class StaticMesh;
+class WorkerPool;
+
+struct FilterContext
+{
+    const GeometryFX_FilterRenderOptions *options;
+    DirectX::XMMATRIX view;
+    DirectX::XMMATRIX projection;
+    DirectX::XMMATRIX viewProjection;
+    DirectX::XMVECTOR eye;
+    int windowWidth;
+    int windowHeight;
+
+    // Pixels covered by one unit at unit distance along the vertical axis,
+    // which turns a simplification error into a screen-space error
+    float lodErrorScale;
+
+    // Set in EndRender() once the occluders are rasterized, if occlusion
+    // culling is enabled
+    const OcclusionBuffer *occlusionBuffer;
+
+    // Set in EndRender() if temporal occlusion is enabled. Every cluster
+    // which is drawn is recorded here, keyed by DrawCommand::drawCallId.
+    ClusterVisibility *clusterVisibility;
+};
+
+/**
+Set up the filter context of one view, before the occlusion buffer is
+rasterized.
+*/
+FilterContext CreateFilterContext (const GeometryFX_FilterRenderOptions &options,
+    const DirectX::XMMATRIX &view, const DirectX::XMMATRIX &projection, const int width,
+    const int height);
+
+#pragma pack(push, 1)
+struct DrawCallArguments
+{
+    DirectX::XMMATRIX world;
+    DirectX::XMMATRIX worldView;
+    uint32 meshIndex;
+    uint32 pad[3];
+};
+
+struct SmallBatchData
+{
+    uint32 meshIndex;         // Index into meshConstants
+    uint32 indexOffset;       // Index relative to the meshConstants[meshIndex].indexOffset
+    uint32 faceCount;         // Number of faces in this small batch
+    uint32 outputIndexOffset; // Offset into the output index buffer
+    uint32 drawIndex;         // Index into the SmallBatchDrawCallTable
+    uint32 drawBatchStart;    // First slot for the current draw call
+};
+#pragma pack(pop)
+
+struct DrawCommand
+{
+    inline DrawCommand ()
+        : mesh (nullptr)
+        , drawCallId (-1)
+        , firstCluster (0)
+        , transform (GeometryFX_WorldTransformGeneral)
+        , hasObjectSpaceEye (false)
+    {
+    }
+
+    // worldView is filled in per view once the draw is packed
+    DrawCallArguments dcb;
+    GeometryFX_Internal::StaticMesh *mesh;
+    int drawCallId;
+    int firstCluster;
+    GEOMETRYFX_WORLD_TRANSFORM transform;
+    // Eye position of the first view in object space. Set when the draw is
+    // recorded if it is cheap to compute, otherwise DrawCullResults computes
+    // it when needed
+    DirectX::XMFLOAT3 objectSpaceEye;
+    bool hasObjectSpaceEye;
+};
+
+/**
+Move the eye into the object space of world.
+
+For GeometryFX_WorldTransformRigid, the rows of the upper 3x3 part are
+orthogonal, so the inverse is the transpose with each row divided by its
+squared length.
+*/
+DirectX::XMFLOAT3 GetObjectSpaceEye (const DirectX::XMVECTOR eye,
+    const DirectX::XMMATRIX &world, const GEOMETRYFX_WORLD_TRANSFORM transform);
+
+/**
+Move the eye into object space using a precomputed inverse world matrix.
+*/
+DirectX::XMFLOAT3 GetObjectSpaceEye (const DirectX::XMVECTOR eye,
+    const DirectX::XMMATRIX &inverseWorld);
+
+/**
+Reorder drawCommands so that all draws of a mesh are next to each other, in
+order of the mesh index. The recorded order of the draws of one mesh is
+kept. scratch is used as temporary storage, which is kept between calls.
+*/
+void SortDrawCommandsByMesh (std::vector<DrawCommand> &drawCommands,
+    const int meshCount, std::vector<DrawCommand> &scratch);
+
+/**
+The per-cluster culling of one draw command, computed once for all views
+before the draw is packed into the chunks of each view.
+
+The level of detail is selected from the first view, so all views draw the
+same clusters before culling. Each view then gets its own frustum and
+backface masks, one byte per block of clusters. The occlusion test is left
+to AddRequest, as only the clusters which pass the masks are tested.
+*/
+class DrawCullResults
+{
+public:
+    DrawCullResults ();
+
+    /**
+    Instances rejected as a whole by a view are added to statistics, if it is
+    not null.
+    */
+    void Compute (const DrawCommand &request, const FilterContext *views,
+        const int viewCount, GeometryFX_FilterStatistics *statistics);
+
+    bool IsVisible (const int view) const
+    {
+        return (visibleViews_ & (1u << view)) != 0;
+    }
+
+    int GetClusterCount () const
+    {
+        return clusterCount_;
+    }
+
+    uint32 GetLaneMask (const int block) const
+    {
+        return laneMasks_[block];
+    }
+
+    uint32 GetFrustumMask (const int view, const int block) const
+    {
+        return frustumMasks_[view * blockCount_ + block];
+    }
+
+    uint32 GetBackfaceMask (const int view, const int block) const
+    {
+        return backfaceMasks_[view * blockCount_ + block];
+    }
+
+    DirectX::XMMATRIX GetQuantizedWorldViewProjection (const int view) const
+    {
+        return DirectX::XMLoadFloat4x4 (&quantizedWorldViewProjections_[view]);
+    }
+
+private:
+    DrawCullResults (const DrawCullResults &);
+    DrawCullResults &operator= (const DrawCullResults &);
+
+    uint32 visibleViews_;
+    int clusterCount_;
+    int blockCount_;
+
+    // Clusters of the selected level, before culling
+    std::vector<uint8> laneMasks_;
+    std::vector<uint8> frustumMasks_;
+    std::vector<uint8> backfaceMasks_;
+
+    // Stored unaligned, as the results live in the worker ranges
+    DirectX::XMFLOAT4X4 quantizedWorldViewProjections_[GeometryFX_FilterMaximumViewCount];
+};
+
+/**
+The CPU side of one small batch chunk. One chunk can accept multiple draw
+requests, and holds up to batchCount batches of up to batchSize triangles.
+Draw requests are split into small batches, one per cluster of the mesh. A
+draw request always occupies consecutive slots. A draw request may be split
+if it does not fit entirely into this small batch. With
+GeometryFX_FilterRenderOptions::mergeClusterBatches, clusters of one draw
+which are next to each other in the index buffer share a batch if they fit.
+
+The filter then processes all small batches in this chunk in one go, and
+renders them by using one indirect draw call per original draw request.
+*/
+class SmallBatchChunkData
+{
+public:
+    SmallBatchChunkData (const int batchSize, const int batchCount);
+
+    /**
+    If true is returned, then remainder has been filled and must be
+    re-submitted. Otherwise, the whole request has been handled by this small
+    batch.
+
+    The clusters are taken from cullResults, which must have been computed
+    for request, and must find it visible in view. filterContext is the
+    context of that view. Cluster statistics are added to statistics, if it
+    is not null.
+    */
+    bool AddRequest (const DrawCommand &request, DrawCommand &remainder,
+        const FilterContext &filterContext, const DrawCullResults &cullResults,
+        const int view, GeometryFX_FilterStatistics *statistics);
+
+    void Reset ();
+
+    int GetBatchSize () const
+    {
+        return batchSize_;
+    }
+
+    /**
+    Maximum number of batches, which is also the maximum number of draws.
+    */
+    int GetMaximumBatchCount () const
+    {
+        return maximumBatchCount_;
+    }
+
+    int GetBatchCount () const
+    {
+        return currentBatchCount_;
+    }
+
+    int GetDrawCallCount () const
+    {
+        return currentDrawCallCount_;
+    }
+
+    int GetFaceCount () const
+    {
+        return faceCount_;
+    }
+
+    const std::vector<SmallBatchData> &GetSmallBatchData () const
+    {
+        return smallBatchDataBackingStore_;
+    }
+
+    const std::vector<DrawCallArguments> &GetDrawCallArguments () const
+    {
+        return drawCallBackingStore_;
+    }
+
+private:
+    SmallBatchChunkData (const SmallBatchChunkData &);
+    SmallBatchChunkData &operator= (const SmallBatchChunkData &);
+
+    std::vector<SmallBatchData> smallBatchDataBackingStore_;
+    std::vector<DrawCallArguments> drawCallBackingStore_;
+
+    int batchSize_;
+    int maximumBatchCount_;
+
+    int currentBatchCount_;
+    int currentDrawCallCount_;
+    int faceCount_;
+};
+
+/**
+Packs the draw commands of a frame into small batch chunks on the threads of
+a worker pool.
+
+The draw commands are split into ranges of a fixed size, and each range is
+packed on its own into chunks. The chunks come out in the order of the
+draw commands, and do not depend on the number of threads. Only the last
+chunk of each range may be partially filled.
+
+With multiple views, every view gets its own chunks. The culling work which
+does not depend on the view is shared by all of them.
+*/
+class SmallBatchPacker
+{
+public:
+    /**
+    The chunks hold batchCount batches of batchSize triangles each. The
+    clusters of all meshes must not have more than batchSize triangles.
+    */
+    SmallBatchPacker (const int batchSize, const int batchCount);
+    ~SmallBatchPacker ();
+
+    /**
+    Cluster statistics of all views are added to statistics, if it is not
+    null. The chunks stay valid until the next call.
+    */
+    void Pack (WorkerPool &pool, const std::vector<DrawCommand> &drawCommands,
+        const FilterContext *views, const int viewCount, GeometryFX_FilterStatistics *statistics);
+
+    int GetChunkCount (const int view) const
+    {
+        return static_cast<int>(chunks_[view].size ());
+    }
+
+    const SmallBatchChunkData &GetChunk (const int view, const int index) const
+    {
+        return *chunks_[view][index];
+    }
+
+private:
+    SmallBatchPacker (const SmallBatchPacker &);
+    SmallBatchPacker &operator= (const SmallBatchPacker &);
+
+    struct Range
+    {
+        // Chunks are kept between frames, only the first chunkCount of each
+        // view are used
+        std::vector<std::unique_ptr<SmallBatchChunkData>> chunks[GeometryFX_FilterMaximumViewCount];
+        int chunkCount[GeometryFX_FilterMaximumViewCount];
+
+        DrawCullResults cullResults;
+        GeometryFX_FilterStatistics statistics;
+    };
+
+    int batchSize_;
+    int batchCount_;
+
+    std::vector<std::unique_ptr<Range>> ranges_;
+    std::vector<const SmallBatchChunkData *> chunks_[GeometryFX_FilterMaximumViewCount];
+};
+}
+}
+
+#endif // AMD_GEOMETRYFX_SMALL_BATCH_PACKING_H
@@ -0,0 +1,481 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXTriangleCulling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "GeometryFXWorkerPool.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// MSVC accepts AVX2 intrinsics in any function, other compilers only if the
+// whole file is compiled for AVX2
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define AMD_GEOMETRY_FX_ENABLE_TRIANGLE_CULLING_AVX2 1
+#endif
+#endif
+
+#ifndef AMD_GEOMETRY_FX_ENABLE_TRIANGLE_CULLING_AVX2
+#define AMD_GEOMETRY_FX_ENABLE_TRIANGLE_CULLING_AVX2 0
+#endif
+
+#ifdef min
+#undef min
+#endif
+
+#ifdef max
+#undef max
+#endif
+
+using namespace DirectX;
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+/**
+Transform a position with w = 1 to clip space. Both kernels use this order
+of operations, so they round the same way. z is not needed for culling.
+*/
+XMFLOAT4 TransformPosition(const float *position, const XMFLOAT4X4 &m)
+{
+    XMFLOAT4 result;
+    result.x = (position[0] * m._11 + position[1] * m._21) + (position[2] * m._31 + m._41);
+    result.y = (position[0] * m._12 + position[1] * m._22) + (position[2] * m._32 + m._42);
+    result.z = 0;
+    result.w = (position[0] * m._14 + position[1] * m._24) + (position[2] * m._34 + m._44);
+
+    return result;
+}
+
+int CullTrianglesReference(const TriangleCullingView &view, const float *vertices,
+    const uint32 *indices, const int triangleCount, uint32 *output)
+{
+    XMFLOAT4X4 worldViewProjection;
+    XMStoreFloat4x4(&worldViewProjection, view.worldViewProjection);
+
+    int keptTriangleCount = 0;
+
+    for (int triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        const uint32 triangleIndices[3] =
+        {
+            indices[triangle * 3 + 0],
+            indices[triangle * 3 + 1],
+            indices[triangle * 3 + 2]
+        };
+
+        XMFLOAT4 clipVertices[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            clipVertices[i] = TransformPosition(vertices + triangleIndices[i] * 3,
+                worldViewProjection);
+        }
+
+        if (!CullTriangle(triangleIndices, clipVertices, view.cullFlags,
+            view.windowWidth, view.windowHeight))
+        {
+            output[keptTriangleCount * 3 + 0] = triangleIndices[0];
+            output[keptTriangleCount * 3 + 1] = triangleIndices[1];
+            output[keptTriangleCount * 3 + 2] = triangleIndices[2];
+            ++keptTriangleCount;
+        }
+    }
+
+    return keptTriangleCount;
+}
+
+#if AMD_GEOMETRY_FX_ENABLE_TRIANGLE_CULLING_AVX2
+/**
+Float to integer conversion with the clamping of CullTriangle. The hardware
+conversion returns 0x80000000 for values out of range and NaN.
+*/
+__m256i FloatToInt(const __m256 value)
+{
+    const __m256i result = _mm256_blendv_epi8(_mm256_cvttps_epi32(value),
+        _mm256_set1_epi32(0x7FFFFFFF),
+        _mm256_castps_si256(_mm256_cmp_ps(value, _mm256_set1_ps(2147483648.0f), _CMP_GE_OQ)));
+
+    return _mm256_and_si256(result,
+        _mm256_castps_si256(_mm256_cmp_ps(value, value, _CMP_ORD_Q)));
+}
+
+/**
+Unsigned a < b
+*/
+__m256i CompareLessUnsigned(const __m256i a, const __m256i b)
+{
+    const __m256i signBit = _mm256_set1_epi32(static_cast<int>(0x80000000));
+    return _mm256_cmpgt_epi32(_mm256_xor_si256(b, signBit), _mm256_xor_si256(a, signBit));
+}
+
+/**
+The small primitive test of CullTriangle for one axis, on the screen space
+coordinates of the three vertices.
+*/
+__m256 IsSmallPrimitive(const __m256 screenSpace[3])
+{
+    const __m256 subpixelSamples = _mm256_set1_ps(256.0f);
+
+    __m256i minimum = _mm256_set1_epi32(1 << 30);
+    __m256i maximum = _mm256_set1_epi32(-(1 << 30));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const __m256i subpixel = FloatToInt(_mm256_mul_ps(screenSpace[i], subpixelSamples));
+        minimum = _mm256_min_epi32(subpixel, minimum);
+        maximum = _mm256_max_epi32(subpixel, maximum);
+    }
+
+    const __m256i subpixelMask = _mm256_set1_epi32(0xFF);
+    const __m256i halfSample = _mm256_set1_epi32(128);
+
+    const __m256i fractionAboveCenter =
+        _mm256_cmpgt_epi32(_mm256_and_si256(minimum, subpixelMask), halfSample);
+    const __m256i narrowerThanSample = CompareLessUnsigned(
+        _mm256_sub_epi32(maximum,
+            _mm256_add_epi32(_mm256_andnot_si256(subpixelMask, minimum), halfSample)),
+        _mm256_set1_epi32(255));
+
+    return _mm256_castsi256_ps(_mm256_and_si256(fractionAboveCenter, narrowerThanSample));
+}
+
+int CullTrianglesAVX2(const TriangleCullingView &view, const float *vertices,
+    const uint32 *indices, const int triangleCount, uint32 *output)
+{
+    XMFLOAT4X4 worldViewProjection;
+    XMStoreFloat4x4(&worldViewProjection, view.worldViewProjection);
+
+    // Columns x, y and w of the matrix
+    __m256 matrix[4][3];
+    for (int row = 0; row < 4; ++row)
+    {
+        matrix[row][0] = _mm256_set1_ps(worldViewProjection.m[row][0]);
+        matrix[row][1] = _mm256_set1_ps(worldViewProjection.m[row][1]);
+        matrix[row][2] = _mm256_set1_ps(worldViewProjection.m[row][3]);
+    }
+
+    const uint32 cullFlags = view.cullFlags;
+    const __m256 windowWidth = _mm256_set1_ps(static_cast<float>(view.windowWidth));
+    const __m256 windowHeight = _mm256_set1_ps(static_cast<float>(view.windowHeight));
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 guardBandMin = _mm256_set1_ps(-static_cast<float>(1 << 23));
+    const __m256 guardBandMax = _mm256_set1_ps(static_cast<float>(1 << 23));
+
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i triangleStride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+    int keptTriangleCount = 0;
+
+    for (int first = 0; first < triangleCount; first += 8)
+    {
+        const int count = std::min(8, triangleCount - first);
+        const __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(count), lane);
+        const int *triangleIndices = reinterpret_cast<const int *>(indices + first * 3);
+
+        // Lanes past the end read vertex 0, and are never kept
+        __m256i index[3];
+        __m256 x[3], y[3], w[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            index[i] = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(),
+                triangleIndices + i, triangleStride, valid, 4);
+
+            const __m256i offset = _mm256_add_epi32(_mm256_add_epi32(index[i], index[i]), index[i]);
+            const __m256 px = _mm256_i32gather_ps(vertices + 0, offset, 4);
+            const __m256 py = _mm256_i32gather_ps(vertices + 1, offset, 4);
+            const __m256 pz = _mm256_i32gather_ps(vertices + 2, offset, 4);
+
+            __m256 *clip[3] = { &x[i], &y[i], &w[i] };
+            for (int c = 0; c < 3; ++c)
+            {
+                *clip[c] = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(px, matrix[0][c]), _mm256_mul_ps(py, matrix[1][c])),
+                    _mm256_add_ps(_mm256_mul_ps(pz, matrix[2][c]), matrix[3][c]));
+            }
+        }
+
+        __m256 cull = zero;
+
+        if (cullFlags & GeometryFX_FilterDuplicateIndices)
+        {
+            cull = _mm256_castsi256_ps(_mm256_or_si256(_mm256_or_si256(
+                _mm256_cmpeq_epi32(index[0], index[1]),
+                _mm256_cmpeq_epi32(index[1], index[2])),
+                _mm256_cmpeq_epi32(index[0], index[2])));
+        }
+
+        if (cullFlags & GeometryFX_FilterBackface)
+        {
+            const __m256 determinant = _mm256_add_ps(_mm256_sub_ps(
+                _mm256_mul_ps(x[0], _mm256_sub_ps(_mm256_mul_ps(y[1], w[2]), _mm256_mul_ps(w[1], y[2]))),
+                _mm256_mul_ps(y[0], _mm256_sub_ps(_mm256_mul_ps(x[1], w[2]), _mm256_mul_ps(w[1], x[2])))),
+                _mm256_mul_ps(w[0], _mm256_sub_ps(_mm256_mul_ps(x[1], y[2]), _mm256_mul_ps(y[1], x[2]))));
+
+            cull = _mm256_or_ps(cull, _mm256_cmp_ps(determinant, zero, _CMP_GT_OQ));
+        }
+
+        if (cullFlags & (GeometryFX_FilterSmallPrimitives | GeometryFX_FilterFrustum))
+        {
+            // Normalized 0..1 screen space
+            __m256 sx[3], sy[3];
+            __m256 anyBehind = zero;
+            __m256 allBehind = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            for (int i = 0; i < 3; ++i)
+            {
+                sx[i] = _mm256_add_ps(_mm256_div_ps(_mm256_div_ps(x[i], w[i]), two), half);
+                sy[i] = _mm256_add_ps(_mm256_div_ps(_mm256_div_ps(y[i], w[i]), two), half);
+
+                const __m256 behind = _mm256_cmp_ps(w[i], zero, _CMP_LT_OQ);
+                anyBehind = _mm256_or_ps(anyBehind, behind);
+                allBehind = _mm256_and_ps(allBehind, behind);
+            }
+
+            if (cullFlags & GeometryFX_FilterSmallPrimitives)
+            {
+                __m256 screenSpaceX[3], screenSpaceY[3];
+                __m256 outsideGuardBand = zero;
+
+                for (int i = 0; i < 3; ++i)
+                {
+                    screenSpaceX[i] = _mm256_mul_ps(sx[i], windowWidth);
+                    screenSpaceY[i] = _mm256_mul_ps(sy[i], windowHeight);
+
+                    outsideGuardBand = _mm256_or_ps(outsideGuardBand, _mm256_or_ps(
+                        _mm256_or_ps(_mm256_cmp_ps(screenSpaceX[i], guardBandMin, _CMP_LT_OQ),
+                            _mm256_cmp_ps(screenSpaceX[i], guardBandMax, _CMP_GT_OQ)),
+                        _mm256_or_ps(_mm256_cmp_ps(screenSpaceY[i], guardBandMin, _CMP_LT_OQ),
+                            _mm256_cmp_ps(screenSpaceY[i], guardBandMax, _CMP_GT_OQ))));
+                }
+
+                const __m256 small = _mm256_or_ps(
+                    IsSmallPrimitive(screenSpaceX), IsSmallPrimitive(screenSpaceY));
+
+                cull = _mm256_or_ps(cull,
+                    _mm256_andnot_ps(_mm256_or_ps(anyBehind, outsideGuardBand), small));
+            }
+
+            if (cullFlags & GeometryFX_FilterFrustum)
+            {
+                // Operand order matches std::min and std::max if a
+                // coordinate is NaN
+                const __m256 minX = _mm256_min_ps(sx[2], _mm256_min_ps(sx[1], sx[0]));
+                const __m256 minY = _mm256_min_ps(sy[2], _mm256_min_ps(sy[1], sy[0]));
+                const __m256 maxX = _mm256_max_ps(sx[2], _mm256_max_ps(sx[1], sx[0]));
+                const __m256 maxY = _mm256_max_ps(sy[2], _mm256_max_ps(sy[1], sy[0]));
+
+                const __m256 outside = _mm256_or_ps(
+                    _mm256_or_ps(_mm256_cmp_ps(maxX, zero, _CMP_LT_OQ),
+                        _mm256_cmp_ps(maxY, zero, _CMP_LT_OQ)),
+                    _mm256_or_ps(_mm256_cmp_ps(minX, one, _CMP_GT_OQ),
+                        _mm256_cmp_ps(minY, one, _CMP_GT_OQ)));
+
+                cull = _mm256_or_ps(cull,
+                    _mm256_or_ps(allBehind, _mm256_andnot_ps(anyBehind, outside)));
+            }
+        }
+
+        const int keepMask = _mm256_movemask_ps(
+            _mm256_andnot_ps(cull, _mm256_castsi256_ps(valid)));
+
+        // Every triangle is written, but only kept ones advance the output.
+        // The output never overtakes the input, so both may be the same.
+        for (int i = 0; i < count; ++i)
+        {
+            const uint32 *triangle = indices + (first + i) * 3;
+            const uint32 i0 = triangle[0], i1 = triangle[1], i2 = triangle[2];
+
+            output[keptTriangleCount * 3 + 0] = i0;
+            output[keptTriangleCount * 3 + 1] = i1;
+            output[keptTriangleCount * 3 + 2] = i2;
+            keptTriangleCount += (keepMask >> i) & 1;
+        }
+    }
+
+    return keptTriangleCount;
+}
+#endif
+
+TriangleCullingKernel DetectTriangleCullingKernel()
+{
+#if AMD_GEOMETRY_FX_ENABLE_TRIANGLE_CULLING_AVX2
+#ifdef _MSC_VER
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 0);
+
+    if (cpuInfo[0] >= 7)
+    {
+        __cpuid(cpuInfo, 1);
+
+        const bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+        const bool avx = (cpuInfo[2] & (1 << 28)) != 0;
+
+        __cpuidex(cpuInfo, 7, 0);
+
+        const bool avx2 = (cpuInfo[1] & (1 << 5)) != 0;
+
+        // The OS must save the YMM registers on context switches
+        if (osxsave && avx && avx2 && (_xgetbv(0) & 0x6) == 0x6)
+        {
+            return TRIANGLE_CULLING_KERNEL_AVX2;
+        }
+    }
+#else
+    // Compiled with -mavx2, so the CPU is required to support it
+    return TRIANGLE_CULLING_KERNEL_AVX2;
+#endif
+#endif
+
+    return TRIANGLE_CULLING_KERNEL_REFERENCE;
+}
+
+/**
+The matrices of the constant buffers are packed, so they are loaded without
+assuming any alignment.
+*/
+XMMATRIX LoadMatrix(const XMMATRIX &matrix)
+{
+    return XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4 *>(&matrix));
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+TriangleCullingKernel GetTriangleCullingKernel()
+{
+    static const TriangleCullingKernel kernel = DetectTriangleCullingKernel();
+    return kernel;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int CullTriangles(const TriangleCullingView &view, const float *vertices,
+    const uint32 *indices, const int triangleCount, uint32 *output)
+{
+    return CullTriangles(view, vertices, indices, triangleCount,
+        GetTriangleCullingKernel(), output);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int CullTriangles(const TriangleCullingView &view, const float *vertices,
+    const uint32 *indices, const int triangleCount, const TriangleCullingKernel kernel,
+    uint32 *output)
+{
+    switch (std::min(kernel, GetTriangleCullingKernel()))
+    {
+#if AMD_GEOMETRY_FX_ENABLE_TRIANGLE_CULLING_AVX2
+    case TRIANGLE_CULLING_KERNEL_AVX2:
+        return CullTrianglesAVX2(view, vertices, indices, triangleCount, output);
+#endif
+
+    default:
+        return CullTrianglesReference(view, vertices, indices, triangleCount, output);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void CullSmallBatchChunk(WorkerPool &pool, const FrameConstantBuffer &frame,
+    const void *vertexData, const uint32 *indexData, const MeshConstants *meshConstants,
+    const SmallBatchChunkData &chunk, std::vector<uint32> &filteredIndices,
+    std::vector<IndirectArguments> &indirectArguments)
+{
+    const int batchCount = chunk.GetBatchCount();
+    const SmallBatchData *smallBatches = chunk.GetSmallBatchData().data();
+    const DrawCallArguments *drawCallArguments = chunk.GetDrawCallArguments().data();
+
+    // Indices past the count of a draw are left undefined, as on the GPU
+    filteredIndices.resize(chunk.GetMaximumBatchCount() * chunk.GetBatchSize() * 3);
+    indirectArguments.resize(chunk.GetMaximumBatchCount());
+
+    for (auto it = indirectArguments.begin(), end = indirectArguments.end(); it != end; ++it)
+    {
+        IndirectArguments::Init(*it);
+    }
+
+    const XMMATRIX projection = LoadMatrix(frame.projection);
+
+    // Each batch first writes its triangles to its own slot in the output
+    // range of its draw, so the batches can run in any order
+    const uint32 batchIndexCount = chunk.GetBatchSize() * 3;
+    std::vector<uint32> keptTriangleCounts(batchCount);
+
+    pool.ParallelFor(batchCount, [&](const int batch, const int)
+    {
+        const SmallBatchData &smallBatch = smallBatches[batch];
+        const MeshConstants &mesh = meshConstants[smallBatch.meshIndex];
+
+        TriangleCullingView view;
+        view.worldViewProjection = XMMatrixMultiply(
+            LoadMatrix(drawCallArguments[smallBatch.drawIndex].worldView), projection);
+        view.cullFlags = frame.cullFlags;
+        view.windowWidth = frame.width;
+        view.windowHeight = frame.height;
+
+        const uint32 slot = smallBatch.outputIndexOffset / 4
+            + (batch - smallBatch.drawBatchStart) * batchIndexCount;
+        assert(slot + smallBatch.faceCount * 3 <= filteredIndices.size());
+
+        keptTriangleCounts[batch] = CullTriangles(view,
+            reinterpret_cast<const float *>(static_cast<const uint8 *>(vertexData) + mesh.vertexOffset),
+            indexData + (mesh.indexOffset + smallBatch.indexOffset) / 4,
+            smallBatch.faceCount, filteredIndices.data() + slot);
+    });
+
+    // Then the triangles of each draw are moved together, in batch order
+    for (int batch = 0; batch < batchCount; ++batch)
+    {
+        const SmallBatchData &smallBatch = smallBatches[batch];
+        IndirectArguments &arguments = indirectArguments[smallBatch.drawIndex];
+
+        const uint32 slot = smallBatch.outputIndexOffset / 4
+            + (batch - smallBatch.drawBatchStart) * batchIndexCount;
+        const uint32 target = smallBatch.outputIndexOffset / 4 + arguments.IndexCountPerInstance;
+
+        if (target != slot)
+        {
+            ::memmove(filteredIndices.data() + target, filteredIndices.data() + slot,
+                keptTriangleCounts[batch] * 3 * sizeof(uint32));
+        }
+
+        arguments.IndexCountPerInstance += keptTriangleCounts[batch] * 3;
+
+        if (static_cast<uint32>(batch) == smallBatch.drawBatchStart)
+        {
+            arguments.StartIndexLocation = smallBatch.outputIndexOffset / 4;
+            arguments.BaseVertexLocation = meshConstants[smallBatch.meshIndex].vertexOffset / 12;
+            arguments.StartInstanceLocation = smallBatch.drawIndex;
+        }
+    }
+}
+}
+}
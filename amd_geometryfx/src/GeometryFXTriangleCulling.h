@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_TRIANGLE_CULLING_H
+#define AMD_GEOMETRYFX_TRIANGLE_CULLING_H
+
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "AMD_Types.h"
+#include "GeometryFXReferenceFilter.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+class WorkerPool;
+
+enum TriangleCullingKernel
+{
+    TRIANGLE_CULLING_KERNEL_REFERENCE,
+    TRIANGLE_CULLING_KERNEL_AVX2
+};
+
+struct TriangleCullingView
+{
+    DirectX::XMMATRIX worldViewProjection;
+    uint32 cullFlags;
+    uint32 windowWidth, windowHeight;
+};
+
+/**
+Cull triangles on the CPU with the tests of the filter shader, see
+CullTriangle. vertices points to float3 positions, indices to triangleCount
+triangles. The indices of the triangles which pass are written to output,
+which must have room for all triangles, in their original order. Returns the
+number of triangles written. output may be the same as indices.
+
+The AVX2 kernel tests eight triangles at a time and makes the same decisions
+as the reference kernel. Both transform the vertices with a single matrix
+instead of the two the shader uses, so they may differ from the shader for
+triangles right at a decision boundary. The widest kernel supported by the
+CPU is selected on first use.
+*/
+int CullTriangles(const TriangleCullingView &view, const float *vertices,
+    const uint32 *indices, const int triangleCount, uint32 *output);
+
+/**
+Same as CullTriangles, but always uses the given kernel. If the CPU does not
+support it, the reference kernel is used instead.
+*/
+int CullTriangles(const TriangleCullingView &view, const float *vertices,
+    const uint32 *indices, const int triangleCount, const TriangleCullingKernel kernel,
+    uint32 *output);
+
+/**
+The widest kernel the CPU and the operating system support.
+*/
+TriangleCullingKernel GetTriangleCullingKernel();
+
+/**
+Filter one packed chunk with CullTriangles on the worker threads, producing
+the same filtered indices and indirect arguments as FilterSmallBatchChunk.
+This allows skipping the filter dispatch when the GPU is the bottleneck.
+*/
+void CullSmallBatchChunk(WorkerPool &pool, const FrameConstantBuffer &frame,
+    const void *vertexData, const uint32 *indexData, const MeshConstants *meshConstants,
+    const SmallBatchChunkData &chunk, std::vector<uint32> &filteredIndices,
+    std::vector<IndirectArguments> &indirectArguments);
+}
+}
+
+#endif // AMD_GEOMETRYFX_TRIANGLE_CULLING_H
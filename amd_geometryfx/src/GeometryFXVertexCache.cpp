@@ -0,0 +1,384 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXVertexCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+namespace
+{
+// Tuning values from the original description of the algorithm
+const int OPTIMIZER_CACHE_SIZE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+
+// Valences above this share the score of the last entry
+const int MAX_SCORED_VALENCE = 32;
+
+struct VertexScoreTables
+{
+    VertexScoreTables()
+    {
+        for (int i = 0; i < OPTIMIZER_CACHE_SIZE; ++i)
+        {
+            if (i < 3)
+            {
+                // The vertex was used by the last triangle. Its score is
+                // fixed, so the next triangle does not simply reuse the same
+                // edge.
+                cacheScore[i] = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                const float scaler = 1.0f / (OPTIMIZER_CACHE_SIZE - 3);
+                cacheScore[i] = std::pow(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        // Prefer vertices with few remaining triangles, so they get finished
+        // and leave the cache
+        valenceScore[0] = 0;
+        for (int i = 1; i <= MAX_SCORED_VALENCE; ++i)
+        {
+            valenceScore[i] =
+                VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+        }
+    }
+
+    float cacheScore[OPTIMIZER_CACHE_SIZE];
+    float valenceScore[MAX_SCORED_VALENCE + 1];
+};
+
+const VertexScoreTables &GetVertexScoreTables()
+{
+    static const VertexScoreTables tables;
+    return tables;
+}
+
+float ComputeVertexScore(const int cachePosition, const int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        // No triangle needs this vertex any more
+        return -1.0f;
+    }
+
+    const VertexScoreTables &tables = GetVertexScoreTables();
+
+    const float score = cachePosition >= 0 ? tables.cacheScore[cachePosition] : 0;
+    return score + tables.valenceScore[std::min(remainingTriangles, MAX_SCORED_VALENCE)];
+}
+
+/**
+Count the misses of a FIFO cache with cacheSize entries. insertedAt must
+hold -1 for every vertex and is left modified.
+*/
+int CountCacheMisses(const int32 *indices, const int indexCount, const int cacheSize,
+    int *insertedAt, int *uniqueVertices)
+{
+    // A vertex is in the FIFO as long as fewer than cacheSize misses happened
+    // since it was inserted
+    int misses = 0;
+    int unique = 0;
+
+    for (int i = 0; i < indexCount; ++i)
+    {
+        const int vertex = indices[i];
+
+        if (insertedAt[vertex] < 0)
+        {
+            ++unique;
+        }
+        else if (misses - insertedAt[vertex] < cacheSize)
+        {
+            continue;
+        }
+
+        insertedAt[vertex] = misses;
+        ++misses;
+    }
+
+    if (uniqueVertices)
+    {
+        *uniqueVertices = unique;
+    }
+
+    return misses;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+VertexCacheStatistics SimulateVertexCache(const int32 *indices, const int indexCount,
+    const int vertexCount, const int cacheSize)
+{
+    VertexCacheStatistics result;
+
+    if (indexCount < 3)
+    {
+        return result;
+    }
+
+    assert(std::all_of(indices, indices + indexCount,
+        [vertexCount](const int32 v) { return v >= 0 && v < vertexCount; }));
+
+    std::vector<int> insertedAt(vertexCount, -1);
+    int uniqueVertices = 0;
+    const int misses = CountCacheMisses(indices, indexCount, cacheSize,
+        insertedAt.data(), &uniqueVertices);
+
+    result.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+    result.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+VertexCacheOptimizer::VertexCacheOptimizer(const int vertexCount)
+    : localVertex_(vertexCount, -1)
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void VertexCacheOptimizer::Optimize(int32 *indices, const int triangleCount)
+{
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    const int indexCount = triangleCount * 3;
+
+    // Work on cluster-local vertices, so all arrays stay small
+    globalVertex_.clear();
+    localIndices_.resize(indexCount);
+
+    for (int i = 0; i < indexCount; ++i)
+    {
+        int &local = localVertex_[indices[i]];
+        if (local < 0)
+        {
+            local = static_cast<int>(globalVertex_.size());
+            globalVertex_.push_back(indices[i]);
+        }
+
+        localIndices_[i] = local;
+    }
+
+    const int vertexCount = static_cast<int>(globalVertex_.size());
+
+    remainingTriangles_.assign(vertexCount, 0);
+    for (int i = 0; i < indexCount; ++i)
+    {
+        ++remainingTriangles_[localIndices_[i]];
+    }
+
+    // The triangles of vertex v are adjacency_[adjacencyOffset_[v]] onwards.
+    // The first remainingTriangles_[v] of them are not emitted yet.
+    adjacencyOffset_.resize(vertexCount + 1);
+    adjacencyOffset_[0] = 0;
+    for (int v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffset_[v + 1] = adjacencyOffset_[v] + remainingTriangles_[v];
+    }
+
+    adjacency_.resize(indexCount);
+    cachePosition_.assign(adjacencyOffset_.begin(), adjacencyOffset_.end() - 1);
+    for (int i = 0; i < indexCount; ++i)
+    {
+        adjacency_[cachePosition_[localIndices_[i]]++] = i / 3;
+    }
+
+    cachePosition_.assign(vertexCount, -1);
+
+    vertexScore_.resize(vertexCount);
+    for (int v = 0; v < vertexCount; ++v)
+    {
+        vertexScore_[v] = ComputeVertexScore(-1, remainingTriangles_[v]);
+    }
+
+    triangleScore_.resize(triangleCount);
+    for (int t = 0; t < triangleCount; ++t)
+    {
+        triangleScore_[t] = vertexScore_[localIndices_[t * 3 + 0]]
+            + vertexScore_[localIndices_[t * 3 + 1]]
+            + vertexScore_[localIndices_[t * 3 + 2]];
+    }
+
+    emitted_.assign(triangleCount, false);
+    cache_.clear();
+    reordered_.clear();
+
+    int bestTriangle = -1;
+
+    for (int emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        if (bestTriangle < 0)
+        {
+            // Nothing in the cache has triangles left, start somewhere new
+            float bestScore = -std::numeric_limits<float>::max();
+            for (int t = 0; t < triangleCount; ++t)
+            {
+                if (!emitted_[t] && triangleScore_[t] > bestScore)
+                {
+                    bestScore = triangleScore_[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        emitted_[bestTriangle] = true;
+        reordered_.insert(reordered_.end(),
+            indices + bestTriangle * 3, indices + bestTriangle * 3 + 3);
+
+        const int *triangle = &localIndices_[bestTriangle * 3];
+
+        nextCache_.clear();
+        for (int j = 0; j < 3; ++j)
+        {
+            const int v = triangle[j];
+
+            // Degenerate triangles reference a vertex twice
+            if (j > 0 && (v == triangle[0] || (j == 2 && v == triangle[1])))
+            {
+                continue;
+            }
+
+            nextCache_.push_back(v);
+        }
+
+        for (int j = 0; j < 3; ++j)
+        {
+            const int v = triangle[j];
+
+            // Move the triangle past the end of the active part of the list
+            int *first = &adjacency_[adjacencyOffset_[v]];
+            int *last = first + remainingTriangles_[v] - 1;
+            for (int *it = first; it <= last; ++it)
+            {
+                if (*it == bestTriangle)
+                {
+                    std::swap(*it, *last);
+                    --remainingTriangles_[v];
+                    break;
+                }
+            }
+        }
+
+        for (auto it = cache_.begin(), end = cache_.end(); it != end; ++it)
+        {
+            if (*it != triangle[0] && *it != triangle[1] && *it != triangle[2])
+            {
+                nextCache_.push_back(*it);
+            }
+        }
+
+        // Vertices which fall out of the cache lose their cache score
+        for (int i = OPTIMIZER_CACHE_SIZE; i < static_cast<int>(nextCache_.size()); ++i)
+        {
+            cachePosition_[nextCache_[i]] = -1;
+            UpdateVertexScore(nextCache_[i]);
+        }
+
+        if (static_cast<int>(nextCache_.size()) > OPTIMIZER_CACHE_SIZE)
+        {
+            nextCache_.resize(OPTIMIZER_CACHE_SIZE);
+        }
+
+        cache_.swap(nextCache_);
+
+        for (int i = 0; i < static_cast<int>(cache_.size()); ++i)
+        {
+            cachePosition_[cache_[i]] = i;
+            UpdateVertexScore(cache_[i]);
+        }
+
+        // The next triangle is taken from the ones touching the cache
+        bestTriangle = -1;
+        float bestScore = -std::numeric_limits<float>::max();
+        for (auto it = cache_.begin(), end = cache_.end(); it != end; ++it)
+        {
+            const int *adjacent = &adjacency_[adjacencyOffset_[*it]];
+            for (int i = 0; i < remainingTriangles_[*it]; ++i)
+            {
+                const int t = adjacent[i];
+                if (triangleScore_[t] > bestScore
+                    || (triangleScore_[t] == bestScore && t < bestTriangle))
+                {
+                    bestScore = triangleScore_[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    // The greedy order is not always better, for instance for strip-like
+    // input. Keep the input order unless the new one has fewer misses.
+    insertedAt_.assign(vertexCount, -1);
+    const int inputMisses = CountCacheMisses(localIndices_.data(), indexCount,
+        VERTEX_CACHE_SIMULATION_SIZE, insertedAt_.data(), nullptr);
+
+    for (int i = 0; i < indexCount; ++i)
+    {
+        localIndices_[i] = localVertex_[reordered_[i]];
+    }
+
+    insertedAt_.assign(vertexCount, -1);
+    const int reorderedMisses = CountCacheMisses(localIndices_.data(), indexCount,
+        VERTEX_CACHE_SIMULATION_SIZE, insertedAt_.data(), nullptr);
+
+    if (reorderedMisses < inputMisses)
+    {
+        std::copy(reordered_.begin(), reordered_.end(), indices);
+    }
+
+    for (auto it = globalVertex_.begin(), end = globalVertex_.end(); it != end; ++it)
+    {
+        localVertex_[*it] = -1;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void VertexCacheOptimizer::UpdateVertexScore(const int vertex)
+{
+    const float score = ComputeVertexScore(cachePosition_[vertex], remainingTriangles_[vertex]);
+    const float delta = score - vertexScore_[vertex];
+
+    const int *adjacent = &adjacency_[adjacencyOffset_[vertex]];
+    for (int i = 0; i < remainingTriangles_[vertex]; ++i)
+    {
+        triangleScore_[adjacent[i]] += delta;
+    }
+
+    vertexScore_[vertex] = score;
+}
+}
+}
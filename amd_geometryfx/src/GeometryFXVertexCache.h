@@ -0,0 +1,108 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_VERTEX_CACHE_H
+#define AMD_GEOMETRYFX_VERTEX_CACHE_H
+
+#include <vector>
+
+#include "AMD_Types.h"
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+struct VertexCacheStatistics
+{
+    inline VertexCacheStatistics()
+        : acmr(0)
+        , atvr(0)
+    {
+    }
+
+    // Average cache miss ratio: vertex shader invocations per triangle.
+    // Ranges from 3 (no reuse) down to about 0.5 for large regular meshes.
+    float acmr;
+
+    // Average transform to vertex ratio: vertex shader invocations per
+    // unique vertex. 1 is optimal.
+    float atvr;
+};
+
+// Number of entries of the FIFO cache modelled by SimulateVertexCache. This
+// is a conservative estimate for current hardware.
+const int VERTEX_CACHE_SIMULATION_SIZE = 16;
+
+/**
+Count the vertex shader invocations of a triangle list on a FIFO
+post-transform cache with cacheSize entries.
+*/
+VertexCacheStatistics SimulateVertexCache(const int32 *indices, const int indexCount,
+    const int vertexCount, const int cacheSize);
+
+/**
+Reorders triangles for post-transform vertex cache locality, using Tom
+Forsyth's "Linear-Speed Vertex Cache Optimisation".
+
+Only the order of whole triangles changes; each triangle keeps its indices
+and winding. The optimizer is meant to be run on each cluster separately, so
+cluster membership is preserved and the cluster bounds stay valid.
+The input order is kept if the optimized one does not simulate better.
+*/
+class VertexCacheOptimizer
+{
+public:
+    explicit VertexCacheOptimizer(const int vertexCount);
+
+    /**
+    Reorder the triangleCount triangles starting at indices in place.
+    */
+    void Optimize(int32 *indices, const int triangleCount);
+
+private:
+    VertexCacheOptimizer(const VertexCacheOptimizer &);
+    VertexCacheOptimizer &operator=(const VertexCacheOptimizer &);
+
+    void UpdateVertexScore(const int vertex);
+
+    // Maps mesh vertices to cluster-local ones, -1 if unused. Restored after
+    // each call, so it is only cleared once.
+    std::vector<int> localVertex_;
+    std::vector<int> globalVertex_;
+
+    std::vector<int> localIndices_;
+    std::vector<int> adjacencyOffset_;
+    std::vector<int> adjacency_;
+    std::vector<int> remainingTriangles_;
+    std::vector<int> cachePosition_;
+    std::vector<float> vertexScore_;
+    std::vector<float> triangleScore_;
+    std::vector<bool> emitted_;
+    std::vector<int> cache_;
+    std::vector<int> nextCache_;
+    std::vector<int32> reordered_;
+    std::vector<int> insertedAt_;
+};
+}
+}
+
+#endif // AMD_GEOMETRYFX_VERTEX_CACHE_H
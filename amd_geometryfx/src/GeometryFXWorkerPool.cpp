@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "GeometryFXWorkerPool.h"
+
+#include <cassert>
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+///////////////////////////////////////////////////////////////////////////////
+WorkerPool::WorkerPool(const int threadCount)
+    : function_(nullptr)
+    , itemCount_(0)
+    , nextItem_(0)
+    , activeWorkers_(0)
+    , generation_(0)
+    , shutdown_(false)
+{
+    assert(threadCount >= 0);
+
+    int totalThreadCount = threadCount;
+    if (totalThreadCount == 0)
+    {
+        totalThreadCount = static_cast<int>(std::thread::hardware_concurrency());
+    }
+
+    for (int i = 1; i < totalThreadCount; ++i)
+    {
+        workers_.emplace_back(&WorkerPool::WorkerMain, this, i);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutdown_ = true;
+    }
+
+    workAvailable_.notify_all();
+
+    for (std::vector<std::thread>::iterator it = workers_.begin(), end = workers_.end();
+         it != end; ++it)
+    {
+        it->join();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int WorkerPool::GetThreadCount() const
+{
+    return static_cast<int>(workers_.size()) + 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WorkerPool::ParallelFor(
+    const int count, const std::function<void (const int, const int)> &function)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+
+    // Not worth waking up the workers
+    if (workers_.empty() || count == 1)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            function(i, 0);
+        }
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        function_ = &function;
+        itemCount_ = count;
+        nextItem_ = 0;
+        activeWorkers_ = static_cast<int>(workers_.size());
+        ++generation_;
+    }
+
+    workAvailable_.notify_all();
+
+    RunItems(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    workDone_.wait(lock, [this]() { return activeWorkers_ == 0; });
+    function_ = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WorkerPool::WorkerMain(const int threadIndex)
+{
+    unsigned int lastGeneration = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workAvailable_.wait(lock,
+                [&]() { return shutdown_ || generation_ != lastGeneration; });
+
+            if (shutdown_)
+            {
+                return;
+            }
+
+            lastGeneration = generation_;
+        }
+
+        RunItems(threadIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--activeWorkers_ == 0)
+            {
+                workDone_.notify_one();
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void WorkerPool::RunItems(const int threadIndex)
+{
+    for (;;)
+    {
+        const int item = nextItem_++;
+        if (item >= itemCount_)
+        {
+            break;
+        }
+
+        (*function_)(item, threadIndex);
+    }
+}
+
+} // namespace GeometryFX_Internal
+} // namespace AMD
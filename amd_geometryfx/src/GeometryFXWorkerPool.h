@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#ifndef AMD_GEOMETRYFX_WORKER_POOL_H
+#define AMD_GEOMETRYFX_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AMD
+{
+namespace GeometryFX_Internal
+{
+
+/**
+A fixed set of worker threads which execute parallel loops.
+
+The thread calling ParallelFor() takes part in the loop, so a pool with a
+thread count of 1 has no worker threads and runs everything inline.
+*/
+class WorkerPool
+{
+public:
+    /**
+    If threadCount is 0, one thread per hardware thread is used.
+    */
+    explicit WorkerPool(const int threadCount);
+    ~WorkerPool();
+
+    /**
+    Number of threads taking part in a loop, including the calling thread.
+    */
+    int GetThreadCount() const;
+
+    /**
+    Call function(item, threadIndex) for each item in [0, count), and block
+    until all calls have returned.
+
+    threadIndex is in [0, GetThreadCount()) and is unique among the calls
+    running concurrently, so it can be used to index per-thread storage.
+    The calling thread always has the thread index 0. Items are handed out
+    in increasing order, but may complete in any order.
+    */
+    void ParallelFor(const int count, const std::function<void (const int, const int)> &function);
+
+private:
+    WorkerPool(const WorkerPool &);
+    WorkerPool &operator=(const WorkerPool &);
+
+    void WorkerMain(const int threadIndex);
+    void RunItems(const int threadIndex);
+
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable workDone_;
+
+    const std::function<void (const int, const int)> *function_;
+    int itemCount_;
+    std::atomic<int> nextItem_;
+    int activeWorkers_;
+    unsigned int generation_;
+    bool shutdown_;
+};
+
+} // namespace GeometryFX_Internal
+} // namespace AMD
+
+#endif // AMD_GEOMETRYFX_WORKER_POOL_H
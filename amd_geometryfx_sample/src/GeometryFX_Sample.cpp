@@ -53,6 +53,7 @@
 #include <fstream>
 #include <random>
 #include <functional>
+#include <chrono>
 
 #include "AMD_GeometryFX_Filtering.h"
 #include "AMD_GeometryFX_Utility.h"
@@ -358,11 +359,46 @@ void GenerateGeometryChunk(
     }
 }
 
+/**
+Set the data for all meshes in one go and measure how long it takes.
+*/
+double SetMeshDataTimed(AMD::GeometryFX_Filter &meshManager,
+    const std::vector<AMD::GeometryFX_Filter::MeshHandle> &handles,
+    const std::vector<const void *> &vertexData, const std::vector<const void *> &indexData)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    meshManager.SetMeshData(static_cast<int>(handles.size()), handles.data(),
+        vertexData.data(), indexData.data());
+
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/**
+Tag every mesh with at most occluderTriangleLimit triangles as occluder.
+This must happen between registering the meshes and setting their data.
+*/
+void TagOccluders(AMD::GeometryFX_Filter &meshManager,
+    const std::vector<AMD::GeometryFX_Filter::MeshHandle> &handles,
+    const std::vector<int> &indexCountPerMesh, const int occluderTriangleLimit)
+{
+    for (std::size_t i = 0; i < handles.size(); ++i)
+    {
+        if (indexCountPerMesh[i] / 3 <= occluderTriangleLimit)
+        {
+            meshManager.SetMeshOccluder(handles[i], true);
+        }
+    }
+}
+
 /**
 Create test geometry.
 */
 std::vector<AMD::GeometryFX_Filter::MeshHandle> CreateGeometry(
-    const int chunkCount, const int chunkSize, const int chunkSizeVariance, AMD::GeometryFX_Filter &meshManager)
+    const int chunkCount, const int chunkSize, const int chunkSizeVariance, AMD::GeometryFX_Filter &meshManager,
+    const int occluderTriangleLimit, double &setMeshDataTime)
 {
     std::vector<std::vector<float>> positions(chunkCount);
     std::vector<std::vector<int>> indices(chunkCount);
@@ -385,16 +421,24 @@ std::vector<AMD::GeometryFX_Filter::MeshHandle> CreateGeometry(
     const auto handles =
         meshManager.RegisterMeshes(chunkCount, vertexCountPerMesh.data(), indexCountPerMesh.data());
 
+    TagOccluders(meshManager, handles, indexCountPerMesh, occluderTriangleLimit);
+
+    std::vector<const void *> vertexData;
+    std::vector<const void *> indexData;
     for (int i = 0; i < chunkCount; ++i)
     {
-        meshManager.SetMeshData(handles[i], positions[i].data(), indices[i].data());
+        vertexData.push_back(positions[i].data());
+        indexData.push_back(indices[i].data());
     }
 
+    setMeshDataTime = SetMeshDataTimed(meshManager, handles, vertexData, indexData);
+
     return handles;
 }
 
 std::vector<AMD::GeometryFX_Filter::MeshHandle> LoadGeometry(
-    const char *filename, AMD::GeometryFX_Filter &meshManager, const int chunkSize = 65535)
+    const char *filename, AMD::GeometryFX_Filter &meshManager, const int occluderTriangleLimit,
+    double &setMeshDataTime, const int chunkSize = 65535)
 {
     const auto propertyStore = aiCreatePropertyStore ();
     aiSetImportPropertyInteger (propertyStore,
@@ -424,21 +468,29 @@ std::vector<AMD::GeometryFX_Filter::MeshHandle> LoadGeometry(
         auto handles =
             meshManager.RegisterMeshes(pScene->mNumMeshes, vertexCounts.data(), indexCounts.data());
 
+        TagOccluders(meshManager, handles, indexCounts, occluderTriangleLimit);
+
+        std::vector<std::vector<int>> indices(pScene->mNumMeshes);
+        std::vector<const void *> vertexData;
+        std::vector<const void *> indexData;
         for (unsigned int i = 0; i < pScene->mNumMeshes; ++i)
         {
             // The mesh is triangulated, so we can use 3 indices per face here
-            std::vector<int> indices(pScene->mMeshes[i]->mNumFaces * 3);
+            indices[i].resize(pScene->mMeshes[i]->mNumFaces * 3);
             for (unsigned j = 0; j < pScene->mMeshes[i]->mNumFaces; ++j)
             {
                 for (int k = 0; k < 3; ++k)
                 {
-                    indices[j * 3 + k] = pScene->mMeshes[i]->mFaces[j].mIndices[k];
+                    indices[i][j * 3 + k] = pScene->mMeshes[i]->mFaces[j].mIndices[k];
                 }
             }
 
-            meshManager.SetMeshData(handles[i], pScene->mMeshes[i]->mVertices, indices.data());
+            vertexData.push_back(pScene->mMeshes[i]->mVertices);
+            indexData.push_back(indices[i].data());
         }
 
+        setMeshDataTime = SetMeshDataTimed(meshManager, handles, vertexData, indexData);
+
         aiReleaseImport (pScene);
         aiReleasePropertyStore (propertyStore);
 
@@ -463,9 +515,31 @@ class Application
         , frontfaceCoverage(0.5f)
         , useCameraForBenchmark(false)
         , emulateMultiIndirectDraw(false)
+        , buildSpatialClusters(false)
+        , minimalNormalCones(false)
+        , optimizeVertexCache(false)
+        , buildClusterLod(false)
+        , lodErrorThreshold(0)
+        , maximumDrawDistance(0)
+        , minimumProjectedSize(0)
+        , occluderTriangleLimit(0)
+        , temporalOcclusion(false)
+        , sortDrawsByMesh(false)
+        , mergeClusterBatches(false)
+        , occlusionBufferWidth(256)
+        , occlusionBufferHeight(128)
+        , workerThreadCount(0)
+        , smallBatchSize(256)
+        , smallBatchCount(384)
+        , singleDispatchFiltering(false)
+        , singleDispatchMemoryLimit(64)
         , shadowMapResolution(-1)
+        , meshTriangleCount(0)
+        , cachedMeshCount(0)
+        , setMeshDataTime(0)
         , pipelineStatsTrianglesIn(0)
         , pipelineStatsTrianglesOut(0)
+        , pendingStatisticsPass(-1)
         , enabledFilters(0xFFFFFFFF)
         , benchmarkMode(false)
         , benchmarkFrameCount(32)
@@ -487,12 +561,51 @@ class Application
     float frontfaceCoverage;
     bool useCameraForBenchmark;
     bool emulateMultiIndirectDraw;
+    bool buildSpatialClusters;
+    bool minimalNormalCones;
+    bool optimizeVertexCache;
+    bool buildClusterLod;
+    float lodErrorThreshold;
+    float maximumDrawDistance;
+    float minimumProjectedSize;
+    int occluderTriangleLimit;
+    bool temporalOcclusion;
+    bool sortDrawsByMesh;
+    bool mergeClusterBatches;
+    int occlusionBufferWidth;
+    int occlusionBufferHeight;
+    int workerThreadCount;
+    int smallBatchSize;
+    int smallBatchCount;
+    bool singleDispatchFiltering;
+    int singleDispatchMemoryLimit;
     int shadowMapResolution;
 
+    AMD::GeometryFX_ClusterStatistics clusterStatistics;
+    int64_t meshTriangleCount;
+    int cachedMeshCount;
+    double setMeshDataTime;
+
     int64_t pipelineStatsTrianglesIn;
     int64_t pipelineStatsTrianglesOut;
     int64_t pipelineStatsClustersIn;
     int64_t pipelineStatsClustersOut;
+    int64_t pipelineStatsClustersFrustumCulled;
+    int64_t pipelineStatsClustersBackfaceCulled;
+    int64_t pipelineStatsClustersOcclusionCulled;
+    int64_t pipelineStatsOccluderTriangles;
+    int64_t pipelineStatsInstancesCulled;
+    int64_t pipelineStatsInstancesFrustumRejected;
+    int64_t pipelineStatsInstancesDistanceRejected;
+    int64_t pipelineStatsInstancesSizeRejected;
+    int64_t pipelineStatsBatches;
+    int64_t pipelineStatsBatchThreads;
+    int64_t pipelineStatsDispatches;
+    int64_t pipelineStatsChunks;
+    int64_t pipelineStatsChunkHighWaterMark;
+    int64_t pipelineStatsUploadMaps;
+    int64_t pipelineStatsUploadBytes;
+    int64_t pendingStatisticsPass;
 
     uint32_t enabledFilters;
 
@@ -512,6 +625,7 @@ class Application
     std::string benchmarkFilename;
     std::string meshFileName;
     std::string cameraName;
+    std::string clusterCacheDirectory;
     ID3D11VertexShader *fullscreenVs;
     ID3D11PixelShader *fullscreenPs;
 
@@ -529,6 +643,24 @@ class Application
         HandleOption(options, "geometry-chunk-size-variance", geometryChunkSizeVariance);
         HandleOption(options, "use-camera-for-benchmark", useCameraForBenchmark);
         HandleOption(options, "emulate-multi-indirect-draw", emulateMultiIndirectDraw);
+        HandleOption(options, "spatial-clusters", buildSpatialClusters);
+        HandleOption(options, "minimal-cones", minimalNormalCones);
+        HandleOption(options, "optimize-vertex-cache", optimizeVertexCache);
+        HandleOption(options, "cluster-lod", buildClusterLod);
+        HandleOption(options, "lod-error", lodErrorThreshold);
+        HandleOption(options, "max-draw-distance", maximumDrawDistance);
+        HandleOption(options, "min-projected-size", minimumProjectedSize);
+        HandleOption(options, "occluder-triangle-limit", occluderTriangleLimit);
+        HandleOption(options, "temporal-occlusion", temporalOcclusion);
+        HandleOption(options, "sort-draws", sortDrawsByMesh);
+        HandleOption(options, "merge-cluster-batches", mergeClusterBatches);
+        HandleOption(options, "occlusion-buffer-width", occlusionBufferWidth);
+        HandleOption(options, "occlusion-buffer-height", occlusionBufferHeight);
+        HandleOption(options, "worker-threads", workerThreadCount);
+        HandleOption(options, "small-batch-count", smallBatchCount);
+        HandleOption(options, "single-dispatch", singleDispatchFiltering);
+        HandleOption(options, "single-dispatch-memory-mb", singleDispatchMemoryLimit);
+        HandleOption(options, "cluster-cache", clusterCacheDirectory);
         HandleOption(options, "resolution", shadowMapResolution);
 
         if (!HandleOption(options, "mesh", meshFileName))
@@ -596,21 +728,42 @@ class Application
         AMD::GeometryFX_FilterDesc ci;
         ci.pDevice = device;
         ci.emulateMultiIndirectDraw = emulateMultiIndirectDraw;
+        ci.buildSpatialClusters = buildSpatialClusters;
+        ci.minimalNormalCones = minimalNormalCones;
+        ci.optimizeVertexCache = optimizeVertexCache;
+        ci.buildClusterLod = buildClusterLod;
+        ci.workerThreadCount = workerThreadCount;
+        ci.smallBatchCount = smallBatchCount;
+        ci.singleDispatchFiltering = singleDispatchFiltering;
+        ci.singleDispatchMemoryLimit = singleDispatchMemoryLimit * 1024 * 1024;
+
+        if (occluderTriangleLimit > 0 || temporalOcclusion)
+        {
+            ci.occlusionBufferWidth = occlusionBufferWidth;
+            ci.occlusionBufferHeight = occlusionBufferHeight;
+            ci.temporalOcclusion = temporalOcclusion;
+        }
+        ci.clusterCacheDirectory =
+            clusterCacheDirectory.empty() ? nullptr : clusterCacheDirectory.c_str();
 
         staticMeshRenderer_ = new AMD::GeometryFX_Filter(&ci);
+        // The batch size is fixed by the filter shader, the count is clamped
+        staticMeshRenderer_->GetSmallBatchInfo(&smallBatchSize, &smallBatchCount);
 
         if (generateGeometry)
         {
-            meshHandles_ = CreateGeometry(
-                384, geometryChunkSize, geometryChunkSizeVariance, *staticMeshRenderer_);
+            meshHandles_ = CreateGeometry(384, geometryChunkSize, geometryChunkSizeVariance,
+                *staticMeshRenderer_, occluderTriangleLimit, setMeshDataTime);
         }
         else
         {
             std::string pathToMesh = "..\\media\\" + meshFileName;
-            meshHandles_ =
-                LoadGeometry(pathToMesh.c_str(), *staticMeshRenderer_, geometryChunkSize);
+            meshHandles_ = LoadGeometry(pathToMesh.c_str(), *staticMeshRenderer_,
+                occluderTriangleLimit, setMeshDataTime, geometryChunkSize);
         }
 
+        UpdateClusterStatistics();
+
         D3D11_BUFFER_DESC desc = {};
         desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
         desc.ByteWidth = sizeof(FullscreenConstantBuffer);
@@ -620,6 +773,55 @@ class Application
         CreateShaders();
     }
 
+    void UpdateClusterStatistics()
+    {
+        clusterStatistics = AMD::GeometryFX_ClusterStatistics();
+        meshTriangleCount = 0;
+        cachedMeshCount = 0;
+
+        float coneAngleSum = 0;
+        double vertexCacheMissSum = 0;
+        double vertexTransformSum = 0;
+        for (std::vector<AMD::GeometryFX_Filter::MeshHandle>::const_iterator it = meshHandles_.begin(),
+                                                               end = meshHandles_.end();
+             it != end; ++it)
+        {
+            AMD::GeometryFX_ClusterStatistics meshStatistics;
+            staticMeshRenderer_->GetClusterStatistics(*it, &meshStatistics);
+
+            clusterStatistics.clusterCount += meshStatistics.clusterCount;
+            clusterStatistics.validConeCount += meshStatistics.validConeCount;
+            clusterStatistics.lodClusterCount += meshStatistics.lodClusterCount;
+            coneAngleSum += meshStatistics.meanConeAngle * meshStatistics.validConeCount;
+
+            if (meshStatistics.loadedFromCache)
+            {
+                ++cachedMeshCount;
+            }
+
+            AMD::int32 indexCount = 0;
+            staticMeshRenderer_->GetMeshInfo(*it, &indexCount);
+            meshTriangleCount += indexCount / 3;
+
+            // Both ratios are averaged over triangles, so weight by triangle count
+            vertexCacheMissSum += meshStatistics.vertexCacheMissRatio * (indexCount / 3);
+            vertexTransformSum += meshStatistics.vertexTransformRatio * (indexCount / 3);
+        }
+
+        if (clusterStatistics.validConeCount > 0)
+        {
+            clusterStatistics.meanConeAngle = coneAngleSum / clusterStatistics.validConeCount;
+        }
+
+        if (meshTriangleCount > 0)
+        {
+            clusterStatistics.vertexCacheMissRatio =
+                static_cast<float>(vertexCacheMissSum / meshTriangleCount);
+            clusterStatistics.vertexTransformRatio =
+                static_cast<float>(vertexTransformSum / meshTriangleCount);
+        }
+    }
+
     void CreateShaders()
     {
         CompileShader(DXUTGetD3D11Device(), (ID3D11DeviceChild **)&fullscreenVs,
@@ -679,6 +881,11 @@ class Application
 
         options.enableFiltering = enableFiltering;
         options.enabledFilters = enabledFilters;
+        options.lodErrorThreshold = lodErrorThreshold;
+        options.maximumDrawDistance = maximumDrawDistance;
+        options.minimumProjectedSize = minimumProjectedSize;
+        options.sortDrawsByMesh = sortDrawsByMesh;
+        options.mergeClusterBatches = mergeClusterBatches;
 
         AMD::GeometryFX_FilterStatistics filterStatistics;
         if (instrumentIndirectRender)
@@ -718,7 +925,9 @@ class Application
                 const auto translate =
                     XMMatrixTranslation((1 - frustumCoverage) * 1.66f + i / rows / 16.0f - 0.66f,
                         i % rows / 16.0f - 0.66f, dis01(generator) * 0.001f);
-                staticMeshRenderer_->RenderMesh(*it, rotate * scale * translate);
+                const auto world = rotate * scale * translate;
+                staticMeshRenderer_->RenderMeshInstanced(
+                    *it, 1, &world, AMD::GeometryFX_WorldTransformRigid);
             }
             else
             {
@@ -729,10 +938,10 @@ class Application
         staticMeshRenderer_->EndRender();
         TIMER_End();
 
-        pipelineStatsTrianglesIn = filterStatistics.trianglesProcessed;
-        pipelineStatsTrianglesOut = filterStatistics.trianglesRendered;
-        pipelineStatsClustersIn = filterStatistics.clustersProcessed;
-        pipelineStatsClustersOut = filterStatistics.clustersRendered;
+        if (instrumentIndirectRender)
+        {
+            UpdatePipelineStatistics(filterStatistics.passIndex);
+        }
 
         D3D11_VIEWPORT viewport = {};
         viewport.MaxDepth = 1.0f;
@@ -772,13 +981,50 @@ class Application
         }
     }
 
-    void OnFrameBegin(ID3D11DeviceContext *context, const CBaseCamera &camera)
+    /**
+    The triangle counts are measured on the GPU and arrive a few frames
+    later. Keep showing the last complete pass until the one we wait for is
+    done.
+    */
+    void UpdatePipelineStatistics(const int64_t currentPass)
     {
-        pipelineStatsTrianglesIn = 0;
-        pipelineStatsTrianglesOut = 0;
-        pipelineStatsClustersIn = 0;
-        pipelineStatsClustersOut = 0;
+        if (pendingStatisticsPass < 0
+            || currentPass - pendingStatisticsPass >= AMD::GeometryFX_FilterStatisticsPassCount)
+        {
+            pendingStatisticsPass = currentPass;
+        }
 
+        AMD::GeometryFX_FilterStatistics statistics;
+        if (!staticMeshRenderer_->GetStatistics(pendingStatisticsPass, &statistics))
+        {
+            return;
+        }
+
+        pendingStatisticsPass = -1;
+
+        pipelineStatsTrianglesIn = statistics.trianglesProcessed;
+        pipelineStatsTrianglesOut = statistics.trianglesRendered;
+        pipelineStatsClustersIn = statistics.clustersProcessed;
+        pipelineStatsClustersOut = statistics.clustersRendered;
+        pipelineStatsClustersFrustumCulled = statistics.clustersFrustumCulled;
+        pipelineStatsClustersBackfaceCulled = statistics.clustersBackfaceCulled;
+        pipelineStatsClustersOcclusionCulled = statistics.clustersOcclusionCulled;
+        pipelineStatsOccluderTriangles = statistics.occluderTrianglesRasterized;
+        pipelineStatsInstancesCulled = statistics.instancesCulled;
+        pipelineStatsInstancesFrustumRejected = statistics.instancesFrustumRejected;
+        pipelineStatsInstancesDistanceRejected = statistics.instancesDistanceRejected;
+        pipelineStatsInstancesSizeRejected = statistics.instancesSizeRejected;
+        pipelineStatsBatches = statistics.batchesProcessed;
+        pipelineStatsBatchThreads = statistics.batchThreadsProcessed;
+        pipelineStatsDispatches = statistics.filterDispatchCount;
+        pipelineStatsChunks = statistics.smallBatchChunkCount;
+        pipelineStatsChunkHighWaterMark = statistics.smallBatchChunkHighWaterMark;
+        pipelineStatsUploadMaps = statistics.uploadMapCount;
+        pipelineStatsUploadBytes = statistics.uploadBytes;
+    }
+
+    void OnFrameBegin(ID3D11DeviceContext *context, const CBaseCamera &camera)
+    {
         context->ClearDepthStencilView(
             resolutionDependentResources.depthView.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
         context->OMSetRenderTargets(0, nullptr, resolutionDependentResources.depthView.Get());
@@ -858,6 +1104,7 @@ enum GEOMETRYFX_SAMPLE_IDC
     IDC_TOGGLE_CULL_CLIP,
     IDC_TOGGLE_CULL_SMALL_PRIMITIVES,
     IDC_TOGGLE_CULL_CLUSTER_BACKFACE,
+    IDC_TOGGLE_CULL_CLUSTER_OCCLUSION,
     IDC_NUM_CONTROL_IDS // THIS ONE SHOULD ALWAYS BE LAST!!!!!
 };
 
@@ -868,6 +1115,7 @@ CDXUTCheckBox *g_UI_cullBackfaceCheckBox;
 CDXUTCheckBox *g_UI_cullClipCheckBox;
 CDXUTCheckBox *g_UI_cullSmallPrimitivesCheckBox;
 CDXUTCheckBox *g_UI_cullClusterBackfaceCheckBox;
+CDXUTCheckBox *g_UI_cullClusterOcclusionCheckBox;
 
 const int g_MaxApplicationControlID = IDC_NUM_CONTROL_IDS;
 
@@ -1061,6 +1309,12 @@ void InitApp()
         AMD::HUD::iElementHeight,
         TestFlag (g_Application.enabledFilters, AMD::GeometryFX_ClusterFilterBackface), 0, false,
         &g_UI_cullClusterBackfaceCheckBox);
+
+    g_HUD.m_GUI.AddCheckBox (IDC_TOGGLE_CULL_CLUSTER_OCCLUSION, L"Occlusion cluster cull",
+        AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, AMD::HUD::iElementWidth,
+        AMD::HUD::iElementHeight,
+        TestFlag (g_Application.enabledFilters, AMD::GeometryFX_ClusterFilterOcclusion), 0, false,
+        &g_UI_cullClusterOcclusionCheckBox);
 }
 
 //--------------------------------------------------------------------------------------
@@ -1082,6 +1336,43 @@ void RenderText()
         g_Application.GetMeshCount());
     g_pTxtHelper->DrawTextLine(wcbuf);
 
+    swprintf_s(wcbuf, 256, L"Small batches: %d triangles, %d per chunk",
+        g_Application.smallBatchSize, g_Application.smallBatchCount);
+    g_pTxtHelper->DrawTextLine(wcbuf);
+
+    if (g_Application.clusterStatistics.clusterCount > 0)
+    {
+        swprintf_s(wcbuf, 256, L"Clusters: %d, valid cones %.2f%%, mean cone angle %.2f deg",
+            g_Application.clusterStatistics.clusterCount,
+            static_cast<float>(g_Application.clusterStatistics.validConeCount) /
+                static_cast<float>(g_Application.clusterStatistics.clusterCount) * 100.0f,
+            g_Application.clusterStatistics.meanConeAngle);
+        g_pTxtHelper->DrawTextLine(wcbuf);
+
+        if (g_Application.clusterStatistics.lodClusterCount > 0)
+        {
+            swprintf_s(wcbuf, 256, L"Cluster LOD: %d simplified clusters, error threshold %.2f px",
+                g_Application.clusterStatistics.lodClusterCount,
+                g_Application.lodErrorThreshold);
+            g_pTxtHelper->DrawTextLine(wcbuf);
+        }
+
+        swprintf_s(wcbuf, 256, L"Vertex cache: ACMR %.3f, ATVR %.3f%s",
+            g_Application.clusterStatistics.vertexCacheMissRatio,
+            g_Application.clusterStatistics.vertexTransformRatio,
+            g_Application.optimizeVertexCache ? L" (optimized)" : L"");
+        g_pTxtHelper->DrawTextLine(wcbuf);
+    }
+
+    if (g_Application.setMeshDataTime > 0)
+    {
+        swprintf_s(wcbuf, 256, L"Mesh setup: %.2f ms, %.2f M triangles/s, %d/%d meshes from cache",
+            g_Application.setMeshDataTime * 1000.0,
+            g_Application.meshTriangleCount / g_Application.setMeshDataTime / 1000000.0,
+            g_Application.cachedMeshCount, g_Application.GetMeshCount());
+        g_pTxtHelper->DrawTextLine(wcbuf);
+    }
+
     // Only display filter stats if the filter is actually running
     if (g_Application.instrumentIndirectRender && g_Application.enableFiltering)
     {
@@ -1099,13 +1390,55 @@ void RenderText()
             g_pTxtHelper->DrawTextLine(buffer);
         }
 
-        if ((g_Application.enabledFilters & AMD::GeometryFX_ClusterFilterBackface) == AMD::GeometryFX_ClusterFilterBackface)
+        if ((g_Application.enabledFilters & (AMD::GeometryFX_ClusterFilterBackface | AMD::GeometryFX_FilterFrustum
+                | AMD::GeometryFX_ClusterFilterOcclusion)) != 0
+            && g_Application.pipelineStatsClustersIn > 0)
         {
-            swprintf_s (buffer, L"Cluster stats: In %I64d, out %I64d (filtered: %.2f%%) ",
+            swprintf_s (buffer, L"Cluster stats: In %I64d, out %I64d (filtered: %.2f%%, frustum %I64d, backface %I64d, occlusion %I64d, whole instances %I64d) ",
                 g_Application.pipelineStatsClustersIn, g_Application.pipelineStatsClustersOut,
                 100 -
                 static_cast<float>(g_Application.pipelineStatsClustersOut) /
-                static_cast<float>(g_Application.pipelineStatsClustersIn) * 100.0f);
+                static_cast<float>(g_Application.pipelineStatsClustersIn) * 100.0f,
+                g_Application.pipelineStatsClustersFrustumCulled,
+                g_Application.pipelineStatsClustersBackfaceCulled,
+                g_Application.pipelineStatsClustersOcclusionCulled,
+                g_Application.pipelineStatsInstancesCulled);
+            g_pTxtHelper->DrawTextLine (buffer);
+        }
+
+        if (g_Application.pipelineStatsInstancesFrustumRejected > 0
+            || g_Application.pipelineStatsInstancesDistanceRejected > 0
+            || g_Application.pipelineStatsInstancesSizeRejected > 0)
+        {
+            swprintf_s (buffer, L"Instances rejected before recording: frustum %I64d, distance %I64d, size %I64d",
+                g_Application.pipelineStatsInstancesFrustumRejected,
+                g_Application.pipelineStatsInstancesDistanceRejected,
+                g_Application.pipelineStatsInstancesSizeRejected);
+            g_pTxtHelper->DrawTextLine (buffer);
+        }
+
+        if (g_Application.pipelineStatsBatchThreads > 0)
+        {
+            swprintf_s (buffer, L"Small batches: %I64d in %I64d dispatches (%.2f%% of filter threads busy)",
+                g_Application.pipelineStatsBatches,
+                g_Application.pipelineStatsDispatches,
+                static_cast<float>(g_Application.pipelineStatsTrianglesIn) /
+                static_cast<float>(g_Application.pipelineStatsBatchThreads) * 100.0f);
+            g_pTxtHelper->DrawTextLine (buffer);
+
+            swprintf_s (buffer, L"Small batch chunks: %I64d allocated, at most %I64d, uploaded %.1f KiB in %I64d maps",
+                g_Application.pipelineStatsChunks,
+                g_Application.pipelineStatsChunkHighWaterMark,
+                g_Application.pipelineStatsUploadBytes / 1024.0,
+                g_Application.pipelineStatsUploadMaps);
+            g_pTxtHelper->DrawTextLine (buffer);
+        }
+
+        if (g_Application.pipelineStatsOccluderTriangles > 0)
+        {
+            swprintf_s (buffer, L"Occlusion buffer: %I64d occluder triangles%s",
+                g_Application.pipelineStatsOccluderTriangles,
+                g_Application.temporalOcclusion ? L" (including previous frame)" : L"");
             g_pTxtHelper->DrawTextLine (buffer);
         }
     }
@@ -1479,6 +1812,13 @@ void CALLBACK OnGUIEvent(UINT nEvent, int nControlID, CDXUTControl *pControl, vo
             AMD::GeometryFX_ClusterFilterBackface, g_UI_cullClusterBackfaceCheckBox->GetChecked ());
             break;
         }
+
+        case IDC_TOGGLE_CULL_CLUSTER_OCCLUSION:
+        {
+            SetOrClearFlag (static_cast<Application *>(pUserContext)->enabledFilters,
+            AMD::GeometryFX_ClusterFilterOcclusion, g_UI_cullClusterOcclusionCheckBox->GetChecked ());
+            break;
+        }
     }
 
     // Call the MagnifyTool gui event handler
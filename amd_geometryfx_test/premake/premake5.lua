@@ -0,0 +1,104 @@
+_AMD_LIBRARY_NAME = "GeometryFX"
+_AMD_LIBRARY_NAME_ALL_CAPS = string.upper(_AMD_LIBRARY_NAME)
+
+-- Set _AMD_LIBRARY_NAME before including amd_premake_util.lua
+dofile ("../../premake/amd_premake_util.lua")
+
+-- The tests and benchmarks only use the CPU side of the library, which needs
+-- DirectXMath but no D3D. On Windows, DirectXMath comes with the SDK.
+-- Elsewhere, point this at the DirectXMath headers (and a sal.h), and
+-- generate makefiles with "premake5 --directxmath=<path> gmake2".
+newoption {
+   trigger = "directxmath",
+   value = "PATH",
+   description = "Include directory of DirectXMath, for builds outside of Windows"
+}
+
+workspace (_AMD_LIBRARY_NAME .. "_Test")
+   configurations { "Debug", "Release" }
+   platforms { "x64" }
+   location "../build"
+   filename (_AMD_LIBRARY_NAME .. "_Test" .. _AMD_VS_SUFFIX)
+   startproject (_AMD_LIBRARY_NAME .. "_Test")
+
+   filter "platforms:x64"
+      architecture "x64"
+
+-- The internal classes are not exported by the library DLL, so the sources
+-- the tests and benchmarks need are compiled into the executables
+_AMD_GEOMETRYFX_SOURCES = {
+   "../../amd_geometryfx/src/GeometryFXClusterBounds.cpp",
+   "../../amd_geometryfx/src/GeometryFXClusterBuilder.cpp",
+   "../../amd_geometryfx/src/GeometryFXClusterCache.cpp",
+   "../../amd_geometryfx/src/GeometryFXClusterCulling.cpp",
+   "../../amd_geometryfx/src/GeometryFXClusterLod.cpp",
+   "../../amd_geometryfx/src/GeometryFXClusterVisibility.cpp",
+   "../../amd_geometryfx/src/GeometryFXInstanceCulling.cpp",
+   "../../amd_geometryfx/src/GeometryFXMesh.cpp",
+   "../../amd_geometryfx/src/GeometryFXOcclusionBuffer.cpp",
+   "../../amd_geometryfx/src/GeometryFXPackedCluster.cpp",
+   "../../amd_geometryfx/src/GeometryFXReferenceFilter.cpp",
+   "../../amd_geometryfx/src/GeometryFXSmallBatchPacking.cpp",
+   "../../amd_geometryfx/src/GeometryFXTriangleCulling.cpp",
+   "../../amd_geometryfx/src/GeometryFXVertexCache.cpp",
+   "../../amd_geometryfx/src/GeometryFXWorkerPool.cpp"
+}
+
+-- Settings shared by the console applications of this workspace
+function amdTestProject(name, projectUuid)
+   project (name)
+      kind "ConsoleApp"
+      language "C++"
+      location "../build"
+      filename (name .. _AMD_VS_SUFFIX)
+      uuid (projectUuid)
+      targetdir "../bin"
+      objdir ("../build/%{_AMD_SAMPLE_DIR_LAYOUT}/" .. name)
+      warnings "Extra"
+
+      includedirs { "../src", "../../amd_geometryfx/inc", "../../amd_geometryfx/src", "../../amd_lib/shared/common/inc" }
+      defines { "AMD_%{_AMD_LIBRARY_NAME_ALL_CAPS}_COMPILE_DYNAMIC_LIB=0" }
+
+      if _OPTIONS["directxmath"] then
+         includedirs { _OPTIONS["directxmath"] }
+      end
+
+      filter "system:windows"
+         -- Specify WindowsTargetPlatformVersion here for VS2015
+         systemversion (_AMD_WIN_SDK_VERSION)
+         defines { "WIN32", "_CONSOLE", "_WIN32_WINNT=0x0601" }
+         characterset "Unicode"
+
+      filter "action:vs*"
+         buildoptions { "/EHsc" }
+
+      -- The AVX and AVX2 kernels are only compiled in if the compiler may
+      -- use them. The executables run where they are built.
+      filter "action:gmake*"
+         cppdialect "C++14"
+         buildoptions { "-march=native" }
+         links { "pthread" }
+
+      filter "configurations:Debug"
+         defines { "_DEBUG", "DEBUG" }
+         flags { "FatalWarnings" }
+         symbols "On"
+         targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+      filter "configurations:Release"
+         defines { "NDEBUG" }
+         flags { "FatalWarnings" }
+         symbols "On"
+         targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+         optimize "On"
+
+      filter {}
+end
+
+amdTestProject(_AMD_LIBRARY_NAME .. "_Test", "A53A51CD-0E2D-4A08-936C-3BE93F61E9EE")
+   files { "../src/GeometryFX_Test.h", "../src/GeometryFX_Test.cpp", "../src/Test*.h", "../src/Test*.cpp" }
+   files (_AMD_GEOMETRYFX_SOURCES)
+
+amdTestProject(_AMD_LIBRARY_NAME .. "_Benchmark", "01266174-8DC4-4695-97CE-A93435F97FAD")
+   files { "../src/GeometryFX_Benchmark*.h", "../src/GeometryFX_Benchmark*.cpp", "../src/Benchmark*.cpp", "../src/TestGeometry.*" }
+   files (_AMD_GEOMETRYFX_SOURCES)
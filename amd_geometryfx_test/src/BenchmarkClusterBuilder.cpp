@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "GeometryFX_Benchmark.h"
+#include "TestGeometry.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "GeometryFXClusterBuilder.h"
+#include "GeometryFXWorkerPool.h"
+
+using namespace AMD::GeometryFX_Internal;
+
+namespace
+{
+bool IsSameCluster(const Cluster &a, const Cluster &b)
+{
+    return std::memcmp(&a.aabbMin, &b.aabbMin, sizeof(a.aabbMin)) == 0 &&
+        std::memcmp(&a.aabbMax, &b.aabbMax, sizeof(a.aabbMax)) == 0 &&
+        std::memcmp(&a.coneCenter, &b.coneCenter, sizeof(a.coneCenter)) == 0 &&
+        std::memcmp(&a.coneAxis, &b.coneAxis, sizeof(a.coneAxis)) == 0 &&
+        a.coneAngleCosine == b.coneAngleCosine && a.valid == b.valid &&
+        a.firstTriangle == b.firstTriangle && a.triangleCount == b.triangleCount;
+}
+
+bool IsSameOutput(const ClusterBuilderOutput &a, const ClusterBuilderOutput &b)
+{
+    if (a.clusters.size() != b.clusters.size() || a.reorderedIndices != b.reorderedIndices)
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < a.clusters.size(); ++i)
+    {
+        if (!IsSameCluster(a.clusters[i], b.clusters[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+}
+
+/**
+Build the clusters of a set of meshes, the size of the sample's default
+scene, on 1..N threads. The clusters must not depend on the thread count.
+*/
+bool BenchmarkClusterBuilder()
+{
+    const int MESH_COUNT = 64;
+    const int REPETITION_COUNT = 3;
+
+    std::vector<TestMesh> meshes(MESH_COUNT);
+    std::vector<ClusterBuilderInput> inputs(MESH_COUNT);
+
+    std::normal_distribution<float> distribution(20000, 5000);
+    std::mt19937 generator;
+
+    int64_t triangleCount = 0;
+
+    for (int i = 0; i < MESH_COUNT; ++i)
+    {
+        GenerateGeometryChunk(std::max(32, static_cast<int>(distribution(generator))), meshes[i]);
+
+        inputs[i].indexCount = static_cast<int>(meshes[i].indices.size());
+        inputs[i].vertexCount = meshes[i].GetVertexCount();
+        inputs[i].vertexData = meshes[i].vertices.data();
+        inputs[i].indexData = meshes[i].indices.data();
+
+        triangleCount += meshes[i].GetTriangleCount();
+    }
+
+    std::printf("%d meshes, %lld triangles, best of %d runs\n", MESH_COUNT,
+        static_cast<long long>(triangleCount), REPETITION_COUNT);
+
+    const std::vector<int> threadCounts = GetBenchmarkThreadCounts();
+    bool passed = true;
+
+    for (int spatialClusters = 0; spatialClusters < 2; ++spatialClusters)
+    {
+        ClusterBuilderOptions options;
+        options.spatialClusters = spatialClusters != 0;
+
+        std::printf("%s clusters\n", options.spatialClusters ? "Spatial" : "Linear");
+
+        std::vector<ClusterBuilderOutput> referenceOutputs;
+        double referenceSeconds = 0;
+
+        for (std::size_t t = 0; t < threadCounts.size(); ++t)
+        {
+            WorkerPool pool(threadCounts[t]);
+
+            std::vector<ClusterBuilderOutput> outputs;
+            double seconds = 0;
+
+            for (int repetition = 0; repetition < REPETITION_COUNT; ++repetition)
+            {
+                outputs.assign(MESH_COUNT, ClusterBuilderOutput());
+
+                const BenchmarkTimer timer;
+                BuildClusters(pool, options, MESH_COUNT, inputs.data(), outputs.data());
+                const double runSeconds = timer.GetSeconds();
+
+                if (repetition == 0 || runSeconds < seconds)
+                {
+                    seconds = runSeconds;
+                }
+            }
+
+            bool identical = true;
+
+            if (t == 0)
+            {
+                referenceOutputs.swap(outputs);
+                referenceSeconds = seconds;
+            }
+            else
+            {
+                for (int i = 0; i < MESH_COUNT; ++i)
+                {
+                    identical &= IsSameOutput(referenceOutputs[i], outputs[i]);
+                }
+            }
+
+            std::printf("  %2d threads: %8.3f M triangles/s, %.2fx%s\n", pool.GetThreadCount(),
+                triangleCount / seconds * 1e-6, referenceSeconds / seconds,
+                identical ? "" : ", clusters differ from 1 thread");
+
+            passed &= identical;
+        }
+    }
+
+    return passed;
+}
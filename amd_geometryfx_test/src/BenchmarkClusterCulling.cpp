@@ -0,0 +1,212 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include "GeometryFX_Benchmark.h"
+#include "TestGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "GeometryFXClusterBuilder.h"
+#include "GeometryFXClusterCulling.h"
+#include "GeometryFXPackedCluster.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+/**
+Test every cluster on its own, with the box and cone tests of the packed
+cluster. Returns the number of visible clusters, whose first triangles are
+written to visible.
+*/
+int CullClusters(const std::vector<PackedCluster> &clusters,
+    const ObjectSpaceFrustum &frustum, const XMFLOAT3 &eye, int *visible)
+{
+    int visibleCount = 0;
+
+    for (std::size_t i = 0; i < clusters.size(); ++i)
+    {
+        const PackedCluster &cluster = clusters[i];
+
+        if (frustum.IsOutside(GetQuantizedAabbMin(cluster), GetQuantizedAabbMax(cluster)) ||
+            IsConeBackfacing(cluster, eye))
+        {
+            continue;
+        }
+
+        visible[visibleCount++] = cluster.firstTriangle;
+    }
+
+    return visibleCount;
+}
+
+/**
+CullClusters with the masks of CLUSTER_BLOCK_SIZE clusters at once.
+*/
+int CullClusterBlocks(const std::vector<PackedCluster> &clusters,
+    const std::vector<ClusterBlock> &blocks, const ObjectSpaceFrustum &frustum,
+    const XMFLOAT3 &eye, int *visible)
+{
+    const int clusterCount = static_cast<int>(clusters.size());
+    int visibleCount = 0;
+
+    for (std::size_t block = 0; block < blocks.size(); ++block)
+    {
+        const int firstCluster = static_cast<int>(block) * CLUSTER_BLOCK_SIZE;
+        const int laneCount = std::min(CLUSTER_BLOCK_SIZE, clusterCount - firstCluster);
+        const uint32 laneMask = (1u << laneCount) - 1;
+
+        const uint32 outsideMask = frustum.GetOutsideMask(blocks[block]) & laneMask;
+        const uint32 backfacingMask = (laneMask & ~outsideMask) ?
+            GetBackfacingMask(blocks[block], eye) & laneMask : 0;
+        const uint32 visibleMask = laneMask & ~(outsideMask | backfacingMask);
+
+        for (int lane = 0; lane < laneCount; ++lane)
+        {
+            if (visibleMask & (1u << lane))
+            {
+                visible[visibleCount++] = clusters[firstCluster + lane].firstTriangle;
+            }
+        }
+    }
+
+    return visibleCount;
+}
+}
+
+/**
+Cull the clusters of a dense sphere from 64 views, once with a test per
+cluster and once with the block masks, and compare the throughput. Both
+must find the same visible clusters.
+*/
+bool BenchmarkClusterCulling()
+{
+    const int VIEW_COUNT = 64;
+    const int REPETITION_COUNT = 200;
+
+    TestMesh sphere;
+    GenerateBumpySphere(300, sphere);
+
+    ClusterBuilderInput input;
+    input.indexCount = static_cast<int>(sphere.indices.size());
+    input.vertexCount = sphere.GetVertexCount();
+    input.vertexData = sphere.vertices.data();
+    input.indexData = sphere.indices.data();
+
+    const XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0f, 1.5f, 0.1f, 100.0f);
+
+    bool passed = true;
+
+    const int maximumVertexCounts[] = { 64, 256 };
+    for (const int maximumVertexCount : maximumVertexCounts)
+    {
+        ClusterBuilderOptions options;
+        options.spatialClusters = true;
+        options.maximumVerticesPerCluster = maximumVertexCount;
+
+        ClusterBuilderOutput output;
+        BuildClusters(options, input, output);
+
+        std::vector<PackedCluster> clusters;
+        ClusterQuantization quantization;
+        PackClusters(output.clusters, clusters, quantization);
+
+        std::vector<ClusterBlock> blocks;
+        BuildClusterBlocks(clusters, blocks);
+
+        std::vector<int> visible(clusters.size());
+        std::vector<int> visibleBlocks(clusters.size());
+
+        double clusterSeconds = 0;
+        double blockSeconds = 0;
+        int visibleCount = 0;
+        int mismatchCount = 0;
+
+        for (int view = 0; view < VIEW_COUNT; ++view)
+        {
+            // Orbit the sphere close enough that parts of it leave the frustum
+            const float angle = view * 0.37f;
+            const XMVECTOR eyePosition = XMVectorSet(2.5f * std::cos(angle),
+                0.7f * std::sin(angle * 1.3f), 2.5f * std::sin(angle), 1);
+            const XMVECTOR target = XMVectorSet(0.4f * std::sin(angle * 2), 0, 0.3f, 1);
+            const XMMATRIX viewProjection =
+                XMMatrixLookAtLH(eyePosition, target, XMVectorSet(0, 1, 0, 0)) * projection;
+
+            const ObjectSpaceFrustum frustum(
+                GetDequantizationMatrix(quantization) * viewProjection);
+
+            XMFLOAT3 eye;
+            XMStoreFloat3(&eye, eyePosition);
+
+            int clusterVisibleCount = 0;
+            {
+                const BenchmarkTimer timer;
+                for (int i = 0; i < REPETITION_COUNT; ++i)
+                {
+                    clusterVisibleCount = CullClusters(clusters, frustum, eye, visible.data());
+                }
+                clusterSeconds += timer.GetSeconds();
+            }
+
+            int blockVisibleCount = 0;
+            {
+                const BenchmarkTimer timer;
+                for (int i = 0; i < REPETITION_COUNT; ++i)
+                {
+                    blockVisibleCount = CullClusterBlocks(clusters, blocks, frustum, eye,
+                        visibleBlocks.data());
+                }
+                blockSeconds += timer.GetSeconds();
+            }
+
+            // Both emit the clusters in order, so the lists must be equal
+            visibleCount += clusterVisibleCount;
+            if (clusterVisibleCount != blockVisibleCount ||
+                !std::equal(visible.begin(), visible.begin() + clusterVisibleCount,
+                    visibleBlocks.begin()))
+            {
+                ++mismatchCount;
+            }
+        }
+
+        const double testCount =
+            static_cast<double>(VIEW_COUNT) * REPETITION_COUNT * clusters.size();
+
+        std::printf("%d clusters of at most %d vertices, %.1f%% visible, %d of %d views differ\n",
+            static_cast<int>(clusters.size()), maximumVertexCount,
+            100.0 * visibleCount / (static_cast<double>(VIEW_COUNT) * clusters.size()),
+            mismatchCount, VIEW_COUNT);
+        std::printf("  Per cluster: %6.1f M clusters/s\n", testCount / clusterSeconds * 1e-6);
+        std::printf("  Blocks:      %6.1f M clusters/s, %.2fx\n", testCount / blockSeconds * 1e-6,
+            clusterSeconds / blockSeconds);
+
+        passed &= mismatchCount == 0;
+    }
+
+    return passed;
+}
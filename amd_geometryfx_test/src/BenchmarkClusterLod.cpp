@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "GeometryFX_Benchmark.h"
+#include "TestGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "GeometryFXClusterBuilder.h"
+
+using namespace AMD::GeometryFX_Internal;
+
+namespace
+{
+bool BenchmarkMeshLod(const char *name, const TestMesh &mesh)
+{
+    ClusterBuilderInput input;
+    input.indexCount = static_cast<int>(mesh.indices.size());
+    input.vertexCount = mesh.GetVertexCount();
+    input.vertexData = mesh.vertices.data();
+    input.indexData = mesh.indices.data();
+
+    ClusterBuilderOptions options;
+    options.spatialClusters = true;
+    options.buildLod = true;
+
+    ClusterBuilderOutput output;
+
+    const BenchmarkTimer timer;
+    BuildClusters(options, input, output);
+    const double seconds = timer.GetSeconds();
+
+    std::printf("%s: %d triangles, %d clusters, %d with the simplified levels, built in %.2f s\n",
+        name, mesh.GetTriangleCount(), output.baseClusterCount,
+        static_cast<int>(output.clusters.size()), seconds);
+
+    float meshRadius = 0;
+    for (std::size_t i = 0; i < mesh.vertices.size(); ++i)
+    {
+        meshRadius = std::max(meshRadius, std::abs(mesh.vertices[i]));
+    }
+
+    // 60 degree vertical field of view at 1080 lines
+    const float projectionScale = 1080 * 0.5f / std::tan(0.5f * 3.14159265f / 3);
+
+    const float distances[] = { 3, 10, 30, 100 };
+    const float thresholds[] = { 0.5f, 1, 4 };
+
+    std::vector<int> indices;
+    int clusterCount = 0;
+
+    GetLodSelection(output, DirectX::XMFLOAT3(0, 0, 0), projectionScale, 0, indices,
+        clusterCount);
+    const MeshEdges fullDetailEdges =
+        GetMeshEdges(indices.data(), static_cast<int>(indices.size() / 3));
+
+    std::printf("  triangles drawn, relative to the full detail mesh, and new open edges\n");
+    std::printf("  distance  ");
+    for (const float threshold : thresholds)
+    {
+        std::printf("  %4.1f px              ", threshold);
+    }
+    std::printf("\n");
+
+    bool passed = true;
+
+    for (const float distance : distances)
+    {
+        std::printf("  %5.0f R   ", distance);
+
+        for (const float threshold : thresholds)
+        {
+            const DirectX::XMFLOAT3 eye(
+                0.3f * meshRadius, 0.2f * meshRadius, distance * meshRadius);
+
+            indices.clear();
+            GetLodSelection(output, eye, projectionScale, threshold, indices, clusterCount);
+
+            const int triangleCount = static_cast<int>(indices.size() / 3);
+            const int newOpenEdgeCount =
+                CountNewOpenEdges(GetMeshEdges(indices.data(), triangleCount), fullDetailEdges);
+
+            std::printf("  %7d %5.1f%% %4d  ", triangleCount,
+                100.0 * triangleCount / mesh.GetTriangleCount(), newOpenEdgeCount);
+
+            passed &= newOpenEdgeCount == 0;
+        }
+
+        std::printf("\n");
+    }
+
+    return passed;
+}
+}
+
+/**
+Build the levels of detail of a closed mesh and an open height field, and
+count the triangles selected at a range of distances and error thresholds.
+Every selection must be free of holes.
+*/
+bool BenchmarkClusterLod()
+{
+    bool passed = true;
+
+    TestMesh sphere;
+    GenerateBumpySphere(200, sphere);
+    passed &= BenchmarkMeshLod("Bumpy sphere", sphere);
+
+    TestMesh chunk;
+    GenerateGeometryChunk(65535, chunk);
+    passed &= BenchmarkMeshLod("Height field", chunk);
+
+    return passed;
+}
@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include "GeometryFX_Benchmark.h"
+#include "TestGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "GeometryFXOcclusionBuffer.h"
+
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+const int BUFFER_WIDTH = 256;
+const int BUFFER_HEIGHT = 128;
+
+// The eye looks down +z from z = EYE_DISTANCE, at a wall in the z = 0 plane
+const float EYE_DISTANCE = 10;
+const float WALL_HALF_WIDTH = 6;
+const float WALL_HALF_HEIGHT = 3;
+
+/**
+A wall of 2 * n * n triangles, centered on the origin in the z = 0 plane.
+*/
+void GenerateWall(const int n, TestMesh &mesh)
+{
+    for (int y = 0; y <= n; ++y)
+    {
+        for (int x = 0; x <= n; ++x)
+        {
+            mesh.vertices.push_back(WALL_HALF_WIDTH * (2.0f * x / n - 1));
+            mesh.vertices.push_back(WALL_HALF_HEIGHT * (2.0f * y / n - 1));
+            mesh.vertices.push_back(0);
+        }
+    }
+
+    for (int y = 0; y < n; ++y)
+    {
+        for (int x = 0; x < n; ++x)
+        {
+            const int i = y * (n + 1) + x;
+            const int quad[] = { i, i + n + 1, i + 1, i + 1, i + n + 1, i + n + 2 };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+/**
+True if the box lies behind the wall and all its corners project onto it.
+*/
+bool IsHiddenByWall(const XMFLOAT3 &center, const XMFLOAT3 &extents)
+{
+    if (center.z - extents.z <= 0)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+        const float x = (i & 1) ? center.x + extents.x : center.x - extents.x;
+        const float y = (i & 2) ? center.y + extents.y : center.y - extents.y;
+        const float z = (i & 4) ? center.z + extents.z : center.z - extents.z;
+
+        const float scale = EYE_DISTANCE / (z + EYE_DISTANCE);
+        if (std::abs(x * scale) > WALL_HALF_WIDTH || std::abs(y * scale) > WALL_HALF_HEIGHT)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+double GetOccluderTrianglesPerMs(OcclusionBuffer &buffer, const XMMATRIX &viewProjection,
+    const TestMesh &mesh, const int repetitionCount)
+{
+    const BenchmarkTimer timer;
+    for (int i = 0; i < repetitionCount; ++i)
+    {
+        buffer.Clear();
+        buffer.RasterizeTriangles(viewProjection, mesh.vertices.data(), mesh.GetVertexCount(),
+            mesh.indices.data(), static_cast<int>(mesh.indices.size()));
+    }
+
+    return repetitionCount * mesh.GetTriangleCount() / (timer.GetSeconds() * 1000);
+}
+}
+
+/**
+Rasterize a wall into the occlusion buffer and test random boxes against
+it, comparing with the exact answer. Then measure how fast occluders are
+rasterized, the hierarchy is built and boxes are tested. No box may be
+reported occluded unless it is hidden.
+*/
+bool BenchmarkOcclusionBuffer()
+{
+    const XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0, 0, -EYE_DISTANCE, 1),
+        XMVectorSet(0, 0, 0, 1), XMVectorSet(0, 1, 0, 0));
+    const XMMATRIX projection =
+        XMMatrixPerspectiveFovLH(XM_PI / 3, 2.0f, 0.1f, 1000.0f);
+    const XMMATRIX viewProjection = view * projection;
+
+    OcclusionBuffer buffer(BUFFER_WIDTH, BUFFER_HEIGHT);
+
+    TestMesh wall;
+    GenerateWall(16, wall);
+
+    buffer.Clear();
+    buffer.RasterizeTriangles(viewProjection, wall.vertices.data(), wall.GetVertexCount(),
+        wall.indices.data(), static_cast<int>(wall.indices.size()));
+    buffer.BuildHierarchy();
+
+    std::mt19937 generator(2);
+    std::uniform_real_distribution<float> distribution(0, 1);
+
+    const int BOX_COUNT = 200000;
+    int hiddenCount = 0;
+    int occludedCount = 0;
+    int falseOcclusionCount = 0;
+
+    for (int i = 0; i < BOX_COUNT; ++i)
+    {
+        const XMFLOAT3 center(-9 + 18 * distribution(generator),
+            -5 + 10 * distribution(generator), -5 + 25 * distribution(generator));
+        const XMFLOAT3 extents(0.05f + 1.5f * distribution(generator),
+            0.05f + 1.5f * distribution(generator), 0.05f + 1.5f * distribution(generator));
+
+        const bool hidden = IsHiddenByWall(center, extents);
+        const bool occluded = buffer.IsOccluded(viewProjection,
+            XMVectorSet(center.x - extents.x, center.y - extents.y, center.z - extents.z, 1),
+            XMVectorSet(center.x + extents.x, center.y + extents.y, center.z + extents.z, 1));
+
+        hiddenCount += hidden;
+        occludedCount += occluded;
+        falseOcclusionCount += occluded && !hidden;
+    }
+
+    std::printf("Wall, %dx%d: %d of %d boxes hidden, %d reported occluded (%.1f%%), "
+        "%d false occlusions\n", BUFFER_WIDTH, BUFFER_HEIGHT, hiddenCount, BOX_COUNT,
+        occludedCount, 100.0 * occludedCount / std::max(1, hiddenCount), falseOcclusionCount);
+
+    const int ringCounts[] = { 8, 32, 128 };
+    for (const int ringCount : ringCounts)
+    {
+        TestMesh sphere;
+        GenerateBumpySphere(ringCount, sphere);
+        for (std::size_t i = 0; i < sphere.vertices.size(); ++i)
+        {
+            sphere.vertices[i] *= 3;
+        }
+
+        std::printf("Sphere occluder, %6d triangles: %.0f triangles/ms\n",
+            sphere.GetTriangleCount(), GetOccluderTrianglesPerMs(buffer, viewProjection,
+                sphere, ringCount > 64 ? 20 : 400));
+    }
+
+    std::printf("Wall occluder, %6d triangles: %.0f triangles/ms\n", wall.GetTriangleCount(),
+        GetOccluderTrianglesPerMs(buffer, viewProjection, wall, 2000));
+
+    {
+        const int REPETITION_COUNT = 20;
+
+        const BenchmarkTimer timer;
+        for (int i = 0; i < REPETITION_COUNT; ++i)
+        {
+            buffer.BuildHierarchy();
+        }
+
+        std::printf("Hierarchy build: %.3f ms\n", timer.GetSeconds() * 1000 / REPETITION_COUNT);
+    }
+
+    {
+        const int REPETITION_COUNT = 5;
+
+        std::vector<XMFLOAT3> boxes;
+        for (int i = 0; i < 100000; ++i)
+        {
+            const XMFLOAT3 center(-9 + 18 * distribution(generator),
+                -5 + 10 * distribution(generator), -5 + 25 * distribution(generator));
+            const float extent = 0.05f + 0.5f * distribution(generator);
+
+            boxes.push_back(XMFLOAT3(center.x - extent, center.y - extent, center.z - extent));
+            boxes.push_back(XMFLOAT3(center.x + extent, center.y + extent, center.z + extent));
+        }
+
+        int boxOccludedCount = 0;
+
+        const BenchmarkTimer timer;
+        for (int i = 0; i < REPETITION_COUNT; ++i)
+        {
+            for (std::size_t j = 0; j < boxes.size(); j += 2)
+            {
+                boxOccludedCount += buffer.IsOccluded(viewProjection,
+                    XMLoadFloat3(&boxes[j]), XMLoadFloat3(&boxes[j + 1]));
+            }
+        }
+        const double seconds = timer.GetSeconds();
+
+        std::printf("Box tests: %.0f per ms, %d of %d occluded\n",
+            REPETITION_COUNT * boxes.size() / 2 / (seconds * 1000),
+            boxOccludedCount / REPETITION_COUNT, static_cast<int>(boxes.size() / 2));
+    }
+
+    return falseOcclusionCount == 0;
+}
@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include "GeometryFX_Benchmark.h"
+#include "TestGeometry.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+#include "AMD_GeometryFX_Internal.h"
+#include "GeometryFXSmallBatchPacking.h"
+#include "GeometryFXWorkerPool.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+/**
+The batches and draw arguments of all chunks, as the bytes uploaded to
+the GPU.
+*/
+void GetPackedBytes(const SmallBatchPacker &packer, std::vector<unsigned char> &bytes)
+{
+    bytes.clear();
+
+    for (int i = 0; i < packer.GetChunkCount(0); ++i)
+    {
+        const SmallBatchChunkData &chunk = packer.GetChunk(0, i);
+
+        const std::vector<SmallBatchData> &batches = chunk.GetSmallBatchData();
+        const unsigned char *batchBytes = reinterpret_cast<const unsigned char *>(batches.data());
+        bytes.insert(bytes.end(), batchBytes,
+            batchBytes + chunk.GetBatchCount() * sizeof(SmallBatchData));
+
+        const std::vector<DrawCallArguments> &draws = chunk.GetDrawCallArguments();
+        const unsigned char *drawBytes = reinterpret_cast<const unsigned char *>(draws.data());
+        bytes.insert(bytes.end(), drawBytes,
+            drawBytes + chunk.GetDrawCallCount() * sizeof(DrawCallArguments));
+    }
+}
+}
+
+/**
+Pack 100k instances of 32 meshes into small batch chunks on 1..N threads,
+with all filters enabled. The packed chunks must not depend on the thread
+count.
+*/
+bool BenchmarkSmallBatchPacking()
+{
+    const int MESH_COUNT = 32;
+    const int INSTANCE_COUNT = 100000;
+    const int REPETITION_COUNT = 7;
+
+    std::mt19937 generator(3);
+
+    std::vector<std::unique_ptr<StaticMesh>> meshes;
+    for (int i = 0; i < MESH_COUNT; ++i)
+    {
+        TestMesh mesh;
+        GenerateGeometryChunk(500 + static_cast<int>(generator() % 4000), mesh);
+
+        ClusterBuilderOptions options;
+        options.spatialClusters = true;
+        meshes.push_back(CreateStaticMesh(mesh, i, options, nullptr));
+    }
+
+    GeometryFX_FilterRenderOptions options;
+    options.enabledFilters = 0xFFFFFFFF;
+
+    GeometryFX_FilterStatistics statistics;
+    options.statistics = &statistics;
+
+    const FilterContext filterContext = CreateFilterContext(options,
+        XMMatrixLookAtLH(XMVectorSet(0, 0, -5, 1), XMVectorSet(0, 0, 0, 1),
+            XMVectorSet(0, 1, 0, 0)),
+        XMMatrixPerspectiveFovLH(1.0f, 1.6f, 0.1f, 1000.0f), 1920, 1080);
+
+    // Small instances in front of the eye, some of them outside the frustum
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<DrawCommand> drawCommands(INSTANCE_COUNT);
+    for (int i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        const int meshIndex = static_cast<int>(generator() % MESH_COUNT);
+
+        DrawCommand &drawCommand = drawCommands[i];
+        drawCommand.mesh = meshes[meshIndex].get();
+        drawCommand.drawCallId = i;
+        drawCommand.dcb.meshIndex = meshIndex;
+        drawCommand.dcb.world = XMMatrixScaling(0.05f, 0.05f, 0.05f) *
+            XMMatrixRotationY(3 * distribution(generator)) *
+            XMMatrixTranslation(8 * distribution(generator), 5 * distribution(generator),
+                20 + 19 * distribution(generator));
+        drawCommand.dcb.worldView = drawCommand.dcb.world * filterContext.view;
+    }
+
+    std::vector<unsigned char> referenceBytes;
+    std::vector<unsigned char> bytes;
+    double singleThreadSeconds = 0;
+    bool passed = true;
+
+    const std::vector<int> threadCounts = GetBenchmarkThreadCounts();
+    for (std::size_t i = 0; i < threadCounts.size(); ++i)
+    {
+        WorkerPool pool(threadCounts[i]);
+        SmallBatchPacker packer(SmallBatchMergeConstants::BATCH_SIZE,
+            SmallBatchMergeConstants::BATCH_COUNT);
+
+        // The first run allocates the chunks, which are kept afterwards
+        packer.Pack(pool, drawCommands, &filterContext, 1, nullptr);
+
+        double seconds = 0;
+        for (int j = 0; j < REPETITION_COUNT; ++j)
+        {
+            statistics = GeometryFX_FilterStatistics();
+
+            const BenchmarkTimer timer;
+            packer.Pack(pool, drawCommands, &filterContext, 1, &statistics);
+            const double repetitionSeconds = timer.GetSeconds();
+
+            seconds = (j == 0) ? repetitionSeconds : std::min(seconds, repetitionSeconds);
+        }
+
+        GetPackedBytes(packer, bytes);
+        if (i == 0)
+        {
+            referenceBytes = bytes;
+            singleThreadSeconds = seconds;
+        }
+
+        int batchCount = 0;
+        int faceCount = 0;
+        for (int j = 0; j < packer.GetChunkCount(0); ++j)
+        {
+            batchCount += packer.GetChunk(0, j).GetBatchCount();
+            faceCount += packer.GetChunk(0, j).GetFaceCount();
+        }
+
+        const bool identical = bytes == referenceBytes;
+        passed &= identical;
+
+        std::printf("%2d threads: %6.2f ms, %.2fx, %d chunks, %d batches, %d triangles, "
+            "%lld instances and %lld of %lld clusters culled, %s\n",
+            threadCounts[i], seconds * 1000, singleThreadSeconds / seconds,
+            packer.GetChunkCount(0), batchCount, faceCount,
+            static_cast<long long>(statistics.instancesCulled),
+            static_cast<long long>(statistics.clustersCulled),
+            static_cast<long long>(statistics.clustersProcessed),
+            identical ? "identical" : "DIFFERENT");
+    }
+
+    return passed;
+}
@@ -0,0 +1,217 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+
+#include "GeometryFX_Benchmark.h"
+#include "TestGeometry.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "AMD_GeometryFX_Internal.h"
+#include "GeometryFXReferenceFilter.h"
+#include "GeometryFXTriangleCulling.h"
+#include "GeometryFXWorkerPool.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+/**
+Cull the triangles repeatedly on the calling thread with the given kernel.
+Returns the best time of a run in seconds, and the number of kept triangles
+in keptTriangleCount.
+*/
+double TimeCullTriangles(const TriangleCullingView &view, const std::vector<float> &vertices,
+    const std::vector<uint32> &indices, const TriangleCullingKernel kernel,
+    std::vector<uint32> &output, int &keptTriangleCount)
+{
+    const int RUN_COUNT = 20;
+    const int REPETITION_COUNT = 50;
+
+    const int triangleCount = static_cast<int>(indices.size() / 3);
+    double bestSeconds = std::numeric_limits<double>::max();
+
+    for (int run = 0; run < RUN_COUNT; ++run)
+    {
+        const BenchmarkTimer timer;
+        for (int i = 0; i < REPETITION_COUNT; ++i)
+        {
+            keptTriangleCount = CullTriangles(view, vertices.data(), indices.data(),
+                triangleCount, kernel, output.data());
+        }
+        bestSeconds = std::min(bestSeconds, timer.GetSeconds() / REPETITION_COUNT);
+    }
+
+    return bestSeconds;
+}
+
+const char *GetKernelName(const TriangleCullingKernel kernel)
+{
+    return kernel == TRIANGLE_CULLING_KERNEL_AVX2 ? "AVX2" : "reference";
+}
+}
+
+/**
+Cull a dense sphere on one thread with the reference and the AVX2 kernel,
+with all filters, from in front of it, from its center (half of the
+vertices are behind the eye) and with some NaN vertices. Both kernels must
+keep the same triangles. Then filter packed chunks of a scene with
+CullSmallBatchChunk on the worker threads, against the single threaded
+FilterSmallBatchChunk.
+*/
+bool BenchmarkTriangleCulling()
+{
+    std::printf("Selected kernel: %s\n", GetKernelName(GetTriangleCullingKernel()));
+
+    TestMesh sphere;
+    GenerateBumpySphere(300, sphere);
+
+    const std::vector<uint32> indices(sphere.indices.begin(), sphere.indices.end());
+    const int triangleCount = sphere.GetTriangleCount();
+
+    const XMMATRIX projection = XMMatrixPerspectiveFovLH(1.0f, 1.6f, 0.1f, 100.0f);
+
+    std::vector<float> nanVertices(sphere.vertices);
+    for (std::size_t i = 0; i < nanVertices.size(); i += 97 * 3)
+    {
+        nanVertices[i] = std::numeric_limits<float>::quiet_NaN();
+    }
+
+    struct Case
+    {
+        const char *name;
+        const std::vector<float> *vertices;
+        XMMATRIX world;
+    };
+
+    const Case cases[] = {
+        { "In front", &sphere.vertices, XMMatrixTranslation(0, 0, 3) },
+        { "Eye inside", &sphere.vertices, XMMatrixIdentity() },
+        { "NaN vertices", &nanVertices, XMMatrixTranslation(0, 0, 3) }
+    };
+
+    TriangleCullingView view;
+    view.cullFlags = 0xFFFFFFFF;
+    view.windowWidth = 1920;
+    view.windowHeight = 1080;
+
+    std::printf("%d triangles, one thread\n", triangleCount);
+
+    std::vector<uint32> referenceOutput(indices.size());
+    std::vector<uint32> output(indices.size());
+
+    bool passed = true;
+
+    for (const Case &c : cases)
+    {
+        view.worldViewProjection = c.world * projection;
+
+        int referenceCount = 0;
+        const double referenceSeconds = TimeCullTriangles(view, *c.vertices, indices,
+            TRIANGLE_CULLING_KERNEL_REFERENCE, referenceOutput, referenceCount);
+
+        int count = 0;
+        const double seconds = TimeCullTriangles(view, *c.vertices, indices,
+            TRIANGLE_CULLING_KERNEL_AVX2, output, count);
+
+        const bool same = count == referenceCount && std::memcmp(output.data(),
+            referenceOutput.data(), count * 3 * sizeof(uint32)) == 0;
+
+        std::printf("  %-12s %5.1f%% kept, reference %6.1f M triangles/s, "
+            "AVX2 %6.1f M triangles/s, %.2fx%s\n", c.name,
+            100.0 * referenceCount / triangleCount, triangleCount / referenceSeconds * 1e-6,
+            triangleCount / seconds * 1e-6, referenceSeconds / seconds,
+            same ? "" : ", DIFFERENT");
+
+        passed &= same;
+    }
+
+    // The chunks of a scene, as the filter dispatch would see them
+    TestScene scene;
+    GenerateTestScene(16, 1000, 7, scene);
+
+    const FrameConstantBuffer frame = scene.GetFrame(0xFFFFFFFF);
+
+    std::vector<const SmallBatchChunkData *> chunks;
+    int chunkTriangleCount = 0;
+
+    WorkerPool packingPool(1);
+    SmallBatchPacker packer(SmallBatchMergeConstants::BATCH_SIZE,
+        SmallBatchMergeConstants::BATCH_COUNT);
+    packer.Pack(packingPool, scene.drawCommands, &scene.filterContext, 1, nullptr);
+
+    for (int i = 0; i < packer.GetChunkCount(0); ++i)
+    {
+        chunks.push_back(&packer.GetChunk(0, i));
+        chunkTriangleCount += packer.GetChunk(0, i).GetFaceCount();
+    }
+
+    std::vector<uint32> filteredIndices;
+    std::vector<IndirectArguments> indirectArguments;
+
+    double referenceSeconds = 0;
+    {
+        const BenchmarkTimer timer;
+        for (const SmallBatchChunkData *chunk : chunks)
+        {
+            FilterSmallBatchChunk(frame, scene.vertexData.data(), scene.indexData.data(),
+                scene.meshConstants.data(), *chunk, filteredIndices, indirectArguments);
+        }
+        referenceSeconds = timer.GetSeconds();
+    }
+
+    std::printf("%d triangles in %d chunks\n", chunkTriangleCount,
+        static_cast<int>(chunks.size()));
+    std::printf("  FilterSmallBatchChunk:        %6.1f M triangles/s\n",
+        chunkTriangleCount / referenceSeconds * 1e-6);
+
+    for (const int threadCount : GetBenchmarkThreadCounts())
+    {
+        WorkerPool pool(threadCount);
+
+        double seconds = std::numeric_limits<double>::max();
+        for (int run = 0; run < 5; ++run)
+        {
+            const BenchmarkTimer timer;
+            for (const SmallBatchChunkData *chunk : chunks)
+            {
+                CullSmallBatchChunk(pool, frame, scene.vertexData.data(),
+                    scene.indexData.data(), scene.meshConstants.data(), *chunk,
+                    filteredIndices, indirectArguments);
+            }
+            seconds = std::min(seconds, timer.GetSeconds());
+        }
+
+        std::printf("  CullSmallBatchChunk, %2d threads: %6.1f M triangles/s, "
+            "%6.1f M triangles/s per core\n", threadCount, chunkTriangleCount / seconds * 1e-6,
+            chunkTriangleCount / seconds * 1e-6 / threadCount);
+    }
+
+    return passed;
+}
@@ -0,0 +1,126 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: GeometryFX_Benchmark.cpp
+//
+// CPU benchmarks of the GeometryFX internals. Run without arguments to run
+// all benchmarks, or pass the names of the ones to run.
+//--------------------------------------------------------------------------------------
+
+#include "GeometryFX_Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+struct Benchmark
+{
+    const char *name;
+    bool (*function)();
+};
+
+const Benchmark benchmarks[] = {
+    { "cluster-builder", BenchmarkClusterBuilder },
+    { "cluster-culling", BenchmarkClusterCulling },
+    { "cluster-lod", BenchmarkClusterLod },
+    { "occlusion-buffer", BenchmarkOcclusionBuffer },
+    { "small-batch-packing", BenchmarkSmallBatchPacking },
+    { "triangle-culling", BenchmarkTriangleCulling }
+};
+
+const int benchmarkCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+bool RunBenchmark(const Benchmark &benchmark)
+{
+    std::printf("--- %s ---\n", benchmark.name);
+    const bool passed = benchmark.function();
+    std::printf("\n");
+
+    if (!passed)
+    {
+        std::printf("%s: FAILED\n\n", benchmark.name);
+    }
+
+    return passed;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::vector<int> GetBenchmarkThreadCounts()
+{
+    const int hardwareThreadCount =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+    std::vector<int> threadCounts;
+    for (int threadCount = 1; threadCount < hardwareThreadCount; threadCount *= 2)
+    {
+        threadCounts.push_back(threadCount);
+    }
+    threadCounts.push_back(hardwareThreadCount);
+
+    return threadCounts;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    bool passed = true;
+
+    if (argc < 2)
+    {
+        for (int i = 0; i < benchmarkCount; ++i)
+        {
+            passed &= RunBenchmark(benchmarks[i]);
+        }
+
+        return passed ? 0 : 1;
+    }
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        int i = 0;
+        while (i < benchmarkCount && std::strcmp(benchmarks[i].name, argv[arg]) != 0)
+        {
+            ++i;
+        }
+
+        if (i == benchmarkCount)
+        {
+            std::printf("Unknown benchmark %s. Available benchmarks:\n", argv[arg]);
+            for (i = 0; i < benchmarkCount; ++i)
+            {
+                std::printf("  %s\n", benchmarks[i].name);
+            }
+
+            return 1;
+        }
+
+        passed &= RunBenchmark(benchmarks[i]);
+    }
+
+    return passed ? 0 : 1;
+}
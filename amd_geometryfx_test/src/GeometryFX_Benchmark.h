@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_GEOMETRYFX_BENCHMARK_H
+#define AMD_GEOMETRYFX_BENCHMARK_H
+
+#include <chrono>
+#include <vector>
+
+/**
+Measures wall clock time.
+*/
+class BenchmarkTimer
+{
+public:
+    BenchmarkTimer()
+        : start_(std::chrono::high_resolution_clock::now())
+    {
+    }
+
+    /**
+    Seconds since the timer was created.
+    */
+    double GetSeconds() const
+    {
+        return std::chrono::duration<double>(
+            std::chrono::high_resolution_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::high_resolution_clock::time_point start_;
+};
+
+/**
+The thread counts to measure scaling with: 1, 2, 4, ... and the number of
+hardware threads.
+*/
+std::vector<int> GetBenchmarkThreadCounts();
+
+/**
+Each benchmark prints its results to stdout. As the benchmarks also check
+that the results of the variants they compare agree, they return false if
+that is not the case.
+*/
+bool BenchmarkClusterBuilder();
+bool BenchmarkClusterCulling();
+bool BenchmarkClusterLod();
+bool BenchmarkOcclusionBuffer();
+bool BenchmarkSmallBatchPacking();
+bool BenchmarkTriangleCulling();
+
+#endif // AMD_GEOMETRYFX_BENCHMARK_H
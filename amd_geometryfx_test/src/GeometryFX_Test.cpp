@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: GeometryFX_Test.cpp
+//
+// Tests of the CPU side of GeometryFX. Run without arguments to run all
+// tests, or pass the names of the ones to run. Returns non-zero if any test
+// failed.
+//--------------------------------------------------------------------------------------
+
+#include "GeometryFX_Test.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+struct Test
+{
+    const char *name;
+    void (*function)();
+};
+
+const Test tests[] = {
+    { "chunk-pool", TestChunkPool },
+    { "cluster-cache", TestClusterCache },
+    { "cluster-lod", TestClusterLod },
+    { "cluster-visibility", TestClusterVisibility },
+    { "instance-culling", TestInstanceCulling },
+    { "multi-view-packing", TestMultiViewPacking },
+    { "object-space-eye", TestObjectSpaceEye },
+    { "packed-clusters", TestPackedClusters },
+    { "reference-filter", TestReferenceFilter },
+    { "reference-filter-chunks", TestReferenceFilterChunks },
+    { "temporal-occlusion", TestTemporalOcclusion },
+    { "triangle-culling-kernels", TestTriangleCullingKernels },
+    { "cull-small-batch-chunk", TestCullSmallBatchChunk }
+};
+
+const int testCount = sizeof(tests) / sizeof(tests[0]);
+
+// Failed checks of the running test
+int failedCheckCount = 0;
+
+bool RunTest(const Test &test)
+{
+    failedCheckCount = 0;
+    test.function();
+
+    if (failedCheckCount == 0)
+    {
+        std::printf("%s: passed\n", test.name);
+    }
+    else
+    {
+        std::printf("%s: FAILED, %d failed checks\n", test.name, failedCheckCount);
+    }
+
+    return failedCheckCount == 0;
+}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+bool ReportTestCheck(const bool passed, const char *condition, const char *file, const int line)
+{
+    if (!passed)
+    {
+        std::printf("%s(%d): check failed: %s\n", file, line, condition);
+        ++failedCheckCount;
+    }
+
+    return passed;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[])
+{
+    bool passed = true;
+
+    if (argc < 2)
+    {
+        for (int i = 0; i < testCount; ++i)
+        {
+            passed &= RunTest(tests[i]);
+        }
+
+        return passed ? 0 : 1;
+    }
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        int i = 0;
+        while (i < testCount && std::strcmp(tests[i].name, argv[arg]) != 0)
+        {
+            ++i;
+        }
+
+        if (i == testCount)
+        {
+            std::printf("Unknown test %s. Available tests:\n", argv[arg]);
+            for (i = 0; i < testCount; ++i)
+            {
+                std::printf("  %s\n", tests[i].name);
+            }
+
+            return 1;
+        }
+
+        passed &= RunTest(tests[i]);
+    }
+
+    return passed ? 0 : 1;
+}
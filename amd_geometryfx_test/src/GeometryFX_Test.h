@@ -0,0 +1,52 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_GEOMETRYFX_TEST_H
+#define AMD_GEOMETRYFX_TEST_H
+
+/**
+Check a condition of a test. A failed check is reported with its location
+and fails the test, which still runs to the end.
+*/
+#define TEST_CHECK(condition) ReportTestCheck((condition), #condition, __FILE__, __LINE__)
+
+/**
+Implementation of TEST_CHECK, returns passed.
+*/
+bool ReportTestCheck(const bool passed, const char *condition, const char *file, const int line);
+
+void TestChunkPool();
+void TestClusterCache();
+void TestClusterLod();
+void TestClusterVisibility();
+void TestInstanceCulling();
+void TestMultiViewPacking();
+void TestObjectSpaceEye();
+void TestPackedClusters();
+void TestReferenceFilter();
+void TestReferenceFilterChunks();
+void TestTemporalOcclusion();
+void TestTriangleCullingKernels();
+void TestCullSmallBatchChunk();
+
+#endif // AMD_GEOMETRYFX_TEST_H
@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+
+#include "GeometryFX_Test.h"
+
+#include <algorithm>
+#include <set>
+
+#include "GeometryFXChunkPool.h"
+
+using namespace AMD::GeometryFX_Internal;
+
+namespace
+{
+/**
+Stands in for the GPU: passes up to completedPass are done. chunkCount is
+the number of chunks alive.
+*/
+struct MockGpu
+{
+    int completedPass;
+    int chunkCount;
+};
+
+struct MockChunk
+{
+    explicit MockChunk(MockGpu &gpu)
+        : gpu(gpu)
+        , submittedPass(-1)
+        , batchCount(0)
+    {
+        ++gpu.chunkCount;
+    }
+
+    ~MockChunk()
+    {
+        --gpu.chunkCount;
+    }
+
+    bool IsIdle()
+    {
+        return submittedPass < 0 || submittedPass <= gpu.completedPass;
+    }
+
+    void Reserve(const int count)
+    {
+        batchCount = std::max(batchCount, count);
+    }
+
+    MockGpu &gpu;
+    int submittedPass;
+    int batchCount;
+};
+}
+
+/**
+Run passes of a few chunks each on a GPU which is one pass behind, with a
+single pass of many chunks in between. The pool must never hand out a chunk
+the GPU still uses, must grow for the spike and shrink back once the spike
+was idle for a trim interval, while the high-water mark keeps the spike.
+*/
+void TestChunkPool()
+{
+    const int STEADY_CHUNK_COUNT = 2;
+    const int SPIKE_CHUNK_COUNT = 20;
+    const int SPIKE_PASS = 10;
+    const int PASS_COUNT = SPIKE_PASS + 2 * ChunkPool<MockChunk>::TRIM_INTERVAL + 1;
+
+    MockGpu gpu = { -1, 0 };
+    ChunkPool<MockChunk> pool([&gpu]()
+    {
+        return new MockChunk(gpu);
+    });
+
+    int busyChunkCount = 0;
+    int spikeChunkCount = 0;
+
+    for (int pass = 0; pass < PASS_COUNT; ++pass)
+    {
+        gpu.completedPass = pass - 2;
+
+        const int chunkCount = (pass == SPIKE_PASS) ? SPIKE_CHUNK_COUNT : STEADY_CHUNK_COUNT;
+        std::set<MockChunk *> passChunks;
+
+        for (int i = 0; i < chunkCount; ++i)
+        {
+            MockChunk *chunk = pool.Acquire(16 * (i + 1));
+
+            busyChunkCount += !chunk->IsIdle();
+            passChunks.insert(chunk);
+
+            TEST_CHECK(chunk->batchCount >= 16 * (i + 1));
+            chunk->submittedPass = pass;
+        }
+
+        TEST_CHECK(static_cast<int>(passChunks.size()) == chunkCount);
+
+        pool.EndPass();
+
+        if (pass == SPIKE_PASS)
+        {
+            spikeChunkCount = pool.GetChunkCount();
+        }
+    }
+
+    TEST_CHECK(busyChunkCount == 0);
+    TEST_CHECK(gpu.chunkCount == pool.GetChunkCount());
+    TEST_CHECK(spikeChunkCount >= SPIKE_CHUNK_COUNT);
+    TEST_CHECK(pool.GetHighWaterMark() == spikeChunkCount);
+
+    // Two passes in flight, plus the chunks the GPU finished in between
+    TEST_CHECK(pool.GetChunkCount() <= 3 * STEADY_CHUNK_COUNT);
+}
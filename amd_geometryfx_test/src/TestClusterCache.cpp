@@ -0,0 +1,241 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+
+#include "GeometryFX_Test.h"
+#include "TestGeometry.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "GeometryFXClusterBuilder.h"
+#include "GeometryFXClusterCache.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+// The cache files are written to the working directory and removed again
+const char *const CACHE_DIRECTORY = ".";
+
+std::string GetCacheFileName(const uint64 key)
+{
+    char name[32];
+    std::sprintf(name, "%016llx.gfxclusters", static_cast<unsigned long long>(key));
+    return name;
+}
+
+std::vector<char> ReadFile(const std::string &fileName)
+{
+    std::vector<char> contents;
+
+    FILE *handle = std::fopen(fileName.c_str(), "rb");
+    if (handle != nullptr)
+    {
+        char buffer[4096];
+        std::size_t size;
+        while ((size = std::fread(buffer, 1, sizeof(buffer), handle)) > 0)
+        {
+            contents.insert(contents.end(), buffer, buffer + size);
+        }
+        std::fclose(handle);
+    }
+
+    return contents;
+}
+
+void WriteFile(const std::string &fileName, const std::vector<char> &contents)
+{
+    FILE *handle = std::fopen(fileName.c_str(), "wb");
+    if (handle != nullptr)
+    {
+        std::fwrite(contents.data(), 1, contents.size(), handle);
+        std::fclose(handle);
+    }
+}
+
+bool IsSameCluster(const Cluster &a, const Cluster &b)
+{
+    return XMVector3Equal(a.aabbMin, b.aabbMin) && XMVector3Equal(a.aabbMax, b.aabbMax) &&
+        XMVector3Equal(a.coneCenter, b.coneCenter) && XMVector3Equal(a.coneAxis, b.coneAxis) &&
+        a.coneAngleCosine == b.coneAngleCosine && a.valid == b.valid &&
+        a.firstTriangle == b.firstTriangle && a.triangleCount == b.triangleCount;
+}
+
+bool IsSameOutput(const ClusterBuilderOutput &a, const ClusterBuilderOutput &b)
+{
+    if (a.clusters.size() != b.clusters.size() || a.baseClusterCount != b.baseClusterCount ||
+        a.clusterLods.size() != b.clusterLods.size() ||
+        a.reorderedIndices != b.reorderedIndices)
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < a.clusters.size(); ++i)
+    {
+        if (!IsSameCluster(a.clusters[i], b.clusters[i]))
+        {
+            return false;
+        }
+    }
+
+    return a.clusterLods.empty() || std::memcmp(a.clusterLods.data(), b.clusterLods.data(),
+        a.clusterLods.size() * sizeof(ClusterLod)) == 0;
+}
+
+/**
+Store the clusters of mesh, load them back and check that damaged files and
+files built with other options are rejected.
+*/
+void TestClusterCacheOptions(const ClusterBuilderInput &input, const ClusterBuilderOptions &options)
+{
+    ClusterBuilderOutput output;
+    BuildClusters(options, input, output);
+
+    const uint64 key = ComputeClusterCacheKey(options, input);
+    const std::string fileName = GetCacheFileName(key);
+
+    TEST_CHECK(StoreClusterCache(CACHE_DIRECTORY, key, options, input, output));
+
+    const std::vector<char> contents = ReadFile(fileName);
+    TEST_CHECK(!contents.empty());
+
+    // Round trip
+    ClusterBuilderOutput loaded;
+    TEST_CHECK(LoadClusterCache(CACHE_DIRECTORY, key, options, input, loaded));
+    TEST_CHECK(loaded.loadedFromCache);
+    TEST_CHECK(IsSameOutput(output, loaded));
+
+    // Truncated files, at the end and within the header. A failed load
+    // leaves the output alone.
+    ClusterBuilderOutput rejected;
+    rejected.baseClusterCount = -1;
+
+    WriteFile(fileName, std::vector<char>(contents.begin(), contents.end() - 4));
+    TEST_CHECK(!LoadClusterCache(CACHE_DIRECTORY, key, options, input, rejected));
+
+    WriteFile(fileName, std::vector<char>(contents.begin(), contents.begin() + 16));
+    TEST_CHECK(!LoadClusterCache(CACHE_DIRECTORY, key, options, input, rejected));
+
+    TEST_CHECK(rejected.baseClusterCount == -1 && rejected.clusters.empty());
+
+    // An index out of range. The indices are at the end of the file.
+    if (!output.reorderedIndices.empty())
+    {
+        std::vector<char> corrupted(contents);
+        const int32 outOfRange = input.vertexCount;
+        std::memcpy(corrupted.data() + corrupted.size() - sizeof(int32), &outOfRange,
+            sizeof(int32));
+        WriteFile(fileName, corrupted);
+        TEST_CHECK(!LoadClusterCache(CACHE_DIRECTORY, key, options, input, rejected));
+    }
+
+    // Files written with other options are rejected, even under the same key
+    WriteFile(fileName, contents);
+
+    ClusterBuilderOptions smallerClusters(options);
+    smallerClusters.maximumTrianglesPerCluster = options.maximumTrianglesPerCluster / 2;
+    TEST_CHECK(!LoadClusterCache(CACHE_DIRECTORY, key, smallerClusters, input, rejected));
+
+    ClusterBuilderOptions otherCones(options);
+    otherCones.coneType = (options.coneType == CLUSTER_CONE_MINIMAL) ?
+        CLUSTER_CONE_AVERAGE_NORMAL : CLUSTER_CONE_MINIMAL;
+    TEST_CHECK(!LoadClusterCache(CACHE_DIRECTORY, key, otherCones, input, rejected));
+
+    ClusterBuilderOptions otherLod(options);
+    otherLod.buildLod = !options.buildLod;
+    TEST_CHECK(!LoadClusterCache(CACHE_DIRECTORY, key, otherLod, input, rejected));
+
+    TEST_CHECK(LoadClusterCache(CACHE_DIRECTORY, key, options, input, rejected));
+
+    std::remove(fileName.c_str());
+}
+}
+
+/**
+The cluster cache on a sphere, with and without reordered indices and
+level of detail. BuildClusters must load what it stored before, and rebuild
+if the cluster size changes.
+*/
+void TestClusterCache()
+{
+    TestMesh sphere;
+    GenerateBumpySphere(40, sphere);
+
+    ClusterBuilderInput input;
+    input.indexCount = static_cast<int>(sphere.indices.size());
+    input.vertexCount = sphere.GetVertexCount();
+    input.vertexData = sphere.vertices.data();
+    input.indexData = sphere.indices.data();
+
+    ClusterBuilderOptions options;
+    TestClusterCacheOptions(input, options);
+
+    options.spatialClusters = true;
+    options.maximumVerticesPerCluster = 64;
+    options.optimizeVertexCache = true;
+    TestClusterCacheOptions(input, options);
+
+    options.optimizeVertexCache = false;
+    options.buildLod = true;
+    options.coneType = CLUSTER_CONE_MINIMAL;
+    TestClusterCacheOptions(input, options);
+
+    // Through the builder: the first build stores, the second loads, and a
+    // different cluster size rebuilds
+    options.cacheDirectory = CACHE_DIRECTORY;
+
+    ClusterBuilderOutput stored;
+    BuildClusters(options, input, stored);
+    TEST_CHECK(!stored.loadedFromCache);
+
+    ClusterBuilderOutput loaded;
+    BuildClusters(options, input, loaded);
+    TEST_CHECK(loaded.loadedFromCache);
+    TEST_CHECK(IsSameOutput(stored, loaded));
+
+    ClusterBuilderOptions smallerClusters(options);
+    smallerClusters.maximumTrianglesPerCluster = 64;
+
+    ClusterBuilderOutput rebuilt;
+    BuildClusters(smallerClusters, input, rebuilt);
+    TEST_CHECK(!rebuilt.loadedFromCache);
+
+    smallerClusters.cacheDirectory.clear();
+    ClusterBuilderOutput uncached;
+    BuildClusters(smallerClusters, input, uncached);
+    TEST_CHECK(IsSameOutput(rebuilt, uncached));
+
+    for (int i = 0; i < rebuilt.baseClusterCount; ++i)
+    {
+        TEST_CHECK(rebuilt.clusters[i].triangleCount <= 64);
+    }
+
+    std::remove(GetCacheFileName(ComputeClusterCacheKey(options, input)).c_str());
+    std::remove(GetCacheFileName(ComputeClusterCacheKey(smallerClusters, input)).c_str());
+}
@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "GeometryFX_Test.h"
+#include "TestGeometry.h"
+
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+#include "GeometryFXClusterBuilder.h"
+
+using namespace AMD::GeometryFX_Internal;
+
+namespace
+{
+void TestMeshLod(const TestMesh &mesh)
+{
+    ClusterBuilderInput input;
+    input.indexCount = static_cast<int>(mesh.indices.size());
+    input.vertexCount = mesh.GetVertexCount();
+    input.vertexData = mesh.vertices.data();
+    input.indexData = mesh.indices.data();
+
+    ClusterBuilderOptions options;
+    options.spatialClusters = true;
+    options.buildLod = true;
+
+    ClusterBuilderOutput output;
+    BuildClusters(options, input, output);
+
+    TEST_CHECK(output.clusterLods.size() == output.clusters.size());
+    TEST_CHECK(static_cast<int>(output.clusters.size()) > output.baseClusterCount);
+
+    // A parent never has a smaller error or sphere, otherwise a selection
+    // could contain two levels of the same part of the mesh
+    int nonMonotonicCount = 0;
+
+    for (std::size_t i = 0; i < output.clusterLods.size(); ++i)
+    {
+        const ClusterLod &lod = output.clusterLods[i];
+
+        if (i < static_cast<std::size_t>(output.baseClusterCount) && lod.error != 0)
+        {
+            ++nonMonotonicCount;
+        }
+
+        if (lod.parentError != FLT_MAX &&
+            (lod.parentError < lod.error || lod.parentRadius < lod.radius))
+        {
+            ++nonMonotonicCount;
+        }
+    }
+
+    TEST_CHECK(nonMonotonicCount == 0);
+
+    float meshRadius = 0;
+    for (std::size_t i = 0; i < mesh.vertices.size(); ++i)
+    {
+        meshRadius = std::max(meshRadius, std::abs(mesh.vertices[i]));
+    }
+
+    const float projectionScale = 1080 * 0.5f / std::tan(0.5f * 3.14159265f / 3);
+    const float thresholds[] = { 0.5f, 1, 2, 8 };
+
+    std::vector<int> indices;
+    int clusterCount = 0;
+
+    GetLodSelection(output, DirectX::XMFLOAT3(0, 0, 0), projectionScale, 0, indices,
+        clusterCount);
+    const MeshEdges fullDetailEdges =
+        GetMeshEdges(indices.data(), static_cast<int>(indices.size() / 3));
+
+    TEST_CHECK(clusterCount == output.baseClusterCount);
+    TEST_CHECK(indices.size() == mesh.indices.size());
+
+    // Eyes in random directions, from close to far away
+    std::mt19937 generator(1);
+    std::normal_distribution<float> direction(0, 1);
+    std::uniform_real_distribution<float> logDistance(std::log(1.5f), std::log(300.0f));
+
+    int newOpenEdgeCount = 0;
+    int simplifiedSelectionCount = 0;
+
+    for (int view = 0; view < 100; ++view)
+    {
+        DirectX::XMFLOAT3 eye(direction(generator), direction(generator), direction(generator));
+        const float scale = meshRadius * std::exp(logDistance(generator)) /
+            std::sqrt(eye.x * eye.x + eye.y * eye.y + eye.z * eye.z);
+        eye.x *= scale;
+        eye.y *= scale;
+        eye.z *= scale;
+
+        for (const float threshold : thresholds)
+        {
+            indices.clear();
+            GetLodSelection(output, eye, projectionScale, threshold, indices, clusterCount);
+
+            newOpenEdgeCount += CountNewOpenEdges(
+                GetMeshEdges(indices.data(), static_cast<int>(indices.size() / 3)),
+                fullDetailEdges);
+
+            if (indices.size() < mesh.indices.size())
+            {
+                ++simplifiedSelectionCount;
+            }
+        }
+    }
+
+    TEST_CHECK(newOpenEdgeCount == 0);
+    TEST_CHECK(simplifiedSelectionCount > 0);
+}
+}
+
+/**
+Every level of detail selection must cover the mesh without adding holes.
+*/
+void TestClusterLod()
+{
+    TestMesh sphere;
+    GenerateBumpySphere(60, sphere);
+    TestMeshLod(sphere);
+
+    TestMesh chunk;
+    GenerateGeometryChunk(16384, chunk);
+    TestMeshLod(chunk);
+}
@@ -0,0 +1,304 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include "GeometryFX_Test.h"
+#include "TestGeometry.h"
+
+#include <random>
+
+#include "AMD_GeometryFX_Internal.h"
+#include "GeometryFXClusterVisibility.h"
+#include "GeometryFXOcclusionBuffer.h"
+#include "GeometryFXSmallBatchPacking.h"
+#include "GeometryFXWorkerPool.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+/**
+A unit square in the z = 0 plane, made of n * n quads.
+*/
+void GeneratePlate(const int n, TestMesh &mesh)
+{
+    for (int x = 0; x <= n; ++x)
+    {
+        for (int y = 0; y <= n; ++y)
+        {
+            mesh.vertices.push_back(static_cast<float>(x) / n);
+            mesh.vertices.push_back(static_cast<float>(y) / n);
+            mesh.vertices.push_back(0);
+        }
+    }
+
+    for (int x = 0; x < n; ++x)
+    {
+        for (int y = 0; y < n; ++y)
+        {
+            const int i = x * (n + 1) + y;
+            const int quad[] = { i, i + 1, i + n + 1, i + 1, i + n + 2, i + n + 1 };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+/**
+A temporal occluder mesh, which keeps its triangles for the occlusion
+buffer.
+*/
+std::unique_ptr<StaticMesh> CreateOccluderMesh(const TestMesh &mesh, const int meshIndex)
+{
+    ClusterBuilderOptions options;
+    options.spatialClusters = true;
+
+    std::vector<int> indices;
+    std::unique_ptr<StaticMesh> staticMesh = CreateStaticMesh(mesh, meshIndex, options, &indices);
+
+    staticMesh->isTemporalOccluder = true;
+    staticMesh->occluderVertices = mesh.vertices;
+    staticMesh->occluderIndices.assign(indices.begin(), indices.end());
+
+    return staticMesh;
+}
+
+/**
+Pack the draws, culling against occlusionBuffer, and record the clusters
+which are drawn in drawn. drawn is advanced to the next frame, so they can
+be read with ClusterVisibility::WasVisible.
+*/
+GeometryFX_FilterStatistics PackDraws(SmallBatchPacker &packer, WorkerPool &pool,
+    const std::vector<DrawCommand> &drawCommands, const FilterContext &filterContext,
+    const OcclusionBuffer &occlusionBuffer, ClusterVisibility &drawn)
+{
+    drawn.BeginFrame();
+    for (std::size_t i = 0; i < drawCommands.size(); ++i)
+    {
+        drawn.AddDraw(drawCommands[i].dcb.meshIndex,
+            static_cast<int>(drawCommands[i].mesh->clusters.size()));
+    }
+
+    FilterContext context = filterContext;
+    context.occlusionBuffer = &occlusionBuffer;
+    context.clusterVisibility = &drawn;
+
+    GeometryFX_FilterStatistics statistics;
+    packer.Pack(pool, drawCommands, &context, 1, &statistics);
+
+    drawn.BeginFrame();
+
+    return statistics;
+}
+
+/**
+Count the clusters drawn in reference which are missing in drawn.
+*/
+int CountMissingClusters(const std::vector<DrawCommand> &drawCommands,
+    const ClusterVisibility &reference, const ClusterVisibility &drawn)
+{
+    int missingCount = 0;
+
+    for (int draw = 0; draw < static_cast<int>(drawCommands.size()); ++draw)
+    {
+        const int meshIndex = drawCommands[draw].dcb.meshIndex;
+        const int clusterCount = static_cast<int>(drawCommands[draw].mesh->clusters.size());
+
+        for (int cluster = 0; cluster < clusterCount; ++cluster)
+        {
+            if (reference.WasVisible(draw, meshIndex, cluster) &&
+                !drawn.WasVisible(draw, meshIndex, cluster))
+            {
+                ++missingCount;
+            }
+        }
+    }
+
+    return missingCount;
+}
+}
+
+/**
+The bookkeeping of ClusterVisibility across frames.
+*/
+void TestClusterVisibility()
+{
+    ClusterVisibility visibility;
+
+    visibility.BeginFrame();
+    visibility.AddDraw(0, 40);
+    visibility.AddDraw(1, 3);
+    visibility.AddDraw(0, 40);
+    visibility.SetVisible(0, 0);
+    visibility.SetVisible(0, 33);
+    visibility.SetVisible(2, 5);
+
+    // Nothing carries over into the first frame
+    TEST_CHECK(visibility.GetPreviousVisibility(0, 0) == nullptr);
+
+    visibility.BeginFrame();
+    visibility.AddDraw(0, 40);
+    visibility.AddDraw(2, 3);
+    visibility.AddDraw(0, 40);
+    visibility.AddDraw(0, 40);
+
+    TEST_CHECK(visibility.WasVisible(0, 0, 0));
+    TEST_CHECK(visibility.WasVisible(0, 0, 33));
+    TEST_CHECK(!visibility.WasVisible(0, 0, 1));
+    TEST_CHECK(!visibility.WasVisible(0, 0, 5));
+    TEST_CHECK(visibility.WasVisible(2, 0, 5));
+    TEST_CHECK(!visibility.WasVisible(2, 0, 0));
+
+    // A draw whose mesh changed, and a draw which is new, have no history
+    TEST_CHECK(visibility.GetPreviousVisibility(1, 2) == nullptr);
+    TEST_CHECK(visibility.GetPreviousVisibility(3, 0) == nullptr);
+
+    // Draw 1 was visible in the previous frame, but not in this one
+    visibility.SetVisible(1, 2);
+    visibility.BeginFrame();
+    TEST_CHECK(visibility.WasVisible(1, 2, 2));
+    TEST_CHECK(!visibility.WasVisible(0, 0, 0));
+
+    visibility.Reset();
+    TEST_CHECK(visibility.GetPreviousVisibility(1, 2) == nullptr);
+}
+
+/**
+32 plates in front of 3000 spheres, culled with the temporal occluders for
+several frames and triangle budgets. The temporal occluders are a subset of
+the scene, so every cluster drawn when culling against all of the scene must
+also be drawn with the temporal occluders.
+*/
+void TestTemporalOcclusion()
+{
+    const int PLATE_COUNT_X = 8;
+    const int PLATE_COUNT_Y = 4;
+    const int SPHERE_COUNT = 3000;
+    const int BUFFER_WIDTH = 256;
+    const int BUFFER_HEIGHT = 128;
+
+    TestMesh plate;
+    GeneratePlate(32, plate);
+
+    TestMesh sphere;
+    GenerateBumpySphere(16, sphere);
+
+    std::vector<std::unique_ptr<StaticMesh>> meshes;
+    meshes.push_back(CreateOccluderMesh(plate, 0));
+    meshes.push_back(CreateOccluderMesh(sphere, 1));
+
+    std::vector<DrawCommand> drawCommands;
+    const auto addDraw = [&](const int meshIndex, const XMMATRIX &world)
+    {
+        DrawCommand drawCommand;
+        drawCommand.mesh = meshes[meshIndex].get();
+        drawCommand.drawCallId = static_cast<int>(drawCommands.size());
+        drawCommand.dcb.meshIndex = meshIndex;
+        drawCommand.dcb.world = world;
+        drawCommands.push_back(drawCommand);
+    };
+
+    // A wall of plates at z = 0, with the spheres behind it and around it
+    for (int x = 0; x < PLATE_COUNT_X; ++x)
+    {
+        for (int y = 0; y < PLATE_COUNT_Y; ++y)
+        {
+            addDraw(0, XMMatrixScaling(1.5f, 1.5f, 1) *
+                XMMatrixTranslation(-6 + 1.5f * x, -3 + 1.5f * y, 0));
+        }
+    }
+
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    for (int i = 0; i < SPHERE_COUNT; ++i)
+    {
+        addDraw(1, XMMatrixScaling(0.3f, 0.3f, 0.3f) *
+            XMMatrixTranslation(9 * distribution(generator), 4.5f * distribution(generator),
+                17.5f + 12.5f * distribution(generator)));
+    }
+
+    GeometryFX_FilterRenderOptions options;
+    options.enabledFilters = GeometryFX_FilterFrustum | GeometryFX_ClusterFilterOcclusion;
+
+    const FilterContext filterContext = CreateFilterContext(options,
+        XMMatrixLookAtLH(XMVectorSet(0, 0, -10, 1), XMVectorSet(0, 0, 0, 1),
+            XMVectorSet(0, 1, 0, 0)),
+        XMMatrixPerspectiveFovLH(0.9f, 2.0f, 0.1f, 1000.0f), 1920, 960);
+
+    WorkerPool pool(1);
+    SmallBatchPacker packer(SmallBatchMergeConstants::BATCH_SIZE,
+        SmallBatchMergeConstants::BATCH_COUNT);
+
+    // The reference culls against all of the scene
+    OcclusionBuffer sceneBuffer(BUFFER_WIDTH, BUFFER_HEIGHT);
+    sceneBuffer.Clear();
+    for (std::size_t i = 0; i < drawCommands.size(); ++i)
+    {
+        const StaticMesh *mesh = drawCommands[i].mesh;
+        sceneBuffer.RasterizeTriangles(drawCommands[i].dcb.world * filterContext.viewProjection,
+            mesh->occluderVertices.data(), mesh->vertexCount, mesh->occluderIndices.data(),
+            mesh->indexCount);
+    }
+    sceneBuffer.BuildHierarchy();
+
+    ClusterVisibility reference;
+    const GeometryFX_FilterStatistics referenceStatistics =
+        PackDraws(packer, pool, drawCommands, filterContext, sceneBuffer, reference);
+
+    TEST_CHECK(referenceStatistics.clustersOcclusionCulled > 0);
+
+    const int budgets[] = { 65536, 8192, 1024 };
+    for (const int budget : budgets)
+    {
+        OcclusionBuffer temporalBuffer(BUFFER_WIDTH, BUFFER_HEIGHT);
+        ClusterVisibility visibility;
+
+        for (int frame = 0; frame < 4; ++frame)
+        {
+            temporalBuffer.Clear();
+            const int64 rasterizedTriangles = RasterizeTemporalOccluders(drawCommands,
+                filterContext.viewProjection, budget, visibility, temporalBuffer);
+            temporalBuffer.BuildHierarchy();
+
+            // Only whole clusters are rasterized, so the last one may go over
+            // the budget
+            TEST_CHECK(rasterizedTriangles <=
+                budget + SmallBatchMergeConstants::MAXIMUM_CLUSTER_SIZE);
+            TEST_CHECK(frame > 0 || rasterizedTriangles == 0);
+
+            // Filling in visibility for the next frame
+            FilterContext context = filterContext;
+            context.occlusionBuffer = &temporalBuffer;
+            context.clusterVisibility = &visibility;
+            packer.Pack(pool, drawCommands, &context, 1, nullptr);
+
+            ClusterVisibility drawn;
+            const GeometryFX_FilterStatistics statistics =
+                PackDraws(packer, pool, drawCommands, filterContext, temporalBuffer, drawn);
+
+            TEST_CHECK(CountMissingClusters(drawCommands, reference, drawn) == 0);
+            TEST_CHECK(frame == 0 || budget < 65536 || statistics.clustersOcclusionCulled > 0);
+        }
+    }
+}
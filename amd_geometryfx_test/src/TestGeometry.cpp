@@ -0,0 +1,380 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "TestGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <random>
+
+#include "GeometryFXClusterBounds.h"
+#include "GeometryFXInstanceCulling.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+const float PI = 3.14159265f;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GenerateGeometryChunk(const int faceCount, TestMesh &mesh)
+{
+    std::vector<float> &vertices = mesh.vertices;
+    std::vector<int> &indices = mesh.indices;
+
+    vertices.clear();
+    indices.clear();
+
+    const int quadCount = faceCount / 2;
+    const int rows = static_cast<int>(std::sqrt(static_cast<float>(quadCount)));
+    const int fullColumns =
+        static_cast<int>(std::floor(static_cast<float>(quadCount) / static_cast<float>(rows)));
+    const int columns =
+        static_cast<int>(std::ceil(static_cast<float>(quadCount) / static_cast<float>(rows)));
+
+    for (int i = 0; i < fullColumns + 1; ++i)
+    {
+        for (int j = 0; j < rows + 1; ++j)
+        {
+            vertices.push_back(static_cast<float>(i));
+            vertices.push_back(static_cast<float>(j));
+            vertices.push_back(4 * std::sin(i * PI / rows * 3) * std::cos(j * PI / rows * 4));
+        }
+    }
+
+    for (int i = fullColumns + 1; i < columns + 1; ++i)
+    {
+        for (int j = 0; j < (quadCount - fullColumns * rows + 1); ++j)
+        {
+            vertices.push_back(static_cast<float>(i));
+            vertices.push_back(static_cast<float>(j));
+            vertices.push_back(0);
+        }
+    }
+
+    for (int i = 0; i < fullColumns; ++i)
+    {
+        for (int j = 0; j < rows; ++j)
+        {
+            indices.push_back(j + i * (rows + 1));
+            indices.push_back(j + 1 + i * (rows + 1));
+            indices.push_back(j + (i + 1) * (rows + 1));
+
+            indices.push_back(j + 1 + i * (rows + 1));
+            indices.push_back(j + 1 + (i + 1) * (rows + 1));
+            indices.push_back(j + (i + 1) * (rows + 1));
+        }
+    }
+
+    for (int i = fullColumns; i < columns; ++i)
+    {
+        for (int j = 0; j < (quadCount - fullColumns * rows); ++j)
+        {
+            indices.push_back(j + i * (rows + 1));
+            indices.push_back(j + 1 + i * (rows + 1));
+            indices.push_back(j + (i + 1) * (rows + 1));
+
+            indices.push_back(j + 1 + i * (rows + 1));
+            indices.push_back(j + 1 + (i + 1) * (rows + 1));
+            indices.push_back(j + (i + 1) * (rows + 1));
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void ShuffleTriangles(const unsigned int seed, TestMesh &mesh)
+{
+    const int triangleCount = mesh.GetTriangleCount();
+
+    std::vector<int> order(triangleCount);
+    for (int i = 0; i < triangleCount; ++i)
+    {
+        order[i] = i;
+    }
+
+    std::mt19937 generator(seed);
+    std::shuffle(order.begin(), order.end(), generator);
+
+    std::vector<int> indices(mesh.indices.size());
+    for (int i = 0; i < triangleCount; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            indices[i * 3 + j] = mesh.indices[order[i] * 3 + j];
+        }
+    }
+
+    mesh.indices.swap(indices);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GenerateBumpySphere(const int ringCount, TestMesh &mesh)
+{
+    std::vector<float> &vertices = mesh.vertices;
+    std::vector<int> &indices = mesh.indices;
+
+    vertices.clear();
+    indices.clear();
+
+    const int segmentCount = 2 * ringCount;
+
+    const auto addVertex = [&vertices](const float theta, const float phi) {
+        const float radius = 1 + 0.05f * std::sin(7 * theta) * std::cos(5 * phi);
+        vertices.push_back(radius * std::sin(theta) * std::cos(phi));
+        vertices.push_back(radius * std::cos(theta));
+        vertices.push_back(radius * std::sin(theta) * std::sin(phi));
+    };
+
+    // Vertex 0 is the north pole, then come the rings, then the south pole
+    const auto getVertex = [ringCount, segmentCount](const int ring, const int segment) {
+        if (ring == 0)
+        {
+            return 0;
+        }
+        else if (ring == ringCount)
+        {
+            return 1 + (ringCount - 1) * segmentCount;
+        }
+
+        return 1 + (ring - 1) * segmentCount + segment % segmentCount;
+    };
+
+    addVertex(0, 0);
+    for (int ring = 1; ring < ringCount; ++ring)
+    {
+        for (int segment = 0; segment < segmentCount; ++segment)
+        {
+            addVertex(PI * ring / ringCount, PI * segment / ringCount);
+        }
+    }
+    addVertex(PI, 0);
+
+    for (int ring = 0; ring < ringCount; ++ring)
+    {
+        for (int segment = 0; segment < segmentCount; ++segment)
+        {
+            const int a = getVertex(ring, segment);
+            const int b = getVertex(ring, segment + 1);
+            const int c = getVertex(ring + 1, segment);
+            const int d = getVertex(ring + 1, segment + 1);
+
+            if (ring > 0)
+            {
+                indices.push_back(a);
+                indices.push_back(c);
+                indices.push_back(b);
+            }
+
+            if (ring < ringCount - 1)
+            {
+                indices.push_back(b);
+                indices.push_back(c);
+                indices.push_back(d);
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+MeshEdges GetMeshEdges(const int *indices, const int triangleCount)
+{
+    std::map<std::pair<int, int>, int> useCounts;
+
+    for (int i = 0; i < triangleCount; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            const int a = indices[i * 3 + j];
+            const int b = indices[i * 3 + (j + 1) % 3];
+
+            if (a != b)
+            {
+                ++useCounts[std::make_pair(std::min(a, b), std::max(a, b))];
+            }
+        }
+    }
+
+    MeshEdges edges;
+
+    for (std::map<std::pair<int, int>, int>::const_iterator it = useCounts.begin(),
+        end = useCounts.end();
+        it != end; ++it)
+    {
+        if (it->second == 1)
+        {
+            edges.openEdges.push_back(it->first);
+        }
+    }
+
+    return edges;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+int CountNewOpenEdges(const MeshEdges &edges, const MeshEdges &reference)
+{
+    std::vector<std::pair<int, int>> newOpenEdges;
+
+    std::set_difference(edges.openEdges.begin(), edges.openEdges.end(),
+        reference.openEdges.begin(), reference.openEdges.end(),
+        std::back_inserter(newOpenEdges));
+
+    return static_cast<int>(newOpenEdges.size());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GetLodSelection(const ClusterBuilderOutput &output, const DirectX::XMFLOAT3 &eye,
+    const float projectionScale, const float threshold, std::vector<int> &indices,
+    int &clusterCount)
+{
+    const int candidateCount =
+        threshold > 0 ? static_cast<int>(output.clusters.size()) : output.baseClusterCount;
+
+    clusterCount = 0;
+
+    for (int i = 0; i < candidateCount; ++i)
+    {
+        if (threshold > 0 &&
+            !IsClusterLodSelected(output.clusterLods[i], eye, projectionScale, threshold))
+        {
+            continue;
+        }
+
+        const Cluster &cluster = output.clusters[i];
+
+        indices.insert(indices.end(),
+            output.reorderedIndices.begin() + cluster.firstTriangle * 3,
+            output.reorderedIndices.begin() + (cluster.firstTriangle + cluster.triangleCount) * 3);
+
+        ++clusterCount;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+std::unique_ptr<StaticMesh> CreateStaticMesh(const TestMesh &mesh, const int meshIndex,
+    const ClusterBuilderOptions &options, std::vector<int> *indices)
+{
+    ClusterBuilderInput input;
+    input.indexCount = static_cast<int>(mesh.indices.size());
+    input.vertexCount = mesh.GetVertexCount();
+    input.vertexData = mesh.vertices.data();
+    input.indexData = mesh.indices.data();
+
+    ClusterBuilderOutput output;
+    BuildClusters(options, input, output);
+
+    std::unique_ptr<StaticMesh> staticMesh(
+        new StaticMesh(input.vertexCount, input.indexCount, meshIndex));
+
+    MergeClusterBounds(output.clusters, staticMesh->bounds);
+    staticMesh->boundingSphere = GetBoundingSphere(staticMesh->bounds);
+    PackClusters(output.clusters, staticMesh->clusters, staticMesh->clusterQuantization);
+    BuildClusterBlocks(staticMesh->clusters, staticMesh->clusterBlocks);
+    staticMesh->baseClusterCount = output.baseClusterCount;
+    staticMesh->clusterLods.swap(output.clusterLods);
+
+    if (indices != nullptr)
+    {
+        if (output.reorderedIndices.empty())
+        {
+            *indices = mesh.indices;
+        }
+        else
+        {
+            indices->swap(output.reorderedIndices);
+        }
+    }
+
+    return staticMesh;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+FrameConstantBuffer TestScene::GetFrame(const uint32 cullFlags) const
+{
+    FrameConstantBuffer frame;
+    frame.view = filterContext.view;
+    frame.projection = filterContext.projection;
+    frame.cullFlags = cullFlags;
+    frame.width = filterContext.windowWidth;
+    frame.height = filterContext.windowHeight;
+
+    return frame;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void GenerateTestScene(const int meshCount, const int instanceCount, const unsigned int seed,
+    TestScene &scene)
+{
+    std::mt19937 generator(seed);
+
+    for (int i = 0; i < meshCount; ++i)
+    {
+        TestMesh mesh;
+        GenerateGeometryChunk(300 + static_cast<int>(generator() % 3000), mesh);
+
+        ClusterBuilderOptions options;
+        options.spatialClusters = true;
+        options.maximumVerticesPerCluster = 64;
+
+        std::vector<int> indices;
+        scene.meshes.push_back(CreateStaticMesh(mesh, i, options, &indices));
+
+        MeshConstants constants;
+        constants.vertexCount = mesh.GetVertexCount();
+        constants.faceCount = mesh.GetTriangleCount();
+        constants.indexOffset = static_cast<uint32>(scene.indexData.size() * sizeof(uint32));
+        constants.vertexOffset = static_cast<uint32>(scene.vertexData.size() * sizeof(float));
+        scene.meshConstants.push_back(constants);
+
+        scene.indexData.insert(scene.indexData.end(), indices.begin(), indices.end());
+        scene.vertexData.insert(scene.vertexData.end(), mesh.vertices.begin(),
+            mesh.vertices.end());
+    }
+
+    scene.options.enabledFilters = 0xFFFFFFFF;
+    scene.filterContext = CreateFilterContext(scene.options,
+        XMMatrixLookAtLH(XMVectorSet(0, 0, -5, 1), XMVectorSet(0, 0, 0, 1),
+            XMVectorSet(0, 1, 0, 0)),
+        XMMatrixPerspectiveFovLH(1.0f, 1.6f, 0.1f, 1000.0f), 1920, 1080);
+
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    scene.drawCommands.resize(instanceCount);
+    for (int i = 0; i < instanceCount; ++i)
+    {
+        const int meshIndex = static_cast<int>(generator() % meshCount);
+
+        DrawCommand &drawCommand = scene.drawCommands[i];
+        drawCommand.mesh = scene.meshes[meshIndex].get();
+        drawCommand.drawCallId = i;
+        drawCommand.dcb.meshIndex = meshIndex;
+        drawCommand.dcb.pad[0] = i;
+        drawCommand.dcb.world = XMMatrixScaling(0.05f, 0.05f, 0.05f) *
+            XMMatrixRotationY(3 * distribution(generator)) *
+            XMMatrixTranslation(8 * distribution(generator), 5 * distribution(generator),
+                20 + 19 * distribution(generator));
+    }
+}
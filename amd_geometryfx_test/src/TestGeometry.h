@@ -0,0 +1,146 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#ifndef AMD_GEOMETRYFX_TEST_GEOMETRY_H
+#define AMD_GEOMETRYFX_TEST_GEOMETRY_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <DirectXMath.h>
+
+#include "GeometryFXClusterBuilder.h"
+#include "GeometryFXMesh.h"
+#include "GeometryFXReferenceFilter.h"
+#include "GeometryFXSmallBatchPacking.h"
+
+/**
+Generated meshes shared by the tests and benchmarks. Vertices are float3
+positions, indices are 32 bit.
+*/
+struct TestMesh
+{
+    std::vector<float> vertices;
+    std::vector<int> indices;
+
+    int GetVertexCount() const
+    {
+        return static_cast<int>(vertices.size() / 3);
+    }
+
+    int GetTriangleCount() const
+    {
+        return static_cast<int>(indices.size() / 3);
+    }
+};
+
+/**
+The wavy height field chunk of the sample, with about faceCount triangles.
+*/
+void GenerateGeometryChunk(const int faceCount, TestMesh &mesh);
+
+/**
+Shuffle the triangles of a mesh, so they are no longer ordered spatially.
+*/
+void ShuffleTriangles(const unsigned int seed, TestMesh &mesh);
+
+/**
+A closed sphere of radius 1 with small bumps, built from rings of 2 *
+ringCount quads. The poles are single vertices and there are no seams, so
+every edge is shared by exactly two triangles.
+*/
+void GenerateBumpySphere(const int ringCount, TestMesh &mesh);
+
+struct MeshEdges
+{
+    // Edges used by a single triangle, as pairs of vertex indices with the
+    // smaller index first, sorted
+    std::vector<std::pair<int, int>> openEdges;
+};
+
+/**
+Find the open edges of triangleCount triangles. Edges of degenerate
+triangles between the same vertex are ignored.
+*/
+MeshEdges GetMeshEdges(const int *indices, const int triangleCount);
+
+/**
+Count the open edges in edges which are not open in reference, which are
+holes the selection of a level of detail added.
+*/
+int CountNewOpenEdges(const MeshEdges &edges, const MeshEdges &reference);
+
+/**
+Append the triangles of the clusters selected for eye, in object space, to
+indices. The clusters and levels of detail are those of output, built with
+ClusterBuilderOptions::buildLod. A threshold of 0 selects the full detail
+mesh, as SmallBatchChunkData::AddRequest does. clusterCount is set to the
+number of clusters selected.
+*/
+void GetLodSelection(const AMD::GeometryFX_Internal::ClusterBuilderOutput &output,
+    const DirectX::XMFLOAT3 &eye, const float projectionScale, const float threshold,
+    std::vector<int> &indices, int &clusterCount);
+
+/**
+Build the clusters of mesh and fill in the CPU side of a StaticMesh, as the
+mesh manager does when a mesh is uploaded. If indices is not null, the
+indices are written to it in the order they would be uploaded, which is the
+order the clusters refer to.
+*/
+std::unique_ptr<AMD::GeometryFX_Internal::StaticMesh> CreateStaticMesh(const TestMesh &mesh,
+    const int meshIndex, const AMD::GeometryFX_Internal::ClusterBuilderOptions &options,
+    std::vector<int> *indices);
+
+/**
+Instances of generated height field chunks in front of the eye, uploaded to
+one vertex and one index buffer the way the filter reads them. The
+instances are small and spread out, so some of them are outside of the
+frustum. DrawCallArguments::pad[0] of each draw holds its drawCallId, so
+the draws can be found in the packed chunks.
+*/
+struct TestScene
+{
+    std::vector<std::unique_ptr<AMD::GeometryFX_Internal::StaticMesh>> meshes;
+    std::vector<float> vertexData;
+    std::vector<AMD::uint32> indexData;
+    std::vector<AMD::GeometryFX_Internal::MeshConstants> meshConstants;
+    std::vector<AMD::GeometryFX_Internal::DrawCommand> drawCommands;
+
+    AMD::GeometryFX_FilterRenderOptions options;
+    AMD::GeometryFX_Internal::FilterContext filterContext;
+
+    /**
+    The constants of the filter shaders for filterContext.
+    */
+    AMD::GeometryFX_Internal::FrameConstantBuffer GetFrame(const AMD::uint32 cullFlags) const;
+};
+
+/**
+Fill scene with instanceCount instances of meshCount meshes, which have
+clusters of at most 64 vertices. All filters are enabled in scene.options.
+*/
+void GenerateTestScene(const int meshCount, const int instanceCount, const unsigned int seed,
+    TestScene &scene);
+
+#endif // AMD_GEOMETRYFX_TEST_GEOMETRY_H
@@ -0,0 +1,177 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+
+#include "GeometryFX_Test.h"
+#include "TestGeometry.h"
+
+#include <random>
+
+#include "GeometryFXInstanceCulling.h"
+#include "GeometryFXSmallBatchPacking.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+enum TransformKind
+{
+    TRANSFORM_ROTATION,
+    TRANSFORM_SCALE_BEFORE_ROTATION,
+    TRANSFORM_SCALE_AFTER_ROTATION,
+    TRANSFORM_SHEAR
+};
+
+/**
+A random world matrix of the given kind, placed around the frustum of the
+view in TestInstanceCulling, so many instances are close to its planes.
+*/
+XMMATRIX GetRandomWorld(std::mt19937 &generator, const TransformKind kind)
+{
+    std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+    std::uniform_real_distribution<float> scale(0.2f, 3.0f);
+    std::uniform_real_distribution<float> shear(-1, 1);
+    std::uniform_real_distribution<float> position(-40, 40);
+
+    const XMMATRIX rotation =
+        XMMatrixRotationRollPitchYaw(angle(generator), angle(generator), angle(generator));
+
+    XMMATRIX linear;
+    switch (kind)
+    {
+    case TRANSFORM_ROTATION:
+        {
+            const float s = scale(generator);
+            linear = XMMatrixScaling(s, s, s) * rotation;
+        }
+        break;
+    case TRANSFORM_SCALE_BEFORE_ROTATION:
+        linear = XMMatrixScaling(scale(generator), scale(generator), scale(generator)) * rotation;
+        break;
+    case TRANSFORM_SCALE_AFTER_ROTATION:
+        linear = rotation * XMMatrixScaling(scale(generator), scale(generator), scale(generator));
+        break;
+    default:
+        linear = XMMatrixSet(1, shear(generator), shear(generator), 0,
+                     shear(generator), 1, shear(generator), 0,
+                     shear(generator), shear(generator), 1, 0,
+                     0, 0, 0, 1)
+            * rotation;
+        break;
+    }
+
+    const float z = 20 + position(generator);
+    return linear * XMMatrixTranslation(position(generator), position(generator), z);
+}
+}
+
+/**
+Instances rejected by the bounding sphere before they are recorded must also
+be rejected by the box test of DrawCullResults, or the sphere would hide
+instances the filter draws. Both tests use the frustum only.
+*/
+void TestInstanceCulling()
+{
+    const int INSTANCE_COUNT = 4000;
+
+    TestMesh sphere;
+    GenerateBumpySphere(16, sphere);
+
+    TestMesh chunk;
+    GenerateGeometryChunk(2000, chunk);
+
+    ClusterBuilderOptions builderOptions;
+    std::unique_ptr<StaticMesh> meshes[] = {
+        CreateStaticMesh(sphere, 0, builderOptions, nullptr),
+        CreateStaticMesh(chunk, 1, builderOptions, nullptr)
+    };
+
+    GeometryFX_FilterRenderOptions options;
+    options.enabledFilters = GeometryFX_FilterFrustum;
+
+    const FilterContext filterContext = CreateFilterContext(options,
+        XMMatrixLookAtLH(XMVectorSet(0, 0, 0, 1), XMVectorSet(0, 0, 1, 1),
+            XMVectorSet(0, 1, 0, 0)),
+        XMMatrixPerspectiveFovLH(0.9f, 1.5f, 0.1f, 1000.0f), 1536, 1024);
+
+    const InstanceCuller culler(filterContext.viewProjection, filterContext.eye,
+        filterContext.lodErrorScale, true, 0, 0);
+
+    const struct
+    {
+        TransformKind kind;
+        GEOMETRYFX_WORLD_TRANSFORM transform;
+    } cases[] = {
+        { TRANSFORM_ROTATION, GeometryFX_WorldTransformRigid },
+        { TRANSFORM_SCALE_BEFORE_ROTATION, GeometryFX_WorldTransformRigid },
+        { TRANSFORM_ROTATION, GeometryFX_WorldTransformGeneral },
+        { TRANSFORM_SCALE_BEFORE_ROTATION, GeometryFX_WorldTransformGeneral },
+        { TRANSFORM_SCALE_AFTER_ROTATION, GeometryFX_WorldTransformGeneral },
+        { TRANSFORM_SHEAR, GeometryFX_WorldTransformGeneral }
+    };
+
+    DrawCullResults cullResults;
+    for (const auto &testCase : cases)
+    {
+        std::mt19937 generator(11 + testCase.kind);
+
+        int rejectedCount = 0;
+        int keptCount = 0;
+        int wrongCount = 0;
+
+        for (int i = 0; i < INSTANCE_COUNT; ++i)
+        {
+            StaticMesh *mesh = meshes[i % 2].get();
+
+            DrawCommand drawCommand;
+            drawCommand.mesh = mesh;
+            drawCommand.drawCallId = i;
+            drawCommand.dcb.meshIndex = mesh->meshIndex;
+            drawCommand.dcb.world = GetRandomWorld(generator, testCase.kind);
+            drawCommand.transform = testCase.transform;
+
+            if (culler.Test(drawCommand.dcb.world, testCase.transform, mesh->boundingSphere) ==
+                INSTANCE_CULL_RESULT_VISIBLE)
+            {
+                ++keptCount;
+                continue;
+            }
+
+            ++rejectedCount;
+
+            cullResults.Compute(drawCommand, &filterContext, 1, nullptr);
+            if (cullResults.IsVisible(0))
+            {
+                ++wrongCount;
+            }
+        }
+
+        // Enough instances on both sides for the test to mean something
+        TEST_CHECK(rejectedCount > INSTANCE_COUNT / 10);
+        TEST_CHECK(keptCount > INSTANCE_COUNT / 10);
+        TEST_CHECK(wrongCount == 0);
+    }
+}
@@ -0,0 +1,201 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+
+#include "GeometryFX_Test.h"
+#include "TestGeometry.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+#include "GeometryFXClusterBuilder.h"
+#include "GeometryFXPackedCluster.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+/**
+Check the packed clusters of mesh against the clusters they were made from:
+the dequantized boxes must contain the original ones, and the packed cone
+may only report an eye as backfacing if every triangle of the cluster faces
+away from it, and the original cone agrees.
+*/
+void TestPackedMesh(const TestMesh &mesh, const ClusterConeType coneType,
+    const unsigned int seed)
+{
+    const int EYE_COUNT = 400;
+
+    ClusterBuilderInput input;
+    input.indexCount = static_cast<int>(mesh.indices.size());
+    input.vertexCount = mesh.GetVertexCount();
+    input.vertexData = mesh.vertices.data();
+    input.indexData = mesh.indices.data();
+
+    ClusterBuilderOptions options;
+    options.spatialClusters = true;
+    options.maximumVerticesPerCluster = 64;
+    options.coneType = coneType;
+
+    ClusterBuilderOutput output;
+    BuildClusters(options, input, output);
+
+    const int *indices = output.reorderedIndices.empty() ?
+        mesh.indices.data() : output.reorderedIndices.data();
+
+    std::vector<PackedCluster> packed;
+    ClusterQuantization quantization;
+    PackClusters(output.clusters, packed, quantization);
+
+    TEST_CHECK(packed.size() == output.clusters.size());
+
+    // The boxes only grow
+    int shrunkBoxCount = 0;
+    XMFLOAT3 meshMin(FLT_MAX, FLT_MAX, FLT_MAX), meshMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    for (std::size_t i = 0; i < packed.size(); ++i)
+    {
+        XMFLOAT3 originalMin, originalMax;
+        XMStoreFloat3(&originalMin, output.clusters[i].aabbMin);
+        XMStoreFloat3(&originalMax, output.clusters[i].aabbMax);
+
+        const float *offset = &quantization.offset.x;
+        const float *scale = &quantization.scale.x;
+        const float *minimum = &originalMin.x;
+        const float *maximum = &originalMax.x;
+
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float dequantizedMin = offset[axis] + packed[i].aabbMin[axis] * scale[axis];
+            const float dequantizedMax = offset[axis] + packed[i].aabbMax[axis] * scale[axis];
+
+            shrunkBoxCount += dequantizedMin > minimum[axis] || dequantizedMax < maximum[axis];
+        }
+
+        meshMin = XMFLOAT3(std::min(meshMin.x, originalMin.x), std::min(meshMin.y, originalMin.y),
+            std::min(meshMin.z, originalMin.z));
+        meshMax = XMFLOAT3(std::max(meshMax.x, originalMax.x), std::max(meshMax.y, originalMax.y),
+            std::max(meshMax.z, originalMax.z));
+
+        TEST_CHECK(GetTriangleCount(packed[i]) == output.clusters[i].triangleCount);
+        TEST_CHECK(static_cast<int>(packed[i].firstTriangle) == output.clusters[i].firstTriangle);
+    }
+
+    TEST_CHECK(shrunkBoxCount == 0);
+
+    // Eyes around the mesh, from close to the surface to a few mesh sizes
+    // away. An eye is exactly where the test would cull a cluster.
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+
+    const float center[3] = { (meshMin.x + meshMax.x) / 2, (meshMin.y + meshMax.y) / 2,
+        (meshMin.z + meshMax.z) / 2 };
+    const float extent = std::max(meshMax.x - meshMin.x,
+        std::max(meshMax.y - meshMin.y, meshMax.z - meshMin.z));
+
+    int backfacingCount = 0;
+    int wrongCount = 0;
+    int outsideOriginalConeCount = 0;
+
+    for (int e = 0; e < EYE_COUNT; ++e)
+    {
+        const float distance = extent * std::pow(10.0f, distribution(generator) * 1.5f);
+        const XMVECTOR direction = XMVector3Normalize(XMVectorSet(distribution(generator),
+            distribution(generator), distribution(generator), 0));
+
+        XMFLOAT3 eye;
+        XMStoreFloat3(&eye, XMVectorAdd(XMVectorSet(center[0], center[1], center[2], 1),
+            XMVectorScale(direction, distance)));
+
+        const XMVECTOR eyePosition = XMLoadFloat3(&eye);
+
+        for (std::size_t i = 0; i < packed.size(); ++i)
+        {
+            if (!IsConeBackfacing(packed[i], eye))
+            {
+                continue;
+            }
+
+            ++backfacingCount;
+
+            const Cluster &cluster = output.clusters[i];
+
+            const float originalCosine = XMVectorGetX(XMVector3Dot(XMVector3Normalize(
+                XMVectorSubtract(eyePosition, cluster.coneCenter)), cluster.coneAxis));
+            outsideOriginalConeCount += !cluster.valid || originalCosine <= cluster.coneAngleCosine;
+
+            for (int t = cluster.firstTriangle; t < cluster.firstTriangle + cluster.triangleCount;
+                ++t)
+            {
+                XMFLOAT3 v[3];
+                for (int k = 0; k < 3; ++k)
+                {
+                    const float *vertex = mesh.vertices.data() + indices[t * 3 + k] * 3;
+                    v[k] = XMFLOAT3(vertex[0], vertex[1], vertex[2]);
+                }
+
+                const XMVECTOR v0 = XMLoadFloat3(&v[0]);
+                const XMVECTOR normal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&v[1]), v0),
+                    XMVectorSubtract(XMLoadFloat3(&v[2]), v0));
+                const XMVECTOR toEye = XMVectorSubtract(eyePosition, v0);
+
+                // Facing the eye, beyond the rounding of the dot product
+                const float facing = XMVectorGetX(XMVector3Dot(normal, toEye));
+                const float tolerance = 1e-5f * XMVectorGetX(XMVector3Length(normal)) *
+                    XMVectorGetX(XMVector3Length(toEye));
+
+                wrongCount += facing > tolerance;
+            }
+        }
+    }
+
+    TEST_CHECK(backfacingCount > 0);
+    TEST_CHECK(wrongCount == 0);
+    TEST_CHECK(outsideOriginalConeCount == 0);
+}
+}
+
+/**
+Pack the clusters of a sphere and of the sample's height field, with both
+cone types, and check that packing is conservative.
+*/
+void TestPackedClusters()
+{
+    TestMesh sphere;
+    GenerateBumpySphere(60, sphere);
+
+    TestMesh chunk;
+    GenerateGeometryChunk(4000, chunk);
+
+    const ClusterConeType coneTypes[] = { CLUSTER_CONE_AVERAGE_NORMAL, CLUSTER_CONE_MINIMAL };
+    for (const ClusterConeType coneType : coneTypes)
+    {
+        TestPackedMesh(sphere, coneType, 1);
+        TestPackedMesh(chunk, coneType, 2);
+    }
+}
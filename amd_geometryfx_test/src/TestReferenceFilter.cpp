@@ -0,0 +1,416 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include "GeometryFX_Test.h"
+#include "TestGeometry.h"
+
+#include <array>
+#include <map>
+#include <set>
+
+#include "AMD_GeometryFX_Internal.h"
+#include "GeometryFXReferenceFilter.h"
+#include "GeometryFXSmallBatchPacking.h"
+#include "GeometryFXWorkerPool.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+const uint32 WINDOW_WIDTH = 1920;
+const uint32 WINDOW_HEIGHT = 1080;
+
+const uint32 ALL_TRIANGLE_FILTERS = GeometryFX_FilterDuplicateIndices |
+    GeometryFX_FilterBackface | GeometryFX_FilterFrustum | GeometryFX_FilterSmallPrimitives;
+
+enum TEST_TRIANGLE
+{
+    TEST_TRIANGLE_VISIBLE,
+    TEST_TRIANGLE_BACKFACING,
+    TEST_TRIANGLE_DUPLICATE_INDEX,
+    TEST_TRIANGLE_OUTSIDE,
+    TEST_TRIANGLE_BETWEEN_SAMPLES,
+    TEST_TRIANGLE_COVERING_SAMPLE,
+    TEST_TRIANGLE_BEHIND_EYE,
+    TEST_TRIANGLE_COUNT
+};
+
+/**
+A vertex at pixel x, y of the window, in front of the eye.
+*/
+XMFLOAT3 GetPixelVertex(const float x, const float y)
+{
+    return XMFLOAT3((x / WINDOW_WIDTH - 0.5f) * 2, (y / WINDOW_HEIGHT - 0.5f) * 2, 1);
+}
+
+/**
+One triangle of each TEST_TRIANGLE, in that order. All but the backfacing
+one are front facing. The projection of the test maps z to w, so the
+vertices are at w = 1, except for those behind the eye.
+*/
+void GetTestTriangles(std::vector<XMFLOAT3> &vertices, std::vector<uint32> &indices)
+{
+    const XMFLOAT3 triangleVertices[] =
+    {
+        // Visible, also used by the backfacing and duplicate index triangles
+        XMFLOAT3(-0.5f, -0.5f, 1), XMFLOAT3(-0.5f, 0.5f, 1), XMFLOAT3(0.5f, -0.5f, 1),
+        // Right of the screen
+        XMFLOAT3(2, -0.5f, 1), XMFLOAT3(2, 0.5f, 1), XMFLOAT3(3, -0.5f, 1),
+        // Inside one pixel, but between its sample and the next ones
+        GetPixelVertex(10.6f, 10.6f), GetPixelVertex(10.6f, 10.9f), GetPixelVertex(10.9f, 10.6f),
+        // Inside one pixel, covering its sample
+        GetPixelVertex(10.2f, 10.2f), GetPixelVertex(10.2f, 10.9f), GetPixelVertex(10.9f, 10.2f),
+        // Behind the eye. w < 0 flips the winding, so the order is reversed
+        // to keep the triangle front facing.
+        XMFLOAT3(-0.5f, -0.5f, -1), XMFLOAT3(0.5f, -0.5f, -1), XMFLOAT3(-0.5f, 0.5f, -1)
+    };
+
+    const uint32 triangleIndices[TEST_TRIANGLE_COUNT * 3] =
+    {
+        0, 1, 2,
+        0, 2, 1,
+        0, 0, 1,
+        3, 4, 5,
+        6, 7, 8,
+        9, 10, 11,
+        12, 13, 14
+    };
+
+    vertices.assign(triangleVertices,
+        triangleVertices + sizeof(triangleVertices) / sizeof(triangleVertices[0]));
+    indices.assign(triangleIndices, triangleIndices + TEST_TRIANGLE_COUNT * 3);
+}
+
+/**
+Clip space x, y, w = view space x, y, z, which keeps the test triangles
+where they are on the screen.
+*/
+FrameConstantBuffer GetTestFrame(const uint32 cullFlags)
+{
+    FrameConstantBuffer frame;
+    frame.view = XMMatrixIdentity();
+    frame.projection = XMMatrixSet(
+        1, 0, 0, 0,
+        0, 1, 0, 0,
+        0, 0, 0, 1,
+        0, 0, 0, 0);
+    frame.cullFlags = cullFlags;
+    frame.width = WINDOW_WIDTH;
+    frame.height = WINDOW_HEIGHT;
+
+    return frame;
+}
+
+/**
+The triangles of one draw written by the filter, or an empty list if the
+indirect arguments are not those of the draw.
+*/
+std::vector<uint32> GetDrawIndices(const std::vector<uint32> &filteredIndices,
+    const IndirectArguments &arguments, const uint32 drawIndex,
+    const uint32 firstOutputIndex, const int32 baseVertex)
+{
+    if (arguments.InstanceCount != 1 || arguments.StartInstanceLocation != drawIndex ||
+        arguments.StartIndexLocation != firstOutputIndex ||
+        arguments.BaseVertexLocation != baseVertex)
+    {
+        return std::vector<uint32>();
+    }
+
+    return std::vector<uint32>(filteredIndices.begin() + arguments.StartIndexLocation,
+        filteredIndices.begin() + arguments.StartIndexLocation + arguments.IndexCountPerInstance);
+}
+
+/**
+The indices of the given test triangles.
+*/
+std::vector<uint32> GetTriangleIndices(const std::vector<uint32> &indices,
+    const std::vector<int> &triangles)
+{
+    std::vector<uint32> result;
+    for (std::size_t i = 0; i < triangles.size(); ++i)
+    {
+        result.insert(result.end(), indices.begin() + triangles[i] * 3,
+            indices.begin() + triangles[i] * 3 + 3);
+    }
+
+    return result;
+}
+
+typedef std::map<int, std::set<std::array<uint32, 3>>> DrawTriangles;
+
+/**
+Pack the draws of scene and run each chunk through the reference filter.
+The triangles kept are collected per draw, keyed by DrawCommand::drawCallId.
+Returns the number of triangles going into the filter.
+*/
+int FilterDraws(const TestScene &scene, const uint32 cullFlags, DrawTriangles &drawTriangles,
+    int &mismatchCount)
+{
+    WorkerPool pool(1);
+    SmallBatchPacker packer(SmallBatchMergeConstants::BATCH_SIZE,
+        SmallBatchMergeConstants::BATCH_COUNT);
+    packer.Pack(pool, scene.drawCommands, &scene.filterContext, 1, nullptr);
+
+    std::vector<uint32> filteredIndices;
+    std::vector<IndirectArguments> indirectArguments;
+    int inputTriangleCount = 0;
+
+    for (int i = 0; i < packer.GetChunkCount(0); ++i)
+    {
+        const SmallBatchChunkData &chunk = packer.GetChunk(0, i);
+        FilterSmallBatchChunk(scene.GetFrame(cullFlags), scene.vertexData.data(),
+            scene.indexData.data(), scene.meshConstants.data(), chunk, filteredIndices,
+            indirectArguments);
+
+        inputTriangleCount += chunk.GetFaceCount();
+
+        const std::vector<SmallBatchData> &batches = chunk.GetSmallBatchData();
+        for (int batch = 0; batch < chunk.GetBatchCount(); ++batch)
+        {
+            const SmallBatchData &smallBatch = batches[batch];
+            if (smallBatch.drawBatchStart != static_cast<uint32>(batch))
+            {
+                continue;
+            }
+
+            const IndirectArguments &arguments = indirectArguments[smallBatch.drawIndex];
+            const std::vector<uint32> indices = GetDrawIndices(filteredIndices, arguments,
+                smallBatch.drawIndex, smallBatch.outputIndexOffset / 4,
+                scene.meshConstants[smallBatch.meshIndex].vertexOffset / 12);
+
+            if (indices.size() != arguments.IndexCountPerInstance)
+            {
+                ++mismatchCount;
+                continue;
+            }
+
+            const int drawCallId = chunk.GetDrawCallArguments()[smallBatch.drawIndex].pad[0];
+            for (std::size_t j = 0; j < indices.size(); j += 3)
+            {
+                const std::array<uint32, 3> triangle =
+                    { { indices[j], indices[j + 1], indices[j + 2] } };
+                drawTriangles[drawCallId].insert(triangle);
+            }
+        }
+    }
+
+    return inputTriangleCount;
+}
+}
+
+/**
+Hand-built batches with one triangle for each filter, checked against the
+indirect arguments and indices the filter shaders write.
+*/
+void TestReferenceFilter()
+{
+    std::vector<XMFLOAT3> vertices;
+    std::vector<uint32> meshIndices;
+    GetTestTriangles(vertices, meshIndices);
+
+    const int vertexCount = static_cast<int>(vertices.size());
+    const int indexCount = static_cast<int>(meshIndices.size());
+
+    // The test triangles are uploaded twice, as two meshes
+    std::vector<XMFLOAT3> vertexData(vertices);
+    vertexData.insert(vertexData.end(), vertices.begin(), vertices.end());
+
+    std::vector<uint32> indexData(meshIndices);
+    indexData.insert(indexData.end(), meshIndices.begin(), meshIndices.end());
+
+    MeshConstants meshConstants[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        meshConstants[i].vertexCount = vertexCount;
+        meshConstants[i].faceCount = TEST_TRIANGLE_COUNT;
+        meshConstants[i].indexOffset = i * indexCount * sizeof(uint32);
+        meshConstants[i].vertexOffset = i * vertexCount * sizeof(XMFLOAT3);
+    }
+
+    // Draw 0 draws mesh 0 as it is. Draw 1 mirrors mesh 1, which turns the
+    // front faces into back faces.
+    DrawCallArguments drawCallArguments[2];
+    for (int i = 0; i < 2; ++i)
+    {
+        drawCallArguments[i].world = (i == 0) ? XMMatrixIdentity() : XMMatrixScaling(-1, 1, 1);
+        drawCallArguments[i].worldView = drawCallArguments[i].world;
+        drawCallArguments[i].meshIndex = i;
+    }
+
+    // Draw 0 is split into two batches, which share its output range
+    const int firstBatchTriangleCount = 4;
+    SmallBatchData smallBatches[3];
+
+    smallBatches[0].meshIndex = 0;
+    smallBatches[0].indexOffset = 0;
+    smallBatches[0].faceCount = firstBatchTriangleCount;
+    smallBatches[0].outputIndexOffset = 0;
+    smallBatches[0].drawIndex = 0;
+    smallBatches[0].drawBatchStart = 0;
+
+    smallBatches[1].meshIndex = 0;
+    smallBatches[1].indexOffset = firstBatchTriangleCount * 3 * sizeof(uint32);
+    smallBatches[1].faceCount = TEST_TRIANGLE_COUNT - firstBatchTriangleCount;
+    smallBatches[1].outputIndexOffset = 0;
+    smallBatches[1].drawIndex = 0;
+    smallBatches[1].drawBatchStart = 0;
+
+    smallBatches[2].meshIndex = 1;
+    smallBatches[2].indexOffset = 0;
+    smallBatches[2].faceCount = TEST_TRIANGLE_COUNT;
+    smallBatches[2].outputIndexOffset = TEST_TRIANGLE_COUNT * 3 * sizeof(uint32);
+    smallBatches[2].drawIndex = 1;
+    smallBatches[2].drawBatchStart = 2;
+
+    struct FilterCase
+    {
+        uint32 cullFlags;
+        std::vector<int> keptTriangles;
+        std::vector<int> keptMirroredTriangles;
+    };
+
+    std::vector<FilterCase> filterCases(6);
+
+    filterCases[0].cullFlags = 0;
+    for (int i = 0; i < TEST_TRIANGLE_COUNT; ++i)
+    {
+        filterCases[0].keptTriangles.push_back(i);
+    }
+    filterCases[0].keptMirroredTriangles = filterCases[0].keptTriangles;
+
+    filterCases[1].cullFlags = GeometryFX_FilterDuplicateIndices;
+    for (int i = 0; i < TEST_TRIANGLE_COUNT; ++i)
+    {
+        if (i != TEST_TRIANGLE_DUPLICATE_INDEX)
+        {
+            filterCases[1].keptTriangles.push_back(i);
+        }
+    }
+    filterCases[1].keptMirroredTriangles = filterCases[1].keptTriangles;
+
+    // The triangle with a duplicate index has no area, so it is kept by the
+    // backface test in both orientations
+    filterCases[2].cullFlags = GeometryFX_FilterBackface;
+    for (int i = 0; i < TEST_TRIANGLE_COUNT; ++i)
+    {
+        if (i != TEST_TRIANGLE_BACKFACING)
+        {
+            filterCases[2].keptTriangles.push_back(i);
+        }
+    }
+    filterCases[2].keptMirroredTriangles.push_back(TEST_TRIANGLE_BACKFACING);
+    filterCases[2].keptMirroredTriangles.push_back(TEST_TRIANGLE_DUPLICATE_INDEX);
+
+    // Mirrored, the outside triangle is left of the screen
+    filterCases[3].cullFlags = GeometryFX_FilterFrustum;
+    for (int i = 0; i < TEST_TRIANGLE_COUNT; ++i)
+    {
+        if (i != TEST_TRIANGLE_OUTSIDE && i != TEST_TRIANGLE_BEHIND_EYE)
+        {
+            filterCases[3].keptTriangles.push_back(i);
+        }
+    }
+    filterCases[3].keptMirroredTriangles = filterCases[3].keptTriangles;
+
+    // Mirrored, the triangle between samples still misses them vertically
+    filterCases[4].cullFlags = GeometryFX_FilterSmallPrimitives;
+    for (int i = 0; i < TEST_TRIANGLE_COUNT; ++i)
+    {
+        if (i != TEST_TRIANGLE_BETWEEN_SAMPLES)
+        {
+            filterCases[4].keptTriangles.push_back(i);
+        }
+    }
+    filterCases[4].keptMirroredTriangles = filterCases[4].keptTriangles;
+
+    filterCases[5].cullFlags = ALL_TRIANGLE_FILTERS;
+    filterCases[5].keptTriangles.push_back(TEST_TRIANGLE_VISIBLE);
+    filterCases[5].keptTriangles.push_back(TEST_TRIANGLE_COVERING_SAMPLE);
+    filterCases[5].keptMirroredTriangles.push_back(TEST_TRIANGLE_BACKFACING);
+
+    for (std::size_t i = 0; i < filterCases.size(); ++i)
+    {
+        const FilterCase &filterCase = filterCases[i];
+
+        // One spare draw, which the clear must reset
+        IndirectArguments indirectArguments[3];
+        for (int j = 0; j < 3; ++j)
+        {
+            IndirectArguments::Init(indirectArguments[j]);
+        }
+        indirectArguments[2].IndexCountPerInstance = 123;
+
+        std::vector<uint32> filteredIndices(2 * indexCount, 0xFFFFFFFF);
+
+        FilterSmallBatches(GetTestFrame(filterCase.cullFlags), vertexData.data(),
+            indexData.data(), meshConstants, drawCallArguments, smallBatches, 3,
+            filteredIndices.data(), indirectArguments, 3);
+
+        TEST_CHECK(GetDrawIndices(filteredIndices, indirectArguments[0], 0, 0, 0) ==
+            GetTriangleIndices(meshIndices, filterCase.keptTriangles));
+        TEST_CHECK(GetDrawIndices(filteredIndices, indirectArguments[1], 1, indexCount,
+            vertexCount) == GetTriangleIndices(meshIndices, filterCase.keptMirroredTriangles));
+        TEST_CHECK(indirectArguments[2].IndexCountPerInstance == 0);
+    }
+}
+
+/**
+Generated meshes, packed into chunks and run through the reference filter.
+Without filters, every packed triangle comes out. With all filters, the
+triangles kept by each draw do not depend on how its clusters are merged
+into batches.
+*/
+void TestReferenceFilterChunks()
+{
+    TestScene scene;
+    GenerateTestScene(16, 1000, 5, scene);
+
+    int mismatchCount = 0;
+
+    DrawTriangles unfilteredTriangles;
+    const int inputTriangleCount = FilterDraws(scene, 0, unfilteredTriangles, mismatchCount);
+
+    int outputTriangleCount = 0;
+    for (DrawTriangles::const_iterator it = unfilteredTriangles.begin(),
+        end = unfilteredTriangles.end(); it != end; ++it)
+    {
+        outputTriangleCount += static_cast<int>(it->second.size());
+    }
+
+    TEST_CHECK(inputTriangleCount > 0);
+    TEST_CHECK(outputTriangleCount == inputTriangleCount);
+
+    DrawTriangles filteredTriangles[2];
+    for (int merge = 0; merge < 2; ++merge)
+    {
+        scene.options.mergeClusterBatches = merge != 0;
+        FilterDraws(scene, ALL_TRIANGLE_FILTERS, filteredTriangles[merge], mismatchCount);
+    }
+
+    TEST_CHECK(mismatchCount == 0);
+    TEST_CHECK(!filteredTriangles[0].empty());
+    TEST_CHECK(filteredTriangles[0] == filteredTriangles[1]);
+}
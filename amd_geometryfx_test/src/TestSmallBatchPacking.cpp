@@ -0,0 +1,242 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+
+#include "GeometryFX_Test.h"
+#include "TestGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "AMD_GeometryFX_Internal.h"
+#include "GeometryFXSmallBatchPacking.h"
+#include "GeometryFXWorkerPool.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+/**
+The batches and draw arguments of all chunks of one view, as the bytes
+uploaded to the GPU.
+*/
+void GetPackedBytes(const SmallBatchPacker &packer, const int view,
+    std::vector<unsigned char> &bytes)
+{
+    bytes.clear();
+
+    for (int i = 0; i < packer.GetChunkCount(view); ++i)
+    {
+        const SmallBatchChunkData &chunk = packer.GetChunk(view, i);
+
+        const std::vector<SmallBatchData> &batches = chunk.GetSmallBatchData();
+        const unsigned char *batchBytes = reinterpret_cast<const unsigned char *>(batches.data());
+        bytes.insert(bytes.end(), batchBytes,
+            batchBytes + chunk.GetBatchCount() * sizeof(SmallBatchData));
+
+        const std::vector<DrawCallArguments> &draws = chunk.GetDrawCallArguments();
+        const unsigned char *drawBytes = reinterpret_cast<const unsigned char *>(draws.data());
+        bytes.insert(bytes.end(), drawBytes,
+            drawBytes + chunk.GetDrawCallCount() * sizeof(DrawCallArguments));
+    }
+}
+
+bool IsSameClusterStatistics(const GeometryFX_FilterStatistics &a,
+    const GeometryFX_FilterStatistics &b)
+{
+    return a.clustersProcessed == b.clustersProcessed
+        && a.clustersRendered == b.clustersRendered
+        && a.clustersCulled == b.clustersCulled
+        && a.clustersFrustumCulled == b.clustersFrustumCulled
+        && a.clustersBackfaceCulled == b.clustersBackfaceCulled
+        && a.clustersOcclusionCulled == b.clustersOcclusionCulled
+        && a.instancesCulled == b.instancesCulled;
+}
+}
+
+/**
+The eye moved into object space with the rigid shortcut of
+GetObjectSpaceEye, against the inverse of the world matrix, for random
+rotations, per-axis scales applied before the rotation, and translations.
+*/
+void TestObjectSpaceEye()
+{
+    const int TRANSFORM_COUNT = 10000;
+
+    std::mt19937 generator(17);
+    std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+    std::uniform_real_distribution<float> logScale(-2.3f, 2.3f);
+    std::uniform_real_distribution<float> position(-100, 100);
+
+    int wrongCount = 0;
+    for (int i = 0; i < TRANSFORM_COUNT; ++i)
+    {
+        const XMMATRIX world =
+            XMMatrixScaling(std::exp(logScale(generator)), std::exp(logScale(generator)),
+                std::exp(logScale(generator)))
+            * XMMatrixRotationRollPitchYaw(angle(generator), angle(generator), angle(generator))
+            * XMMatrixTranslation(position(generator), position(generator), position(generator));
+        const XMVECTOR eye =
+            XMVectorSet(position(generator), position(generator), position(generator), 1);
+
+        const XMFLOAT3 rigid = GetObjectSpaceEye(eye, world, GeometryFX_WorldTransformRigid);
+        const XMFLOAT3 general = GetObjectSpaceEye(eye, world, GeometryFX_WorldTransformGeneral);
+
+        XMFLOAT3 expected;
+        XMStoreFloat3(&expected, XMVector4Transform(eye, XMMatrixInverse(nullptr, world)));
+
+        // Relative to the size of the result, which can be up to 10^4 with
+        // the smallest scale
+        const XMVECTOR expectedVector = XMLoadFloat3(&expected);
+        const float tolerance =
+            1e-4f * std::max(1.0f, XMVectorGetX(XMVector3Length(expectedVector)));
+
+        if (XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&rigid),
+                expectedVector))) > tolerance ||
+            XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&general),
+                expectedVector))) > tolerance)
+        {
+            ++wrongCount;
+        }
+    }
+
+    TEST_CHECK(wrongCount == 0);
+}
+
+/**
+Four views packed at once, against each view packed on its own. The shared
+culling work must not change the chunks of any view, so they have to be
+byte-identical. The level of detail is selected from the first view when
+packing several views, so it is disabled here.
+*/
+void TestMultiViewPacking()
+{
+    const int MESH_COUNT = 8;
+    const int INSTANCE_COUNT = 5000;
+    const int VIEW_COUNT = 4;
+
+    std::mt19937 generator(23);
+
+    std::vector<std::unique_ptr<StaticMesh>> meshes;
+    for (int i = 0; i < MESH_COUNT; ++i)
+    {
+        TestMesh mesh;
+        if (i % 2 == 0)
+        {
+            GenerateGeometryChunk(500 + static_cast<int>(generator() % 3000), mesh);
+        }
+        else
+        {
+            GenerateBumpySphere(8 + static_cast<int>(generator() % 16), mesh);
+        }
+
+        ClusterBuilderOptions options;
+        options.spatialClusters = true;
+        meshes.push_back(CreateStaticMesh(mesh, i, options, nullptr));
+    }
+
+    // Instances all around the origin, with rigid and general transforms
+    std::uniform_real_distribution<float> distribution(-1, 1);
+    std::vector<DrawCommand> drawCommands(INSTANCE_COUNT);
+    for (int i = 0; i < INSTANCE_COUNT; ++i)
+    {
+        const int meshIndex = static_cast<int>(generator() % MESH_COUNT);
+
+        DrawCommand &drawCommand = drawCommands[i];
+        drawCommand.mesh = meshes[meshIndex].get();
+        drawCommand.drawCallId = i;
+        drawCommand.dcb.meshIndex = meshIndex;
+        drawCommand.dcb.world = XMMatrixScaling(0.5f, 0.5f, 0.5f) *
+            XMMatrixRotationRollPitchYaw(3 * distribution(generator),
+                3 * distribution(generator), 3 * distribution(generator)) *
+            XMMatrixTranslation(20 * distribution(generator), 10 * distribution(generator),
+                20 * distribution(generator));
+        drawCommand.transform = (i % 2 == 0)
+            ? GeometryFX_WorldTransformRigid
+            : GeometryFX_WorldTransformGeneral;
+    }
+
+    const XMVECTOR eyes[VIEW_COUNT] = {
+        XMVectorSet(0, 0, -30, 1),
+        XMVectorSet(30, 5, 0, 1),
+        XMVectorSet(-4, 25, 3, 1),
+        XMVectorSet(0, 0, 0, 1)
+    };
+    const XMVECTOR targets[VIEW_COUNT] = {
+        XMVectorSet(0, 0, 0, 1),
+        XMVectorSet(0, 0, 0, 1),
+        XMVectorSet(0, 0, 0, 1),
+        XMVectorSet(1, 0, 1, 1)
+    };
+
+    GeometryFX_FilterRenderOptions options;
+    options.enabledFilters = 0xFFFFFFFF;
+
+    WorkerPool pool(2);
+    SmallBatchPacker packer(SmallBatchMergeConstants::BATCH_SIZE,
+        SmallBatchMergeConstants::BATCH_COUNT);
+    SmallBatchPacker singleViewPacker(SmallBatchMergeConstants::BATCH_SIZE,
+        SmallBatchMergeConstants::BATCH_COUNT);
+
+    std::vector<unsigned char> bytes;
+    std::vector<unsigned char> singleViewBytes;
+
+    for (const bool mergeClusterBatches : { false, true })
+    {
+        options.mergeClusterBatches = mergeClusterBatches;
+
+        FilterContext views[VIEW_COUNT];
+        for (int view = 0; view < VIEW_COUNT; ++view)
+        {
+            views[view] = CreateFilterContext(options,
+                XMMatrixLookAtLH(eyes[view], targets[view], XMVectorSet(0, 1, 0, 0)),
+                XMMatrixPerspectiveFovLH(1.0f, 1.6f, 0.1f, 1000.0f), 1920, 1080);
+        }
+
+        GeometryFX_FilterStatistics statistics;
+        packer.Pack(pool, drawCommands, views, VIEW_COUNT, &statistics);
+
+        GeometryFX_FilterStatistics singleViewStatistics;
+        for (int view = 0; view < VIEW_COUNT; ++view)
+        {
+            singleViewPacker.Pack(pool, drawCommands, &views[view], 1, &singleViewStatistics);
+
+            GetPackedBytes(packer, view, bytes);
+            GetPackedBytes(singleViewPacker, 0, singleViewBytes);
+
+            TEST_CHECK(packer.GetChunkCount(view) == singleViewPacker.GetChunkCount(0));
+            TEST_CHECK(!bytes.empty());
+            TEST_CHECK(bytes == singleViewBytes);
+        }
+
+        // Some instances and clusters are culled in every view, and the
+        // counters of all views are added up
+        TEST_CHECK(statistics.instancesCulled > 0);
+        TEST_CHECK(statistics.clustersBackfaceCulled > 0);
+        TEST_CHECK(IsSameClusterStatistics(statistics, singleViewStatistics));
+    }
+}
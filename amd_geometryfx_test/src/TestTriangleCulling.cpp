@@ -0,0 +1,283 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+
+#include "GeometryFX_Test.h"
+#include "TestGeometry.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <set>
+
+#include "AMD_GeometryFX_Internal.h"
+#include "GeometryFXReferenceFilter.h"
+#include "GeometryFXTriangleCulling.h"
+#include "GeometryFXWorkerPool.h"
+
+using namespace AMD;
+using namespace AMD::GeometryFX_Internal;
+using namespace DirectX;
+
+namespace
+{
+typedef std::set<std::array<uint32, 3>> TriangleSet;
+
+TriangleSet GetDrawTriangles(const std::vector<uint32> &filteredIndices,
+    const IndirectArguments &arguments)
+{
+    TriangleSet triangles;
+    for (uint32 i = 0; i < arguments.IndexCountPerInstance; i += 3)
+    {
+        const uint32 *triangle = filteredIndices.data() + arguments.StartIndexLocation + i;
+        const std::array<uint32, 3> indices = { { triangle[0], triangle[1], triangle[2] } };
+        triangles.insert(indices);
+    }
+
+    return triangles;
+}
+
+bool IsSameDraw(const IndirectArguments &a, const IndirectArguments &b)
+{
+    return a.InstanceCount == b.InstanceCount && a.StartIndexLocation == b.StartIndexLocation &&
+        a.BaseVertexLocation == b.BaseVertexLocation &&
+        a.StartInstanceLocation == b.StartInstanceLocation;
+}
+}
+
+/**
+The AVX2 kernel of CullTriangles must make the same decisions as the
+reference kernel, on random triangles with vertices behind the eye, huge
+and NaN coordinates, and random filters and window sizes. If the CPU has no
+AVX2, both run the reference kernel.
+*/
+void TestTriangleCullingKernels()
+{
+    const int RUN_COUNT = 2000;
+
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> distribution(-1, 1);
+
+    int keptTriangleCount = 0;
+    int differentRunCount = 0;
+
+    for (int run = 0; run < RUN_COUNT; ++run)
+    {
+        const int vertexCount = 1 + static_cast<int>(generator() % 300);
+        const int triangleCount = 1 + static_cast<int>(generator() % 300);
+
+        // The vertices span many orders of magnitude, and the eye sits
+        // among them, so some of them are behind it
+        const float scale = std::pow(10.0f, static_cast<float>(generator() % 8) - 4);
+        std::vector<float> vertices(vertexCount * 3);
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+        {
+            vertices[i] = distribution(generator) * scale;
+        }
+
+        if (run % 50 == 0)
+        {
+            vertices[generator() % vertices.size()] = std::numeric_limits<float>::quiet_NaN();
+        }
+
+        if (run % 70 == 0)
+        {
+            vertices[generator() % vertices.size()] = 1e30f;
+        }
+
+        // Some triangles reuse the first index, so they have duplicate ones
+        std::vector<uint32> indices(triangleCount * 3);
+        for (std::size_t i = 0; i < indices.size(); ++i)
+        {
+            indices[i] = (generator() % 7 == 0) ? indices[0] : generator() % vertexCount;
+        }
+
+        TriangleCullingView view;
+        view.worldViewProjection = XMMatrixTranslation(distribution(generator),
+            distribution(generator), 2 * distribution(generator)) *
+            XMMatrixPerspectiveFovLH(1.0f, 1.6f, 0.1f, 1000.0f);
+        view.cullFlags = (run % 5 == 0) ? 0xFFFFFFFF : (generator() & 0x2B);
+        view.windowWidth = 1 + generator() % 4000;
+        view.windowHeight = 1 + generator() % 4000;
+
+        std::vector<uint32> referenceOutput(indices.size());
+        const int referenceCount = CullTriangles(view, vertices.data(), indices.data(),
+            triangleCount, TRIANGLE_CULLING_KERNEL_REFERENCE, referenceOutput.data());
+
+        // The AVX2 kernel culls in place
+        std::vector<uint32> output(indices);
+        const int count = CullTriangles(view, vertices.data(), output.data(), triangleCount,
+            TRIANGLE_CULLING_KERNEL_AVX2, output.data());
+
+        keptTriangleCount += referenceCount;
+
+        if (count != referenceCount || std::memcmp(output.data(), referenceOutput.data(),
+            referenceCount * 3 * sizeof(uint32)) != 0)
+        {
+            ++differentRunCount;
+        }
+    }
+
+    TEST_CHECK(keptTriangleCount > 0);
+    TEST_CHECK(differentRunCount == 0);
+
+    // A triangle with all vertices behind the eye is culled by the frustum
+    // test in either winding, and kept without it
+    const float behindEye[] = { -1, -1, -5, -1, 1, -5, 1, -1, -5 };
+    const uint32 windings[2][3] = { { 0, 1, 2 }, { 0, 2, 1 } };
+
+    TriangleCullingView view;
+    view.worldViewProjection = XMMatrixPerspectiveFovLH(1.0f, 1.6f, 0.1f, 1000.0f);
+    view.windowWidth = 1920;
+    view.windowHeight = 1080;
+
+    for (int kernel = 0; kernel < 2; ++kernel)
+    {
+        for (int winding = 0; winding < 2; ++winding)
+        {
+            uint32 output[3];
+
+            view.cullFlags = GeometryFX_FilterFrustum;
+            TEST_CHECK(CullTriangles(view, behindEye, windings[winding], 1,
+                static_cast<TriangleCullingKernel>(kernel), output) == 0);
+
+            view.cullFlags = 0;
+            TEST_CHECK(CullTriangles(view, behindEye, windings[winding], 1,
+                static_cast<TriangleCullingKernel>(kernel), output) == 1);
+        }
+
+        // Right on the decision boundaries: a collinear triangle has a zero
+        // determinant and is kept by the backface test, and a vertex in the
+        // eye plane (w = 0) is not behind the eye, so a triangle off to the
+        // right is culled by the frustum test
+        const float collinear[] = { -1, 0, 5, 0, 0, 5, 1, 0, 5 };
+        const float eyePlane[] = { 100, 1, 0, 100, 1, 5, 100, 2, 5 };
+        uint32 output[3];
+
+        view.cullFlags = GeometryFX_FilterBackface;
+        TEST_CHECK(CullTriangles(view, collinear, windings[0], 1,
+            static_cast<TriangleCullingKernel>(kernel), output) == 1);
+
+        view.cullFlags = GeometryFX_FilterFrustum;
+        TEST_CHECK(CullTriangles(view, eyePlane, windings[0], 1,
+            static_cast<TriangleCullingKernel>(kernel), output) == 0);
+    }
+}
+
+/**
+CullSmallBatchChunk against the shader reference FilterSmallBatchChunk on
+packed chunks. The draws must be laid out the same way. Without filters,
+the indices must be identical. With all filters, the CPU culler transforms
+with one matrix instead of two, so a few triangles right at a decision
+boundary may differ.
+*/
+void TestCullSmallBatchChunk()
+{
+    TestScene scene;
+    GenerateTestScene(16, 1000, 7, scene);
+
+    WorkerPool pool(2);
+
+    const uint32 cullFlags[] = { 0, 0xFFFFFFFF };
+    for (const uint32 flags : cullFlags)
+    {
+        const FrameConstantBuffer frame = scene.GetFrame(flags);
+
+        for (int merge = 0; merge < 2; ++merge)
+        {
+            scene.options.mergeClusterBatches = merge != 0;
+
+            SmallBatchPacker packer(SmallBatchMergeConstants::BATCH_SIZE,
+                SmallBatchMergeConstants::BATCH_COUNT);
+            packer.Pack(pool, scene.drawCommands, &scene.filterContext, 1, nullptr);
+
+            std::vector<uint32> referenceIndices;
+            std::vector<IndirectArguments> referenceArguments;
+            std::vector<uint32> indices;
+            std::vector<IndirectArguments> arguments;
+
+            int referenceTriangleCount = 0;
+            int differentTriangleCount = 0;
+            int differentDrawCount = 0;
+
+            for (int i = 0; i < packer.GetChunkCount(0); ++i)
+            {
+                const SmallBatchChunkData &chunk = packer.GetChunk(0, i);
+
+                FilterSmallBatchChunk(frame, scene.vertexData.data(), scene.indexData.data(),
+                    scene.meshConstants.data(), chunk, referenceIndices, referenceArguments);
+                CullSmallBatchChunk(pool, frame, scene.vertexData.data(),
+                    scene.indexData.data(), scene.meshConstants.data(), chunk, indices,
+                    arguments);
+
+                for (int draw = 0; draw < chunk.GetDrawCallCount(); ++draw)
+                {
+                    if (!IsSameDraw(referenceArguments[draw], arguments[draw]))
+                    {
+                        ++differentDrawCount;
+                        continue;
+                    }
+
+                    const TriangleSet referenceTriangles =
+                        GetDrawTriangles(referenceIndices, referenceArguments[draw]);
+                    const TriangleSet triangles = GetDrawTriangles(indices, arguments[draw]);
+
+                    referenceTriangleCount += static_cast<int>(referenceTriangles.size());
+
+                    for (TriangleSet::const_iterator it = referenceTriangles.begin(),
+                        end = referenceTriangles.end(); it != end; ++it)
+                    {
+                        differentTriangleCount += triangles.count(*it) == 0;
+                    }
+
+                    for (TriangleSet::const_iterator it = triangles.begin(),
+                        end = triangles.end(); it != end; ++it)
+                    {
+                        differentTriangleCount += referenceTriangles.count(*it) == 0;
+                    }
+
+                    const IndirectArguments &reference = referenceArguments[draw];
+                    if (flags == 0 && (arguments[draw].IndexCountPerInstance !=
+                        reference.IndexCountPerInstance ||
+                        !std::equal(referenceIndices.begin() + reference.StartIndexLocation,
+                            referenceIndices.begin() + reference.StartIndexLocation +
+                            reference.IndexCountPerInstance,
+                            indices.begin() + arguments[draw].StartIndexLocation)))
+                    {
+                        ++differentDrawCount;
+                    }
+                }
+            }
+
+            TEST_CHECK(referenceTriangleCount > 0);
+            TEST_CHECK(differentDrawCount == 0);
+            TEST_CHECK(flags != 0 || differentTriangleCount == 0);
+
+            // One in 1000 triangles
+            TEST_CHECK(differentTriangleCount * 1000 <= referenceTriangleCount);
+        }
+    }
+}